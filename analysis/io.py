@@ -45,6 +45,34 @@ def read_structured_dataset_with_file_attrs(
         return handle[dataset_name][:], attrs
 
 
+def read_group_datasets(
+    hdf5_path: str | Path,
+    group_name: str,
+) -> dict[str, tuple[np.ndarray, dict[str, object]]]:
+    """Read every dataset below one HDF5 group with its attributes.
+
+    Keys are dataset paths relative to `group_name` (for example
+    `creation_delay/primary/n`).
+    """
+
+    path = Path(hdf5_path)
+    if not path.exists():
+        raise FileNotFoundError(f"HDF5 file not found: {path}")
+
+    datasets: dict[str, tuple[np.ndarray, dict[str, object]]] = {}
+    with h5py.File(path, "r") as handle:
+        if group_name not in handle:
+            raise KeyError(f"Group {group_name!r} not found in {path}")
+
+        def collect(name: str, obj: object) -> None:
+            if isinstance(obj, h5py.Dataset):
+                attrs = {str(key): obj.attrs[key] for key in obj.attrs.keys()}
+                datasets[name] = (obj[()], attrs)
+
+        handle[group_name].visititems(collect)
+    return datasets
+
+
 def decode_species(values: np.ndarray) -> np.ndarray:
     """Decode fixed-length HDF5 string arrays into lowercase Python strings."""
 
@@ -106,6 +134,7 @@ def intensifier_input_screen_from_attrs(
 __all__ = [
     "decode_species",
     "intensifier_input_screen_from_attrs",
+    "read_group_datasets",
     "read_structured_dataset",
     "read_structured_dataset_with_file_attrs",
     "require_fields",
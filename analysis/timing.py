@@ -7,7 +7,7 @@ from pathlib import Path
 from typing import Sequence
 
 import numpy as np
-from analysis.io import read_structured_dataset, require_fields
+from analysis.io import read_group_datasets, read_structured_dataset, require_fields
 from analysis.plotting import plot_histogram_1d
 from matplotlib.axes import Axes
 from matplotlib.figure import Figure
@@ -18,6 +18,10 @@ try:
 except ModuleNotFoundError:
     least_squares = None
 
+TIMING_HISTOGRAM_GROUP = "histograms/timing"
+TIMING_HISTOGRAM_QUANTITIES = ("creation_delay", "arrival")
+TIMING_HISTOGRAM_GROUPINGS = ("primary", "secondary")
+
 
 @dataclass(frozen=True)
 class ScintillationDecayComponent:
@@ -115,6 +119,74 @@ def photon_creation_delays_ns(hdf5_path: str | Path) -> np.ndarray:
     return delay_array
 
 
+def stored_timing_histograms(
+    hdf5_path: str | Path,
+    quantity: str = "creation_delay",
+    *,
+    by: str = "primary",
+) -> dict[str, tuple[np.ndarray, np.ndarray]]:
+    """Return simulation-side timing histograms keyed by species label.
+
+    Reads `/histograms/timing/<quantity>/<by>/<species>` written with
+    `/output/timing/bins`. Each value is `(counts, bin_edges_ns)`; photons
+    outside the range are not included in `counts`.
+    """
+
+    if quantity not in TIMING_HISTOGRAM_QUANTITIES:
+        raise ValueError(
+            f"quantity must be one of {TIMING_HISTOGRAM_QUANTITIES}, got {quantity!r}."
+        )
+    if by not in TIMING_HISTOGRAM_GROUPINGS:
+        raise ValueError(f"by must be one of {TIMING_HISTOGRAM_GROUPINGS}, got {by!r}.")
+
+    prefix = f"{quantity}/{by}/"
+    histograms: dict[str, tuple[np.ndarray, np.ndarray]] = {}
+    for name, (counts, attrs) in read_group_datasets(
+        hdf5_path, TIMING_HISTOGRAM_GROUP
+    ).items():
+        if not name.startswith(prefix):
+            continue
+        counts = np.asarray(counts, dtype=float)
+        bin_edges_ns = np.linspace(
+            float(attrs["range_min_ns"]),
+            float(attrs["range_max_ns"]),
+            counts.size + 1,
+        )
+        histograms[name[len(prefix) :]] = (counts, bin_edges_ns)
+    return histograms
+
+
+def stored_photon_creation_delay_histogram(
+    hdf5_path: str | Path,
+    *,
+    by: str = "primary",
+    species: str | Sequence[str] | None = None,
+) -> tuple[np.ndarray, np.ndarray]:
+    """Return stored creation-delay counts summed over the selected species."""
+
+    histograms = stored_timing_histograms(hdf5_path, "creation_delay", by=by)
+    if species is None:
+        selected = sorted(histograms)
+    elif isinstance(species, str):
+        selected = [species]
+    else:
+        selected = list(species)
+    missing = [label for label in selected if label not in histograms]
+    if missing:
+        raise KeyError(
+            f"No stored creation-delay histogram for {by} species {missing}; "
+            f"available: {sorted(histograms)}"
+        )
+    if not selected:
+        raise ValueError("No stored creation-delay histograms found.")
+
+    bin_edges_ns = histograms[selected[0]][1]
+    counts = np.zeros(bin_edges_ns.size - 1, dtype=float)
+    for label in selected:
+        counts += histograms[label][0]
+    return counts, bin_edges_ns
+
+
 def decay_model_bin_counts(
     bin_edges_ns: Sequence[float],
     total_count: float,
@@ -192,14 +264,52 @@ def fit_photon_creation_delay_histogram(
 ) -> PhotonCreationDelayFitResult:
     """Fit a 3-component exponential mixture to the photon-creation histogram."""
 
+    delays_ns = photon_creation_delays_ns(hdf5_path)
+    observed_counts, bin_edges = _histogram_counts(delays_ns, bins=bins)
+    return _fit_delay_counts(
+        observed_counts,
+        bin_edges,
+        initial_components=initial_components,
+    )
+
+
+def fit_stored_photon_creation_delay_histogram(
+    hdf5_path: str | Path,
+    *,
+    by: str = "primary",
+    species: str | Sequence[str] | None = None,
+    initial_components: Sequence[ScintillationDecayComponent] | None = None,
+) -> PhotonCreationDelayFitResult:
+    """Fit the simulation-side creation-delay histogram without `/photons` rows."""
+
+    observed_counts, bin_edges = stored_photon_creation_delay_histogram(
+        hdf5_path,
+        by=by,
+        species=species,
+    )
+    return _fit_delay_counts(
+        observed_counts,
+        bin_edges,
+        initial_components=initial_components,
+    )
+
+
+def _fit_delay_counts(
+    observed_counts: np.ndarray,
+    bin_edges: np.ndarray,
+    *,
+    initial_components: Sequence[ScintillationDecayComponent] | None,
+) -> PhotonCreationDelayFitResult:
+    """Fit a 3-component exponential mixture to binned creation delays."""
+
     if least_squares is None:
         raise ModuleNotFoundError(
             "scipy is required for timing fits. Install project dependencies with "
             "`pixi install`."
         )
 
-    delays_ns = photon_creation_delays_ns(hdf5_path)
-    observed_counts, bin_edges = _histogram_counts(delays_ns, bins=bins)
+    observed_counts = np.asarray(observed_counts, dtype=float)
+    bin_edges = np.asarray(bin_edges, dtype=float)
     total_count = float(np.sum(observed_counts))
     if total_count <= 0.0:
         raise ValueError("Timing histogram is empty; cannot perform fit.")
@@ -326,6 +436,9 @@ __all__ = [
     "PhotonCreationDelayFitResult",
     "decay_model_bin_counts",
     "fit_photon_creation_delay_histogram",
+    "fit_stored_photon_creation_delay_histogram",
     "photon_creation_delays_ns",
     "photon_creation_delay_to_histogram",
+    "stored_photon_creation_delay_histogram",
+    "stored_timing_histograms",
 ]
@@ -0,0 +1,517 @@
+#include "EventAction.hh"
+#include "SimIO.hh"
+
+#include "G4ParticleTable.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_bench`.
+struct CommandLine {
+  bool runMicro = true;
+  bool runMacro = true;
+  /// Worker-thread counts for the macro-level runs.
+  std::vector<int> threads = {1, 4, 16};
+  /// Events per macro-level run.
+  long events = 2000;
+  /// Minimum measured time per microbenchmark.
+  double minSeconds = 0.5;
+  std::string batchPath = G4EMI_BENCH_BATCH;
+  std::string macroPath = G4EMI_REPO_ROOT "/sim/macros/neutron_gps_bench.mac";
+  /// JSON report destination (stdout when empty).
+  std::string outputPath;
+  bool showHelp = false;
+};
+
+struct MicroResult {
+  std::string name;
+  std::int64_t iterations = 0;
+  double nsPerOp = 0.0;
+  /// Rows or records processed per second (0 when not meaningful).
+  double itemsPerSecond = 0.0;
+  double megabytesPerSecond = 0.0;
+};
+
+struct MacroResult {
+  std::string name;
+  int threads = 0;
+  double wallSeconds = 0.0;
+  double runSeconds = 0.0;
+  std::int64_t events = 0;
+  std::int64_t photonsGenerated = 0;
+  std::int64_t photonsDetected = 0;
+  std::int64_t bytesWritten = 0;
+  std::string error;
+};
+
+/// Keeps benchmark results observable so the compiler cannot drop the work.
+volatile std::size_t gSink = 0;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "  --micro-only          Skip the macro-level runs.\n"
+      << "  --macro-only          Skip the microbenchmarks.\n"
+      << "  --threads LIST        Comma-separated macro thread counts (default 1,4,16).\n"
+      << "  --events N            Events per macro run (default 2000).\n"
+      << "  --min-time SECONDS    Minimum time per microbenchmark (default 0.5).\n"
+      << "  --batch PATH          g4emi_batch executable for macro runs.\n"
+      << "  --macro PATH          Macro for macro runs (aliases threads, events, outputPath).\n"
+      << "  -o, --output FILE     Write the JSON report to FILE instead of stdout.\n"
+      << "  -h, --help            Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    const auto value = [&]() { return hasValue ? std::string(argv[++i]) : std::string(); };
+
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+    } else if (arg == "--micro-only") {
+      out->runMacro = false;
+    } else if (arg == "--macro-only") {
+      out->runMicro = false;
+    } else if (arg == "--threads") {
+      out->threads.clear();
+      std::istringstream list(value());
+      for (std::string item; std::getline(list, item, ',');) {
+        const int threads = std::atoi(item.c_str());
+        if (threads <= 0) {
+          *error = arg + " expects positive thread counts";
+          return false;
+        }
+        out->threads.push_back(threads);
+      }
+      if (out->threads.empty()) {
+        *error = arg + " expects a thread count list";
+        return false;
+      }
+    } else if (arg == "--events") {
+      out->events = std::atol(value().c_str());
+      if (out->events <= 0) {
+        *error = arg + " expects a positive event count";
+        return false;
+      }
+    } else if (arg == "--min-time") {
+      out->minSeconds = std::atof(value().c_str());
+      if (out->minSeconds <= 0.0) {
+        *error = arg + " expects a positive number of seconds";
+        return false;
+      }
+    } else if (arg == "--batch" || arg == "--macro" || arg == "-o" || arg == "--output") {
+      if (!hasValue) {
+        *error = arg + " expects a path";
+        return false;
+      }
+      auto& target = arg == "--batch"   ? out->batchPath
+                     : arg == "--macro" ? out->macroPath
+                                        : out->outputPath;
+      target = value();
+    } else {
+      *error = "Unknown option '" + arg + "'";
+      return false;
+    }
+  }
+  if (!out->runMicro && !out->runMacro) {
+    *error = "--micro-only and --macro-only are exclusive";
+    return false;
+  }
+  return true;
+}
+
+// Run `body` (after one warm-up call) in doubling batches until at least
+// `minSeconds` have elapsed. `items` and `bytes` describe one call.
+template <typename Body>
+MicroResult Measure(const std::string& name, double minSeconds, std::int64_t items,
+                    std::int64_t bytes, Body&& body) {
+  body();
+  MicroResult result;
+  result.name = name;
+  std::int64_t batch = 1;
+  double elapsed = 0.0;
+  const auto start = std::chrono::steady_clock::now();
+  while (elapsed < minSeconds) {
+    for (std::int64_t i = 0; i < batch; ++i) {
+      body();
+    }
+    result.iterations += batch;
+    batch *= 2;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  result.nsPerOp = elapsed * 1e9 / static_cast<double>(result.iterations);
+  const double callsPerSecond = static_cast<double>(result.iterations) / elapsed;
+  result.itemsPerSecond = static_cast<double>(items) * callsPerSecond;
+  result.megabytesPerSecond = static_cast<double>(bytes) * callsPerSecond / 1e6;
+  return result;
+}
+
+// Synthetic rows for one event with `photons` detected hits spread over
+// `photons / 32` parent secondaries; values vary so nothing is trivially constant.
+struct EventRows {
+  std::vector<SimIO::PrimaryInfo> primaries;
+  std::vector<SimIO::SecondaryInfo> secondaries;
+  std::vector<SimIO::PhotonInfo> photons;
+};
+
+EventRows MakeEventRows(std::size_t photons, std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  EventRows rows;
+
+  SimIO::PrimaryInfo primary;
+  primary.gunCallId = 0;
+  primary.primaryTrackId = 1;
+  primary.primarySpecies = "n";
+  primary.primaryXmm = 10.0 * unit(*rng);
+  primary.primaryYmm = 10.0 * unit(*rng);
+  primary.primaryEnergyMeV = 6.0;
+  primary.primaryInteractionTimeNs = 3.3 + unit(*rng);
+  primary.primaryCreatedSecondaryCount = static_cast<std::int64_t>(photons / 32 + 1);
+  primary.primaryGeneratedOpticalPhotonCount = static_cast<std::int64_t>(photons * 20);
+  primary.primaryDetectedOpticalInterfacePhotonCount = static_cast<std::int64_t>(photons);
+  rows.primaries.push_back(primary);
+
+  const std::size_t secondaries = photons / 32 + 1;
+  for (std::size_t i = 0; i < secondaries; ++i) {
+    SimIO::SecondaryInfo secondary;
+    secondary.gunCallId = 0;
+    secondary.primaryTrackId = 1;
+    secondary.secondaryTrackId = static_cast<std::int32_t>(i + 2);
+    secondary.secondarySpecies = i % 4 == 0 ? "C12" : "p";
+    secondary.secondaryOriginXmm = 25.0 * unit(*rng);
+    secondary.secondaryOriginYmm = 25.0 * unit(*rng);
+    secondary.secondaryOriginZmm = 5.0 * unit(*rng);
+    secondary.secondaryOriginEnergyMeV = 6.0 * unit(*rng);
+    secondary.secondaryEndXmm = secondary.secondaryOriginXmm + unit(*rng);
+    secondary.secondaryEndYmm = secondary.secondaryOriginYmm + unit(*rng);
+    secondary.secondaryEndZmm = secondary.secondaryOriginZmm + unit(*rng);
+    rows.secondaries.push_back(secondary);
+  }
+
+  rows.photons.reserve(photons);
+  for (std::size_t i = 0; i < photons; ++i) {
+    SimIO::PhotonInfo photon;
+    photon.gunCallId = 0;
+    photon.primaryTrackId = 1;
+    photon.secondaryTrackId = static_cast<std::int32_t>(i % secondaries + 2);
+    photon.photonTrackId = static_cast<std::int32_t>(i + secondaries + 2);
+    photon.photonCreationTimeNs = 3.3 + 10.0 * unit(*rng);
+    photon.photonOriginXmm = 25.0 * unit(*rng);
+    photon.photonOriginYmm = 25.0 * unit(*rng);
+    photon.photonOriginZmm = 5.0 * unit(*rng);
+    photon.photonScintExitXmm = 25.0 * unit(*rng);
+    photon.photonScintExitYmm = 25.0 * unit(*rng);
+    photon.photonScintExitZmm = 5.0;
+    photon.opticalInterfaceHitXmm = 25.0 * unit(*rng);
+    photon.opticalInterfaceHitYmm = 25.0 * unit(*rng);
+    photon.opticalInterfaceHitTimeNs = photon.photonCreationTimeNs + unit(*rng);
+    photon.opticalInterfaceHitDirX = unit(*rng) - 0.5;
+    photon.opticalInterfaceHitDirY = unit(*rng) - 0.5;
+    photon.opticalInterfaceHitDirZ = 0.7;
+    photon.opticalInterfaceHitPolX = unit(*rng) - 0.5;
+    photon.opticalInterfaceHitPolY = unit(*rng) - 0.5;
+    photon.opticalInterfaceHitPolZ = 0.0;
+    photon.opticalInterfaceHitEnergyEV = 2.5 + 0.5 * unit(*rng);
+    photon.opticalInterfaceHitWavelengthNm = 1239.84 / photon.opticalInterfaceHitEnergyEV;
+    rows.photons.push_back(photon);
+  }
+  return rows;
+}
+
+void RunMicrobenchmarks(const CommandLine& options, const std::filesystem::path& workDir,
+                        std::vector<MicroResult>* results) {
+  std::mt19937_64 rng(12345);
+  const double minSeconds = options.minSeconds;
+
+  for (const std::size_t photons : {std::size_t{1}, std::size_t{64}, std::size_t{1024},
+                                    std::size_t{16384}}) {
+    const auto rows = MakeEventRows(photons, &rng);
+    const auto path = (workDir / ("append_" + std::to_string(photons) + ".h5")).string();
+    const auto rowCount = static_cast<std::int64_t>(
+        rows.primaries.size() + rows.secondaries.size() + rows.photons.size());
+    const auto bytes = SimIO::EncodedRowBytes(rows.primaries.size(), rows.secondaries.size(),
+                                              rows.photons.size());
+    std::string error;
+    results->push_back(Measure(
+        "AppendHdf5/photons=" + std::to_string(photons), minSeconds, rowCount, bytes, [&] {
+          if (!SimIO::AppendHdf5(path, rows.primaries, rows.secondaries, rows.photons,
+                                 &error)) {
+            throw std::runtime_error(error);
+          }
+        }));
+    // The writer keeps the file open until the next path; unlinking it now
+    // keeps disk use bounded to one case.
+    std::filesystem::remove(path);
+  }
+
+  const auto rows = MakeEventRows(1024, &rng);
+  const std::vector<SimIO::PrimaryInfo> primaries(1024, rows.primaries.front());
+  results->push_back(Measure("ToNative/primaries", minSeconds, 1024,
+                             SimIO::EncodedRowBytes(1024, 0, 0), [&] {
+                               gSink = gSink + SimIO::detail::ToNative(primaries).size();
+                             }));
+  std::vector<SimIO::SecondaryInfo> secondaries;
+  while (secondaries.size() < 1024) {
+    secondaries.insert(secondaries.end(), rows.secondaries.begin(), rows.secondaries.end());
+  }
+  secondaries.resize(1024);
+  results->push_back(Measure("ToNative/secondaries", minSeconds, 1024,
+                             SimIO::EncodedRowBytes(0, 1024, 0), [&] {
+                               gSink = gSink + SimIO::detail::ToNative(secondaries).size();
+                             }));
+  for (const char* preset : {"full", "transport", "minimal"}) {
+    SimIO::PhotonFieldMask fields = 0;
+    SimIO::ParsePhotonFields(preset, &fields, nullptr);
+    results->push_back(Measure(
+        std::string("PackPhotons/") + preset, minSeconds, 1024,
+        static_cast<std::int64_t>(1024 * SimIO::PhotonRowBytes(fields)), [&] {
+          gSink = gSink + SimIO::detail::PackPhotons(rows.photons, fields).size();
+        }));
+  }
+
+  // EventAction refuses to construct before the particle table is marked ready.
+  G4ParticleTable::GetParticleTable()->SetReadiness();
+  EventAction eventAction(nullptr);
+  constexpr int kTracks = 256;
+  constexpr int kPhotons = 1024;
+
+  results->push_back(Measure("EventAction/TrackInfo", minSeconds, kTracks, 0, [&] {
+    eventAction.BeginOfEventAction(nullptr);
+    EventAction::TrackInfo info;
+    info.species = "p";
+    for (G4int id = 1; id <= kTracks; ++id) {
+      info.primaryTrackID = 1;
+      eventAction.RecordTrackInfo(id, info);
+    }
+    for (G4int id = 1; id <= kTracks; ++id) {
+      gSink = gSink + (eventAction.FindTrackInfo(id) != nullptr);
+    }
+  }));
+
+  results->push_back(Measure("EventAction/PhotonCreationInfo", minSeconds, kPhotons, 0, [&] {
+    eventAction.BeginOfEventAction(nullptr);
+    EventAction::PhotonCreationInfo info;
+    info.primaryTrackID = 1;
+    info.secondarySpecies = "electron";
+    for (G4int id = 1; id <= kPhotons; ++id) {
+      info.secondaryTrackID = 2 + id % 32;
+      eventAction.RecordPhotonCreationInfo(id, info);
+    }
+    for (G4int id = 1; id <= kPhotons; ++id) {
+      gSink = gSink + (eventAction.FindPhotonCreationInfo(id) != nullptr);
+    }
+  }));
+
+  // Only the addresses are used, as map keys; no G4Track is ever dereferenced.
+  std::vector<std::uint64_t> trackKeys(kPhotons);
+  results->push_back(Measure("EventAction/PendingPhotonOrigin", minSeconds, kPhotons, 0, [&] {
+    eventAction.BeginOfEventAction(nullptr);
+    const G4ThreeVector origin(1.0 * mm, 2.0 * mm, 3.0 * mm);
+    for (const auto& key : trackKeys) {
+      eventAction.RecordPendingPhotonOrigin(reinterpret_cast<const G4Track*>(&key), origin);
+    }
+    G4ThreeVector found;
+    for (const auto& key : trackKeys) {
+      gSink = gSink + eventAction.ConsumePendingPhotonOrigin(
+                          reinterpret_cast<const G4Track*>(&key), &found);
+    }
+  }));
+
+  results->push_back(Measure("EventAction/RecordPhotonHit", minSeconds, kPhotons, 0, [&] {
+    eventAction.BeginOfEventAction(nullptr);
+    EventAction::PhotonHitRecord hit;
+    hit.primaryID = 1;
+    hit.secondarySpecies = "electron";
+    for (G4int id = 1; id <= kPhotons; ++id) {
+      hit.secondaryID = 2 + id % 32;
+      hit.photonID = id;
+      eventAction.RecordPhotonHit(hit);
+    }
+  }));
+
+  const auto base = std::string("data/photon_optical_interface_hits");
+  results->push_back(Measure("ComposeOutputPath/outputPath", minSeconds, 1, 0, [&] {
+    gSink = gSink + SimIO::ComposeOutputPath(base, "/scratch/g4emi", "run_1", ".h5").size();
+  }));
+  results->push_back(Measure("ComposeOutputPath/runName", minSeconds, 1, 0, [&] {
+    gSink = gSink + SimIO::ComposeOutputPath(base, "", "run_1", ".h5").size();
+  }));
+}
+
+std::string ShellQuote(const std::string& value) {
+  std::string quoted = "'";
+  for (const char c : value) {
+    quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+  return quoted + "'";
+}
+
+// Read a numeric field from one progress-file JSON line.
+double ReadField(const std::string& line, const std::string& key) {
+  const auto pos = line.find("\"" + key + "\": ");
+  return pos == std::string::npos ? 0.0 : std::atof(line.c_str() + pos + key.size() + 4);
+}
+
+MacroResult RunMacro(const CommandLine& options, const std::filesystem::path& workDir,
+                     int threads) {
+  MacroResult result;
+  result.name = "neutron_gps/threads=" + std::to_string(threads);
+  result.threads = threads;
+
+  const auto runDir = workDir / ("threads_" + std::to_string(threads));
+  std::filesystem::create_directories(runDir / "bench" / "simulatedPhotons");
+  const auto progressPath = runDir / "progress.jsonl";
+  const auto logPath = runDir / "g4emi_batch.log";
+
+  const std::string command =
+      ShellQuote(options.batchPath) + " -c " +
+      ShellQuote("/g4emi/run/progressFile " + progressPath.string()) + " -a threads=" +
+      std::to_string(threads) + " -a events=" + std::to_string(options.events) +
+      " -a " + ShellQuote("outputPath=" + runDir.string()) + " " +
+      ShellQuote(options.macroPath) + " > " + ShellQuote(logPath.string()) + " 2>&1";
+
+  const auto start = std::chrono::steady_clock::now();
+  const int status = std::system(command.c_str());
+  result.wallSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (status != 0) {
+    result.error = "g4emi_batch failed; see " + logPath.string();
+    return result;
+  }
+
+  std::string done;
+  std::ifstream progress(progressPath);
+  for (std::string line; std::getline(progress, line);) {
+    if (line.find("\"state\": \"done\"") != std::string::npos) {
+      done = line;
+    }
+  }
+  if (done.empty()) {
+    result.error = "No final progress snapshot in " + progressPath.string();
+    return result;
+  }
+  result.runSeconds = ReadField(done, "elapsed_s");
+  result.events = static_cast<std::int64_t>(ReadField(done, "events_completed"));
+  result.photonsGenerated = static_cast<std::int64_t>(ReadField(done, "photons_generated"));
+  result.photonsDetected = static_cast<std::int64_t>(ReadField(done, "photons_detected"));
+  result.bytesWritten = static_cast<std::int64_t>(ReadField(done, "bytes_written"));
+  return result;
+}
+
+double PerSecond(double value, double seconds) {
+  return seconds > 0.0 ? value / seconds : 0.0;
+}
+
+std::string FormatReport(const CommandLine& options,
+                         const std::vector<MicroResult>& micro,
+                         const std::vector<MacroResult>& macro) {
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3) << "{\n  \"hardware_threads\": "
+       << std::thread::hardware_concurrency() << ",\n  \"micro\": [";
+  const char* separator = "\n";
+  for (const auto& result : micro) {
+    json << separator << "    {\"name\": \"" << result.name
+         << "\", \"iterations\": " << result.iterations << ", \"ns_per_op\": " << result.nsPerOp
+         << ", \"items_per_s\": " << result.itemsPerSecond
+         << ", \"mb_per_s\": " << result.megabytesPerSecond << "}";
+    separator = ",\n";
+  }
+  json << (micro.empty() ? "" : "\n  ") << "],\n  \"macro\": [";
+  separator = "\n";
+  for (const auto& result : macro) {
+    json << separator << "    {\"name\": \"" << result.name << "\", \"threads\": "
+         << result.threads << ", \"events_requested\": " << options.events
+         << ", \"wall_s\": " << result.wallSeconds;
+    if (!result.error.empty()) {
+      json << ", \"error\": \"" << result.error << "\"}";
+    } else {
+      json << ", \"run_s\": " << result.runSeconds << ", \"events\": " << result.events
+           << ", \"events_per_s\": " << PerSecond(result.events, result.runSeconds)
+           << ", \"photons_per_s\": " << PerSecond(result.photonsDetected, result.runSeconds)
+           << ", \"photons_generated_per_s\": "
+           << PerSecond(result.photonsGenerated, result.runSeconds)
+           << ", \"mb_per_s\": " << PerSecond(result.bytesWritten / 1e6, result.runSeconds)
+           << "}";
+    }
+    separator = ",\n";
+  }
+  json << (macro.empty() ? "" : "\n  ") << "]\n}\n";
+  return json.str();
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string parseError;
+  if (!ParseCommandLine(argc, argv, &options, &parseError)) {
+    std::cerr << parseError << "." << std::endl;
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return EXIT_SUCCESS;
+  }
+
+  const auto workDir = std::filesystem::temp_directory_path() /
+                       ("g4emi_bench_" + std::to_string(getpid()));
+  std::filesystem::create_directories(workDir);
+
+  int exitCode = EXIT_SUCCESS;
+  std::vector<MicroResult> micro;
+  std::vector<MacroResult> macro;
+  try {
+    if (options.runMicro) {
+      RunMicrobenchmarks(options, workDir, &micro);
+    }
+  } catch (const std::exception& error) {
+    std::cerr << "Microbenchmark failed: " << error.what() << std::endl;
+    exitCode = EXIT_FAILURE;
+  }
+  if (options.runMacro) {
+    for (const int threads : options.threads) {
+      macro.push_back(RunMacro(options, workDir, threads));
+      if (!macro.back().error.empty()) {
+        std::cerr << macro.back().error << std::endl;
+        exitCode = EXIT_FAILURE;
+      }
+    }
+  }
+
+  const std::string report = FormatReport(options, micro, macro);
+  if (options.outputPath.empty()) {
+    std::cout << report;
+  } else {
+    std::ofstream out(options.outputPath, std::ios::out | std::ios::trunc);
+    out << report;
+    if (!out) {
+      std::cerr << "Cannot write report to '" << options.outputPath << "'." << std::endl;
+      exitCode = EXIT_FAILURE;
+    }
+  }
+
+  // Keep logs of failed macro runs for inspection.
+  if (exitCode == EXIT_SUCCESS) {
+    std::error_code ignored;
+    std::filesystem::remove_all(workDir, ignored);
+  } else {
+    std::cerr << "Benchmark files kept in " << workDir.string() << "." << std::endl;
+  }
+  return exitCode;
+}
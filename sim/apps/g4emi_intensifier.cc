@@ -0,0 +1,258 @@
+#include "intensifier.hh"
+#include "stagefile.hh"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_intensifier`.
+struct CommandLine {
+  std::string input;
+  std::string output;
+  Intensifier::Params params;
+  std::string intensifierModel;
+  std::uint64_t seed = 0;
+  bool seedGiven = false;
+  /// Keep photons outside the intensifier input screen (`require_in_bounds=False`).
+  bool allRows = false;
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  /// Input rows read and processed per step.
+  std::size_t chunkRows = std::size_t{1} << 20;
+  bool showHelp = false;
+};
+
+constexpr const char* kInputDataset = "transported_photons";
+constexpr const char* kOutputDataset = "intensifier_output_events";
+constexpr hsize_t kOutputChunkRows = 1 << 16;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " --input TRANSPORT.h5 -o INTENSIFIER.h5 [options]\n"
+      << "Runs the photocathode, MCP, and phosphor stages over /transported_photons and\n"
+      << "writes /intensifier_output_events as the Python intensifier stage does, a chunk\n"
+      << "at a time on worker threads. Prints a JSON summary.\n"
+      << "  --input FILE               Transport HDF5 (/transported_photons).\n"
+      << Intensifier::OptionsUsage()
+      << "  --intensifier-model NAME   intensifier_model attribute.\n"
+      << "  --seed N                   Random seed (default: drawn and reported).\n"
+      << "  --all-rows                 Keep photons with in_bounds false.\n"
+      << "  --threads N                Worker threads (default: hardware threads).\n"
+      << "  --chunk-rows N             Input rows per step (default: 1048576).\n"
+      << "  -o, --output FILE          Output path.\n"
+      << "  -h, --help                 Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (arg == "--all-rows") {
+      out->allRows = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (arg == "--input") {
+        out->input = value;
+      } else if (arg == "-o" || arg == "--output") {
+        out->output = value;
+      } else if (arg == "--intensifier-model") {
+        out->intensifierModel = value;
+      } else if (arg == "--seed") {
+        out->seed = std::stoull(value);
+        out->seedGiven = true;
+      } else if (arg == "--threads") {
+        out->threads = std::stoi(value);
+      } else if (arg == "--chunk-rows") {
+        out->chunkRows = static_cast<std::size_t>(std::stoull(value));
+      } else if (!Intensifier::ApplyOption(arg, value, &out->params)) {
+        *error = "Unknown option '" + arg + "'";
+        return false;
+      }
+    } catch (const std::exception&) {
+      *error = "Invalid value '" + value + "' for " + arg;
+      return false;
+    }
+  }
+  if (out->showHelp) {
+    return true;
+  }
+  if (out->input.empty() || out->output.empty()) {
+    *error = "--input and --output are required";
+    return false;
+  }
+  if (!Intensifier::ValidateParams(out->params, error)) {
+    return false;
+  }
+  if (out->threads <= 0 || out->chunkRows == 0) {
+    *error = "--threads and --chunk-rows must be positive";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_intensifier: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  if (!options.seedGiven) {
+    std::random_device device;
+    options.seed = (static_cast<std::uint64_t>(device()) << 32) | device();
+  }
+
+  const hid_t input = H5Fopen(options.input.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  const hid_t photons = input >= 0 ? H5Dopen2(input, kInputDataset, H5P_DEFAULT) : -1;
+  if (photons < 0) {
+    std::cerr << "g4emi_intensifier: cannot open /" << kInputDataset << " in " << options.input
+              << "\n";
+    if (input >= 0) {
+      H5Fclose(input);
+    }
+    return 1;
+  }
+  const hid_t output = H5Fcreate(options.output.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (output < 0) {
+    std::cerr << "g4emi_intensifier: cannot create " << options.output << "\n";
+    H5Dclose(photons);
+    H5Fclose(input);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const hid_t rowType = StageFile::TransportedPhotonType();
+  const hid_t eventType = StageFile::IntensifierEventType();
+  const hid_t events = StageFile::CreateTable(output, kOutputDataset, eventType, kOutputChunkRows);
+  const hsize_t totalRows = StageFile::RowCount(photons);
+  const auto readChunk = [&](hsize_t first, std::vector<Intensifier::Photon>* rows) {
+    rows->resize(std::min<hsize_t>(options.chunkRows, totalRows - first));
+    return StageFile::ReadRows(photons, rowType, first, rows->size(), rows->data());
+  };
+
+  // Workers process one chunk in slices while the main thread reads the
+  // next; slice outputs are written in input order.
+  const std::size_t workers = static_cast<std::size_t>(options.threads);
+  std::vector<Intensifier::Photon> current;
+  std::vector<Intensifier::Photon> next;
+  std::vector<std::vector<Intensifier::OutputEvent>> sliceEvents(workers);
+  std::uint64_t selected = 0;
+  std::uint64_t written = 0;
+  bool ok = events >= 0;
+  if (ok && totalRows > 0 && !readChunk(0, &current)) {
+    ok = false;
+  }
+  for (hsize_t first = 0; ok && first < totalRows; first += options.chunkRows) {
+    const std::size_t count = current.size();
+    const std::size_t sliceRows = (count + workers - 1) / workers;
+    std::vector<std::thread> pool;
+    for (std::size_t w = 0; w < workers; ++w) {
+      const std::size_t begin = std::min(count, w * sliceRows);
+      const std::size_t end = std::min(count, begin + sliceRows);
+      sliceEvents[w].clear();
+      if (begin == end) {
+        continue;
+      }
+      pool.emplace_back([&, w, begin, end] {
+        Intensifier::Process(options.params, options.seed, current.data() + begin, end - begin,
+                             !options.allRows, &sliceEvents[w]);
+      });
+    }
+    const hsize_t nextFirst = first + options.chunkRows;
+    const bool readOk = nextFirst >= totalRows || readChunk(nextFirst, &next);
+    for (auto& thread : pool) {
+      thread.join();
+    }
+    if (options.allRows) {
+      selected += count;
+    } else {
+      for (const auto& photon : current) {
+        selected += photon.inBounds ? 1 : 0;
+      }
+    }
+    for (const auto& slice : sliceEvents) {
+      if (!StageFile::AppendRows(events, eventType, slice.data(), slice.size())) {
+        error = "Failed writing /" + std::string(kOutputDataset) + " to " + options.output;
+        ok = false;
+        break;
+      }
+      written += slice.size();
+    }
+    if (ok && !readOk) {
+      error = std::string("Failed reading /") + kInputDataset + " from " + options.input;
+      ok = false;
+    }
+    current.swap(next);
+  }
+  if (!ok && error.empty()) {
+    error = std::string("Failed reading /") + kInputDataset + " from " + options.input;
+  }
+  if (events >= 0) {
+    H5Dclose(events);
+  }
+  H5Tclose(eventType);
+  H5Tclose(rowType);
+  H5Dclose(photons);
+
+  if (ok) {
+    if (!StageFile::CopyEventTables(input, output)) {
+      error = "Failed copying /primaries and /secondaries from " + options.input;
+      ok = false;
+    }
+    // A Python transport file names its source; an in-process one is its own.
+    const std::string inputPath = StageFile::AbsolutePath(options.input);
+    if (!StageFile::CopyAttribute(input, output, "source_hdf5")) {
+      StageFile::WriteStringAttribute(output, "source_hdf5", inputPath);
+    }
+    StageFile::WriteStringAttribute(output, "transport_hdf5", inputPath);
+    StageFile::CopyAttribute(input, output, "run_id");
+    if (!options.intensifierModel.empty()) {
+      StageFile::WriteStringAttribute(output, "intensifier_model", options.intensifierModel);
+    }
+    StageFile::WriteUint64Attribute(output, "intensifier_seed", options.seed);
+    StageFile::WriteStringAttribute(output, "generated_utc", StageFile::UtcNowIso());
+  }
+  H5Fclose(output);
+  H5Fclose(input);
+  if (!ok) {
+    std::cerr << "g4emi_intensifier: " << error << "\n";
+    return 1;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("{\n  \"input\": \"%s\",\n  \"output\": \"%s\",\n  \"photons\": %llu,\n"
+              "  \"selected_photons\": %llu,\n  \"output_events\": %llu,\n  \"seed\": %llu,\n"
+              "  \"threads\": %d,\n  \"seconds\": %.3f,\n  \"photons_per_second\": %.6g\n}\n",
+              options.input.c_str(), options.output.c_str(),
+              static_cast<unsigned long long>(totalRows),
+              static_cast<unsigned long long>(selected),
+              static_cast<unsigned long long>(written),
+              static_cast<unsigned long long>(options.seed), options.threads, seconds,
+              seconds > 0.0 ? static_cast<double>(totalRows) / seconds : 0.0);
+  return 0;
+}
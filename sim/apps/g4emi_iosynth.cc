@@ -0,0 +1,411 @@
+#include "EventAction.hh"
+#include "SimIO.hh"
+#include "config.hh"
+#include "progress.hh"
+#include "trace.hh"
+
+#include "G4Event.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_iosynth`.
+struct CommandLine {
+  int producers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::int64_t events = 100000;
+  /// Detected photons per event: `lognormal`, `pareto`, or `fixed`.
+  std::string distribution = "lognormal";
+  /// Median (lognormal), minimum (pareto), or value (fixed) of photons per event.
+  double scale = 200.0;
+  /// Sigma (lognormal) or tail index alpha (pareto).
+  double shape = 1.0;
+  std::int64_t maxPhotons = 100000;
+  /// Fraction of events that produce no hits (neutrons passing straight through).
+  double emptyFraction = 0.0;
+  std::uint64_t seed = 12345;
+  /// `/photons` columns, as for `/output/photonFields`.
+  SimIO::PhotonFieldMask photonFields = SimStructures::PhotonField::kAll;
+  /// Output directory as for `/output/path` (temporary and removed when empty).
+  std::string outputPath;
+  std::string progressPath;
+  std::string tracePath;
+  /// JSON report destination (stdout when empty).
+  std::string reportPath;
+  bool showHelp = false;
+};
+
+/// Per-producer photons-per-event samples, merged for the report.
+struct ProducerStats {
+  std::vector<std::int64_t> photonsPerEvent;
+};
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " [options]\n"
+      << "  -p, --producers N        Producer threads (default: hardware threads).\n"
+      << "  -n, --events N           Events to write (default 100000).\n"
+      << "  --distribution NAME      Photons per event: lognormal, pareto, fixed.\n"
+      << "  --scale X                Median (lognormal), minimum (pareto), or value (fixed);\n"
+      << "                           default 200.\n"
+      << "  --shape X                Sigma (lognormal) or tail index (pareto); default 1.\n"
+      << "  --max-photons N          Cap on photons per event (default 100000).\n"
+      << "  --empty-fraction F       Fraction of events without hits (default 0).\n"
+      << "  --seed N                 Base seed; event content depends only on seed and ID.\n"
+      << "  --photon-fields LIST     /photons columns as /output/photonFields (default full).\n"
+      << "  --output-path DIR        Write under DIR like /output/path and keep the file.\n"
+      << "  --progress FILE          Write progress snapshots as /g4emi/run/progressFile.\n"
+      << "  --trace FILE             Write a Chrome trace as /g4emi/profile/traceFile.\n"
+      << "  -o, --output FILE        Write the JSON report to FILE instead of stdout.\n"
+      << "  -h, --help               Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    if (arg == "-p" || arg == "--producers") {
+      out->producers = std::atoi(value.c_str());
+    } else if (arg == "-n" || arg == "--events") {
+      out->events = std::atoll(value.c_str());
+    } else if (arg == "--distribution") {
+      out->distribution = value;
+    } else if (arg == "--scale") {
+      out->scale = std::atof(value.c_str());
+    } else if (arg == "--shape") {
+      out->shape = std::atof(value.c_str());
+    } else if (arg == "--max-photons") {
+      out->maxPhotons = std::atoll(value.c_str());
+    } else if (arg == "--empty-fraction") {
+      out->emptyFraction = std::atof(value.c_str());
+    } else if (arg == "--seed") {
+      out->seed = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--photon-fields") {
+      if (!SimIO::ParsePhotonFields(value, &out->photonFields, error)) {
+        return false;
+      }
+    } else if (arg == "--output-path") {
+      out->outputPath = value;
+    } else if (arg == "--progress") {
+      out->progressPath = value;
+    } else if (arg == "--trace") {
+      out->tracePath = value;
+    } else if (arg == "-o" || arg == "--output") {
+      out->reportPath = value;
+    } else {
+      *error = "Unknown option '" + arg + "'";
+      return false;
+    }
+  }
+
+  if (out->producers <= 0 || out->events <= 0 || out->maxPhotons < 0) {
+    *error = "Producers, events, and max photons must be positive";
+    return false;
+  }
+  if (out->distribution != "lognormal" && out->distribution != "pareto" &&
+      out->distribution != "fixed") {
+    *error = "Unknown distribution '" + out->distribution + "'";
+    return false;
+  }
+  if (out->scale < 0.0 || out->shape <= 0.0 || out->emptyFraction < 0.0 ||
+      out->emptyFraction > 1.0) {
+    *error = "Scale must be non-negative, shape positive, empty fraction in [0, 1]";
+    return false;
+  }
+  return true;
+}
+
+std::int64_t SamplePhotonCount(const CommandLine& options, std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  if (unit(*rng) < options.emptyFraction) {
+    return 0;
+  }
+  double photons = options.scale;
+  if (options.distribution == "lognormal") {
+    photons = std::lognormal_distribution<double>(std::log(std::max(options.scale, 1.0)),
+                                                  options.shape)(*rng);
+  } else if (options.distribution == "pareto") {
+    photons = options.scale / std::pow(1.0 - unit(*rng), 1.0 / options.shape);
+  }
+  // Clamp before rounding: heavy tails reach inf or leave the int64 range.
+  if (!(photons < static_cast<double>(options.maxPhotons))) {
+    return options.maxPhotons;
+  }
+  return static_cast<std::int64_t>(std::llround(photons));
+}
+
+/// Random unit vector in the +Z hemisphere.
+G4ThreeVector ForwardDirection(std::mt19937_64* rng) {
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const double cosTheta = unit(*rng);
+  const double sinTheta = std::sqrt(1.0 - cosTheta * cosTheta);
+  const double phi = twopi * unit(*rng);
+  return G4ThreeVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+}
+
+// Feed one synthetic event through the same EventAction hooks the stepping,
+// tracking, and sensitive-detector code uses. The geometry matches
+// neutron_gps.mac: a 5 x 5 x 1 cm scintillator with the interface on +Z.
+// Content depends only on the seed and event ID, not on the producer count.
+std::int64_t SimulateEvent(const CommandLine& options, G4int eventID,
+                           EventAction* eventAction) {
+  std::mt19937_64 rng(options.seed +
+                      0x9E3779B97F4A7C15ULL * static_cast<std::uint64_t>(eventID + 1));
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  std::exponential_distribution<double> decay(1.0 / 2.1);  // EJ-200 decay time, ns
+
+  G4Event event(eventID);
+  eventAction->BeginOfEventAction(&event);
+
+  const std::int64_t photons = SamplePhotonCount(options, &rng);
+  const double halfX = 25.0 * mm;
+  const double halfY = 25.0 * mm;
+  const double halfZ = 5.0 * mm;
+  const double beamRadius = 10.0 * mm * std::sqrt(unit(rng));
+  const double beamPhi = twopi * unit(rng);
+  const G4ThreeVector primaryOrigin(beamRadius * std::cos(beamPhi),
+                                    beamRadius * std::sin(beamPhi), -100.0 * mm);
+
+  constexpr G4int kPrimaryID = 1;
+  EventAction::TrackInfo primary;
+  primary.species = "n";
+  primary.originPosition = primaryOrigin;
+  primary.originEnergy = 6.0 * MeV;
+  primary.primaryTrackID = kPrimaryID;
+  eventAction->RecordTrackInfo(kPrimaryID, primary);
+  if (photons == 0) {
+    eventAction->EndOfEventAction(&event);
+    return 0;
+  }
+  const double interactionTime = (0.33 + 0.05 * unit(rng)) * ns;
+  eventAction->RecordPrimaryScintillatorFirstInteraction(kPrimaryID, interactionTime);
+
+  // Recoil protons dominate, with some carbon, alpha, and electron secondaries.
+  static const char* const kSpecies[] = {"p", "p", "p", "C12", "alpha", "electron"};
+  const auto secondaries = static_cast<G4int>(1 + photons / 400);
+  std::vector<EventAction::TrackInfo> secondaryInfo(secondaries);
+  for (G4int i = 0; i < secondaries; ++i) {
+    auto& info = secondaryInfo[i];
+    info.species = kSpecies[static_cast<std::size_t>(unit(rng) * 6.0) % 6];
+    info.originPosition = G4ThreeVector(primaryOrigin.x() + 0.5 * mm * gauss(rng),
+                                        primaryOrigin.y() + 0.5 * mm * gauss(rng),
+                                        (2.0 * unit(rng) - 1.0) * halfZ);
+    info.originEnergy = 6.0 * MeV * unit(rng);
+    info.primaryTrackID = kPrimaryID;
+    const G4int trackID = 2 + i;
+    eventAction->RecordTrackInfo(trackID, info);
+    eventAction->RecordPrimarySecondaryCreation(kPrimaryID, false);
+    eventAction->RecordSecondaryScintillatorEndpoint(
+        trackID, info.originPosition + G4ThreeVector(0.0, 0.0, 0.1 * mm * unit(rng)));
+  }
+
+  for (std::int64_t i = 0; i < photons; ++i) {
+    const G4int secondaryIndex = static_cast<G4int>(unit(rng) * secondaries) % secondaries;
+    const auto& secondary = secondaryInfo[secondaryIndex];
+    eventAction->RecordPrimarySecondaryCreation(kPrimaryID, true);
+
+    EventAction::PhotonHitRecord hit;
+    hit.primaryID = kPrimaryID;
+    hit.secondaryID = 2 + secondaryIndex;
+    hit.photonID = static_cast<G4int>(2 + secondaries + i);
+    hit.primarySpecies = "n";
+    hit.primaryX = primaryOrigin.x();
+    hit.primaryY = primaryOrigin.y();
+    hit.secondarySpecies = secondary.species;
+    hit.secondaryOriginPosition = secondary.originPosition;
+    hit.secondaryOriginEnergy = secondary.originEnergy;
+    hit.scintOriginPosition =
+        secondary.originPosition + G4ThreeVector(0.05 * mm * gauss(rng),
+                                                 0.05 * mm * gauss(rng),
+                                                 0.05 * mm * gauss(rng));
+    const auto direction = ForwardDirection(&rng);
+    const double pathLength = (halfZ - hit.scintOriginPosition.z()) / direction.z();
+    hit.photonScintExitPosition =
+        G4ThreeVector(std::clamp(hit.scintOriginPosition.x() + pathLength * direction.x(),
+                                 -halfX, halfX),
+                      std::clamp(hit.scintOriginPosition.y() + pathLength * direction.y(),
+                                 -halfY, halfY),
+                      halfZ);
+    hit.hasPhotonScintExitPosition = unit(rng) < 0.9;
+    hit.opticalInterfaceHitPosition = hit.photonScintExitPosition;
+    hit.photonCreationTime = interactionTime + decay(rng) * ns;
+    hit.opticalInterfaceHitTime =
+        hit.photonCreationTime + std::min(pathLength, 500.0 * mm) * 1.58 / c_light;
+    hit.opticalInterfaceHitDirection = direction;
+    hit.opticalInterfaceHitPolarization = direction.orthogonal().unit();
+    const double wavelengthNm = 425.0 + 15.0 * gauss(rng);
+    hit.opticalInterfaceHitWavelength = wavelengthNm * nm;
+    hit.opticalInterfaceHitEnergy = 1239.841984 / wavelengthNm * eV;
+    eventAction->RecordPhotonHit(hit);
+  }
+
+  eventAction->EndOfEventAction(&event);
+  return photons;
+}
+
+void RunProducer(const CommandLine& options, const Config* config, G4int threadID,
+                 std::atomic<std::int64_t>* nextEvent, ProducerStats* stats) {
+  G4Threading::G4SetThreadId(threadID);
+  Trace::BeginThreadRun(!options.tracePath.empty());
+  {
+    EventAction eventAction(config);
+    for (auto eventID = nextEvent->fetch_add(1); eventID < options.events;
+         eventID = nextEvent->fetch_add(1)) {
+      stats->photonsPerEvent.push_back(
+          SimulateEvent(options, static_cast<G4int>(eventID), &eventAction));
+    }
+  }
+  Trace::EndThreadRun();
+}
+
+double PerSecond(double value, double seconds) {
+  return seconds > 0.0 ? value / seconds : 0.0;
+}
+
+std::int64_t Percentile(const std::vector<std::int64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string parseError;
+  if (!ParseCommandLine(argc, argv, &options, &parseError)) {
+    std::cerr << parseError << "." << std::endl;
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return EXIT_SUCCESS;
+  }
+
+  const bool keepOutput = !options.outputPath.empty();
+  const std::filesystem::path outputDir =
+      keepOutput ? std::filesystem::path(options.outputPath)
+                 : std::filesystem::temp_directory_path() /
+                       ("g4emi_iosynth_" + std::to_string(getpid()));
+  Config config;
+  config.SetOutputPath(outputDir.string());
+  config.SetOutputFilename("iosynth");
+  config.SetPhotonFields(options.photonFields);
+  SimIO::SetPhotonFields(options.photonFields);
+  const std::string hdf5Path = config.GetHdf5FilePath();
+  std::filesystem::create_directories(std::filesystem::path(hdf5Path).parent_path());
+
+  // EventAction refuses to construct before the particle table is marked ready.
+  G4ParticleTable::GetParticleTable()->SetReadiness();
+  Progress::BeginRun(0, options.events, options.progressPath, 1.0);
+
+  std::atomic<std::int64_t> nextEvent{0};
+  std::vector<ProducerStats> stats(options.producers);
+  std::vector<std::thread> producers;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < options.producers; ++i) {
+    producers.emplace_back(RunProducer, std::cref(options), &config, i, &nextEvent,
+                           &stats[i]);
+  }
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  SimIO::Close();
+  const double wallSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Progress::EndRun();
+  const auto totals = Progress::Current();
+
+  int exitCode = EXIT_SUCCESS;
+  if (!options.tracePath.empty()) {
+    std::string error;
+    if (!Trace::WriteRun(options.tracePath, &error)) {
+      std::cerr << error << "." << std::endl;
+      exitCode = EXIT_FAILURE;
+    }
+  }
+
+  std::vector<std::int64_t> photonsPerEvent;
+  for (const auto& producer : stats) {
+    photonsPerEvent.insert(photonsPerEvent.end(), producer.photonsPerEvent.begin(),
+                           producer.photonsPerEvent.end());
+  }
+  std::sort(photonsPerEvent.begin(), photonsPerEvent.end());
+  std::error_code sizeError;
+  const auto fileBytes = std::filesystem::file_size(hdf5Path, sizeError);
+  if (totals.rowsWritten == 0 && !photonsPerEvent.empty() && photonsPerEvent.back() > 0) {
+    std::cerr << "No rows were written to '" << hdf5Path << "'." << std::endl;
+    exitCode = EXIT_FAILURE;
+  }
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3) << "{\n  \"output\": \"" << hdf5Path
+       << "\",\n  \"producers\": " << options.producers
+       << ",\n  \"photon_fields\": \"" << SimIO::DescribePhotonFields(options.photonFields)
+       << "\",\n  \"photon_row_bytes\": " << SimIO::PhotonRowBytes(options.photonFields)
+       << ",\n  \"events\": " << totals.eventsCompleted
+       << ",\n  \"photons_per_event\": {\"p50\": " << Percentile(photonsPerEvent, 0.5)
+       << ", \"p90\": " << Percentile(photonsPerEvent, 0.9)
+       << ", \"p99\": " << Percentile(photonsPerEvent, 0.99)
+       << ", \"max\": " << Percentile(photonsPerEvent, 1.0) << "}"
+       << ",\n  \"rows\": " << totals.rowsWritten << ",\n  \"bytes\": " << totals.bytesWritten
+       << ",\n  \"file_bytes\": " << (sizeError ? 0 : fileBytes)
+       << ",\n  \"wall_s\": " << wallSeconds
+       << ",\n  \"events_per_s\": " << PerSecond(totals.eventsCompleted, wallSeconds)
+       << ",\n  \"rows_per_s\": " << PerSecond(totals.rowsWritten, wallSeconds)
+       << ",\n  \"mb_per_s\": " << PerSecond(totals.bytesWritten / 1e6, wallSeconds)
+       << ",\n  \"output_wait_s\": " << totals.outputWaitSeconds
+       << ",\n  \"output_held_s\": " << totals.outputHeldSeconds
+       << ",\n  \"output_wait_fraction\": "
+       << PerSecond(totals.outputWaitSeconds, options.producers * wallSeconds)
+       << ",\n  \"writer_busy_fraction\": "
+       << PerSecond(totals.outputHeldSeconds, wallSeconds) << "\n}\n";
+  // EventAction's console progress lines also go to stdout; use -o for a
+  // report that is JSON only.
+  if (options.reportPath.empty()) {
+    std::cout << json.str();
+  } else {
+    std::ofstream out(options.reportPath, std::ios::out | std::ios::trunc);
+    out << json.str();
+    if (!out) {
+      std::cerr << "Cannot write report to '" << options.reportPath << "'." << std::endl;
+      exitCode = EXIT_FAILURE;
+    }
+  }
+
+  if (!keepOutput) {
+    std::error_code ignored;
+    std::filesystem::remove_all(outputDir, ignored);
+  }
+  return exitCode;
+}
@@ -0,0 +1,366 @@
+#include "SimIO.hh"
+#include "lenssurrogate.hh"
+#include "lenstrace.hh"
+#include "stagefile.hh"
+#include "structures.hh"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_lenssurrogate`.
+struct CommandLine {
+  /// `fit` or `apply`.
+  std::string command;
+  std::string lens;
+  std::string smx;
+  std::string model;
+  std::string input;
+  std::string output;
+  LensSurrogate::FitOptions fit;
+  /// Domain rays compared against the exact trace after `fit`.
+  std::size_t validateRays = 200000;
+  /// Also trace `apply`'s photons exactly and report the model's error.
+  bool validate = false;
+  double screenDiameterMm = 0.0;
+  double screenCenterXmm = 0.0;
+  double screenCenterYmm = 0.0;
+  bool showHelp = false;
+};
+
+constexpr hsize_t kApplyChunkRows = 1 << 20;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " fit --lens LENS [options] -o MODEL.h5\n"
+      << "       " << program << " apply --model MODEL.h5 --input SIM.h5 -o OUT.h5 [options]\n"
+      << "fit samples LENS with the exact tracer and stores a polynomial surrogate;\n"
+      << "apply fills /transported_photons of OUT.h5 from SIM.h5's /photons with it.\n"
+      << "Both print their statistics as JSON.\n"
+      << "  --lens LENS              .zmx path, lenses/zmxFiles name, catalog ID, or alias.\n"
+      << "  --smx FILE               Glass overrides (default: the lens's .smx).\n"
+      << "  --degree N               Image polynomial degree (default: 4).\n"
+      << "  --mask-degree N          Aperture polynomial degree (default: 3).\n"
+      << "  --grid N                 Sampling points per pupil and field axis (default: 11).\n"
+      << "  --wavelength-min NM      Fitted wavelength range (default: 380).\n"
+      << "  --wavelength-max NM      (default: 700).\n"
+      << "  --validate-rays N        Domain rays compared after fitting (default: 200000).\n"
+      << "  --model FILE             Surrogate model written by fit.\n"
+      << "  --input FILE             g4emi output with /photons.\n"
+      << "  --screen-diameter MM     Intensifier input screen diameter (default: none).\n"
+      << "  --screen-center X,Y      Input screen center in mm (default: 0,0).\n"
+      << "  --validate               Also trace the photons exactly and report the error.\n"
+      << "  -o, --output FILE        Output path.\n"
+      << "  -h, --help               Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  int i = 1;
+  if (argc > 1 && argv[1][0] != '-') {
+    out->command = argv[1];
+    i = 2;
+  }
+  for (; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (arg == "--validate") {
+      out->validate = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (arg == "--lens") {
+        out->lens = value;
+      } else if (arg == "--smx") {
+        out->smx = value;
+      } else if (arg == "--degree") {
+        out->fit.degree = std::stoi(value);
+      } else if (arg == "--mask-degree") {
+        out->fit.maskDegree = std::stoi(value);
+      } else if (arg == "--grid") {
+        out->fit.gridPoints = std::stoi(value);
+      } else if (arg == "--wavelength-min") {
+        out->fit.wavelengthMinNm = std::stod(value);
+      } else if (arg == "--wavelength-max") {
+        out->fit.wavelengthMaxNm = std::stod(value);
+      } else if (arg == "--validate-rays") {
+        out->validateRays = static_cast<std::size_t>(std::stoull(value));
+      } else if (arg == "--model") {
+        out->model = value;
+      } else if (arg == "--input") {
+        out->input = value;
+      } else if (arg == "--screen-diameter") {
+        out->screenDiameterMm = std::stod(value);
+      } else if (arg == "--screen-center") {
+        const auto comma = value.find(',');
+        if (comma == std::string::npos) {
+          *error = "--screen-center expects X,Y";
+          return false;
+        }
+        out->screenCenterXmm = std::stod(value.substr(0, comma));
+        out->screenCenterYmm = std::stod(value.substr(comma + 1));
+      } else if (arg == "-o" || arg == "--output") {
+        out->output = value;
+      } else {
+        *error = "Unknown option '" + arg + "'";
+        return false;
+      }
+    } catch (const std::exception&) {
+      *error = "Invalid value '" + value + "' for " + arg;
+      return false;
+    }
+  }
+  if (out->showHelp) {
+    return true;
+  }
+  if (out->command == "fit") {
+    if (out->lens.empty() || out->output.empty()) {
+      *error = "fit requires --lens and --output";
+      return false;
+    }
+  } else if (out->command == "apply") {
+    if (out->model.empty() || out->input.empty() || out->output.empty()) {
+      *error = "apply requires --model, --input, and --output";
+      return false;
+    }
+  } else {
+    *error = "expected a 'fit' or 'apply' command";
+    return false;
+  }
+  return true;
+}
+
+bool LoadLens(const std::string& name,
+              const std::string& smxOverride,
+              LensTrace::Lens* lens,
+              std::string* error) {
+  const std::string zmx = LensTrace::ResolveZmxPath(name);
+  if (zmx.empty()) {
+    *error = "lens '" + name + "' not found";
+    return false;
+  }
+  const std::string smx = smxOverride.empty() ? LensTrace::ResolveSmxPath(zmx) : smxOverride;
+  return LensTrace::Load(zmx, smx, lens, error);
+}
+
+void PrintStatistics(const char* key, const LensSurrogate::Statistics& stats) {
+  std::printf(
+      "  \"%s\": {\"rays\": %zu, \"exact_transmitted\": %zu, \"model_transmitted\": %zu, "
+      "\"false_pass\": %zu, \"false_block\": %zu, \"rms_error_mm\": %.6g, "
+      "\"p99_error_mm\": %.6g, \"max_error_mm\": %.6g}",
+      key, stats.rays, stats.exactTransmitted, stats.modelTransmitted, stats.falsePass,
+      stats.falseBlock, stats.rmsErrorMm, stats.p99ErrorMm, stats.maxErrorMm);
+}
+
+int RunFit(const CommandLine& options) {
+  std::string error;
+  LensTrace::Lens lens;
+  if (!LoadLens(options.lens, options.smx, &lens, &error)) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    return 1;
+  }
+  LensSurrogate::Model model;
+  const auto start = std::chrono::steady_clock::now();
+  if (!LensSurrogate::Fit(lens, options.fit, &model, &error)) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    return 1;
+  }
+  const double fitSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (options.validateRays > 0) {
+    model.validation = LensSurrogate::Compare(
+        lens, model, LensSurrogate::SampleDomain(model, options.validateRays, 1));
+  }
+  if (!LensSurrogate::Save(options.output, model, &error)) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    return 1;
+  }
+
+  std::printf("{\n  \"lens\": \"%s\",\n  \"model\": \"%s\",\n  \"degree\": %d,\n"
+              "  \"mask_degree\": %d,\n  \"terms\": %zu,\n  \"apertures\": %zu,\n"
+              "  \"pupil_radius_mm\": %.6g,\n  \"max_slope\": %.6g,\n  \"fit_seconds\": %.3f,\n",
+              model.lensName.c_str(), options.output.c_str(), model.degree, model.maskDegree,
+              model.Terms(), model.apertureSurfaces.size(), model.pupilRadiusMm, model.maxSlope,
+              fitSeconds);
+  PrintStatistics("validation", model.validation);
+  std::printf("\n}\n");
+  return 0;
+}
+
+int RunApply(const CommandLine& options) {
+  std::string error;
+  LensSurrogate::Model model;
+  if (!LensSurrogate::Load(options.model, &model, &error)) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    return 1;
+  }
+  LensTrace::Lens lens;
+  if (options.validate && !LensTrace::Load(model.zmxPath, model.smxPath, &lens, &error)) {
+    std::cerr << "g4emi_lenssurrogate: --validate: " << error << "\n";
+    return 1;
+  }
+
+  const hid_t file = H5Fopen(options.input.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  const hid_t dataset = file >= 0 ? H5Dopen2(file, "photons", H5P_DEFAULT) : -1;
+  if (dataset < 0) {
+    std::cerr << "g4emi_lenssurrogate: cannot open /photons in " << options.input << "\n";
+    if (file >= 0) {
+      H5Fclose(file);
+    }
+    return 1;
+  }
+  const hid_t fileType = H5Dget_type(dataset);
+  const hid_t readType = StageFile::InterfaceHitType(fileType, &error);
+  H5Tclose(fileType);
+  const hsize_t totalRows = StageFile::RowCount(dataset);
+
+  const double radius = 0.5 * options.screenDiameterMm;
+  std::vector<StageFile::InterfaceHit> photons;
+  std::vector<SimIO::TransportedPhotonInfo> rows;
+  LensTrace::RayBatch batch;
+  // Exact-trace comparison accumulated over chunks, weighted by ray count.
+  LensSurrogate::Statistics validation;
+  double squaredErrorSum = 0.0;
+  std::size_t transported = 0;
+  double evaluateSeconds = 0.0;
+  bool ok = readType >= 0;
+  for (hsize_t first = 0; ok && first < totalRows; first += kApplyChunkRows) {
+    const hsize_t count = std::min(kApplyChunkRows, totalRows - first);
+    photons.assign(count, StageFile::InterfaceHit{});
+    ok = StageFile::ReadRows(dataset, readType, first, count, photons.data());
+    if (!ok) {
+      error = "Failed reading /photons from " + options.input;
+      break;
+    }
+
+    batch.Resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      batch.x[i] = photons[i].x;
+      batch.y[i] = photons[i].y;
+      batch.dx[i] = photons[i].dx;
+      batch.dy[i] = photons[i].dy;
+      batch.dz[i] = photons[i].dz;
+      batch.wavelengthNm[i] = photons[i].wavelengthNm;
+    }
+    if (options.validate) {
+      const auto stats = LensSurrogate::Compare(lens, model, batch);
+      validation.rays += stats.rays;
+      validation.exactTransmitted += stats.exactTransmitted;
+      validation.modelTransmitted += stats.modelTransmitted;
+      validation.falsePass += stats.falsePass;
+      validation.falseBlock += stats.falseBlock;
+      const std::size_t both = stats.modelTransmitted - stats.falsePass;
+      squaredErrorSum += stats.rmsErrorMm * stats.rmsErrorMm * static_cast<double>(both);
+      validation.p99ErrorMm = std::max(validation.p99ErrorMm, stats.p99ErrorMm);
+      validation.maxErrorMm = std::max(validation.maxErrorMm, stats.maxErrorMm);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    LensSurrogate::Evaluate(model, &batch);
+    evaluateSeconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    rows.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!batch.valid[i]) {
+        continue;
+      }
+      const auto& photon = photons[i];
+      SimIO::TransportedPhotonInfo row;
+      row.sourcePhotonIndex = static_cast<std::int64_t>(first + i);
+      row.gunCallId = photon.gunCallId;
+      row.primaryTrackId = photon.primaryTrackId;
+      row.secondaryTrackId = photon.secondaryTrackId;
+      row.photonTrackId = photon.photonTrackId;
+      row.intensifierHitXmm = batch.x[i];
+      row.intensifierHitYmm = batch.y[i];
+      row.intensifierHitZmm = batch.z[i];
+      row.intensifierHitTimeNs = photon.timeNs;
+      if (photon.wavelengthNm > 0.0) {
+        row.intensifierHitWavelengthNm = photon.wavelengthNm;
+      }
+      if (radius > 0.0) {
+        row.inBounds = std::hypot(batch.x[i] - options.screenCenterXmm,
+                                  batch.y[i] - options.screenCenterYmm) <= radius;
+      }
+      rows.push_back(row);
+    }
+    transported += rows.size();
+    ok = SimIO::AppendTransported(options.output, rows, 0, &error);
+  }
+  if (readType >= 0) {
+    H5Tclose(readType);
+  }
+  H5Dclose(dataset);
+  H5Fclose(file);
+
+  if (ok) {
+    SimIO::TransportAttributes attributes;
+    attributes.lensName = model.lensName;
+    attributes.zmxPath = model.zmxPath;
+    attributes.smxPath = model.smxPath;
+    attributes.engine = "g4emi-surrogate";
+    attributes.surrogatePath = options.model;
+    attributes.screenDefined = radius > 0.0;
+    attributes.screenDiameterMm = options.screenDiameterMm;
+    attributes.screenCenterXmm = options.screenCenterXmm;
+    attributes.screenCenterYmm = options.screenCenterYmm;
+    ok = SimIO::WriteTransportAttributes(options.output, attributes, &error);
+  }
+  SimIO::Close();
+  if (ok) {
+    ok = StageFile::FinishTransportFile(options.input, options.output, &error);
+  }
+  if (!ok) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    return 1;
+  }
+
+  std::printf("{\n  \"input\": \"%s\",\n  \"output\": \"%s\",\n  \"photons\": %llu,\n"
+              "  \"transported\": %zu,\n  \"evaluate_seconds\": %.6f,\n"
+              "  \"photons_per_second\": %.6g",
+              options.input.c_str(), options.output.c_str(),
+              static_cast<unsigned long long>(totalRows), transported, evaluateSeconds,
+              evaluateSeconds > 0.0 ? static_cast<double>(totalRows) / evaluateSeconds : 0.0);
+  if (options.validate) {
+    const std::size_t both = validation.modelTransmitted - validation.falsePass;
+    validation.rmsErrorMm = both > 0 ? std::sqrt(squaredErrorSum / static_cast<double>(both))
+                                     : 0.0;
+    std::printf(",\n");
+    // p99 is the worst chunk's; exact over the run when it fits one chunk.
+    PrintStatistics("validation", validation);
+  }
+  std::printf("\n}\n");
+  return 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_lenssurrogate: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  return options.command == "fit" ? RunFit(options) : RunApply(options);
+}
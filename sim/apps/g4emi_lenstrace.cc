@@ -0,0 +1,106 @@
+#include "lenstrace.hh"
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+/// Parsed command-line options for `g4emi_lenstrace`.
+struct CommandLine {
+  std::string lens;
+  /// Glass overrides; empty infers the `.smx` from the lens file.
+  std::string smx;
+  bool showHelp = false;
+};
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " --lens LENS [--smx FILE] < rays.txt\n"
+      << "Traces rays through LENS with the in-process transport tracer. Each input\n"
+      << "line holds 'x_mm y_mm dir_x dir_y dir_z wavelength_nm' at the lens entrance\n"
+      << "plane; each output line holds 'valid x_mm y_mm z_mm' at the image surface.\n"
+      << "  --lens LENS              .zmx path, lenses/zmxFiles name, or alias.\n"
+      << "  --smx FILE               Glass overrides (default: the lens's .smx).\n"
+      << "  -h, --help               Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    if (arg == "--lens") {
+      out->lens = value;
+    } else if (arg == "--smx") {
+      out->smx = value;
+    } else {
+      *error = "Unknown option '" + arg + "'";
+      return false;
+    }
+  }
+  if (!out->showHelp && out->lens.empty()) {
+    *error = "--lens is required";
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_lenstrace: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+
+  const std::string zmx = LensTrace::ResolveZmxPath(options.lens);
+  if (zmx.empty()) {
+    std::cerr << "g4emi_lenstrace: lens '" << options.lens << "' not found\n";
+    return 1;
+  }
+  LensTrace::Lens lens;
+  const std::string smx = options.smx.empty() ? LensTrace::ResolveSmxPath(zmx) : options.smx;
+  if (!LensTrace::Load(zmx, smx, &lens, &error)) {
+    std::cerr << "g4emi_lenstrace: " << error << "\n";
+    return 1;
+  }
+
+  LensTrace::RayBatch batch;
+  for (std::string line; std::getline(std::cin, line);) {
+    std::istringstream stream(line);
+    double values[6];
+    if (!(stream >> values[0] >> values[1] >> values[2] >> values[3] >> values[4] >>
+          values[5])) {
+      continue;
+    }
+    const std::size_t i = batch.Size();
+    batch.Resize(i + 1);
+    batch.x[i] = values[0];
+    batch.y[i] = values[1];
+    batch.dx[i] = values[2];
+    batch.dy[i] = values[3];
+    batch.dz[i] = values[4];
+    batch.wavelengthNm[i] = values[5];
+  }
+  LensTrace::Trace(lens, &batch);
+
+  for (std::size_t i = 0; i < batch.Size(); ++i) {
+    std::printf("%d %.17g %.17g %.17g\n", batch.valid[i] ? 1 : 0, batch.x[i], batch.y[i],
+                batch.z[i]);
+  }
+  return 0;
+}
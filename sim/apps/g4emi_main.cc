@@ -1,45 +1,311 @@
 #include "ActionInitialization.hh"
 #include "DetectorConstruction.hh"
+#include "PhysicsList.hh"
+#include "StackingAction.hh"
+#include "WorkerInitialization.hh"
 #include "config.hh"
 #include "messenger.hh"
 #include "seed.hh"
 
-#include "FTFP_BERT_HP.hh"
 #include "G4OpticalParameters.hh"
-#include "G4OpticalPhysics.hh"
 #include "G4RunManagerFactory.hh"
-#include "G4UIExecutive.hh"
 #include "G4UImanager.hh"
-#include "G4VisExecutive.hh"
 #include "G4ios.hh"
 
+#ifdef G4EMI_WITH_VIS
+#include "G4UIExecutive.hh"
+#include "G4VisExecutive.hh"
+#endif
+
+#include <sys/resource.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+/// Parsed command-line options shared by `g4emi` and `g4emi_batch`.
+struct CommandLine {
+  /// Macro executed after override commands (required for `g4emi_batch`).
+  std::string macroPath;
+  /// UI commands applied, in order, before the macro runs.
+  std::vector<std::string> preCommands;
+  /// Events for an extra `/run/beamOn` after the macro (negative disables).
+  G4long beamOnEvents = -1;
+  /// Run-manager backend from `-b`; overrides `/g4emi/run/taskingBackend`.
+  std::string backend;
+  bool showHelp = false;
+};
+
+void PrintUsage(const char* program) {
+  G4cout << "Usage: " << program << " [options] "
+#ifdef G4EMI_WITH_VIS
+         << "[macro]"
+#else
+         << "<macro>"
+#endif
+         << G4endl
+         << "  -c, --command \"<cmd>\"   Apply a UI command before the macro (repeatable)."
+         << G4endl
+         << "  -a, --alias name=value  Define a macro alias {name} before the macro (repeatable)."
+         << G4endl
+         << "  -n, --events N          Run /run/beamOn N after the macro." << G4endl
+         << "  -b, --backend NAME      Run-manager backend (see /g4emi/run/taskingBackend)."
+         << G4endl
+         << "  -h, --help              Show this message." << G4endl
+         << "Run progress: -c '/g4emi/run/progressFile <path>' writes JSON-lines snapshots."
+         << G4endl;
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (arg == "-c" || arg == "--command") {
+      if (!hasValue) {
+        *error = arg + " expects a UI command";
+        return false;
+      }
+      out->preCommands.emplace_back(argv[++i]);
+      continue;
+    }
+    if (arg == "-a" || arg == "--alias") {
+      const std::string value = hasValue ? argv[++i] : "";
+      const auto separator = value.find('=');
+      if (separator == std::string::npos || separator == 0) {
+        *error = arg + " expects name=value";
+        return false;
+      }
+      out->preCommands.push_back("/control/alias " + value.substr(0, separator) + " " +
+                                 value.substr(separator + 1));
+      continue;
+    }
+    if (arg == "-n" || arg == "--events") {
+      // BeamOn takes a G4int; reject empty, overflowing, and larger values.
+      const char* text = hasValue ? argv[++i] : "";
+      char* end = nullptr;
+      errno = 0;
+      const long events = std::strtol(text, &end, 10);
+      if (end == text || *end != '\0' || errno == ERANGE || events < 0 ||
+          events > std::numeric_limits<G4int>::max()) {
+        *error = arg + " expects an event count from 0 to " +
+                 std::to_string(std::numeric_limits<G4int>::max());
+        return false;
+      }
+      out->beamOnEvents = events;
+      continue;
+    }
+    if (arg == "-b" || arg == "--backend") {
+      if (!hasValue) {
+        *error = arg + " expects a backend name";
+        return false;
+      }
+      out->backend = argv[++i];
+      continue;
+    }
+    if (!arg.empty() && arg[0] == '-') {
+      *error = "Unknown option '" + arg + "'";
+      return false;
+    }
+    if (!out->macroPath.empty()) {
+      *error = "Only one macro may be given";
+      return false;
+    }
+    out->macroPath = arg;
+  }
+
+#ifndef G4EMI_WITH_VIS
+  if (out->macroPath.empty() && !out->showHelp) {
+    *error = "A macro is required in batch mode";
+    return false;
+  }
+#endif
+  return true;
+}
+
+// Find the last value of a startup-only command (for example
+// `/g4emi/run/taskingBackend`) in override commands or the top-level macro.
+// The run manager must exist before any command runs, so such values are read
+// ahead of time; aliases from `-a` are expanded, nested `/control/execute`
+// macros are not followed.
+std::string ScanStartupCommand(const CommandLine& options, const std::string& command) {
+  static const std::string kAliasCommand = "/control/alias";
+
+  std::vector<std::pair<std::string, std::string>> aliases;
+  std::string result;
+  const auto scanLine = [&](const std::string& line) {
+    std::istringstream tokens(line);
+    std::string name;
+    std::string value;
+    tokens >> name >> value;
+    if (name == kAliasCommand) {
+      std::string aliasValue;
+      std::getline(tokens >> std::ws, aliasValue);
+      aliases.emplace_back("{" + value + "}", aliasValue);
+    } else if (name == command && !value.empty()) {
+      for (const auto& [key, replacement] : aliases) {
+        for (auto pos = value.find(key); pos != std::string::npos; pos = value.find(key)) {
+          value.replace(pos, key.size(), replacement);
+        }
+      }
+      result = value;
+    }
+  };
+
+  for (const auto& command : options.preCommands) {
+    scanLine(command);
+  }
+  if (!options.macroPath.empty()) {
+    std::ifstream macro(options.macroPath);
+    for (std::string line; std::getline(macro, line);) {
+      scanLine(line);
+    }
+  }
+  return result;
+}
+
+// Map a backend name onto a run-manager type. Explicit names use the
+// `*Only` variants so G4RUN_MANAGER_TYPE cannot silently override them.
+bool ToRunManagerType(const std::string& backend, G4RunManagerType* out) {
+  if (backend == "default") {
+    *out = G4RunManagerType::Default;
+  } else if (backend == "tasking") {
+    *out = G4RunManagerType::TaskingOnly;
+  } else if (backend == "tbb") {
+    *out = G4RunManagerType::TBBOnly;
+  } else if (backend == "mt") {
+    *out = G4RunManagerType::MTOnly;
+  } else if (backend == "serial") {
+    *out = G4RunManagerType::SerialOnly;
+#ifdef G4EMI_WITH_SUBEVENT
+  } else if (backend == "subevent") {
+    *out = G4RunManagerType::SubEvtOnly;
+#endif
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Peak resident set size of this process in MiB.
+double PeakResidentSetMiB() {
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0.0;
+  }
+#ifdef __APPLE__
+  return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#else
+  return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#endif
+}
+
+std::string FormatSeconds(std::chrono::steady_clock::duration duration) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3)
+      << std::chrono::duration<double>(duration).count() << " s";
+  return out.str();
+}
+}  // namespace
 
 int main(int argc, char** argv) {
-  Seed::SetAutoMasterSeeds();
+  const auto processStart = std::chrono::steady_clock::now();
+
+  CommandLine options;
+  std::string parseError;
+  if (!ParseCommandLine(argc, argv, &options, &parseError)) {
+    G4cerr << parseError << "." << G4endl;
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return EXIT_SUCCESS;
+  }
 
-  auto* runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+  Seed::SetAutoMasterSeeds();
 
   auto config = std::make_unique<Config>();
+  config->SetRunManagerBackend(options.backend.empty()
+                                   ? ScanStartupCommand(options, "/g4emi/run/taskingBackend")
+                                   : options.backend);
+  G4RunManagerType runManagerType = G4RunManagerType::Default;
+  if (!ToRunManagerType(config->GetRunManagerBackend(), &runManagerType)) {
+    G4cerr << "Unknown run-manager backend '" << config->GetRunManagerBackend() << "'."
+           << G4endl;
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto* runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+
+#ifdef G4EMI_WITH_SUBEVENT
+  if (runManagerType == G4RunManagerType::SubEvtOnly) {
+    const auto photons = ScanStartupCommand(options, "/g4emi/run/photonsPerSubEvent");
+    if (!photons.empty()) {
+      config->SetPhotonsPerSubEvent(std::atoi(photons.c_str()));
+    }
+    runManager->RegisterSubEventType(StackingAction::kOpticalPhotonSubEventType,
+                                     config->GetPhotonsPerSubEvent());
+  }
+#endif
+
   auto* detector = new DetectorConstruction(config.get());
   runManager->SetUserInitialization(detector);
   Messenger messenger(config.get());
 
-  auto* physicsList = new FTFP_BERT_HP();
-  physicsList->RegisterPhysics(new G4OpticalPhysics());
-  runManager->SetUserInitialization(physicsList);
+  runManager->SetUserInitialization(new PhysicsList(config.get()));
   G4OpticalParameters::Instance()->SetScintTrackSecondariesFirst(true);
 
+  runManager->SetUserInitialization(new WorkerInitialization(config.get()));
   runManager->SetUserInitialization(new ActionInitialization(detector, config.get()));
 
+#ifdef G4EMI_WITH_VIS
   auto* visManager = new G4VisExecutive();
   visManager->Initialize();
+#endif
 
   auto* uiManager = G4UImanager::GetUIpointer();
-  if (argc > 1) {
+  int exitCode = EXIT_SUCCESS;
+  for (const auto& command : options.preCommands) {
+    if (uiManager->ApplyCommand(command) != 0) {
+      G4cerr << "Command failed: " << command << G4endl;
+      exitCode = EXIT_FAILURE;
+    }
+  }
+
+  G4cout << "[g4emi] Startup took "
+         << FormatSeconds(std::chrono::steady_clock::now() - processStart) << " (peak RSS "
+         << PeakResidentSetMiB() << " MiB)." << G4endl;
+
+  // Never run a macro against partially applied overrides.
+  if (exitCode == EXIT_SUCCESS && !options.macroPath.empty()) {
     G4String command = "/control/execute ";
-    uiManager->ApplyCommand(command + argv[1]);
-  } else {
+    if (uiManager->ApplyCommand(command + options.macroPath) != 0) {
+      G4cerr << "Macro failed: " << options.macroPath << G4endl;
+      exitCode = EXIT_FAILURE;
+    } else if (options.beamOnEvents >= 0) {
+      const G4String beamOn = "/run/beamOn " + std::to_string(options.beamOnEvents);
+      if (uiManager->ApplyCommand(beamOn) != 0) {
+        G4cerr << "Command failed: " << beamOn << G4endl;
+        exitCode = EXIT_FAILURE;
+      }
+    }
+  } else if (exitCode == EXIT_SUCCESS) {
+#ifdef G4EMI_WITH_VIS
     auto* ui = new G4UIExecutive(argc, argv);
     G4cout << "Interactive session started without auto-running a visualization macro."
            << G4endl
@@ -47,9 +313,16 @@ int main(int argc, char** argv) {
            << G4endl;
     ui->SessionStart();
     delete ui;
+#endif
   }
 
+  G4cout << "[g4emi] Wall time "
+         << FormatSeconds(std::chrono::steady_clock::now() - processStart) << ", peak RSS "
+         << PeakResidentSetMiB() << " MiB." << G4endl;
+
+#ifdef G4EMI_WITH_VIS
   delete visManager;
+#endif
   delete runManager;
-  return 0;
+  return exitCode;
 }
@@ -0,0 +1,849 @@
+#include "SimIO.hh"
+#include "intensifier.hh"
+#include "lenssurrogate.hh"
+#include "lenstrace.hh"
+#include "stagefile.hh"
+#include "structures.hh"
+#include "timepix.hh"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_pipeline`.
+struct CommandLine {
+  std::string input;
+  std::string lens;
+  std::string smx;
+  std::string surrogate;
+  double screenDiameterMm = 0.0;
+  double screenCenterXmm = 0.0;
+  double screenCenterYmm = 0.0;
+
+  Intensifier::Params intensifier;
+  std::string intensifierModel;
+  std::uint64_t seed = 0;
+  bool seedGiven = false;
+  /// Keep photons outside the intensifier input screen (`require_in_bounds=False`).
+  bool allRows = false;
+
+  Timepix::Params timepix;
+  std::string sensorModel = "Timepix3";
+  std::size_t timepixChunkEvents = std::size_t{1} << 22;
+
+  std::string transportedOutput;
+  std::string intensifierOutput;
+  std::string timepixOutput;
+
+  int transportThreads = 1;
+  int intensifierThreads = 1;
+  std::size_t chunkRows = std::size_t{1} << 18;
+  /// Chunks alive at once; with `chunkRows` this bounds the pipeline's memory.
+  std::size_t chunksInFlight = 0;
+  bool showHelp = false;
+};
+
+constexpr const char* kIntensifierDataset = "intensifier_output_events";
+constexpr const char* kTimepixDataset = "timepix_hits";
+constexpr hsize_t kOutputChunkRows = 1 << 16;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " --input SIM.h5 (--lens LENS | --surrogate MODEL.h5)\n"
+      << "       [--transported-output T.h5] [--intensifier-output I.h5]\n"
+      << "       [--timepix-output P.h5] [options]\n"
+      << "Streams /photons through lens transport, the intensifier chain, and the Timepix\n"
+      << "readout in one process. Each stage runs on its own threads and hands chunks to\n"
+      << "the next through bounded queues, so memory stays at --chunks-in-flight chunks\n"
+      << "however large the input is. Every output matches what the standalone stage\n"
+      << "writes. Prints a JSON summary with per-stage timings.\n"
+      << "  --input FILE                 g4emi output with /photons.\n"
+      << "  --lens LENS                  .zmx path, lenses/zmxFiles name, catalog ID, or alias.\n"
+      << "  --smx FILE                   Glass overrides (default: the lens's .smx).\n"
+      << "  --surrogate FILE             Transport with a g4emi_lenssurrogate model instead.\n"
+      << "  --screen-diameter MM         Intensifier input screen diameter (default: none).\n"
+      << "  --screen-center X,Y          Input screen center in mm (default: 0,0).\n"
+      << Intensifier::OptionsUsage()
+      << "  --intensifier-model NAME     intensifier_model attribute.\n"
+      << "  --seed N                     Random seed (default: drawn and reported).\n"
+      << "  --all-rows                   Keep photons with in_bounds false.\n"
+      << Timepix::OptionsUsage()
+      << "  --sensor-model NAME          sensor_model attribute (default: Timepix3).\n"
+      << "  --timepix-chunk-events N     Events sorted in memory at once (default: 4194304).\n"
+      << "  --transport-threads N        Lens transport threads (default: 1).\n"
+      << "  --intensifier-threads N      Intensifier threads (default: 1).\n"
+      << "  --chunk-rows N               /photons rows per chunk (default: 262144).\n"
+      << "  --chunks-in-flight N         Chunks alive at once (default: worker threads + 4).\n"
+      << "  --transported-output FILE    Write /transported_photons here.\n"
+      << "  --intensifier-output FILE    Write /intensifier_output_events here.\n"
+      << "  --timepix-output FILE        Write /timepix_hits here.\n"
+      << "  -h, --help                   Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (arg == "--all-rows") {
+      out->allRows = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (arg == "--input") {
+        out->input = value;
+      } else if (arg == "--lens") {
+        out->lens = value;
+      } else if (arg == "--smx") {
+        out->smx = value;
+      } else if (arg == "--surrogate") {
+        out->surrogate = value;
+      } else if (arg == "--screen-diameter") {
+        out->screenDiameterMm = std::stod(value);
+      } else if (arg == "--screen-center") {
+        const auto comma = value.find(',');
+        if (comma == std::string::npos) {
+          *error = "--screen-center expects X,Y";
+          return false;
+        }
+        out->screenCenterXmm = std::stod(value.substr(0, comma));
+        out->screenCenterYmm = std::stod(value.substr(comma + 1));
+      } else if (arg == "--intensifier-model") {
+        out->intensifierModel = value;
+      } else if (arg == "--seed") {
+        out->seed = std::stoull(value);
+        out->seedGiven = true;
+      } else if (arg == "--sensor-model") {
+        out->sensorModel = value;
+      } else if (arg == "--timepix-chunk-events") {
+        out->timepixChunkEvents = static_cast<std::size_t>(std::stoull(value));
+      } else if (arg == "--transport-threads") {
+        out->transportThreads = std::stoi(value);
+      } else if (arg == "--intensifier-threads") {
+        out->intensifierThreads = std::stoi(value);
+      } else if (arg == "--chunk-rows") {
+        out->chunkRows = static_cast<std::size_t>(std::stoull(value));
+      } else if (arg == "--chunks-in-flight") {
+        out->chunksInFlight = static_cast<std::size_t>(std::stoull(value));
+      } else if (arg == "--transported-output") {
+        out->transportedOutput = value;
+      } else if (arg == "--intensifier-output") {
+        out->intensifierOutput = value;
+      } else if (arg == "--timepix-output") {
+        out->timepixOutput = value;
+      } else if (!Intensifier::ApplyOption(arg, value, &out->intensifier) &&
+                 !Timepix::ApplyOption(arg, value, &out->timepix)) {
+        *error = "Unknown option '" + arg + "'";
+        return false;
+      }
+    } catch (const std::exception&) {
+      *error = "Invalid value '" + value + "' for " + arg;
+      return false;
+    }
+  }
+  if (out->showHelp) {
+    return true;
+  }
+  if (out->input.empty()) {
+    *error = "--input is required";
+    return false;
+  }
+  if (out->lens.empty() == out->surrogate.empty()) {
+    *error = "exactly one of --lens and --surrogate is required";
+    return false;
+  }
+  if (out->transportedOutput.empty() && out->intensifierOutput.empty() &&
+      out->timepixOutput.empty()) {
+    *error = "at least one of --transported-output, --intensifier-output, and "
+             "--timepix-output is required";
+    return false;
+  }
+  if (!Intensifier::ValidateParams(out->intensifier, error) ||
+      !Timepix::ValidateParams(out->timepix, error)) {
+    return false;
+  }
+  if (out->transportThreads <= 0 || out->intensifierThreads <= 0 || out->chunkRows == 0 ||
+      out->timepixChunkEvents == 0) {
+    *error = "thread counts, --chunk-rows, and --timepix-chunk-events must be positive";
+    return false;
+  }
+  if (out->chunksInFlight == 0) {
+    out->chunksInFlight =
+        static_cast<std::size_t>(out->transportThreads + out->intensifierThreads) + 4;
+  }
+  return true;
+}
+
+bool LoadLens(const std::string& name,
+              const std::string& smxOverride,
+              LensTrace::Lens* lens,
+              std::string* error) {
+  const std::string zmx = LensTrace::ResolveZmxPath(name);
+  if (zmx.empty()) {
+    *error = "lens '" + name + "' not found";
+    return false;
+  }
+  const std::string smx = smxOverride.empty() ? LensTrace::ResolveSmxPath(zmx) : smxOverride;
+  return LensTrace::Load(zmx, smx, lens, error);
+}
+
+/// Blocking FIFO of at most `capacity` items. `Close` wakes every waiter:
+/// `Push` then fails and `Pop` fails once the queue is empty.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity) : fCapacity(std::max<std::size_t>(capacity, 1)) {}
+
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fNotFull.wait(lock, [this] { return fClosed || fItems.size() < fCapacity; });
+    if (fClosed) {
+      return false;
+    }
+    fItems.push_back(std::move(item));
+    fNotEmpty.notify_one();
+    return true;
+  }
+
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fNotEmpty.wait(lock, [this] { return fClosed || !fItems.empty(); });
+    if (fItems.empty()) {
+      return false;
+    }
+    *item = std::move(fItems.front());
+    fItems.pop_front();
+    fNotFull.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fClosed = true;
+    fNotFull.notify_all();
+    fNotEmpty.notify_all();
+  }
+
+ private:
+  std::size_t fCapacity;
+  std::deque<T> fItems;
+  bool fClosed = false;
+  std::mutex fMutex;
+  std::condition_variable fNotFull;
+  std::condition_variable fNotEmpty;
+};
+
+/// One slice of `/photons` and what each stage made of it. Chunks are
+/// recycled through a free pool, so their vectors keep their capacity.
+struct Chunk {
+  std::uint64_t index = 0;
+  hsize_t firstRow = 0;
+  std::vector<StageFile::InterfaceHit> photons;
+  std::vector<SimIO::TransportedPhotonInfo> transported;
+  std::vector<Intensifier::Photon> intensifierInput;
+  std::vector<Intensifier::OutputEvent> events;
+};
+using ChunkPtr = std::unique_ptr<Chunk>;
+
+/// Busy time of one stage, summed over its threads.
+class StageClock {
+ public:
+  class Scope {
+   public:
+    explicit Scope(StageClock* clock)
+        : fClock(clock), fStart(std::chrono::steady_clock::now()) {}
+    ~Scope() {
+      fClock->fNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - fStart)
+                                  .count();
+    }
+
+   private:
+    StageClock* fClock;
+    std::chrono::steady_clock::time_point fStart;
+  };
+
+  double Seconds() const { return 1e-9 * static_cast<double>(fNanoseconds.load()); }
+
+ private:
+  std::atomic<std::int64_t> fNanoseconds{0};
+};
+
+/// State shared by the stage threads.
+class Pipeline {
+ public:
+  explicit Pipeline(const CommandLine& options)
+      : options(options),
+        freeChunks(options.chunksInFlight),
+        readQueue(options.chunksInFlight),
+        transportedQueue(options.chunksInFlight),
+        doneQueue(options.chunksInFlight),
+        timepixQueue(options.chunksInFlight) {}
+
+  /// Record the first error and stop every stage.
+  void Fail(const std::string& message) {
+    {
+      std::lock_guard<std::mutex> lock(fErrorMutex);
+      if (fError.empty()) {
+        fError = message;
+      }
+    }
+    failed = true;
+    freeChunks.Close();
+    readQueue.Close();
+    transportedQueue.Close();
+    doneQueue.Close();
+    timepixQueue.Close();
+  }
+
+  std::string Error() {
+    std::lock_guard<std::mutex> lock(fErrorMutex);
+    return fError;
+  }
+
+  const CommandLine& options;
+  bool runIntensifier = false;
+
+  // Transport.
+  const LensTrace::Lens* lens = nullptr;
+  const LensSurrogate::Model* surrogate = nullptr;
+
+  // /photons input and the intensifier and Timepix outputs. The HDF5 library
+  // is not built thread-safe, so every call into it holds `hdf5Mutex`.
+  std::mutex hdf5Mutex;
+  hid_t photons = -1;
+  hid_t photonType = -1;
+  hsize_t totalRows = 0;
+  hid_t eventType = -1;
+  hid_t intensifierFile = -1;
+  hid_t intensifierEvents = -1;
+  hid_t hitType = -1;
+  hid_t timepixFile = -1;
+  hid_t timepixHits = -1;
+
+  BoundedQueue<ChunkPtr> freeChunks;
+  BoundedQueue<ChunkPtr> readQueue;
+  BoundedQueue<ChunkPtr> transportedQueue;
+  BoundedQueue<ChunkPtr> doneQueue;
+  BoundedQueue<std::vector<Timepix::Event>> timepixQueue;
+  std::atomic<int> transportRunning{0};
+  std::atomic<int> intensifierRunning{0};
+  std::atomic<bool> failed{false};
+
+  StageClock readClock;
+  StageClock transportClock;
+  StageClock intensifierClock;
+  StageClock writeClock;
+  StageClock timepixClock;
+  std::uint64_t transported = 0;
+  std::uint64_t selected = 0;
+  std::uint64_t outputEvents = 0;
+  std::uint64_t mappedEvents = 0;
+  std::uint64_t hits = 0;
+  std::size_t spilledChunks = 0;
+
+ private:
+  std::mutex fErrorMutex;
+  std::string fError;
+};
+
+/// Reader: fill free chunks with consecutive `/photons` slices.
+void ReadStage(Pipeline* pipeline) {
+  std::uint64_t index = 0;
+  for (hsize_t first = 0; first < pipeline->totalRows; first += pipeline->options.chunkRows) {
+    ChunkPtr chunk;
+    if (!pipeline->freeChunks.Pop(&chunk)) {
+      return;
+    }
+    StageClock::Scope scope(&pipeline->readClock);
+    const hsize_t count =
+        std::min<hsize_t>(pipeline->options.chunkRows, pipeline->totalRows - first);
+    chunk->index = index++;
+    chunk->firstRow = first;
+    chunk->photons.assign(count, StageFile::InterfaceHit{});
+    bool ok = false;
+    {
+      std::lock_guard<std::mutex> lock(pipeline->hdf5Mutex);
+      ok = StageFile::ReadRows(pipeline->photons, pipeline->photonType, first, count,
+                               chunk->photons.data());
+    }
+    if (!ok) {
+      pipeline->Fail("Failed reading /photons from " + pipeline->options.input);
+      return;
+    }
+    if (!pipeline->readQueue.Push(std::move(chunk))) {
+      return;
+    }
+  }
+  pipeline->readQueue.Close();
+}
+
+/// Transport worker: trace a chunk's photons onto the intensifier plane and
+/// build its `/transported_photons` rows.
+void TransportStage(Pipeline* pipeline) {
+  const CommandLine& options = pipeline->options;
+  auto& next = pipeline->runIntensifier ? pipeline->transportedQueue : pipeline->doneQueue;
+  const double radius = 0.5 * options.screenDiameterMm;
+  LensTrace::RayBatch batch;
+  ChunkPtr chunk;
+  while (pipeline->readQueue.Pop(&chunk)) {
+    {
+      StageClock::Scope scope(&pipeline->transportClock);
+      const auto& photons = chunk->photons;
+      const std::size_t count = photons.size();
+      batch.Resize(count);
+      for (std::size_t i = 0; i < count; ++i) {
+        batch.x[i] = photons[i].x;
+        batch.y[i] = photons[i].y;
+        batch.dx[i] = photons[i].dx;
+        batch.dy[i] = photons[i].dy;
+        batch.dz[i] = photons[i].dz;
+        batch.wavelengthNm[i] = photons[i].wavelengthNm;
+      }
+      if (pipeline->surrogate != nullptr) {
+        LensSurrogate::Evaluate(*pipeline->surrogate, &batch);
+      } else {
+        LensTrace::Trace(*pipeline->lens, &batch);
+      }
+      chunk->transported.clear();
+      for (std::size_t i = 0; i < count; ++i) {
+        if (!batch.valid[i]) {
+          continue;
+        }
+        const auto& photon = photons[i];
+        SimIO::TransportedPhotonInfo row;
+        row.sourcePhotonIndex = static_cast<std::int64_t>(chunk->firstRow + i);
+        row.gunCallId = photon.gunCallId;
+        row.primaryTrackId = photon.primaryTrackId;
+        row.secondaryTrackId = photon.secondaryTrackId;
+        row.photonTrackId = photon.photonTrackId;
+        row.intensifierHitXmm = batch.x[i];
+        row.intensifierHitYmm = batch.y[i];
+        row.intensifierHitZmm = batch.z[i];
+        row.intensifierHitTimeNs = photon.timeNs;
+        if (photon.wavelengthNm > 0.0) {
+          row.intensifierHitWavelengthNm = photon.wavelengthNm;
+        }
+        if (radius > 0.0) {
+          row.inBounds = std::hypot(batch.x[i] - options.screenCenterXmm,
+                                    batch.y[i] - options.screenCenterYmm) <= radius;
+        }
+        chunk->transported.push_back(row);
+      }
+    }
+    if (!next.Push(std::move(chunk))) {
+      break;
+    }
+  }
+  if (--pipeline->transportRunning == 0) {
+    next.Close();
+  }
+}
+
+/// Intensifier worker: run the photocathode, MCP, and phosphor chain over a
+/// chunk's transported rows.
+void IntensifierStage(Pipeline* pipeline) {
+  const CommandLine& options = pipeline->options;
+  ChunkPtr chunk;
+  while (pipeline->transportedQueue.Pop(&chunk)) {
+    {
+      StageClock::Scope scope(&pipeline->intensifierClock);
+      auto& input = chunk->intensifierInput;
+      input.resize(chunk->transported.size());
+      for (std::size_t i = 0; i < input.size(); ++i) {
+        const auto& row = chunk->transported[i];
+        auto& photon = input[i];
+        photon.sourcePhotonIndex = row.sourcePhotonIndex;
+        photon.gunCallId = row.gunCallId;
+        photon.primaryTrackId = row.primaryTrackId;
+        photon.secondaryTrackId = row.secondaryTrackId;
+        photon.photonTrackId = row.photonTrackId;
+        photon.xMm = row.intensifierHitXmm;
+        photon.yMm = row.intensifierHitYmm;
+        photon.timeNs = row.intensifierHitTimeNs;
+        photon.wavelengthNm = row.intensifierHitWavelengthNm;
+        photon.inBounds = static_cast<std::int8_t>(row.inBounds);
+      }
+      chunk->events.clear();
+      Intensifier::Process(options.intensifier, options.seed, input.data(), input.size(),
+                           !options.allRows, &chunk->events);
+    }
+    if (!pipeline->doneQueue.Push(std::move(chunk))) {
+      break;
+    }
+  }
+  if (--pipeline->intensifierRunning == 0) {
+    pipeline->doneQueue.Close();
+  }
+}
+
+/// Writer: put chunks back in input order, append their rows, hand mapped
+/// events to the Timepix stage, and recycle the chunks.
+void WriteStage(Pipeline* pipeline) {
+  const CommandLine& options = pipeline->options;
+  std::map<std::uint64_t, ChunkPtr> pending;
+  std::uint64_t nextIndex = 0;
+  std::uint64_t eventRow = 0;
+  std::string error;
+  ChunkPtr arrived;
+  while (pipeline->doneQueue.Pop(&arrived)) {
+    const std::uint64_t index = arrived->index;
+    pending.emplace(index, std::move(arrived));
+    while (!pending.empty() && pending.begin()->first == nextIndex) {
+      ChunkPtr chunk = std::move(pending.begin()->second);
+      pending.erase(pending.begin());
+      ++nextIndex;
+      StageClock::Scope scope(&pipeline->writeClock);
+      pipeline->transported += chunk->transported.size();
+      if (pipeline->runIntensifier) {
+        if (options.allRows) {
+          pipeline->selected += chunk->transported.size();
+        } else {
+          for (const auto& row : chunk->transported) {
+            pipeline->selected += row.inBounds ? 1 : 0;
+          }
+        }
+        pipeline->outputEvents += chunk->events.size();
+      }
+      {
+        std::lock_guard<std::mutex> lock(pipeline->hdf5Mutex);
+        if (!options.transportedOutput.empty() &&
+            !SimIO::AppendTransported(options.transportedOutput, chunk->transported, 0, &error)) {
+          pipeline->Fail(error);
+          return;
+        }
+        if (pipeline->intensifierEvents >= 0 &&
+            !StageFile::AppendRows(pipeline->intensifierEvents, pipeline->eventType,
+                                   chunk->events.data(), chunk->events.size())) {
+          pipeline->Fail("Failed writing /" + std::string(kIntensifierDataset) + " to " +
+                         options.intensifierOutput);
+          return;
+        }
+      }
+      if (pipeline->timepixHits >= 0) {
+        std::vector<Timepix::Event> mapped;
+        mapped.reserve(chunk->events.size());
+        for (const auto& row : chunk->events) {
+          Timepix::Event event;
+          const std::uint64_t order = eventRow++;
+          if (!Timepix::MapToPixel(options.timepix, row.outputXmm, row.outputYmm,
+                                   &event.xPixel, &event.yPixel)) {
+            continue;
+          }
+          event.timeNs = row.outputTimeNs;
+          event.amplitude = row.signalAmplitudeArb;
+          event.order = order;
+          event.gunCallId = row.gunCallId;
+          event.primaryTrackId = row.primaryTrackId;
+          event.secondaryTrackId = row.secondaryTrackId;
+          mapped.push_back(event);
+        }
+        pipeline->mappedEvents += mapped.size();
+        if (!pipeline->timepixQueue.Push(std::move(mapped))) {
+          return;
+        }
+      }
+      if (!pipeline->freeChunks.Push(std::move(chunk))) {
+        return;
+      }
+    }
+  }
+  pipeline->timepixQueue.Close();
+}
+
+/// Timepix: sort the mapped events as they arrive, then merge them in time
+/// order once the input has ended and write the hits.
+void TimepixStage(Pipeline* pipeline) {
+  const CommandLine& options = pipeline->options;
+  Timepix::EventSorter sorter(options.timepixChunkEvents);
+  std::string error;
+  std::vector<Timepix::Event> mapped;
+  while (pipeline->timepixQueue.Pop(&mapped)) {
+    StageClock::Scope scope(&pipeline->timepixClock);
+    if (!sorter.Add(mapped.data(), mapped.size(), &error)) {
+      pipeline->Fail(error);
+      return;
+    }
+  }
+  if (pipeline->failed) {
+    return;
+  }
+  StageClock::Scope scope(&pipeline->timepixClock);
+  Timepix::Engine engine(options.timepix);
+  std::vector<Timepix::Hit> finished;
+  bool written = true;
+  const auto append = [&] {
+    std::lock_guard<std::mutex> lock(pipeline->hdf5Mutex);
+    written = StageFile::AppendRows(pipeline->timepixHits, pipeline->hitType, finished.data(),
+                                    finished.size()) &&
+              written;
+    finished.clear();
+  };
+  bool ok = sorter.Drain(
+      [&](const Timepix::Event* batch, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+          engine.Consume(batch[i]);
+        }
+        engine.TakeFinished(&finished);
+        if (finished.size() >= kOutputChunkRows) {
+          append();
+        }
+      },
+      &error);
+  engine.Finish(&finished);
+  append();
+  if (ok && !written) {
+    error = "Failed writing /" + std::string(kTimepixDataset) + " to " + options.timepixOutput;
+    ok = false;
+  }
+  if (!ok) {
+    pipeline->Fail(error);
+    return;
+  }
+  pipeline->hits = engine.HitCount();
+  pipeline->spilledChunks = sorter.SpilledChunks();
+}
+
+/// Root attributes of the intensifier and Timepix outputs, as the standalone
+/// stages write them.
+void WriteStageAttributes(const CommandLine& options, hid_t input, hid_t output,
+                          bool timepix) {
+  const std::string inputPath = StageFile::AbsolutePath(options.input);
+  StageFile::WriteStringAttribute(output, "source_hdf5", inputPath);
+  if (!options.transportedOutput.empty()) {
+    StageFile::WriteStringAttribute(output, "transport_hdf5",
+                                    StageFile::AbsolutePath(options.transportedOutput));
+  }
+  StageFile::CopyAttribute(input, output, "run_id");
+  if (!options.intensifierModel.empty()) {
+    StageFile::WriteStringAttribute(output, "intensifier_model", options.intensifierModel);
+  }
+  if (timepix) {
+    StageFile::WriteStringAttribute(output, "sensor_model", options.sensorModel);
+  } else {
+    StageFile::WriteUint64Attribute(output, "intensifier_seed", options.seed);
+  }
+  StageFile::WriteStringAttribute(output, "generated_utc", StageFile::UtcNowIso());
+}
+
+/// Create an output file holding one empty stage table.
+bool CreateOutput(const std::string& path, const char* dataset, hid_t type, hid_t* file,
+                  hid_t* table, std::string* error) {
+  *file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  *table = *file >= 0 ? StageFile::CreateTable(*file, dataset, type, kOutputChunkRows) : -1;
+  if (*table < 0) {
+    *error = "cannot create " + path;
+    return false;
+  }
+  return true;
+}
+
+/// Copy the event tables and attributes into a finished output and close it.
+bool FinishOutput(const CommandLine& options, hid_t input, hid_t file, hid_t table,
+                  bool timepix, std::string* error) {
+  if (table >= 0) {
+    H5Dclose(table);
+  }
+  if (file < 0) {
+    return true;
+  }
+  bool ok = StageFile::CopyEventTables(input, file);
+  if (!ok) {
+    *error = "Failed copying /primaries and /secondaries from " + options.input;
+  } else {
+    WriteStageAttributes(options, input, file, timepix);
+  }
+  H5Fclose(file);
+  return ok;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_pipeline: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  if (!options.seedGiven) {
+    std::random_device device;
+    options.seed = (static_cast<std::uint64_t>(device()) << 32) | device();
+  }
+
+  LensTrace::Lens lens;
+  LensSurrogate::Model surrogate;
+  SimIO::TransportAttributes transportAttributes;
+  if (!options.surrogate.empty()) {
+    if (!LensSurrogate::Load(options.surrogate, &surrogate, &error)) {
+      std::cerr << "g4emi_pipeline: " << error << "\n";
+      return 1;
+    }
+    transportAttributes.lensName = surrogate.lensName;
+    transportAttributes.zmxPath = surrogate.zmxPath;
+    transportAttributes.smxPath = surrogate.smxPath;
+    transportAttributes.engine = "g4emi-surrogate";
+    transportAttributes.surrogatePath = options.surrogate;
+  } else {
+    if (!LoadLens(options.lens, options.smx, &lens, &error)) {
+      std::cerr << "g4emi_pipeline: " << error << "\n";
+      return 1;
+    }
+    transportAttributes.lensName = lens.name;
+    transportAttributes.zmxPath = lens.zmxPath;
+    transportAttributes.smxPath = lens.smxPath;
+  }
+  transportAttributes.screenDefined = options.screenDiameterMm > 0.0;
+  transportAttributes.screenDiameterMm = options.screenDiameterMm;
+  transportAttributes.screenCenterXmm = options.screenCenterXmm;
+  transportAttributes.screenCenterYmm = options.screenCenterYmm;
+
+  const hid_t input = H5Fopen(options.input.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  const hid_t photons = input >= 0 ? H5Dopen2(input, "photons", H5P_DEFAULT) : -1;
+  if (photons < 0) {
+    std::cerr << "g4emi_pipeline: cannot open /photons in " << options.input << "\n";
+    if (input >= 0) {
+      H5Fclose(input);
+    }
+    return 1;
+  }
+
+  Pipeline pipeline(options);
+  pipeline.runIntensifier = !options.intensifierOutput.empty() || !options.timepixOutput.empty();
+  pipeline.lens = options.surrogate.empty() ? &lens : nullptr;
+  pipeline.surrogate = options.surrogate.empty() ? nullptr : &surrogate;
+  pipeline.photons = photons;
+  pipeline.totalRows = StageFile::RowCount(photons);
+  const hid_t fileType = H5Dget_type(photons);
+  pipeline.photonType = StageFile::InterfaceHitType(fileType, &error);
+  H5Tclose(fileType);
+  pipeline.eventType = StageFile::IntensifierEventType();
+  pipeline.hitType = StageFile::TimepixHitType();
+  bool ok = pipeline.photonType >= 0;
+  if (ok && !options.intensifierOutput.empty()) {
+    ok = CreateOutput(options.intensifierOutput, kIntensifierDataset, pipeline.eventType,
+                      &pipeline.intensifierFile, &pipeline.intensifierEvents, &error);
+  }
+  if (ok && !options.timepixOutput.empty()) {
+    ok = CreateOutput(options.timepixOutput, kTimepixDataset, pipeline.hitType,
+                      &pipeline.timepixFile, &pipeline.timepixHits, &error);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  if (ok) {
+    for (std::size_t i = 0; i < options.chunksInFlight; ++i) {
+      pipeline.freeChunks.Push(ChunkPtr(new Chunk));
+    }
+    pipeline.transportRunning = options.transportThreads;
+    pipeline.intensifierRunning = options.intensifierThreads;
+    std::vector<std::thread> threads;
+    threads.emplace_back(ReadStage, &pipeline);
+    for (int i = 0; i < options.transportThreads; ++i) {
+      threads.emplace_back(TransportStage, &pipeline);
+    }
+    if (pipeline.runIntensifier) {
+      for (int i = 0; i < options.intensifierThreads; ++i) {
+        threads.emplace_back(IntensifierStage, &pipeline);
+      }
+    }
+    if (pipeline.timepixHits >= 0) {
+      threads.emplace_back(TimepixStage, &pipeline);
+    }
+    WriteStage(&pipeline);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    if (pipeline.failed) {
+      error = pipeline.Error();
+      ok = false;
+    }
+  }
+  H5Tclose(pipeline.hitType);
+  H5Tclose(pipeline.eventType);
+  if (pipeline.photonType >= 0) {
+    H5Tclose(pipeline.photonType);
+  }
+  H5Dclose(photons);
+
+  if (ok && !options.transportedOutput.empty()) {
+    ok = SimIO::WriteTransportAttributes(options.transportedOutput, transportAttributes,
+                                         &error);
+  }
+  SimIO::Close();
+  if (ok && !options.transportedOutput.empty()) {
+    ok = StageFile::FinishTransportFile(options.input, options.transportedOutput, &error);
+    const hid_t file = ok ? H5Fopen(options.transportedOutput.c_str(), H5F_ACC_RDWR,
+                                    H5P_DEFAULT)
+                          : -1;
+    if (file >= 0) {
+      StageFile::WriteStringAttribute(file, "source_hdf5", StageFile::AbsolutePath(options.input));
+      H5Fclose(file);
+    }
+  }
+  const bool intensifierOk = FinishOutput(options, input, pipeline.intensifierFile,
+                                          pipeline.intensifierEvents, false, &error);
+  const bool timepixOk =
+      FinishOutput(options, input, pipeline.timepixFile, pipeline.timepixHits, true, &error);
+  ok = ok && intensifierOk && timepixOk;
+  H5Fclose(input);
+  if (!ok) {
+    std::cerr << "g4emi_pipeline: " << error << "\n";
+    return 1;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("{\n  \"input\": \"%s\",\n  \"photons\": %llu,\n  \"transported\": %llu,\n",
+              options.input.c_str(), static_cast<unsigned long long>(pipeline.totalRows),
+              static_cast<unsigned long long>(pipeline.transported));
+  if (pipeline.runIntensifier) {
+    std::printf("  \"selected_photons\": %llu,\n  \"output_events\": %llu,\n  \"seed\": %llu,\n",
+                static_cast<unsigned long long>(pipeline.selected),
+                static_cast<unsigned long long>(pipeline.outputEvents),
+                static_cast<unsigned long long>(options.seed));
+  }
+  if (pipeline.timepixHits >= 0) {
+    std::printf("  \"mapped_events\": %llu,\n  \"hits\": %llu,\n  \"spilled_chunks\": %zu,\n",
+                static_cast<unsigned long long>(pipeline.mappedEvents),
+                static_cast<unsigned long long>(pipeline.hits), pipeline.spilledChunks);
+  }
+  std::printf("  \"transport_threads\": %d,\n  \"intensifier_threads\": %d,\n"
+              "  \"chunk_rows\": %zu,\n  \"chunks_in_flight\": %zu,\n"
+              "  \"stage_seconds\": {\"read\": %.3f, \"transport\": %.3f, "
+              "\"intensifier\": %.3f, \"write\": %.3f, \"timepix\": %.3f},\n"
+              "  \"seconds\": %.3f,\n  \"photons_per_second\": %.6g\n}\n",
+              options.transportThreads, options.intensifierThreads, options.chunkRows,
+              options.chunksInFlight, pipeline.readClock.Seconds(),
+              pipeline.transportClock.Seconds(), pipeline.intensifierClock.Seconds(),
+              pipeline.writeClock.Seconds(), pipeline.timepixClock.Seconds(), seconds,
+              seconds > 0.0 ? static_cast<double>(pipeline.totalRows) / seconds : 0.0);
+  return 0;
+}
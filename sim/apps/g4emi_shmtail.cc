@@ -0,0 +1,233 @@
+#include "SimIO.hh"
+#include "shmring.hh"
+#include "stagefile.hh"
+
+#include <hdf5.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_shmtail`.
+struct CommandLine {
+  std::string name;
+  std::string output;
+  bool claimSlot = false;
+  bool fromNewest = false;
+  /// How long to wait for the ring to appear.
+  double waitSeconds = 10.0;
+  /// Stop after this long without a new batch; 0 follows until the run ends.
+  double idleSeconds = 0.0;
+  std::uint64_t maxBatches = 0;
+  bool showHelp = false;
+};
+
+constexpr hsize_t kOutputChunkRows = 1 << 16;
+constexpr std::chrono::microseconds kEmptyPoll{200};
+
+volatile std::sig_atomic_t gStop = 0;
+
+void HandleSignal(int) { gStop = 1; }
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " --name SHM_NAME [options]\n"
+      << "Follows the /photons batches a run publishes with /output/shm/name until\n"
+      << "the run ends, optionally writing them to an HDF5 /photons table. Prints a\n"
+      << "JSON summary.\n"
+      << "  --name NAME              Ring name, as given to /output/shm/name.\n"
+      << "  --claim                  Claim a reader slot, so the writer keeps the ring\n"
+      << "                           from overrunning this reader (see /output/shm/policy).\n"
+      << "  --from-newest            Skip batches already in the ring.\n"
+      << "  --wait-s S               Wait this long for the ring to appear (default: 10).\n"
+      << "  --idle-s S               Stop after S seconds without a batch (default: 0,\n"
+      << "                           follow until the run ends).\n"
+      << "  --max-batches N          Stop after N batches.\n"
+      << "  -o, --output FILE        Write received rows to /photons in FILE.\n"
+      << "  -h, --help               Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (arg == "--claim") {
+      out->claimSlot = true;
+      continue;
+    }
+    if (arg == "--from-newest") {
+      out->fromNewest = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (arg == "--name") {
+        out->name = value;
+      } else if (arg == "-o" || arg == "--output") {
+        out->output = value;
+      } else if (arg == "--wait-s") {
+        out->waitSeconds = std::stod(value);
+      } else if (arg == "--idle-s") {
+        out->idleSeconds = std::stod(value);
+      } else if (arg == "--max-batches") {
+        out->maxBatches = std::stoull(value);
+      } else {
+        *error = "Unknown option '" + arg + "'";
+        return false;
+      }
+    } catch (const std::exception&) {
+      *error = "Invalid value '" + value + "' for " + arg;
+      return false;
+    }
+  }
+  if (out->showHelp) {
+    return true;
+  }
+  if (out->name.empty()) {
+    *error = "--name is required";
+    return false;
+  }
+  if (out->waitSeconds < 0.0 || out->idleSeconds < 0.0) {
+    *error = "--wait-s and --idle-s must not be negative";
+    return false;
+  }
+  return true;
+}
+
+// HDF5 row type matching the ring's column table.
+hid_t RowType(const ShmRing::Header& header) {
+  const hid_t type = H5Tcreate(H5T_COMPOUND, header.rowBytes);
+  for (std::uint32_t i = 0; i < header.columnCount; ++i) {
+    const auto& column = header.columns[i];
+    const hid_t member = column.isFloat ? H5T_NATIVE_DOUBLE
+                         : column.size == 8 ? H5T_NATIVE_INT64
+                                            : H5T_NATIVE_INT32;
+    H5Tinsert(type, column.name, column.offset, member);
+  }
+  return type;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_shmtail: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+  std::signal(SIGINT, HandleSignal);
+  std::signal(SIGTERM, HandleSignal);
+
+  // The simulation creates the ring at run start, possibly after we start.
+  ShmRing::Reader reader;
+  const auto waitStart = std::chrono::steady_clock::now();
+  while (!reader.Open(options.name, options.claimSlot, options.fromNewest, &error)) {
+    const std::chrono::duration<double> waited = std::chrono::steady_clock::now() - waitStart;
+    if (gStop || waited.count() >= options.waitSeconds) {
+      std::cerr << "g4emi_shmtail: " << error << "\n";
+      return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  const auto& header = *reader.GetHeader();
+
+  hid_t output = -1;
+  hid_t rowType = -1;
+  hid_t photons = -1;
+  if (!options.output.empty()) {
+    output = H5Fcreate(options.output.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    rowType = output >= 0 ? RowType(header) : -1;
+    photons = output >= 0 ? StageFile::CreateTable(output, "photons", rowType, kOutputChunkRows)
+                          : -1;
+    if (photons < 0) {
+      std::cerr << "g4emi_shmtail: cannot create /photons in " << options.output << "\n";
+      if (rowType >= 0) {
+        H5Tclose(rowType);
+      }
+      if (output >= 0) {
+        H5Fclose(output);
+      }
+      return 1;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto lastBatch = start;
+  std::uint64_t batches = 0;
+  std::uint64_t rows = 0;
+  std::int64_t firstSequence = -1;
+  std::int64_t lastSequence = -1;
+  bool closed = false;
+  bool ok = true;
+  ShmRing::Batch batch;
+  while (ok && !gStop && (options.maxBatches == 0 || batches < options.maxBatches)) {
+    const auto status = reader.Next(&batch);
+    if (status == ShmRing::Reader::Status::kClosed) {
+      closed = true;
+      break;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (status == ShmRing::Reader::Status::kEmpty) {
+      if (options.idleSeconds > 0.0 &&
+          std::chrono::duration<double>(now - lastBatch).count() >= options.idleSeconds) {
+        break;
+      }
+      std::this_thread::sleep_for(kEmptyPoll);
+      continue;
+    }
+    lastBatch = now;
+    ++batches;
+    rows += batch.rowCount;
+    if (firstSequence < 0) {
+      firstSequence = static_cast<std::int64_t>(batch.sequence);
+    }
+    lastSequence = static_cast<std::int64_t>(batch.sequence);
+    if (photons >= 0 && batch.rowCount > 0) {
+      ok = StageFile::AppendRows(photons, rowType, batch.rows.data(), batch.rowCount);
+    }
+  }
+
+  if (photons >= 0) {
+    H5Dclose(photons);
+    H5Tclose(rowType);
+    H5Fclose(output);
+  }
+  if (!ok) {
+    std::cerr << "g4emi_shmtail: failed writing /photons to " << options.output << "\n";
+    return 1;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("{\n  \"name\": \"%s\",\n  \"photon_fields\": \"%s\",\n  \"row_bytes\": %u,\n"
+              "  \"batches\": %llu,\n  \"rows\": %llu,\n  \"first_sequence\": %lld,\n"
+              "  \"last_sequence\": %lld,\n  \"lost_batches\": %llu,\n  \"overruns\": %llu,\n"
+              "  \"closed\": %s,\n  \"seconds\": %.3f,\n  \"rows_per_second\": %.6g\n}\n",
+              options.name.c_str(), SimIO::DescribePhotonFields(header.photonFields).c_str(),
+              header.rowBytes, static_cast<unsigned long long>(batches),
+              static_cast<unsigned long long>(rows), static_cast<long long>(firstSequence),
+              static_cast<long long>(lastSequence),
+              static_cast<unsigned long long>(reader.Lost()),
+              static_cast<unsigned long long>(reader.Overruns()), closed ? "true" : "false",
+              seconds, seconds > 0.0 ? static_cast<double>(rows) / seconds : 0.0);
+  return 0;
+}
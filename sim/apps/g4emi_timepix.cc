@@ -0,0 +1,254 @@
+#include "stagefile.hh"
+#include "timepix.hh"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+/// Parsed command-line options for `g4emi_timepix`.
+struct CommandLine {
+  std::string input;
+  std::string output;
+  Timepix::Params params;
+  std::string sensorModel = "Timepix3";
+  /// Events sorted in memory at once; larger inputs spill sorted chunks.
+  std::size_t chunkEvents = std::size_t{1} << 22;
+  bool showHelp = false;
+};
+
+/// `/intensifier_output_events` columns the Timepix stage reads.
+struct IntensifierRow {
+  std::int64_t gunCallId;
+  std::int32_t primaryTrackId;
+  std::int32_t secondaryTrackId;
+  double outputXmm;
+  double outputYmm;
+  double outputTimeNs;
+  double signalAmplitudeArb;
+};
+
+constexpr const char* kInputDataset = "intensifier_output_events";
+constexpr const char* kOutputDataset = "timepix_hits";
+constexpr hsize_t kOutputChunkRows = 1 << 16;
+
+void PrintUsage(const char* program) {
+  std::cout
+      << "Usage: " << program << " --input INTENSIFIER.h5 -o TIMEPIX.h5 [options]\n"
+      << "Applies the Timepix ToT and dead-time readout to /intensifier_output_events\n"
+      << "and writes /timepix_hits as the Python sensor stage does, streaming the input\n"
+      << "in bounded memory. Prints a JSON summary.\n"
+      << "  --input FILE             Intensifier output HDF5.\n"
+      << Timepix::OptionsUsage()
+      << "  --sensor-model NAME      sensor_model attribute (default: Timepix3).\n"
+      << "  --chunk-events N         Events sorted in memory at once (default: 4194304).\n"
+      << "  -o, --output FILE        Output path.\n"
+      << "  -h, --help               Show this message.\n";
+}
+
+bool ParseCommandLine(int argc, char** argv, CommandLine* out, std::string* error) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help") {
+      out->showHelp = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      *error = "Unknown option or missing value for '" + arg + "'";
+      return false;
+    }
+    const std::string value = argv[++i];
+    try {
+      if (arg == "--input") {
+        out->input = value;
+      } else if (arg == "-o" || arg == "--output") {
+        out->output = value;
+      } else if (arg == "--sensor-model") {
+        out->sensorModel = value;
+      } else if (arg == "--chunk-events") {
+        out->chunkEvents = static_cast<std::size_t>(std::stoull(value));
+      } else if (!Timepix::ApplyOption(arg, value, &out->params)) {
+        *error = "Unknown option '" + arg + "'";
+        return false;
+      }
+    } catch (const std::exception&) {
+      *error = "Invalid value '" + value + "' for " + arg;
+      return false;
+    }
+  }
+  if (out->showHelp) {
+    return true;
+  }
+  if (out->input.empty() || out->output.empty()) {
+    *error = "--input and --output are required";
+    return false;
+  }
+  if (!Timepix::ValidateParams(out->params, error)) {
+    return false;
+  }
+  if (out->chunkEvents == 0) {
+    *error = "--chunk-events must be positive";
+    return false;
+  }
+  return true;
+}
+
+hid_t InputRowType() {
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(IntensifierRow));
+  H5Tinsert(type, "gun_call_id", HOFFSET(IntensifierRow, gunCallId), H5T_NATIVE_INT64);
+  H5Tinsert(type, "primary_track_id", HOFFSET(IntensifierRow, primaryTrackId),
+            H5T_NATIVE_INT32);
+  H5Tinsert(type, "secondary_track_id", HOFFSET(IntensifierRow, secondaryTrackId),
+            H5T_NATIVE_INT32);
+  H5Tinsert(type, "output_x_mm", HOFFSET(IntensifierRow, outputXmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "output_y_mm", HOFFSET(IntensifierRow, outputYmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "output_time_ns", HOFFSET(IntensifierRow, outputTimeNs), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "signal_amplitude_arb", HOFFSET(IntensifierRow, signalAmplitudeArb),
+            H5T_NATIVE_DOUBLE);
+  return type;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  CommandLine options;
+  std::string error;
+  if (!ParseCommandLine(argc, argv, &options, &error)) {
+    std::cerr << "g4emi_timepix: " << error << "\n";
+    PrintUsage(argv[0]);
+    return 2;
+  }
+  if (options.showHelp) {
+    PrintUsage(argv[0]);
+    return 0;
+  }
+
+  const hid_t input = H5Fopen(options.input.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  const hid_t events = input >= 0 ? H5Dopen2(input, kInputDataset, H5P_DEFAULT) : -1;
+  if (events < 0) {
+    std::cerr << "g4emi_timepix: cannot open /" << kInputDataset << " in " << options.input
+              << "\n";
+    if (input >= 0) {
+      H5Fclose(input);
+    }
+    return 1;
+  }
+  const hid_t output = H5Fcreate(options.output.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (output < 0) {
+    std::cerr << "g4emi_timepix: cannot create " << options.output << "\n";
+    H5Dclose(events);
+    H5Fclose(input);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const hid_t rowType = InputRowType();
+  const hid_t hitType = StageFile::TimepixHitType();
+  const hid_t hits = StageFile::CreateTable(output, kOutputDataset, hitType, kOutputChunkRows);
+
+  // Map and hand the input to the sorter a chunk at a time.
+  Timepix::EventSorter sorter(options.chunkEvents);
+  const hsize_t totalRows = StageFile::RowCount(events);
+  std::uint64_t mapped = 0;
+  bool ok = hits >= 0;
+  {
+    std::vector<IntensifierRow> rows;
+    std::vector<Timepix::Event> chunk;
+    const hsize_t readRows = std::min<hsize_t>(options.chunkEvents, 1 << 20);
+    for (hsize_t first = 0; ok && first < totalRows; first += readRows) {
+      const hsize_t count = std::min(readRows, totalRows - first);
+      rows.resize(count);
+      ok = StageFile::ReadRows(events, rowType, first, count, rows.data());
+      if (!ok) {
+        error = std::string("Failed reading /") + kInputDataset + " from " + options.input;
+        break;
+      }
+      chunk.clear();
+      for (hsize_t i = 0; i < count; ++i) {
+        const auto& row = rows[i];
+        Timepix::Event event;
+        if (!Timepix::MapToPixel(options.params, row.outputXmm, row.outputYmm, &event.xPixel,
+                                 &event.yPixel)) {
+          continue;
+        }
+        event.timeNs = row.outputTimeNs;
+        event.amplitude = row.signalAmplitudeArb;
+        event.order = first + i;
+        event.gunCallId = row.gunCallId;
+        event.primaryTrackId = row.primaryTrackId;
+        event.secondaryTrackId = row.secondaryTrackId;
+        chunk.push_back(event);
+      }
+      mapped += chunk.size();
+      ok = sorter.Add(chunk.data(), chunk.size(), &error);
+    }
+  }
+  H5Dclose(events);
+
+  // Merge in time order, writing hits as they become final.
+  Timepix::Engine engine(options.params);
+  std::vector<Timepix::Hit> finished;
+  if (ok) {
+    bool written = true;
+    ok = sorter.Drain(
+        [&](const Timepix::Event* batch, std::size_t count) {
+          for (std::size_t i = 0; i < count; ++i) {
+            engine.Consume(batch[i]);
+          }
+          engine.TakeFinished(&finished);
+          if (finished.size() >= kOutputChunkRows) {
+            written = StageFile::AppendRows(hits, hitType, finished.data(), finished.size()) &&
+                      written;
+            finished.clear();
+          }
+        },
+        &error);
+    engine.Finish(&finished);
+    written = StageFile::AppendRows(hits, hitType, finished.data(), finished.size()) && written;
+    if (ok && !written) {
+      error = "Failed writing /" + std::string(kOutputDataset) + " to " + options.output;
+      ok = false;
+    }
+  }
+  if (hits >= 0) {
+    H5Dclose(hits);
+  }
+  H5Tclose(hitType);
+  H5Tclose(rowType);
+
+  if (ok) {
+    if (!StageFile::CopyEventTables(input, output)) {
+      error = "Failed copying /primaries and /secondaries from " + options.input;
+      ok = false;
+    }
+    for (const char* name : {"source_hdf5", "transport_hdf5", "run_id", "intensifier_model"}) {
+      StageFile::CopyAttribute(input, output, name);
+    }
+    StageFile::WriteStringAttribute(output, "sensor_model", options.sensorModel);
+    StageFile::WriteStringAttribute(output, "generated_utc", StageFile::UtcNowIso());
+  }
+  H5Fclose(output);
+  H5Fclose(input);
+  if (!ok) {
+    std::cerr << "g4emi_timepix: " << error << "\n";
+    return 1;
+  }
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("{\n  \"input\": \"%s\",\n  \"output\": \"%s\",\n  \"events\": %llu,\n"
+              "  \"mapped_events\": %llu,\n  \"hits\": %llu,\n  \"spilled_chunks\": %zu,\n"
+              "  \"seconds\": %.3f,\n  \"events_per_second\": %.6g\n}\n",
+              options.input.c_str(), options.output.c_str(),
+              static_cast<unsigned long long>(totalRows),
+              static_cast<unsigned long long>(mapped),
+              static_cast<unsigned long long>(engine.HitCount()), sorter.SpilledChunks(), seconds,
+              seconds > 0.0 ? static_cast<double>(totalRows) / seconds : 0.0);
+  return 0;
+}
@@ -13,7 +13,8 @@ class ActionInitialization : public G4VUserActionInitialization {
   ActionInitialization(const DetectorConstruction* detector, const Config* config);
   ~ActionInitialization() override = default;
 
-  /// Register worker-thread actions.
+  /// Register worker-thread actions (also the master's event actions with the
+  /// sub-event run manager, where the master owns the event loop).
   void Build() const override;
   /// Register master-thread actions.
   void BuildForMaster() const override;
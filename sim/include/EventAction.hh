@@ -1,12 +1,16 @@
 #ifndef EventAction_h
 #define EventAction_h 1
 
-#include "structures.hh"
+#include "eventstructures.hh"
 
 #include "G4ThreeVector.hh"
 #include "G4Types.hh"
 #include "G4UserEventAction.hh"
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -14,6 +18,13 @@
 class G4Event;
 class G4Track;
 class Config;
+namespace LensSurrogate {
+struct Model;
+}
+
+namespace LensTrace {
+struct Lens;
+}
 
 /// Per-event aggregation and HDF5 row assembly.
 class EventAction : public G4UserEventAction {
@@ -30,6 +41,19 @@ class EventAction : public G4UserEventAction {
 
   void BeginOfEventAction(const G4Event* event) override;
   void EndOfEventAction(const G4Event* event) override;
+#ifdef G4EMI_WITH_SUBEVENT
+  /// Collect photon hits returned by a sub-event into its owning event.
+  void MergeSubEvent(G4Event* masterEvent, const G4Event* subEvent) override;
+#endif
+  /// Write events still waiting for sub-events at run end, with a warning.
+  void FlushPendingEvents();
+
+  /// True when this thread hands optical photons to sub-events.
+  G4bool DispatchesPhotonsToSubEvents() const { return fSubEventMode && !fSubEventWorker; }
+  /// Count one optical photon handed to a sub-event (owning-event thread).
+  void RecordSubEventPhotonDispatched() { ++fDispatchedPhotons; }
+  /// Count one dispatched optical photon tracked in this sub-event (worker thread).
+  void RecordSubEventPhotonTracked() { ++fTrackedPhotons; }
 
   void RecordTrackInfo(G4int trackID, const TrackInfo& info);
   const TrackInfo* FindTrackInfo(G4int trackID) const;
@@ -50,8 +74,17 @@ class EventAction : public G4UserEventAction {
                                          G4ThreeVector* position) const;
 
   void RecordPhotonHit(const PhotonHitRecord& hit);
-  const std::string& GetPrimarySpecies() const { return fPrimarySpecies; }
-  const G4ThreeVector& GetPrimaryPosition() const { return fPrimaryPosition; }
+  const std::string& GetPrimarySpecies() const { return fState.primarySpecies; }
+  const G4ThreeVector& GetPrimaryPosition() const { return fState.primaryPosition; }
+  /// Photon column groups to capture at the interface: the `/photons`
+  /// selection plus creation time while timing histograms are enabled and
+  /// wavelength while lens transport is.
+  SimStructures::PhotonFieldMask GetPhotonFields() const { return fPhotonFields; }
+  /// False in `/output/mode images` without timing histograms or an event
+  /// trigger, where hits only fill the interface image.
+  G4bool RecordsHits() const { return fRecordsHits; }
+  /// Count a detected photon that went only into the interface image.
+  void RecordImagedPhoton() { ++fState.imagedPhotons; }
 
   /// Called from stepping when first non-transportation primary step is seen.
   void RecordPrimaryScintillatorFirstInteraction(G4int primaryTrackID,
@@ -62,20 +95,88 @@ class EventAction : public G4UserEventAction {
                                       G4bool generatedOpticalPhoton);
 
  private:
+  /// Per-event accumulators; swapped aside while an event waits for sub-events.
+  struct EventState {
+    std::string primarySpecies = "unknown";
+    G4ThreeVector primaryPosition;
+    G4double primaryEnergy = -1.0;
+    std::unordered_map<G4int, TrackInfo> trackInfo;
+    std::unordered_map<G4int, PhotonCreationInfo> photonCreationInfo;
+    std::unordered_map<const void*, G4ThreeVector> pendingPhotonOrigin;
+    std::unordered_map<G4int, G4ThreeVector> photonScintillatorExit;
+    std::unordered_map<G4int, G4ThreeVector> secondaryScintillatorEndpoint;
+    std::unordered_map<G4int, G4double> primaryScintillatorFirstInteractionTime;
+    std::unordered_map<G4int, PrimaryActivity> primaryActivity;
+    std::vector<PhotonHitRecord> photonHits;
+    /// Detected photons counted without a hit record (`/output/mode images`).
+    std::int64_t imagedPhotons = 0;
+  };
+
+  /// Event finished tracking locally but still owed sub-events. The photon
+  /// counts only feed the run-end warning; Geant4 decides completion.
+  struct PendingEvent {
+    EventState state;
+    G4bool ended = false;
+    std::int64_t dispatchedPhotons = 0;
+    std::int64_t returnedPhotons = 0;
+    std::vector<PhotonHitRecord> subEventHits;
+    std::int64_t subEventImagedPhotons = 0;
+  };
+
+  /// Clear per-event accumulators while keeping their allocated capacity.
+  void ResetEventState();
+  /// Reserve the per-thread initial capacities in `state`.
+  static void ReserveEventState(EventState* state);
+  /// Swap the current event's state into `pending`, leaving `fState` with a
+  /// recycled state of the same capacity (caller holds `fPendingMutex`).
+  void ParkEventState(PendingEvent* pending);
+  /// Capture primary species, position, and energy from the event's first vertex.
+  void RecordPrimary(const G4Event* event);
+  /// Append a detected photon hit to `state`, updating primary detection counts.
+  static void AppendPhotonHit(EventState* state, const PhotonHitRecord& hit);
+  /// Apply the event trigger to one completed event, then fill its images and
+  /// timing histograms, hand its rows to the output sinks, and count progress.
+  /// Events rejected by the trigger are only counted.
+  void WriteEventRows(G4int eventID, const EventState& state) const;
+  /// Add every detected photon in `state` to this thread's timing histograms.
+  static void FillTimingHistograms(const EventState& state);
+  /// Scintillation photons generated by all primaries of `state`.
+  static std::int64_t GeneratedPhotons(const EventState& state);
+  /// Count one completed event in the run progress counters.
+  static void CountCompletedEvent(const EventState& state);
+  /// Fold returned sub-event hits into a completed pending event, write it,
+  /// and recycle its state (caller holds `fPendingMutex`).
+  void FinishPendingEvent(G4int eventID, PendingEvent* pending);
+
   static G4ThreadLocal EventAction* fgInstance;
 
   const Config* fConfig = nullptr;
-  std::string fPrimarySpecies = "unknown";
-  G4ThreeVector fPrimaryPosition;
-  G4double fPrimaryEnergy = -1.0;
-  std::unordered_map<G4int, TrackInfo> fTrackInfo;
-  std::unordered_map<G4int, PhotonCreationInfo> fPhotonCreationInfo;
-  std::unordered_map<const void*, G4ThreeVector> fPendingPhotonOrigin;
-  std::unordered_map<G4int, G4ThreeVector> fPhotonScintillatorExit;
-  std::unordered_map<G4int, G4ThreeVector> fSecondaryScintillatorEndpoint;
-  std::unordered_map<G4int, G4double> fPrimaryScintillatorFirstInteractionTime;
-  std::unordered_map<G4int, PrimaryActivity> fPrimaryActivity;
-  std::vector<PhotonHitRecord> fPhotonHits;
+  EventState fState;
+  /// Cached from `Config` at BeginOfEventAction so hit capture skips the lock.
+  SimStructures::PhotonFieldMask fPhotonFields = SimStructures::PhotonField::kAll;
+  G4bool fWritesRows = true;
+  G4bool fRecordsHits = true;
+  /// Lens for in-process transport this run; null when transport is off.
+  std::shared_ptr<const LensTrace::Lens> fLens;
+  /// Surrogate used in place of `fLens` when set.
+  std::shared_ptr<const LensSurrogate::Model> fSurrogate;
+
+  /// Sub-event mode: owning-event threads dispatch photons, workers track them.
+  G4bool fSubEventMode = false;
+  G4bool fSubEventWorker = false;
+  /// Photons dispatched by the current event (owner) or tracked in the current
+  /// sub-event (worker).
+  std::int64_t fDispatchedPhotons = 0;
+  std::int64_t fTrackedPhotons = 0;
+  /// Events waiting for sub-event results; merges may arrive from any thread.
+  std::mutex fPendingMutex;
+  std::unordered_map<G4int, PendingEvent> fPendingEvents;
+  /// States of written pending events, reused by `ParkEventState`.
+  std::vector<EventState> fSpareStates;
+  /// BeginOfEventAction timestamp (set only in perf-counter builds).
+  std::chrono::steady_clock::time_point fEventStart;
+  /// End of BeginOfEventAction, opening the trace's tracking span.
+  std::uint64_t fTraceTrackingStart = 0;
 };
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef PhotonTrackInformation_h
+#define PhotonTrackInformation_h 1
+
+#include "eventstructures.hh"
+
+#include "G4VUserTrackInformation.hh"
+
+/// Optical-photon ancestry attached at creation so a hit can be attributed on
+/// any thread, including sub-event workers without the owning event's maps.
+class PhotonTrackInformation : public G4VUserTrackInformation {
+ public:
+  explicit PhotonTrackInformation(const SimStructures::PhotonCreationInfo& info)
+      : fCreationInfo(info) {}
+  ~PhotonTrackInformation() override = default;
+
+  const SimStructures::PhotonCreationInfo& GetCreationInfo() const { return fCreationInfo; }
+
+ private:
+  SimStructures::PhotonCreationInfo fCreationInfo;
+};
+
+#endif
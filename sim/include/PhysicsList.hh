@@ -0,0 +1,53 @@
+#ifndef PhysicsList_h
+#define PhysicsList_h 1
+
+#include "FTFP_BERT_HP.hh"
+
+#include <chrono>
+#include <string>
+
+class Config;
+
+/// FTFP_BERT_HP + optical physics with an opt-in persistent physics-table cache.
+///
+/// When `/g4emi/physics/tableCacheDir` is set, built physics tables are stored
+/// under `<cacheDir>/<key>/` after the first run and retrieved by later
+/// processes instead of being rebuilt. The key hashes the physics-list name,
+/// Geant4 version, scintillator material version, material table, and
+/// production cuts, so any change to those selects a fresh cache entry.
+class PhysicsList : public FTFP_BERT_HP {
+ public:
+  /// `config` supplies the cache directory and scintillator material version.
+  explicit PhysicsList(const Config* config);
+  ~PhysicsList() override = default;
+
+  /// Physics list registered with the current thread's run-manager kernel, if any.
+  static PhysicsList* FromRunManager();
+
+  /// Apply default cuts, then select cached tables for retrieval when present.
+  void SetCuts() override;
+
+  /// Store freshly built tables into the cache (master only, no-op on cache hit).
+  void StoreTableCacheIfNeeded();
+
+  /// Drop cache retrieval after post-initialization material/geometry changes.
+  void InvalidateTableCache();
+
+  /// Print cache state and elapsed time since physics initialization.
+  void ReportTableCacheStartup() const;
+
+ private:
+  /// Resolve `<cacheDir>/<key>` for the current materials and cuts.
+  std::string ResolveCacheEntryDirectory(const std::string& cacheRoot) const;
+
+  /// Read-only runtime configuration source.
+  const Config* fConfig = nullptr;
+  /// Cache entry directory selected for retrieval (empty when not retrieving).
+  std::string fRetrievedDirectory;
+  /// Physics initialization timestamp used for startup reporting.
+  std::chrono::steady_clock::time_point fInitializeStart;
+  /// True once `SetCuts` has run on the master thread.
+  bool fInitialized = false;
+};
+
+#endif
@@ -3,21 +3,28 @@
 
 #include "G4UserRunAction.hh"
 
+#include <chrono>
+
 class G4Run;
 class Config;
 
-/// Run-level validation before event processing starts.
+/// Run-level validation before event processing and end-of-run bookkeeping.
 class RunAction : public G4UserRunAction {
  public:
   explicit RunAction(const Config* config);
   ~RunAction() override = default;
 
-  /// Validate output paths on run start.
+  /// Validate output paths, apply task grain size, and start progress reporting.
   void BeginOfRunAction(const G4Run* run) override;
+  /// Finish progress reporting, report throughput and counters, and persist
+  /// fresh physics tables.
+  void EndOfRunAction(const G4Run* run) override;
 
  private:
   /// Read-only runtime configuration source.
   const Config* fConfig = nullptr;
+  /// Master-side wall-clock start of the current run.
+  std::chrono::steady_clock::time_point fRunStart;
 };
 
 #endif
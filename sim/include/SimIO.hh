@@ -3,7 +3,10 @@
 
 #include "structures.hh"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <variant>
 #include <vector>
 
 namespace SimIO {
@@ -12,6 +15,43 @@ namespace SimIO {
 using PrimaryInfo = SimStructures::PrimaryInfo;
 using SecondaryInfo = SimStructures::SecondaryInfo;
 using PhotonInfo = SimStructures::PhotonInfo;
+using ProfileInfo = SimStructures::ProfileInfo;
+using TransportedPhotonInfo = SimStructures::TransportedPhotonInfo;
+using PhotonFieldMask = SimStructures::PhotonFieldMask;
+template <typename T>
+using RowSpan = SimStructures::RowSpan<T>;
+
+/// Named scalar stored as an attribute of the `/run_stats` group.
+struct RunStatistic {
+  std::string name;
+  std::variant<std::int64_t, double> value;
+};
+
+/// One histogram dataset: row-major counts, their shape, and scalar attributes.
+/// `name` is relative to the group passed to `WriteCounts` and may contain `/`.
+struct CountsInfo {
+  std::string name;
+  std::vector<std::size_t> shape;
+  std::vector<std::uint64_t> counts;
+  std::vector<RunStatistic> attributes;
+};
+
+/// Lens and input-screen provenance stored as root attributes next to
+/// `/transported_photons`, under the names the Python transport stage uses.
+struct TransportAttributes {
+  std::string lensName;
+  std::string zmxPath;
+  /// Omitted from the file when empty.
+  std::string smxPath;
+  /// `transport_engine` value.
+  std::string engine = "g4emi-native";
+  /// `LensSurrogate` model file; omitted from the file when empty.
+  std::string surrogatePath;
+  bool screenDefined = false;
+  double screenDiameterMm = 0.0;
+  double screenCenterXmm = 0.0;
+  double screenCenterYmm = 0.0;
+};
 
 /// Normalize run name for filesystem-safe directory usage.
 std::string NormalizeRunName(const std::string& value);
@@ -25,13 +65,154 @@ std::string ComposeOutputPath(const std::string& base,
                               const std::string& runName,
                               const char* extension);
 
+/// Parse a `/output/photonFields` value: presets (`minimal`, `transport`,
+/// `full`) and column groups, separated by spaces or commas.
+bool ParsePhotonFields(const std::string& value,
+                       PhotonFieldMask* fields,
+                       std::string* errorMessage);
+
+/// Preset name for `fields`, or its column groups as a comma list.
+std::string DescribePhotonFields(PhotonFieldMask fields);
+
+/// Bytes of one packed `/photons` row holding `fields`.
+std::size_t PhotonRowBytes(PhotonFieldMask fields);
+
+/// Start a new run: the next open of each output path recreates the file.
+/// Within a run a path is created once; later opens append to it.
+void BeginRun();
+
+/// Select the `/photons` columns of files created after this call. Changing
+/// the selection closes the open file; the next append to it recreates it.
+void SetPhotonFields(PhotonFieldMask fields);
+
+/// Single-writer/multiple-reader access to the output file while a run
+/// appends rows (`/output/swmr/*`).
+struct SwmrSettings {
+  bool enabled = false;
+  /// Shortest time between flushes that make appended rows visible to
+  /// readers; 0 flushes after every append.
+  double flushIntervalSeconds = 1.0;
+  /// Create `/transported_photons` with the other row tables; no dataset can
+  /// be created once SWMR writing has started.
+  bool transported = false;
+};
+
+/// Select SWMR writing for files created after this call. Changing the
+/// settings closes the open file; the next append to it recreates it. With
+/// SWMR enabled, files use the latest file format and enter SWMR-write mode
+/// at the first row append. Writing anything but rows (run statistics,
+/// images, histograms, attributes) leaves SWMR mode for the rest of the run;
+/// that reopen waits up to 30 s for SWMR readers to close the file and fails
+/// if they do not.
+void SetSwmr(const SwmrSettings& settings);
+
 /// Append primary/secondary/photon rows to HDF5 datasets.
 bool AppendHdf5(const std::string& hdf5Path,
-                const std::vector<PrimaryInfo>& primaryRows,
-                const std::vector<SecondaryInfo>& secondaryRows,
-                const std::vector<PhotonInfo>& photonRows,
+                RowSpan<PrimaryInfo> primaryRows,
+                RowSpan<SecondaryInfo> secondaryRows,
+                RowSpan<PhotonInfo> photonRows,
                 std::string* errorMessage);
 
+/// Rows already in `/photons` when `hdf5Path` is the open file, else 0 (the
+/// next append recreates it).
+std::int64_t PhotonRowCount(const std::string& hdf5Path);
+
+/// Append rows to `/transported_photons`, creating the dataset on first use.
+/// `sourcePhotonIndexBase` is added to each row's `sourcePhotonIndex`, which
+/// callers give relative to the event's first `/photons` row.
+bool AppendTransported(const std::string& hdf5Path,
+                       RowSpan<TransportedPhotonInfo> rows,
+                       std::int64_t sourcePhotonIndexBase,
+                       std::string* errorMessage);
+
+/// Write the transport root attributes, creating an empty
+/// `/transported_photons` if no rows were appended.
+bool WriteTransportAttributes(const std::string& hdf5Path,
+                              const TransportAttributes& attributes,
+                              std::string* errorMessage);
+
+/// Replace the `/profile` dataset with `rows`.
+bool WriteProfile(const std::string& hdf5Path,
+                  const std::vector<ProfileInfo>& rows,
+                  std::string* errorMessage);
+
+/// Bytes the given row counts occupy in the native HDF5 row layouts (photon
+/// rows use the current `SetPhotonFields` selection).
+std::int64_t EncodedRowBytes(std::size_t primaryRows,
+                             std::size_t secondaryRows,
+                             std::size_t photonRows);
+
+/// One table of the `raw` output sink: a flat file of native rows.
+struct RawTable {
+  /// Absolute path, so the index resolves it from any working directory.
+  std::string path;
+  std::uint64_t rows = 0;
+};
+
+/// The `raw` sink's row files for one run. Rows use the layouts
+/// `AppendHdf5` writes in memory: native primary, secondary, and transported
+/// rows, and `/photons` packed to `photonFields`.
+struct RawTables {
+  RawTable primaries;
+  RawTable secondaries;
+  RawTable photons;
+  RawTable transported;
+  PhotonFieldMask photonFields = SimStructures::PhotonField::kAll;
+};
+
+/// Create `hdf5Path` (replacing it, and independent of the cached output
+/// file) with `/primaries`, `/secondaries`, `/photons`, and (when it has
+/// rows) `/transported_photons` as contiguous external datasets over the
+/// raw files, so HDF5 readers open them like ordinary datasets.
+bool WriteRawIndex(const std::string& hdf5Path,
+                   const RawTables& tables,
+                   std::string* errorMessage);
+
+/// Close the cached output file; the next append to its path recreates it.
+void Close();
+
+/// Replace the attributes of the `/run_stats` group with `stats`.
+bool WriteRunStats(const std::string& hdf5Path,
+                   const std::vector<RunStatistic>& stats,
+                   std::string* errorMessage);
+
+/// Replace the group at `groupPath` (e.g. `/images`) with `datasets`,
+/// attaching `attributes` to the group. Missing parent groups are created.
+bool WriteCounts(const std::string& hdf5Path,
+                 const std::string& groupPath,
+                 const std::vector<CountsInfo>& datasets,
+                 const std::vector<RunStatistic>& attributes,
+                 std::string* errorMessage);
+
+namespace detail {
+
+/// Convert semantic rows into their native HDF5 row layouts (used by
+/// `AppendHdf5`; exposed for `g4emi_bench`).
+std::vector<SimStructures::detail::Hdf5PrimaryNativeRow> ToNative(RowSpan<PrimaryInfo> rows);
+std::vector<SimStructures::detail::Hdf5SecondaryNativeRow> ToNative(
+    RowSpan<SecondaryInfo> rows);
+
+/// Pack the `fields` columns of `rows` into contiguous `/photons` rows.
+std::vector<unsigned char> PackPhotons(RowSpan<PhotonInfo> rows, PhotonFieldMask fields);
+
+/// Pack into `out`, which holds `rows.size * PhotonRowBytes(fields)` bytes.
+void PackPhotons(RowSpan<PhotonInfo> rows, PhotonFieldMask fields, unsigned char* out);
+
+/// One column of a packed `/photons` row.
+struct PhotonColumnInfo {
+  const char* name;
+  std::size_t offset;
+  /// 4 (int32) or 8 (int64 or double) bytes.
+  std::size_t size;
+  bool isFloat;
+};
+
+/// Columns of packed `/photons` rows holding `fields`, in file order (used by
+/// the Python module to describe captured rows).
+std::vector<PhotonColumnInfo> PhotonColumns(PhotonFieldMask fields);
+
+}  // namespace detail
+
 }  // namespace SimIO
 
 #endif
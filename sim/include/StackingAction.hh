@@ -0,0 +1,27 @@
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+
+class EventAction;
+class G4Track;
+
+/// Routes optical photons into sub-events when the sub-event backend is active.
+class StackingAction : public G4UserStackingAction {
+ public:
+  /// Sub-event type registered with the run manager for optical photons.
+  static constexpr G4int kOpticalPhotonSubEventType = 0;
+
+  /// `eventAction` counts dispatched photons for the owning event.
+  explicit StackingAction(EventAction* eventAction);
+  ~StackingAction() override = default;
+
+  /// Send optical photons of the owning event to sub-events; keep all else urgent.
+  G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track) override;
+
+ private:
+  /// Event-local sink for dispatch counts.
+  EventAction* fEventAction = nullptr;
+};
+
+#endif
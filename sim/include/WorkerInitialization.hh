@@ -0,0 +1,27 @@
+#ifndef WorkerInitialization_h
+#define WorkerInitialization_h 1
+
+#include "G4UserWorkerInitialization.hh"
+
+class Config;
+
+/// Pins each worker thread per `/g4emi/run/pinThreads` before its actions are built.
+///
+/// Geant4 calls `WorkerInitialize` on the new thread before `Build()`, so
+/// per-thread action buffers are first touched, and placed, on the pinned CPU's
+/// NUMA node.
+class WorkerInitialization : public G4UserWorkerInitialization {
+ public:
+  /// `config` supplies the pinning policy.
+  explicit WorkerInitialization(const Config* config);
+  ~WorkerInitialization() override = default;
+
+  /// Apply the pinning policy to the calling worker thread.
+  void WorkerInitialize() const override;
+
+ private:
+  /// Read-only runtime configuration source.
+  const Config* fConfig = nullptr;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef affinity_h
+#define affinity_h 1
+
+#include <string>
+#include <vector>
+
+/// Worker-thread CPU pinning helpers for `/g4emi/run/pinThreads`.
+namespace Affinity {
+
+/// Parsed pinning policy.
+struct Policy {
+  enum class Kind { None, Compact, Scatter, Explicit };
+  Kind kind = Kind::None;
+  /// CPU ids for `Kind::Explicit`, in assignment order.
+  std::vector<int> cpus;
+};
+
+/// Parse `none`, `compact`, `scatter`, or an explicit CPU list such as `0,2,8-15`.
+bool ParsePolicy(const std::string& text, Policy* out, std::string* errorMessage);
+
+/// CPUs in the order worker threads are assigned to them (thread i gets entry i mod size).
+/// `compact` fills one NUMA node before the next; `scatter` alternates nodes.
+std::vector<int> CpuOrder(const Policy& policy);
+
+/// Pin the calling thread to `cpu`; false when unsupported or rejected by the OS.
+bool PinCurrentThread(int cpu, std::string* errorMessage);
+
+/// CPU the calling thread was pinned to, or -1 when it is not pinned.
+int PinnedCpu();
+
+}  // namespace Affinity
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef capture_h
+#define capture_h 1
+
+#include "structures.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// In-memory row capture for in-process callers (the `g4emi_native` Python
+/// module).
+///
+/// While enabled, a run's only output sink appends each event's rows here
+/// instead of writing them to HDF5 (see `OutputSink`). Rows are stored once,
+/// back to back, in the same native layouts `SimIO` writes (`/photons`
+/// packed to the run's `/output/photonFields`), so a caller can hand the
+/// buffers out without converting them again.
+namespace Capture {
+
+/// One table's rows, contiguous.
+struct Table {
+  std::vector<unsigned char> bytes;
+  std::size_t rowBytes = 0;
+
+  std::size_t Rows() const { return rowBytes > 0 ? bytes.size() / rowBytes : 0; }
+};
+
+/// Everything captured since the last `Take`.
+struct Rows {
+  /// `SimStructures::detail::Hdf5PrimaryNativeRow` rows.
+  Table primaries;
+  /// `SimStructures::detail::Hdf5SecondaryNativeRow` rows.
+  Table secondaries;
+  /// Packed `/photons` rows holding `photonFields`.
+  Table photons;
+  /// `SimStructures::TransportedPhotonInfo` rows.
+  Table transported;
+  SimStructures::PhotonFieldMask photonFields = SimStructures::PhotonField::kAll;
+};
+
+/// Route event rows here (true) or to HDF5 (false, the default).
+void SetEnabled(bool enabled);
+bool Enabled();
+
+/// Start an empty capture whose photon rows hold `photonFields` (called by
+/// the master at run start); rows not yet taken are dropped.
+void BeginRun(SimStructures::PhotonFieldMask photonFields);
+
+/// Photon rows captured so far.
+std::int64_t PhotonRowCount();
+
+/// Append one event's rows, rebasing the event-relative `sourcePhotonIndex`
+/// of `transportedRows` onto the captured photons. Callers serialize calls
+/// with the output lock.
+void Append(SimStructures::RowSpan<SimStructures::PrimaryInfo> primaryRows,
+            SimStructures::RowSpan<SimStructures::SecondaryInfo> secondaryRows,
+            SimStructures::RowSpan<SimStructures::PhotonInfo> photonRows,
+            SimStructures::RowSpan<SimStructures::TransportedPhotonInfo> transportedRows);
+
+/// Hand over the captured rows, leaving the capture empty.
+Rows Take();
+
+}  // namespace Capture
+
+#endif
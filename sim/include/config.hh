@@ -2,12 +2,110 @@
 #define config_h 1
 
 #include "globals.hh"
+#include "structures.hh"
 
 #include <array>
 #include <mutex>
 #include <string>
 #include <vector>
 
+/// Event-level acceptance criteria checked before output rows are assembled.
+struct EventTrigger {
+  /// Minimum detected optical-interface photons (within the time window, if set).
+  G4int minPhotons = 0;
+  /// Minimum scintillation energy, estimated as generated photons / yield.
+  G4double minEnergyProxy = 0.0;
+  /// Accept only events with a detected photon from one of these secondaries.
+  std::vector<std::string> secondarySpecies;
+  /// Interface-hit time window; disabled while `timeMax` <= `timeMin`. A window
+  /// on its own accepts events with at least one hit inside it.
+  G4double timeMin = 0.0;
+  G4double timeMax = 0.0;
+
+  bool HasTimeWindow() const { return timeMax > timeMin; }
+  /// True when any criterion can reject an event.
+  bool Enabled() const {
+    return minPhotons > 0 || minEnergyProxy > 0.0 || !secondarySpecies.empty() ||
+           HasTimeWindow();
+  }
+};
+
+/// Interface-hit histogram binning for `/images` (Geant4 length/time units).
+struct ImageBinning {
+  G4int binsX = 256;
+  G4int binsY = 256;
+  /// Image extent; an axis with `max` <= `min` spans the optical-interface face.
+  G4double xMin = 0.0;
+  G4double xMax = 0.0;
+  G4double yMin = 0.0;
+  G4double yMax = 0.0;
+  /// Time slices for `/images/xyt`; disabled while 0 or `timeMax` <= `timeMin`.
+  G4int timeBins = 0;
+  G4double timeMin = 0.0;
+  G4double timeMax = 0.0;
+
+  bool HasTimeSlices() const { return timeBins > 0 && timeMax > timeMin; }
+};
+
+/// Per-species photon timing histograms for `/histograms/timing` (Geant4 time units).
+struct TimingBinning {
+  /// Bins per histogram; 0 disables timing histograms.
+  G4int bins = 0;
+  /// Creation-delay histograms span [0, `delayMax`).
+  G4double delayMax = 0.0;
+  /// Interface-arrival histograms span [0, `arrivalMax`).
+  G4double arrivalMax = 0.0;
+
+  bool Enabled() const { return bins > 0 && delayMax > 0.0 && arrivalMax > 0.0; }
+};
+
+/// In-process lens transport into `/transported_photons` (Geant4 length units).
+struct LensTransport {
+  /// Lens prescription as for `LensTrace::ResolveZmxPath`; empty disables transport.
+  std::string lens;
+  /// Glass overrides; empty infers the `.smx` from the lens file.
+  std::string smx;
+  /// `LensSurrogate` model file used instead of tracing `lens`; empty traces exactly.
+  std::string surrogate;
+  /// Intensifier input-screen circle for `in_bounds`; 0 diameter marks every hit in bounds.
+  G4double screenDiameter = 0.0;
+  G4double screenCenterX = 0.0;
+  G4double screenCenterY = 0.0;
+
+  bool Enabled() const { return !lens.empty() || !surrogate.empty(); }
+};
+
+/// Shared-memory ring (`ShmRing`) settings of the `shm` output sink.
+struct ShmStream {
+  /// `shm_open` segment name.
+  std::string name = "/g4emi_photons";
+  /// Ring data size in MiB (rounded up to a power of two).
+  G4int sizeMiB = 64;
+  /// `block` waits for readers that claimed a slot; `drop` discards batches instead.
+  std::string policy = "block";
+  /// Longest `block` wait per batch (Geant4 time units); 0 waits while readers live.
+  G4double blockTimeout = 0.0;
+};
+
+/// Row-file settings of the `raw` output sink.
+struct RawStream {
+  /// Directory for the row files and their HDF5 index; empty uses
+  /// `<HDF5 file stem>_raw` next to the HDF5 file.
+  std::string directory;
+  /// Write buffer per row file in MiB.
+  G4int bufferMiB = 8;
+  /// Open the row files with `O_DIRECT`, bypassing the page cache.
+  G4bool direct = false;
+};
+
+/// Single-writer/multiple-reader (SWMR) settings of the HDF5 row output.
+struct SwmrOutput {
+  /// Let readers open the file while rows are appended.
+  G4bool enabled = false;
+  /// Shortest time between flushes that make new rows visible (Geant4 time units).
+  G4double flushInterval = 0.0;
+};
+
 /// Thread-safe runtime configuration shared across geometry/actions/messenger.
 class Config {
  public:
@@ -166,6 +264,98 @@ class Config {
 
   /// Get HDF5 output file path derived from output settings.
   std::string GetHdf5FilePath() const;
+  /// Get selected optional `/photons` column groups (`SimStructures::PhotonField` bits).
+  SimStructures::PhotonFieldMask GetPhotonFields() const;
+  /// Set selected optional `/photons` column groups.
+  void SetPhotonFields(SimStructures::PhotonFieldMask value);
+  /// Get output mode (`rows`, `images`, or `both`).
+  std::string GetOutputMode() const;
+  /// Set output mode (lower-cased; empty selects `rows`).
+  void SetOutputMode(const std::string& value);
+  /// Get the output sinks accepted events' rows go to (`OutputSink` names).
+  std::vector<std::string> GetOutputSinks() const;
+  /// Set the output sinks (names already validated by `OutputSink::ParseSinks`).
+  void SetOutputSinks(const std::vector<std::string>& value);
+  /// Get interface-hit image binning.
+  ImageBinning GetImageBinning() const;
+  /// Set interface-hit image binning.
+  void SetImageBinning(const ImageBinning& value);
+  /// Get photon timing-histogram binning.
+  TimingBinning GetTimingBinning() const;
+  /// Set photon timing-histogram binning.
+  void SetTimingBinning(const TimingBinning& value);
+  /// Get in-process lens transport settings.
+  LensTransport GetLensTransport() const;
+  /// Set in-process lens transport settings.
+  void SetLensTransport(const LensTransport& value);
+  /// Get shared-memory stream settings.
+  ShmStream GetShmStream() const;
+  /// Set shared-memory stream settings.
+  void SetShmStream(const ShmStream& value);
+  /// Get raw row-file settings.
+  RawStream GetRawStream() const;
+  /// Set raw row-file settings.
+  void SetRawStream(const RawStream& value);
+  /// Get SWMR live-read settings.
+  SwmrOutput GetSwmrOutput() const;
+  /// Set SWMR live-read settings.
+  void SetSwmrOutput(const SwmrOutput& value);
+
+  /// Get physics-table cache root directory (empty disables the cache).
+  std::string GetPhysicsTableCacheDir() const;
+  /// Set physics-table cache root directory (empty string disables the cache).
+  void SetPhysicsTableCacheDir(const std::string& value);
+
+  /// Get requested worker-thread count (-1 keeps the Geant4 default, 0 uses all cores).
+  G4int GetRunThreads() const;
+  /// Set requested worker-thread count (-1 keeps the Geant4 default, 0 uses all cores).
+  void SetRunThreads(G4int value);
+  /// Get events handed to a worker per task/seed batch (0 keeps the Geant4 heuristic).
+  G4int GetEventsPerTask() const;
+  /// Set events handed to a worker per task/seed batch (0 keeps the Geant4 heuristic).
+  void SetEventsPerTask(G4int value);
+  /// Get worker pinning policy (`none`, `compact`, `scatter`, or a CPU list).
+  std::string GetPinThreadsPolicy() const;
+  /// Set worker pinning policy (lower-cased; empty selects `none`).
+  void SetPinThreadsPolicy(const std::string& value);
+  /// Get optical photons per sub-event for the `subevent` backend.
+  G4int GetPhotonsPerSubEvent() const;
+  /// Set optical photons per sub-event for the `subevent` backend.
+  void SetPhotonsPerSubEvent(G4int value);
+  /// Get run-manager backend name (`default`, `tasking`, `tbb`, `mt`, `serial`, or `subevent`).
+  std::string GetRunManagerBackend() const;
+  /// Set run-manager backend name (lower-cased; empty selects `default`).
+  void SetRunManagerBackend(const std::string& value);
+  /// Backend name as `SetRunManagerBackend` stores it.
+  static std::string NormalizeRunManagerBackend(const std::string& value);
+  /// Get step-profiler sampling interval (0 disables, 1 profiles every step).
+  G4int GetStepProfileInterval() const;
+  /// Set step-profiler sampling interval (0 disables, 1 profiles every step).
+  void SetStepProfileInterval(G4int value);
+  /// Get Chrome trace-event output path (empty disables tracing).
+  std::string GetTraceFile() const;
+  /// Set Chrome trace-event output path (empty string disables tracing).
+  void SetTraceFile(const std::string& value);
+  /// Get JSON-lines progress file path (empty disables progress reporting).
+  std::string GetProgressFile() const;
+  /// Set JSON-lines progress file path (empty string disables progress reporting).
+  void SetProgressFile(const std::string& value);
+  /// Get progress snapshot interval in Geant4 time units.
+  G4double GetProgressInterval() const;
+  /// Set progress snapshot interval in Geant4 time units.
+  void SetProgressInterval(G4double value);
+  /// Get the event trigger (default accepts every event).
+  EventTrigger GetEventTrigger() const;
+  /// Set minimum detected photons per accepted event (0 disables).
+  void SetTriggerMinPhotons(G4int value);
+  /// Set minimum scintillation-energy proxy in Geant4 energy units (0 disables).
+  void SetTriggerMinEnergyProxy(G4double value);
+  /// Set required secondary species from a space/comma list (empty disables).
+  void SetTriggerSecondarySpecies(const std::string& value);
+  /// Set trigger time-window start in Geant4 time units.
+  void SetTriggerTimeMin(G4double value);
+  /// Set trigger time-window end in Geant4 time units (<= start disables).
+  void SetTriggerTimeMax(G4double value);
 
  private:
   /// Guards all mutable config fields for cross-thread read/write safety.
@@ -212,6 +402,34 @@ class Config {
   std::string fOutputFilename;
   std::string fOutputPath;
   std::string fOutputRunName;
+  SimStructures::PhotonFieldMask fPhotonFields;
+  std::string fOutputMode;
+  std::vector<std::string> fOutputSinks;
+  ImageBinning fImageBinning;
+  TimingBinning fTimingBinning;
+  LensTransport fLensTransport;
+  ShmStream fShmStream;
+  RawStream fRawStream;
+  SwmrOutput fSwmrOutput;
+  std::string fPhysicsTableCacheDir;
+
+  /// Run-manager threading controls.
+  G4int fRunThreads = -1;
+  G4int fEventsPerTask = 0;
+  G4int fPhotonsPerSubEvent = 0;
+  std::string fPinThreadsPolicy;
+  std::string fRunManagerBackend;
+
+  /// Step-profiler sampling interval.
+  G4int fStepProfileInterval = 0;
+  std::string fTraceFile;
+
+  /// Progress reporting controls.
+  std::string fProgressFile;
+  G4double fProgressInterval = 0.0;
+
+  /// Event trigger criteria.
+  EventTrigger fEventTrigger;
 };
 
 #endif
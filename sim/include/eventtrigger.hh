@@ -0,0 +1,42 @@
+#ifndef eventtrigger_h
+#define eventtrigger_h 1
+
+#include "eventstructures.hh"
+
+#include "G4Types.hh"
+
+#include <cstdint>
+#include <vector>
+
+struct EventTrigger;
+
+/// Event-level acceptance behind `/g4emi/trigger/*`.
+///
+/// Each thread caches the run's criteria at run start, so completed events are
+/// checked without locking `Config`. Events the trigger rejects are counted
+/// but never reach the interface images, the timing histograms, or the output
+/// sinks.
+namespace Trigger {
+
+/// Cache `trigger` and the scintillation yield (photons per MeV, for the
+/// energy proxy) on the calling thread for its next run.
+void BeginThreadRun(const EventTrigger& trigger, G4double scintYield);
+
+/// True when the calling thread's trigger can reject events this run.
+bool Enabled();
+
+/// True when an event that generated `generatedPhotons` scintillation photons
+/// and detected `hits` meets the calling thread's trigger.
+bool Accepts(std::int64_t generatedPhotons,
+             const std::vector<SimStructures::PhotonHitRecord>& hits);
+
+/// True when such an event meets `trigger`. A time window on its own asks for
+/// at least one hit inside it.
+bool Accepts(const EventTrigger& trigger,
+             G4double scintYield,
+             std::int64_t generatedPhotons,
+             const std::vector<SimStructures::PhotonHitRecord>& hits);
+
+}  // namespace Trigger
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef imaging_h
+#define imaging_h 1
+
+#include "G4Types.hh"
+
+#include <cstdint>
+#include <string>
+
+struct ImageBinning;
+
+/// Interface-hit image accumulation behind `/output/mode images`.
+///
+/// Each thread fills its own x/y (and optional x/y/t) count histograms from
+/// the optical-interface sensitive detector without locking. Threads hand
+/// their counts over at end of run, and the master sums them and writes
+/// `/images/xy` and `/images/xyt`.
+namespace Imaging {
+
+/// Record the optical-interface face extent used for unset image ranges.
+void SetInterfaceExtent(G4double xMin, G4double xMax, G4double yMin, G4double yMax);
+
+/// Resolve the x/y image range of `binning` into `range` (xMin, xMax, yMin,
+/// yMax): its own bounds, or the interface extent for axes left unset. False
+/// when the range is empty.
+bool ResolveRange(const ImageBinning& binning, G4double range[4]);
+
+/// Enable or disable accumulation on the calling thread for its next run.
+void BeginThreadRun(bool enabled, const ImageBinning& binning);
+
+/// True when the calling thread accumulates interface hits this run.
+bool Enabled();
+
+/// Count one interface hit at global `x`, `y` and time `t` (Geant4 units).
+void Fill(G4double x, G4double y, G4double t);
+
+/// Add the calling thread's counts to the run totals.
+void EndThreadRun();
+
+/// Write this run's summed images to `hdf5Path` and clear them. `hits`
+/// receives the number of interface hits counted (in range or not).
+bool WriteRun(const std::string& hdf5Path, std::int64_t* hits, std::string* errorMessage);
+
+}  // namespace Imaging
+
+#endif
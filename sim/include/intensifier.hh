@@ -0,0 +1,130 @@
+#ifndef intensifier_h
+#define intensifier_h 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Native streaming form of the intensifier response chain.
+///
+/// Mirrors `src/intensifier/`: photocathode detection with interpolated QE and
+/// transit-time spread (`photocathode.py`), two-stage gamma MCP gain with
+/// gain-dependent spread (`mcp.py`), and the fast/slow phosphor delay with PSF
+/// blur (`phosphor.py`). The three stages run fused, one photon at a time, so
+/// no per-stage batches are built. Random numbers come from a Philox
+/// counter-based generator keyed by the seed and the photon's
+/// `source_photon_index`, so results do not depend on chunking, thread count,
+/// or which other photons are processed. They follow the Python
+/// stage's distributions but not its numpy random stream.
+namespace Intensifier {
+
+/// `PhotocathodeParams`, `McpParams`, and `PhosphorParams` in one block;
+/// defaults follow `IntensifierConfig`.
+struct Params {
+  std::vector<double> qeWavelengthNm{350.0, 500.0, 650.0};
+  std::vector<double> qeValues{0.15, 0.25, 0.05};
+  double collectionEfficiency = 1.0;
+  double ttsSigmaNs = 0.0;
+
+  double stage1MeanGain = 8.0;
+  double stage1GainShape = 2.0;
+  double stage2MeanGain = 800.0;
+  double stage2GainShape = 2.0;
+  double gainRef = 1000.0;
+  double spreadSigma0Mm = 0.03;
+  double spreadGainExponent = 0.4;
+
+  double phosphorGain = 1.0;
+  double decayFastNs = 70.0;
+  double decaySlowNs = 200.0;
+  double fastFraction = 0.9;
+  double psfSigmaMm = 0.04;
+};
+
+/// Same checks as the `__post_init__` of the Python parameter classes.
+bool ValidateParams(const Params& params, std::string* errorMessage);
+
+/// Apply one `--flag VALUE` parameter option of the native apps
+/// (`--tts-sigma 0.5`, `--qe-values 0.1,0.2`, ...); false when `flag` is not
+/// one. Malformed numbers throw as `std::stod` does.
+bool ApplyOption(const std::string& flag, const std::string& value, Params* params);
+
+/// Usage lines for the options `ApplyOption` accepts.
+const char* OptionsUsage();
+
+/// One `/transported_photons` row, as the Python loader reads it.
+struct Photon {
+  std::int64_t sourcePhotonIndex = -1;
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t photonTrackId = -1;
+  double xMm = 0.0;
+  double yMm = 0.0;
+  double timeNs = 0.0;
+  double wavelengthNm = 0.0;
+  std::int8_t inBounds = 1;
+};
+
+/// One `/intensifier_output_events` row.
+struct OutputEvent {
+  std::int64_t sourcePhotonIndex = -1;
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t photonTrackId = -1;
+  double outputXmm = 0.0;
+  double outputYmm = 0.0;
+  double outputTimeNs = 0.0;
+  double signalAmplitudeArb = 0.0;
+  double totalGain = 0.0;
+  double wavelengthNm = 0.0;
+};
+
+/// Philox4x32-10 stream for one photon (Salmon et al., SC'11).
+///
+/// The key is the run seed and the counter's upper half the photon's
+/// `source_photon_index`, so every photon draws from its own reproducible
+/// stream.
+class Philox {
+ public:
+  Philox(std::uint64_t seed, std::uint64_t stream);
+
+  std::uint32_t Next();
+  /// Uniform on [0, 1) with 53 random bits.
+  double Uniform();
+  /// Standard normal (Box-Muller; the second value is kept for the next call).
+  double Normal();
+  /// Exponential with unit mean.
+  double Exponential();
+  /// Gamma with unit scale (Marsaglia-Tsang).
+  double Gamma(double shape);
+
+ private:
+  void Refill();
+
+  std::uint32_t fKey[2];
+  std::uint32_t fCounter[4];
+  std::uint32_t fBlock[4];
+  int fUsed = 4;
+  bool fHasSpare = false;
+  double fSpare = 0.0;
+};
+
+/// Photocathode QE at `wavelengthNm`; `np.interp` with zero outside the table.
+double InterpolateQe(const Params& params, double wavelengthNm);
+
+/// Run the full chain over `count` photons, appending the detected photons'
+/// output events in input order. With `requireInBounds`, rows whose
+/// `inBounds` is 0 are skipped as the Python loader does.
+void Process(const Params& params,
+             std::uint64_t seed,
+             const Photon* photons,
+             std::size_t count,
+             bool requireInBounds,
+             std::vector<OutputEvent>* events);
+
+}  // namespace Intensifier
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef lenssurrogate_h
+#define lenssurrogate_h 1
+
+#include "lenstrace.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Polynomial stand-in for `LensTrace::Trace`.
+///
+/// A ray is described by its pupil vector p (entrance-plane offset from the
+/// chief ray of its field), its field vector f (slopes dx/dz, dy/dz), and
+/// its wavelength. The lenses are rotationally symmetric, so the image point
+/// is A p + B f with A, B scalar functions of |p|^2, p.f, |f|^2, and
+/// 1/lambda^2; the model expands A, B, and the image z in Legendre
+/// polynomials of those invariants. Vignetting is modelled per limiting
+/// aperture by a lower-degree expansion of 1 - (r / semiDiameter)^2, and a
+/// ray is transmitted when every one is positive. `Evaluate` drops rays
+/// outside the fitted domain, then rays an aperture stops, before paying for
+/// the image terms. Models are fitted from `TraceUnclipped` samples and
+/// stored as small HDF5 files.
+namespace LensSurrogate {
+
+/// Scalar inputs: |p|^2, p.f, |f|^2, and 1/lambda^2 (p pupil, f field).
+constexpr std::size_t kInvariants = 4;
+
+/// Sampling and basis settings for `Fit`.
+struct FitOptions {
+  /// Maximum total degree in the invariants of the image polynomials.
+  int degree = 4;
+  /// Maximum total degree in the invariants of the aperture polynomials.
+  int maskDegree = 3;
+  /// Grid points per pupil and field axis.
+  int gridPoints = 11;
+  /// Maximum degree in 1/lambda^2; dispersion varies slowly.
+  int wavelengthDegree = 2;
+  /// Grid points along 1/lambda^2.
+  int wavelengthPoints = 4;
+  /// Fitted wavelength range; evaluation clamps wavelengths into it.
+  double wavelengthMinNm = 380.0;
+  double wavelengthMaxNm = 700.0;
+  /// Entrance radius scanned for transmitted rays; 0 uses the first
+  /// surface's semi-diameter.
+  double radiusMm = 0.0;
+};
+
+/// Agreement between a model and the exact trace on the same rays.
+struct Statistics {
+  std::size_t rays = 0;
+  /// Rays the exact trace and the model transmit.
+  std::size_t exactTransmitted = 0;
+  std::size_t modelTransmitted = 0;
+  /// Rays the model transmits but the trace vignettes, and the reverse.
+  std::size_t falsePass = 0;
+  std::size_t falseBlock = 0;
+  /// Image-point error over rays both transmit (mm).
+  double rmsErrorMm = 0.0;
+  double p99ErrorMm = 0.0;
+  double maxErrorMm = 0.0;
+};
+
+struct Model {
+  std::string lensName;
+  std::string zmxPath;
+  std::string smxPath;
+  int degree = 0;
+  /// Aperture polynomials use the leading `MaskTerms()` basis terms, those
+  /// of total degree <= maskDegree.
+  int maskDegree = 0;
+  /// Domain: pupil coordinates within +-pupilRadiusMm and slopes within
+  /// +-maxSlope; rays outside it are treated as vignetted.
+  double pupilRadiusMm = 0.0;
+  double maxSlope = 0.0;
+  /// The chief ray of slope s = (u, v) crosses the entrance plane at
+  /// s * (chiefRay[0] + chiefRay[1] * |s|^2) (mm).
+  std::array<double, 2> chiefRay{};
+  double wavelengthMinNm = 0.0;
+  double wavelengthMaxNm = 0.0;
+  /// Used for rays without a valid wavelength, as in `Trace`.
+  double primaryWavelengthNm = 0.0;
+  /// Per-term Legendre degree of each input, in order of total degree.
+  std::vector<std::array<std::uint8_t, kInvariants>> exponents;
+  /// A, B, and z with image (x, y) = A p + B f, p and f scaled to the domain
+  /// box: `imageCoefficients[output * Terms() + term]`.
+  std::vector<double> imageCoefficients;
+  /// Surface index of each modelled aperture.
+  std::vector<int> apertureSurfaces;
+  /// Clearance 1 - (r / semiDiameter)^2 at each aperture:
+  /// `apertureCoefficients[aperture * MaskTerms() + term]`.
+  std::vector<double> apertureCoefficients;
+  /// Held-out comparison recorded by the fitting tool.
+  Statistics validation;
+
+  std::size_t Terms() const { return exponents.size(); }
+  std::size_t MaskTerms() const;
+};
+
+/// Fit a model to `lens`.
+bool Fit(const LensTrace::Lens& lens,
+         const FitOptions& options,
+         Model* model,
+         std::string* errorMessage);
+
+/// Replace the batch's rays with their modelled image points, with the same
+/// contract as `LensTrace::Trace`.
+void Evaluate(const Model& model, LensTrace::RayBatch* batch);
+
+/// Compare `model` with `lens` on `rays` (left untouched).
+Statistics Compare(const LensTrace::Lens& lens,
+                   const Model& model,
+                   const LensTrace::RayBatch& rays);
+
+/// `count` rays drawn uniformly over the model domain.
+LensTrace::RayBatch SampleDomain(const Model& model, std::size_t count, std::uint64_t seed);
+
+bool Save(const std::string& path, const Model& model, std::string* errorMessage);
+bool Load(const std::string& path, Model* model, std::string* errorMessage);
+
+/// Share `model` (or nothing) with the worker threads for the next run.
+void SetActiveModel(std::shared_ptr<const Model> model);
+
+/// The model set by `SetActiveModel`, or null when surrogate transport is off.
+std::shared_ptr<const Model> ActiveModel();
+
+}  // namespace LensSurrogate
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef lenstrace_h
+#define lenstrace_h 1
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Native sequential ray tracer for the `lenses/zmxFiles` prescriptions.
+///
+/// Mirrors `RayOpticsLensTracer` in `src/optics/OpticalTransport.py`: the
+/// object gap is rebased to zero so rays start on the first surface's vertex
+/// plane at the optical-interface (x, y), directions are flipped to travel
+/// toward the image, every surface after the object clips rays at its
+/// semi-diameter (the stop included), and the image point is where the ray
+/// meets the last surface. Lengths are in mm and wavelengths in nm.
+namespace LensTrace {
+
+/// One sequential surface and the medium that follows it.
+struct Surface {
+  double curvature = 0.0;
+  double conic = 0.0;
+  /// Even-asphere terms: `asphere[i]` multiplies r^(2(i+1)) (`PARM 1..8`).
+  std::array<double, 8> asphere{};
+  bool aspheric = false;
+  /// Clear semi-diameter; 0 leaves the surface unclipped.
+  double semiDiameter = 0.0;
+  /// Vertex distance to the next surface (`DISZ`).
+  double thickness = 0.0;
+  bool stop = false;
+  /// Glass name after this surface; empty for air.
+  std::string glass;
+  /// Refractive index n = indexA + indexB / lambda^2 (lambda in um) fitted
+  /// through the glass nd and Vd; air is exactly 1.
+  double indexA = 1.0;
+  double indexB = 0.0;
+};
+
+/// A loaded prescription; `surfaces[0]` is the object surface.
+struct Lens {
+  std::string name;
+  std::string zmxPath;
+  std::string smxPath;
+  std::vector<Surface> surfaces;
+  /// Wavelengths with non-zero weight in the file, and the `PWAV` one used
+  /// for rays without a valid wavelength.
+  std::vector<double> wavelengthsNm;
+  double primaryWavelengthNm = 587.5618;
+};
+
+/// Rays traced together, one array per component so each surface pass is a
+/// flat loop over contiguous doubles.
+///
+/// Inputs are the interface position (`x`, `y`), direction, and wavelength
+/// (<= 0 or NaN selects the primary wavelength). `Trace` overwrites
+/// `x`, `y`, `z` with the image point and clears `valid` for rays that are
+/// vignetted, totally internally reflected, or miss a surface.
+struct RayBatch {
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> z;
+  std::vector<double> dx;
+  std::vector<double> dy;
+  std::vector<double> dz;
+  std::vector<double> wavelengthNm;
+  std::vector<std::uint8_t> valid;
+
+  void Resize(std::size_t n);
+  std::size_t Size() const { return x.size(); }
+};
+
+/// Resolve a lens argument: an existing path, a path under the repository
+/// root, a `lenses/catalog.yaml` entry (or "default"), or a file name (with
+/// or without `.zmx`) in `lenses/zmxFiles`.
+std::string ResolveZmxPath(const std::string& value);
+
+/// The `.smx` next to `zmxPath`, else `lenses/smxFiles/<stem>.smx`; empty when
+/// neither exists.
+std::string ResolveSmxPath(const std::string& zmxPath);
+
+/// Parse `zmxPath`. Glasses named in `smxPath` (may be empty) take their nd
+/// and Vd from its `ModelGlass` entries.
+bool Load(const std::string& zmxPath,
+          const std::string& smxPath,
+          Lens* lens,
+          std::string* errorMessage);
+
+/// Trace every ray in `batch` through `lens`.
+void Trace(const Lens& lens, RayBatch* batch);
+
+/// Trace without clipping at any aperture, storing r / semiDiameter where each
+/// ray meets each apertured surface in `apertureUse[surface * batch->Size() + ray]`
+/// (NaN where the ray never arrives). Rays are still lost to total internal
+/// reflection or a missed surface; a clipped `Trace` keeps exactly the rays
+/// whose every recorded use is <= 1 (within the aperture fuzz).
+void TraceUnclipped(const Lens& lens, RayBatch* batch, std::vector<double>* apertureUse);
+
+/// Share `lens` (or nothing) with the worker threads for the next run.
+void SetActiveLens(std::shared_ptr<const Lens> lens);
+
+/// The lens set by `SetActiveLens`, or null when transport is off.
+std::shared_ptr<const Lens> ActiveLens();
+
+}  // namespace LensTrace
+
+#endif
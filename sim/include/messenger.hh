@@ -7,6 +7,7 @@
 
 class Config;
 class G4UIdirectory;
+class G4UIcmdWithABool;
 class G4UIcmdWithADouble;
 class G4UIcmdWithADoubleAndUnit;
 class G4UIcmdWithAnInteger;
@@ -37,6 +38,17 @@ class Messenger : public G4UImessenger {
   G4UIdirectory* fOpticalInterfaceDir = nullptr;
   G4UIdirectory* fOpticalInterfaceGeomDir = nullptr;
   G4UIdirectory* fOutputDir = nullptr;
+  G4UIdirectory* fG4emiDir = nullptr;
+  G4UIdirectory* fPhysicsDir = nullptr;
+  G4UIdirectory* fRunDir = nullptr;
+  G4UIdirectory* fProfileDir = nullptr;
+  G4UIdirectory* fTriggerDir = nullptr;
+  G4UIdirectory* fImageDir = nullptr;
+  G4UIdirectory* fTimingDir = nullptr;
+  G4UIdirectory* fTransportDir = nullptr;
+  G4UIdirectory* fShmDir = nullptr;
+  G4UIdirectory* fRawDir = nullptr;
+  G4UIdirectory* fSwmrDir = nullptr;
 
   /// Scintillator geometry/material commands.
   G4UIcmdWithAString* fGeomMaterialCmd = nullptr;
@@ -75,6 +87,71 @@ class Messenger : public G4UImessenger {
   G4UIcmdWithAString* fOutputPathCmd = nullptr;
   G4UIcmdWithAString* fOutputFilenameCmd = nullptr;
   G4UIcmdWithAString* fOutputRunNameCmd = nullptr;
+  G4UIcmdWithAString* fOutputPhotonFieldsCmd = nullptr;
+  G4UIcmdWithAString* fOutputModeCmd = nullptr;
+  G4UIcmdWithAString* fOutputSinkCmd = nullptr;
+
+  /// Interface-image binning commands.
+  G4UIcmdWithAnInteger* fImageBinsXCmd = nullptr;
+  G4UIcmdWithAnInteger* fImageBinsYCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageXMinCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageXMaxCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageYMinCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageYMaxCmd = nullptr;
+  G4UIcmdWithAnInteger* fImageTimeBinsCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageTimeMinCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fImageTimeMaxCmd = nullptr;
+
+  /// Photon timing-histogram commands.
+  G4UIcmdWithAnInteger* fTimingBinsCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTimingDelayMaxCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTimingArrivalMaxCmd = nullptr;
+
+  /// In-process lens transport commands.
+  G4UIcmdWithAString* fTransportLensCmd = nullptr;
+  G4UIcmdWithAString* fTransportSmxCmd = nullptr;
+  G4UIcmdWithAString* fTransportSurrogateCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTransportScreenDiameterCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTransportScreenCenterXCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTransportScreenCenterYCmd = nullptr;
+
+  /// Shared-memory stream commands.
+  G4UIcmdWithAString* fShmNameCmd = nullptr;
+  G4UIcmdWithAnInteger* fShmSizeCmd = nullptr;
+  G4UIcmdWithAString* fShmPolicyCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fShmBlockTimeoutCmd = nullptr;
+
+  /// Raw row-file commands.
+  G4UIcmdWithAString* fRawDirectoryCmd = nullptr;
+  G4UIcmdWithAnInteger* fRawBufferCmd = nullptr;
+  G4UIcmdWithABool* fRawDirectCmd = nullptr;
+
+  /// SWMR live-read commands.
+  G4UIcmdWithABool* fSwmrEnableCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fSwmrFlushIntervalCmd = nullptr;
+
+  /// Physics controls.
+  G4UIcmdWithAString* fPhysicsTableCacheDirCmd = nullptr;
+
+  /// Run-manager threading controls.
+  G4UIcmdWithAnInteger* fRunThreadsCmd = nullptr;
+  G4UIcmdWithAnInteger* fRunEventsPerTaskCmd = nullptr;
+  G4UIcmdWithAString* fRunTaskingBackendCmd = nullptr;
+  G4UIcmdWithAnInteger* fRunPhotonsPerSubEventCmd = nullptr;
+  G4UIcmdWithAString* fRunPinThreadsCmd = nullptr;
+  G4UIcmdWithAString* fRunProgressFileCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fRunProgressIntervalCmd = nullptr;
+
+  /// Profiling controls.
+  G4UIcmdWithAnInteger* fProfileStepsCmd = nullptr;
+  G4UIcmdWithAString* fProfileTraceFileCmd = nullptr;
+
+  /// Event trigger controls.
+  G4UIcmdWithAnInteger* fTriggerMinPhotonsCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTriggerMinEnergyProxyCmd = nullptr;
+  G4UIcmdWithAString* fTriggerSecondarySpeciesCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTriggerTimeMinCmd = nullptr;
+  G4UIcmdWithADoubleAndUnit* fTriggerTimeMaxCmd = nullptr;
 };
 
 #endif
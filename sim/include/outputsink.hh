@@ -0,0 +1,113 @@
+#ifndef outputsink_h
+#define outputsink_h 1
+
+#include "structures.hh"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Config;
+
+/// Destinations for accepted events' rows, selected by `/output/sink`.
+///
+/// `EventAction` assembles each accepted event's rows once and hands them, by
+/// span, to every sink of the run under the shared output lock. Sinks are
+/// created by the master at run start and ended after the workers finish, so
+/// `Consume` calls never overlap with `BeginRun` or `EndRun`. The built-in
+/// sinks are:
+///
+/// - `hdf5`: `/primaries`, `/secondaries`, `/photons`, and
+///   `/transported_photons` in the run's HDF5 file (`SimIO`).
+/// - `shm`: `/photons` batches published to a shared-memory ring (`ShmRing`).
+/// - `raw`: native rows appended to flat files, indexed at run end by an HDF5
+///   file of external datasets (`RawFile`, `SimIO::WriteRawIndex`).
+/// - `histogram`: per-run histograms of the accepted photons in
+///   `/histograms/photons`.
+/// - `null`: discards rows, for measuring simulation throughput alone.
+///
+/// While `Capture::Enabled()`, a run uses only the in-process capture instead.
+namespace OutputSink {
+
+/// One accepted event's rows, valid only for the duration of `Consume`.
+struct EventBatch {
+  std::int64_t eventId = -1;
+  SimStructures::RowSpan<SimStructures::PrimaryInfo> primaries;
+  SimStructures::RowSpan<SimStructures::SecondaryInfo> secondaries;
+  SimStructures::RowSpan<SimStructures::PhotonInfo> photons;
+  /// `sourcePhotonIndex` counts from the event's first `photons` row; sinks
+  /// that number photons across events rebase it.
+  SimStructures::RowSpan<SimStructures::TransportedPhotonInfo> transported;
+};
+
+/// Run settings every sink sees.
+struct RunInfo {
+  const Config* config = nullptr;
+  std::string hdf5Path;
+  SimStructures::PhotonFieldMask photonFields = SimStructures::PhotonField::kAll;
+};
+
+class Sink {
+ public:
+  virtual ~Sink() = default;
+
+  /// Prepare for a run on the master; false fails the run.
+  virtual bool BeginRun(const RunInfo& run, std::string* errorMessage) = 0;
+  /// Take one event's rows; called under the output lock.
+  virtual bool Consume(const EventBatch& batch, std::string* errorMessage) = 0;
+  /// Finish the run on the master, after the last `Consume`.
+  virtual bool EndRun(const RunInfo& run, std::string* errorMessage) {
+    (void)run;
+    (void)errorMessage;
+    return true;
+  }
+  /// True when the sink writes into `RunInfo::hdf5Path`.
+  virtual bool WritesHdf5() const { return false; }
+  /// True when the sink keeps every row it consumes, so the rows count as
+  /// written in the run progress.
+  virtual bool StoresRows() const { return false; }
+};
+
+using Factory = std::unique_ptr<Sink> (*)();
+
+/// Make `factory` selectable as `name`, replacing any sink of that name.
+void Register(const std::string& name, Factory factory);
+
+/// Registered sink names, built-ins first.
+std::vector<std::string> Names();
+
+/// Parse an `/output/sink` value: registered names separated by spaces or
+/// commas. Repeated names count once; the empty list is an error.
+bool ParseSinks(const std::string& value,
+                std::vector<std::string>* names,
+                std::string* errorMessage);
+
+/// Create and begin the run's sinks (the capture alone while
+/// `Capture::Enabled()`). On failure no sink stays active.
+bool BeginRun(const std::vector<std::string>& names,
+              const RunInfo& run,
+              std::string* errorMessage);
+
+/// Hand `batch` to every sink of the run. Every sink gets the batch even when
+/// an earlier one fails; `errorMessage` reports the first failure.
+bool Consume(const EventBatch& batch, std::string* errorMessage);
+
+/// True when the current run has any sink (none in `/output/mode images`).
+bool Active();
+
+/// True when a sink of the current run writes into its HDF5 file.
+bool WritesHdf5();
+
+/// True when a sink of the current run keeps the rows it consumes.
+bool StoresRows();
+
+/// True when sink `name` is part of the current run.
+bool Selected(const std::string& name);
+
+/// End and drop the run's sinks.
+bool EndRun(std::string* errorMessage);
+
+}  // namespace OutputSink
+
+#endif
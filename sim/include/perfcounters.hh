@@ -0,0 +1,73 @@
+#ifndef perfcounters_h
+#define perfcounters_h 1
+
+#include "SimIO.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// Per-thread hot-path counters merged into one report at end of run.
+///
+/// Built only with `-DG4EMI_WITH_PERF_COUNTERS=ON`. Call sites guard updates
+/// with `if constexpr (PerfCounters::kEnabled)`, so disabled builds compile
+/// them out entirely.
+namespace PerfCounters {
+
+#ifdef G4EMI_PERF_COUNTERS
+constexpr bool kEnabled = true;
+#else
+constexpr bool kEnabled = false;
+#endif
+
+/// Counters one thread accumulates during a run.
+struct Block {
+  /// Steps whose pre-step point lies in the scintillator scoring volume.
+  std::int64_t scintillatorSteps = 0;
+  /// Tracks started, keyed by output species label.
+  std::map<std::string, std::int64_t> tracksBySpecies;
+  /// Optical photons created in the scintillator, tracked, and detected.
+  std::int64_t opticalPhotonsCreated = 0;
+  std::int64_t opticalPhotonsTracked = 0;
+  std::int64_t opticalPhotonsDetected = 0;
+  /// Events completed and their Begin-to-EndOfEventAction wall time.
+  std::int64_t events = 0;
+  double eventSeconds = 0.0;
+  double maxEventSeconds = 0.0;
+  /// `SimIO::AppendHdf5` calls, time spent inside them, and bytes appended.
+  std::int64_t appendCalls = 0;
+  double appendSeconds = 0.0;
+  std::int64_t appendBytes = 0;
+  /// High-water sizes of per-event `EventAction` maps and hit buffer.
+  std::size_t peakTrackInfo = 0;
+  std::size_t peakPhotonCreationInfo = 0;
+  std::size_t peakPendingPhotonOrigin = 0;
+  std::size_t peakPhotonHits = 0;
+
+  /// Add `other` into this block (sums, maxima for peaks).
+  void Merge(const Block& other);
+};
+
+/// Counter block owned by the calling thread.
+inline Block& Local() {
+  static thread_local Block block;
+  return block;
+}
+
+/// Fold the calling thread's block into the run totals and reset it.
+void MergeLocal();
+
+/// Return the run totals and reset them for the next run.
+Block TakeMerged();
+
+/// Print a console summary of `totals` tagged with `runID`.
+void Report(int runID, const Block& totals);
+
+/// Flatten `totals` into named `/run_stats` attributes.
+std::vector<SimIO::RunStatistic> ToRunStatistics(int runID, const Block& totals);
+
+}  // namespace PerfCounters
+
+#endif
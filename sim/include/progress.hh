@@ -0,0 +1,52 @@
+#ifndef progress_h
+#define progress_h 1
+
+#include "G4Types.hh"
+
+#include <cstdint>
+#include <string>
+
+/// Run-wide progress counters shared by all threads and the JSON-lines
+/// reporter behind `/g4emi/run/progressFile`.
+namespace Progress {
+
+/// Counter values since the last `BeginRun`.
+struct Totals {
+  std::int64_t eventsCompleted = 0;
+  /// Completed events the event trigger kept out of the output.
+  std::int64_t eventsRejected = 0;
+  std::int64_t photonsGenerated = 0;
+  std::int64_t photonsDetected = 0;
+  std::int64_t rowsWritten = 0;
+  std::int64_t bytesWritten = 0;
+  /// Summed over threads: time spent waiting for, and holding, the output lock.
+  double outputWaitSeconds = 0.0;
+  double outputHeldSeconds = 0.0;
+};
+
+/// Reset counters for a run of `eventsTotal` events and, when `path` is not
+/// empty, start appending one snapshot every `intervalSeconds` to it.
+void BeginRun(G4int runID, std::int64_t eventsTotal, const std::string& path,
+              double intervalSeconds);
+
+/// Stop the reporter and append the final `done` snapshot.
+void EndRun();
+
+/// Count one completed event; returns events completed so far in this run.
+std::int64_t RecordEvent(std::int64_t photonsGenerated, std::int64_t photonsDetected);
+
+/// Count one event rejected by the event trigger (also pass it to `RecordEvent`).
+void RecordEventRejected();
+
+/// Count output rows and their encoded size in bytes.
+void RecordRowsWritten(std::int64_t rows, std::int64_t bytes);
+
+/// Count time one event spent waiting for and then holding the output lock.
+void RecordOutputLock(std::int64_t waitNs, std::int64_t heldNs);
+
+/// Current counter values.
+Totals Current();
+
+}  // namespace Progress
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef rawfile_h
+#define rawfile_h 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Append-only flat file written through one large aligned buffer.
+///
+/// Bytes collect in the buffer and go to the file with `pwrite` at
+/// buffer-aligned offsets, so with `direct` the file can be opened with
+/// `O_DIRECT` and bypass the page cache. File systems that refuse `O_DIRECT`
+/// (tmpfs, some network mounts) fall back to buffered writes. Used by the
+/// `raw` output sink (`OutputSink`); not thread-safe.
+namespace RawFile {
+
+/// `O_DIRECT` transfer alignment; buffers, offsets, and sizes are multiples.
+constexpr std::size_t kAlign = 4096;
+
+class Writer {
+ public:
+  Writer() = default;
+  ~Writer();
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  /// Create (truncating) `path` with a buffer of `bufferBytes`, rounded up to
+  /// a multiple of `kAlign` and at least two alignment blocks.
+  bool Open(const std::string& path, std::size_t bufferBytes, bool direct,
+            std::string* errorMessage);
+
+  /// Copy `bytes` bytes to the end of the file.
+  bool Append(const void* data, std::size_t bytes);
+
+  /// Room for `bytes` contiguous bytes at the end of the file, for callers
+  /// that fill rows in place; nullptr when `bytes` exceeds what the buffer
+  /// can ever hold contiguously (use `Append`) or a flush failed.
+  unsigned char* Claim(std::size_t bytes);
+
+  /// Write what is buffered and close the file.
+  bool Close(std::string* errorMessage);
+
+  bool IsOpen() const { return fFd >= 0; }
+  /// True while writes bypass the page cache.
+  bool Direct() const { return fDirect; }
+  /// Bytes appended so far.
+  std::uint64_t Bytes() const { return fOffset + fUsed; }
+  const std::string& Path() const { return fPath; }
+
+ private:
+  /// Write the buffered bytes up to the last alignment boundary (all of them
+  /// without `O_DIRECT`) and keep the rest at the buffer front.
+  bool Flush();
+  bool WriteAt(const unsigned char* data, std::size_t bytes, std::uint64_t offset);
+  void Release();
+
+  std::string fPath;
+  int fFd = -1;
+  bool fDirect = false;
+  unsigned char* fBuffer = nullptr;
+  std::size_t fCapacity = 0;
+  std::size_t fUsed = 0;
+  /// File offset of the buffer's first byte.
+  std::uint64_t fOffset = 0;
+  /// First write error, reported by `Close`.
+  std::string fError;
+};
+
+}  // namespace RawFile
+
+#endif
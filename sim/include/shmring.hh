@@ -0,0 +1,207 @@
+#ifndef shmring_h
+#define shmring_h 1
+
+#include "structures.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Live `/photons` stream through a POSIX shared-memory ring buffer.
+///
+/// One writer (the simulation, serialized by the output lock) publishes each
+/// event's photon rows as one batch, packed exactly as `SimIO` writes
+/// `/photons`. Any number of readers on the same node map the segment and
+/// follow along without locks:
+///
+/// - The writer owns the data area. It raises `reserved` before it writes a
+///   batch and `head` after, so a reader copies a batch and then checks
+///   `reserved` to see whether the writer overwrote it meanwhile
+///   (seqlock-style validation).
+/// - Readers that claim a slot publish their cursor, and the writer keeps
+///   that far behind them (`Policy::kBlock` waits; `Policy::kDrop` drops the
+///   batch). Readers without a slot never hold the writer back and skip ahead
+///   when they are overrun.
+/// - Every offered batch takes the next sequence number, published or not, so
+///   readers see drops and overruns as gaps.
+namespace ShmRing {
+
+constexpr char kMagic[8] = {'G', '4', 'E', 'M', 'I', 'R', 'B', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kMaxColumns = 32;
+constexpr std::size_t kMaxReaders = 16;
+/// Batches start on this boundary; it is also the record-header size.
+constexpr std::size_t kRecordAlign = 32;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "the shared ring needs address-free 64-bit atomics");
+
+/// One column of the published rows, as `SimIO::detail::PhotonColumnInfo`.
+struct Column {
+  char name[48];
+  std::uint32_t offset;
+  /// 4 (int32) or 8 (int64 or double) bytes.
+  std::uint32_t size;
+  std::uint32_t isFloat;
+  std::uint32_t reserved;
+};
+
+/// A reader's claim on the writer's attention.
+struct ReaderSlot {
+  /// Ring position the reader has consumed up to.
+  alignas(64) std::atomic<std::uint64_t> cursor;
+  /// 1 while claimed.
+  std::atomic<std::uint32_t> active;
+  /// Claiming process; the writer frees slots of processes that exited.
+  std::atomic<std::int32_t> pid;
+};
+
+/// Start of the segment; the data area follows at `headerBytes`.
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t headerBytes;
+  /// Data-area size, a power of two.
+  std::uint64_t dataBytes;
+  std::uint32_t rowBytes;
+  /// `SimStructures::PhotonField` bits of the rows.
+  std::uint32_t photonFields;
+  std::uint32_t columnCount;
+  std::uint32_t policy;
+  Column columns[kMaxColumns];
+
+  /// Bytes published (monotonic ring position of the end of the last batch).
+  alignas(64) std::atomic<std::uint64_t> head;
+  /// End of the bytes the writer may currently be writing.
+  std::atomic<std::uint64_t> reserved;
+  /// Batches offered so far; the next batch's sequence number.
+  std::atomic<std::uint64_t> offeredBatches;
+  std::atomic<std::uint64_t> droppedBatches;
+  std::atomic<std::uint64_t> droppedRows;
+  /// 1 once the writer has finished its run; nothing more will be published.
+  std::atomic<std::uint32_t> closed;
+
+  ReaderSlot readers[kMaxReaders];
+};
+
+/// Precedes each batch in the data area. A record with `rowCount` ==
+/// `kWrapRecord` only pads to the end of the data area.
+struct RecordHeader {
+  std::uint64_t sequence;
+  std::int64_t eventId;
+  std::uint32_t rowCount;
+  std::uint32_t recordBytes;
+  std::uint64_t reserved;
+};
+constexpr std::uint32_t kWrapRecord = 0xffffffffu;
+static_assert(sizeof(RecordHeader) == kRecordAlign, "record header must fill one slot");
+
+enum class Policy : std::uint32_t {
+  /// Wait for claimed readers, dropping the batch after `blockTimeout`.
+  kBlock = 0,
+  /// Drop batches that claimed readers have not made room for.
+  kDrop = 1,
+};
+
+/// `block` or `drop`.
+bool ParsePolicy(const std::string& value, Policy* policy);
+const char* PolicyName(Policy policy);
+
+struct WriterSettings {
+  /// `shm_open` name, e.g. `/g4emi_hits`.
+  std::string name;
+  /// Data-area size; rounded up to a power of two of at least 1 MiB.
+  std::size_t dataBytes = std::size_t{64} << 20;
+  Policy policy = Policy::kBlock;
+  /// Longest `kBlock` wait per batch; zero waits as long as readers live.
+  std::chrono::milliseconds blockTimeout{0};
+};
+
+/// Writer totals for one run.
+struct WriterStats {
+  std::uint64_t publishedBatches = 0;
+  std::uint64_t publishedRows = 0;
+  std::uint64_t droppedBatches = 0;
+  std::uint64_t droppedRows = 0;
+};
+
+/// Create (replacing any old segment of the same name) and map the ring for
+/// rows holding `photonFields`. Called by the master at run start.
+bool BeginRun(const WriterSettings& settings,
+              SimStructures::PhotonFieldMask photonFields,
+              std::string* errorMessage);
+
+/// True between `BeginRun` and `EndRun`.
+bool Active();
+
+/// Publish one event's photon rows as one batch. Callers serialize calls with
+/// the output lock they hold for `SimIO`.
+void Publish(std::int64_t eventId, SimStructures::RowSpan<SimStructures::PhotonInfo> photonRows);
+
+/// Mark the ring closed, unmap it, and remove its name; readers that are
+/// attached keep their mapping and drain what is left.
+WriterStats EndRun();
+
+/// One batch as a reader received it.
+struct Batch {
+  std::uint64_t sequence = 0;
+  std::int64_t eventId = -1;
+  std::uint32_t rowCount = 0;
+  /// `rowCount` rows of `Reader::RowBytes()` bytes.
+  std::vector<unsigned char> rows;
+};
+
+/// Follows a ring from another process (or thread).
+class Reader {
+ public:
+  enum class Status {
+    /// `Next` filled a batch.
+    kBatch,
+    /// Nothing new yet.
+    kEmpty,
+    /// The writer finished and everything published has been read.
+    kClosed,
+  };
+
+  Reader() = default;
+  ~Reader();
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  /// Map ring `name`. With `claimSlot` the writer keeps the ring from
+  /// overrunning this reader. Reading starts at the oldest batch still in the
+  /// ring unless `fromNewest`.
+  bool Open(const std::string& name, bool claimSlot, bool fromNewest, std::string* errorMessage);
+
+  /// Copy the next batch into `batch`.
+  Status Next(Batch* batch);
+
+  /// Sequence numbers skipped so far: batches the writer dropped plus batches
+  /// overwritten before this reader got to them.
+  std::uint64_t Lost() const { return fLost; }
+  /// Times this reader was overrun and skipped ahead to the newest batch.
+  std::uint64_t Overruns() const { return fOverruns; }
+
+  const Header* GetHeader() const { return fHeader; }
+  std::size_t RowBytes() const { return fHeader ? fHeader->rowBytes : 0; }
+
+ private:
+  void Close();
+
+  Header* fHeader = nullptr;
+  const unsigned char* fData = nullptr;
+  std::size_t fMappedBytes = 0;
+  ReaderSlot* fSlot = nullptr;
+  std::uint64_t fCursor = 0;
+  std::uint64_t fNextSequence = 0;
+  bool fSequenceKnown = false;
+  std::uint64_t fLost = 0;
+  std::uint64_t fOverruns = 0;
+};
+
+}  // namespace ShmRing
+
+#endif
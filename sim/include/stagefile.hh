@@ -0,0 +1,91 @@
+#ifndef stagefile_h
+#define stagefile_h 1
+
+#include <hdf5.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// HDF5 plumbing shared by the standalone post-processing stages
+/// (`g4emi_lenssurrogate`, `g4emi_intensifier`, `g4emi_timepix`, and
+/// `g4emi_pipeline`): row tables stored like the Python stages' numpy dtypes,
+/// the copied `/primaries` and `/secondaries`, and the file attributes the
+/// Python writers set. Functions return false (or a negative id) on HDF5
+/// errors and never throw.
+namespace StageFile {
+
+/// `/photons` interface-hit columns the lens stages read, by name.
+struct InterfaceHit {
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t photonTrackId = -1;
+  double x = 0.0;
+  double y = 0.0;
+  double timeNs = 0.0;
+  double dx = 0.0;
+  double dy = 0.0;
+  double dz = 0.0;
+  /// 0 when the file has no wavelength column ("unknown").
+  double wavelengthNm = 0.0;
+};
+
+/// Memory type reading `InterfaceHit` from a `/photons` file type. Columns the
+/// file lacks keep their defaults; without a position or direction column it
+/// fails with an `errorMessage` naming the missing one.
+hid_t InterfaceHitType(hid_t photonFileType, std::string* errorMessage);
+
+/// `/transported_photons` rows as `Intensifier::Photon`.
+hid_t TransportedPhotonType();
+
+/// `/intensifier_output_events` rows as `Intensifier::OutputEvent`.
+hid_t IntensifierEventType();
+
+/// `/timepix_hits` rows as `Timepix::Hit`.
+hid_t TimepixHitType();
+
+/// Create an empty extendible 1-D table of `memoryType` rows, stored packed.
+hid_t CreateTable(hid_t file, const char* name, hid_t memoryType, hsize_t chunkRows);
+
+/// Rows in a 1-D table.
+hsize_t RowCount(hid_t dataset);
+
+/// Read rows [first, first + count) of `dataset` into `rows`.
+bool ReadRows(hid_t dataset, hid_t memoryType, hsize_t first, hsize_t count, void* rows);
+
+/// Append `count` rows to the end of `dataset`.
+bool AppendRows(hid_t dataset, hid_t memoryType, const void* rows, std::size_t count);
+
+/// Copy `/primaries` and `/secondaries` from `source` when present, replacing
+/// any already in `destination`.
+bool CopyEventTables(hid_t source, hid_t destination);
+
+/// Turn a file the `SimIO` writer created for `/transported_photons` into a
+/// transport file: its empty `/photons`, `/primaries`, and `/secondaries` are
+/// dropped and `inputPath`'s tables copied in, as the Python transport stage
+/// does.
+bool FinishTransportFile(const std::string& inputPath,
+                         const std::string& outputPath,
+                         std::string* errorMessage);
+
+/// Copy one root attribute as stored, variable-length strings included; false
+/// when `source` does not have it.
+bool CopyAttribute(hid_t source, hid_t destination, const char* name);
+
+/// Scalar variable-length UTF-8 string attribute, as h5py writes `str`.
+bool WriteStringAttribute(hid_t object, const char* name, const std::string& value);
+
+/// Scalar unsigned 64-bit attribute.
+bool WriteUint64Attribute(hid_t object, const char* name, std::uint64_t value);
+
+/// `datetime.now(timezone.utc).isoformat()`.
+std::string UtcNowIso();
+
+/// Absolute form of an existing `path`, as the Python stages record inputs;
+/// `path` itself when it cannot be resolved.
+std::string AbsolutePath(const std::string& path);
+
+}  // namespace StageFile
+
+#endif
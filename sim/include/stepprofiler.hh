@@ -0,0 +1,132 @@
+#ifndef stepprofiler_h
+#define stepprofiler_h 1
+
+#include "SimIO.hh"
+
+#include "G4Types.hh"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+class G4LogicalVolume;
+class G4ParticleDefinition;
+class G4Step;
+class G4VProcess;
+
+/// Sampling step-time profiler behind `/g4emi/profile/steps`.
+///
+/// Every Nth step start (track start, or the end of the previous step) arms a
+/// timestamp; the step's cost (up to its `UserSteppingAction` call) is charged
+/// to its (particle, process defining the step, pre-step logical volume). A
+/// track's first step includes the tracking action's setup. Counts and times
+/// are scaled by N when merged, so N = 1 is an exact profile and larger N
+/// trades resolution for overhead.
+namespace StepProfiler {
+
+/// Bucket key; pointers are converted to names when threads merge.
+struct Key {
+  const G4ParticleDefinition* particle = nullptr;
+  const G4VProcess* process = nullptr;
+  const G4LogicalVolume* volume = nullptr;
+
+  bool operator==(const Key& other) const {
+    return particle == other.particle && process == other.process && volume == other.volume;
+  }
+};
+
+struct KeyHash {
+  std::size_t operator()(const Key& key) const {
+    std::size_t hash = reinterpret_cast<std::uintptr_t>(key.particle);
+    hash = hash * 31 + reinterpret_cast<std::uintptr_t>(key.process);
+    hash = hash * 31 + reinterpret_cast<std::uintptr_t>(key.volume);
+    return hash;
+  }
+};
+
+/// Sampled steps and clock ticks for one bucket.
+struct Entry {
+  std::int64_t steps = 0;
+  std::uint64_t ticks = 0;
+};
+
+/// Profiler state owned by one thread.
+struct ThreadState {
+  /// Sampling interval for this run (0 disables the profiler).
+  G4int sampleEvery = 0;
+  /// Steps left until the next armed sample.
+  G4int countdown = 0;
+  bool armed = false;
+  std::uint64_t armedTick = 0;
+  std::unordered_map<Key, Entry, KeyHash> entries;
+};
+
+inline ThreadState& Local() {
+  static thread_local ThreadState state;
+  return state;
+}
+
+/// Cheap monotonic tick counter (TSC on x86, steady_clock elsewhere).
+inline std::uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// Charge `ticks` to the bucket of `step`.
+void Record(ThreadState* state, const G4Step* step, std::uint64_t ticks);
+
+/// Decide whether the step about to start is sampled and, if so, arm the clock.
+inline void ArmIfDue(ThreadState* state) {
+  state->armed = --state->countdown <= 0;
+  if (state->armed) {
+    state->countdown = state->sampleEvery;
+    state->armedTick = ReadTicks();
+  }
+}
+
+/// Hot-path hook called first thing in `SteppingAction::UserSteppingAction`.
+inline void OnStep(const G4Step* step) {
+  auto& state = Local();
+  if (state.sampleEvery <= 0) {
+    return;
+  }
+  if (state.armed) {
+    Record(&state, step, ReadTicks() - state.armedTick);
+  }
+  ArmIfDue(&state);
+}
+
+/// Arm for the track's first step when it is due. This replaces any arm left
+/// by the previous track's last step, so time between tracks is never charged.
+inline void OnTrackStart() {
+  auto& state = Local();
+  if (state.sampleEvery > 0) {
+    ArmIfDue(&state);
+  }
+}
+
+/// Start profiling the calling thread's run (`sampleEvery` 0 disables).
+void BeginThreadRun(G4int sampleEvery);
+
+/// Convert the calling thread's buckets to named totals and merge them.
+void EndThreadRun();
+
+/// Run totals sorted by time, largest first; resets them for the next run.
+std::vector<SimIO::ProfileInfo> TakeRows();
+
+/// Print the `limit` most expensive buckets of `rows`.
+void Report(G4int runID, const std::vector<SimIO::ProfileInfo>& rows, std::size_t limit);
+
+}  // namespace StepProfiler
+
+#endif
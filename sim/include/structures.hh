@@ -1,15 +1,14 @@
 #ifndef structures_h
 #define structures_h 1
 
-#include "G4ThreeVector.hh"
-#include "G4Types.hh"
-
 #include <hdf5.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <string>
+#include <vector>
 
 namespace SimStructures {
 
@@ -74,6 +73,9 @@ struct SecondaryInfo {
  * Represents one detected optical photon row destined for the `/photons`
  * dataset in HDF5 output. This includes both creation-point metadata and
  * optical-interface crossing state needed for downstream optical propagation.
+ *
+ * The writer copies the selected members into packed `/photons` rows by
+ * offset, so keep this struct standard-layout with scalar members only.
  */
 struct PhotonInfo {
   /// Geant4 event ID (`G4Event::GetEventID()`).
@@ -121,56 +123,94 @@ struct PhotonInfo {
   double opticalInterfaceHitWavelengthNm = -1.0;
 };
 
-/// Event-local track metadata cached by Geant4 track ID.
-struct TrackInfo {
-  std::string species = "unknown";
-  G4ThreeVector originPosition;
-  G4double originEnergy = -1.0;
-  G4int primaryTrackID = -1;
+/**
+ * One photon traced through the lens, for the `/transported_photons` dataset.
+ *
+ * Matches the rows `src/optics/OpticalTransport.py` writes: only photons that
+ * reach the image plane get a row, and `sourcePhotonIndex` points back at
+ * their `/photons` row. Standard-layout so the writer can describe it to HDF5
+ * directly.
+ */
+struct TransportedPhotonInfo {
+  std::int64_t sourcePhotonIndex = -1;
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t photonTrackId = -1;
+  /// Image-plane hit in the lens image-surface frame, in mm.
+  double intensifierHitXmm = 0.0;
+  double intensifierHitYmm = 0.0;
+  double intensifierHitZmm = 0.0;
+  /// Interface crossing time in ns (the lens transit is not added).
+  double intensifierHitTimeNs = 0.0;
+  /// Photon wavelength in nm; NaN when it was not captured.
+  double intensifierHitWavelengthNm = std::numeric_limits<double>::quiet_NaN();
+  /// True inside the intensifier input screen (or when none is defined).
+  std::uint8_t inBounds = 1;
 };
 
-/// Optical-photon ancestry and creation context.
-struct PhotonCreationInfo {
-  G4int primaryTrackID = -1;
-  G4int secondaryTrackID = -1;
-  G4ThreeVector scintOriginPosition;
-  std::string secondarySpecies = "unknown";
-  G4ThreeVector secondaryOriginPosition;
-  G4double secondaryOriginEnergy = -1.0;
-};
+/// Borrowed view of contiguous rows, valid while its owner is. Converts
+/// implicitly from `std::vector`, so writers take rows without copying them.
+template <typename T>
+struct RowSpan {
+  const T* data = nullptr;
+  std::size_t size = 0;
 
-/// Per-primary activity counters accumulated during stepping/hit capture.
-struct PrimaryActivity {
-  std::int64_t createdSecondaryCount = 0;
-  std::int64_t generatedOpticalPhotonCount = 0;
-  std::int64_t detectedOpticalInterfacePhotonCount = 0;
-};
+  RowSpan() = default;
+  RowSpan(const T* rows, std::size_t count) : data(rows), size(count) {}
+  RowSpan(const std::vector<T>& rows) : data(rows.data()), size(rows.size()) {}
 
-/// One detected optical-interface photon hit.
-struct PhotonHitRecord {
-  G4int primaryID = -1;
-  G4int secondaryID = -1;
-  G4int photonID = -1;
+  const T* begin() const { return data; }
+  const T* end() const { return data + size; }
+  bool empty() const { return size == 0; }
+  const T& operator[](std::size_t i) const { return data[i]; }
+};
 
-  std::string primarySpecies = "unknown";
-  G4double primaryX = -1.0;
-  G4double primaryY = -1.0;
+/// Bit mask of optional `/photons` column groups selected by
+/// `/output/photonFields`. The four track-ID columns are always written.
+using PhotonFieldMask = std::uint32_t;
 
-  std::string secondarySpecies = "unknown";
-  G4ThreeVector secondaryOriginPosition;
-  G4double secondaryOriginEnergy = -1.0;
+namespace PhotonField {
+/// `photon_creation_time_ns`
+constexpr PhotonFieldMask kCreationTime = 1u << 0;
+/// `photon_origin_{x,y,z}_mm`
+constexpr PhotonFieldMask kOrigin = 1u << 1;
+/// `photon_scint_exit_{x,y,z}_mm`
+constexpr PhotonFieldMask kScintExit = 1u << 2;
+/// `optical_interface_hit_{x,y}_mm`
+constexpr PhotonFieldMask kHitPosition = 1u << 3;
+/// `optical_interface_hit_time_ns`
+constexpr PhotonFieldMask kHitTime = 1u << 4;
+/// `optical_interface_hit_dir_{x,y,z}`
+constexpr PhotonFieldMask kDirection = 1u << 5;
+/// `optical_interface_hit_pol_{x,y,z}`
+constexpr PhotonFieldMask kPolarization = 1u << 6;
+/// `optical_interface_hit_energy_eV`
+constexpr PhotonFieldMask kEnergy = 1u << 7;
+/// `optical_interface_hit_wavelength_nm`
+constexpr PhotonFieldMask kWavelength = 1u << 8;
 
-  G4ThreeVector scintOriginPosition;
-  G4ThreeVector photonScintExitPosition;
-  G4bool hasPhotonScintExitPosition = false;
+/// `minimal` preset: where and when each photon crossed the interface.
+constexpr PhotonFieldMask kMinimal = kHitPosition | kHitTime;
+/// `transport` preset: the columns `src/optics` traces through the lens.
+constexpr PhotonFieldMask kTransport = kMinimal | kDirection | kWavelength;
+/// `full` preset (default): every column.
+constexpr PhotonFieldMask kAll = (1u << 9) - 1;
+}  // namespace PhotonField
 
-  G4ThreeVector opticalInterfaceHitPosition;
-  G4double opticalInterfaceHitTime = -1.0;
-  G4ThreeVector opticalInterfaceHitDirection;
-  G4ThreeVector opticalInterfaceHitPolarization;
-  G4double photonCreationTime = -1.0;
-  G4double opticalInterfaceHitEnergy = -1.0;
-  G4double opticalInterfaceHitWavelength = -1.0;
+/**
+ * One step-profiler bucket for the `/profile` HDF5 dataset.
+ *
+ * Steps and seconds are estimates scaled by the sampling interval; `fraction`
+ * is this bucket's share of all profiled step time.
+ */
+struct ProfileInfo {
+  std::string particle;
+  std::string process;
+  std::string volume;
+  std::int64_t steps = 0;
+  double seconds = 0.0;
+  double fraction = 0.0;
 };
 
 namespace detail {
@@ -219,35 +259,19 @@ struct Hdf5SecondaryNativeRow {
   double secondary_end_z_mm;
 };
 
+/// Fixed-length label size for `/profile` particle, process, and volume names.
+constexpr std::size_t kHdf5ProfileLabelSize = 48;
+
 /**
- * Binary/native row layout for `/photons` HDF5 dataset.
- *
- * Field names/ordering mirror the semantic PhotonInfo container above. Keep
- * this struct POD-compatible for HDF5 compound writes.
+ * Binary/native row layout for the `/profile` HDF5 dataset.
  */
-struct Hdf5PhotonNativeRow {
-  std::int64_t gun_call_id;
-  std::int32_t primary_track_id;
-  std::int32_t secondary_track_id;
-  std::int32_t photon_track_id;
-  double photon_creation_time_ns;
-  double photon_origin_x_mm;
-  double photon_origin_y_mm;
-  double photon_origin_z_mm;
-  double photon_scint_exit_x_mm;
-  double photon_scint_exit_y_mm;
-  double photon_scint_exit_z_mm;
-  double optical_interface_hit_x_mm;
-  double optical_interface_hit_y_mm;
-  double optical_interface_hit_time_ns;
-  double optical_interface_hit_dir_x;
-  double optical_interface_hit_dir_y;
-  double optical_interface_hit_dir_z;
-  double optical_interface_hit_pol_x;
-  double optical_interface_hit_pol_y;
-  double optical_interface_hit_pol_z;
-  double optical_interface_hit_energy_eV;
-  double optical_interface_hit_wavelength_nm;
+struct Hdf5ProfileNativeRow {
+  char particle[kHdf5ProfileLabelSize];
+  char process[kHdf5ProfileLabelSize];
+  char volume[kHdf5ProfileLabelSize];
+  std::int64_t steps;
+  double seconds;
+  double fraction;
 };
 
 /**
@@ -263,8 +287,17 @@ struct Hdf5State {
   hid_t primariesDs = -1;
   hid_t secondariesDs = -1;
   hid_t photonsDs = -1;
+  hid_t transportedType = -1;
+  hid_t transportedDs = -1;
   std::string openPath;
+  /// True while the file is in SWMR-write mode (`SimIO::SetSwmr`).
+  bool swmr = false;
+  std::chrono::steady_clock::time_point lastFlush{};
   bool registeredAtExit = false;
+  /// Paths created this run; reopening one keeps its rows.
+  std::vector<std::string> createdPaths;
+  /// Path whose reopen after SWMR writing failed; not touched again this run.
+  std::string failedPath;
 };
 
 }  // namespace detail
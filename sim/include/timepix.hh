@@ -0,0 +1,171 @@
+#ifndef timepix_h
+#define timepix_h 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Native streaming form of the Timepix readout stage.
+///
+/// Mirrors `src/sensor/timepix.py`: intensifier output events are mapped onto
+/// the centered pixel grid (`map_intensifier_output_to_timepix_events`) and
+/// merged per pixel with the ToT and dead-time rules of
+/// `convert_timepix_events_to_hits`, producing the same `/timepix_hits` rows
+/// in the same order. Instead of a global sort, `EventSorter` sorts each
+/// event's rows and k-way merges those runs, spilling sorted chunks to a
+/// temporary file so memory stays bounded; `Engine` keeps per-pixel state in
+/// dense arrays and releases hits as soon as no later event can change them.
+namespace Timepix {
+
+/// `TimepixParams`; defaults follow `SensorConfig.TimepixConfig`.
+struct Params {
+  int pixelsX = 256;
+  int pixelsY = 256;
+  double pixelPitchMm = 0.055;
+  double maxTotNs = 25550.0;
+  double deadTimeNs = 475.0;
+
+  double SensorWidthMm() const { return static_cast<double>(pixelsX) * pixelPitchMm; }
+  double SensorHeightMm() const { return static_cast<double>(pixelsY) * pixelPitchMm; }
+};
+
+/// Apply one `--flag VALUE` parameter option of the native apps
+/// (`--pixels-x`, `--pixel-pitch`, `--max-tot`, ...); false when `flag` is
+/// not one. Malformed numbers throw as `std::stod` does.
+bool ApplyOption(const std::string& flag, const std::string& value, Params* params);
+
+/// Usage lines for the options `ApplyOption` accepts.
+const char* OptionsUsage();
+
+/// Same checks as `TimepixParams.__post_init__`.
+bool ValidateParams(const Params& params, std::string* errorMessage);
+
+/// One mapped intensifier event (`TimepixEventBatch` row).
+struct Event {
+  double timeNs = 0.0;
+  double amplitude = 0.0;
+  /// Input row; breaks time ties the way the Python stable sort does.
+  std::uint64_t order = 0;
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t xPixel = 0;
+  std::int32_t yPixel = 0;
+};
+
+/// One `/timepix_hits` row.
+struct Hit {
+  std::int64_t gunCallId = -1;
+  std::int32_t primaryTrackId = -1;
+  std::int32_t secondaryTrackId = -1;
+  std::int32_t xPixel = 0;
+  std::int32_t yPixel = 0;
+  /// Written as 0, as the Python stage does.
+  double timeOfArrivalNs = 0.0;
+  double timeOverThresholdNs = 0.0;
+  std::int32_t contributionCount = 0;
+};
+
+/// Pixel of a centered sensor-plane point; false off the active area
+/// (`timepix_in_bounds_mask` and `centered_mm_to_pixel_indices`).
+bool MapToPixel(const Params& params, double xMm, double yMm, std::int32_t* xPixel,
+                std::int32_t* yPixel);
+
+/// Time order of `np.argsort(kind="stable")`: by time, NaN last, then by row.
+inline bool EventBefore(const Event& a, const Event& b) {
+  const bool aNan = a.timeNs != a.timeNs;
+  const bool bNan = b.timeNs != b.timeNs;
+  if (aNan != bNan) {
+    return bNan;
+  }
+  if (!aNan && a.timeNs != b.timeNs) {
+    return a.timeNs < b.timeNs;
+  }
+  return a.order < b.order;
+}
+
+/// Orders events given in input order, a chunk at a time.
+///
+/// `Add` collects rows; each full chunk is split into runs of one
+/// `gun_call_id`, every run is sorted, and the runs are k-way merged into one
+/// sorted chunk. With more than one chunk, chunks are spilled to an anonymous
+/// temporary file and `Drain` merges them back through per-chunk buffers, so
+/// memory is about two chunks plus one chunk of merge buffers.
+class EventSorter {
+ public:
+  explicit EventSorter(std::size_t chunkEvents = std::size_t{1} << 22);
+  ~EventSorter();
+  EventSorter(const EventSorter&) = delete;
+  EventSorter& operator=(const EventSorter&) = delete;
+
+  bool Add(const Event* events, std::size_t count, std::string* errorMessage);
+
+  /// Hand every event to `consume` in `EventBefore` order, in batches.
+  bool Drain(const std::function<void(const Event*, std::size_t)>& consume,
+             std::string* errorMessage);
+
+  /// Sorted chunks written to the temporary file so far.
+  std::size_t SpilledChunks() const { return fSpilled; }
+
+ private:
+  struct Run {
+    long offset = 0;
+    std::size_t count = 0;
+  };
+
+  void SortChunk();
+  bool Spill(std::string* errorMessage);
+
+  std::size_t fChunkEvents;
+  std::vector<Event> fChunk;
+  std::vector<Event> fSorted;
+  std::FILE* fSpill = nullptr;
+  std::vector<Run> fRuns;
+  std::size_t fSpilled = 0;
+};
+
+/// Per-pixel ToT and dead-time merging over time-ordered events.
+class Engine {
+ public:
+  explicit Engine(const Params& params);
+
+  /// Apply one event; events must arrive in `EventBefore` order.
+  void Consume(const Event& event);
+
+  /// Append the hits no later event can change, in creation order.
+  void TakeFinished(std::vector<Hit>* hits);
+
+  /// Append every remaining hit once the stream has ended.
+  void Finish(std::vector<Hit>* hits);
+
+  /// Hits created so far.
+  std::uint64_t HitCount() const { return fReleased + fPending.size(); }
+
+ private:
+  struct PendingHit {
+    Hit hit;
+    double endNs = 0.0;
+  };
+
+  Params fParams;
+  /// Grid row length. Points just inside the upper edge can round onto
+  /// index `pixelsX` (or `pixelsY`) as in Python, so the grid has one spare
+  /// row and column.
+  std::size_t fStride;
+  /// Current hit end time per pixel; -inf before the pixel's first hit.
+  std::vector<double> fHitEndNs;
+  /// Creation index of the pixel's current hit.
+  std::vector<std::uint64_t> fHitIndex;
+  /// Hits not yet released, oldest first; `fReleased` precede them.
+  std::deque<PendingHit> fPending;
+  std::uint64_t fReleased = 0;
+  double fNowNs = 0.0;
+};
+
+}  // namespace Timepix
+
+#endif
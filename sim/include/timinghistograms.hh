@@ -0,0 +1,43 @@
+#ifndef timinghistograms_h
+#define timinghistograms_h 1
+
+#include "G4Types.hh"
+
+#include <cstdint>
+#include <string>
+
+struct TimingBinning;
+
+/// Per-species photon timing histograms behind `/output/timing/bins`.
+///
+/// Each thread fills creation-delay and interface-arrival histograms for
+/// every detected photon of the events it completes, keyed by primary and by
+/// parent-secondary species. Threads hand their counts over at end of run,
+/// and the master sums them and writes `/histograms/timing`.
+namespace TimingHistograms {
+
+/// Enable or disable accumulation on the calling thread for its next run.
+void BeginThreadRun(const TimingBinning& binning);
+
+/// True when the calling thread accumulates timing histograms this run.
+bool Enabled();
+
+/// Count one detected photon. `creationDelay` is the photon creation time
+/// minus its primary's first scintillator interaction time and is ignored
+/// when `hasDelay` is false (no interaction time was recorded).
+void Fill(const std::string& primarySpecies,
+          const std::string& secondarySpecies,
+          bool hasDelay,
+          G4double creationDelay,
+          G4double arrivalTime);
+
+/// Add the calling thread's counts to the run totals.
+void EndThreadRun();
+
+/// Write this run's summed histograms to `hdf5Path` and clear them. `photons`
+/// receives the number of photons counted.
+bool WriteRun(const std::string& hdf5Path, std::int64_t* photons, std::string* errorMessage);
+
+}  // namespace TimingHistograms
+
+#endif
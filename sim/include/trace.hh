@@ -0,0 +1,56 @@
+#ifndef trace_h
+#define trace_h 1
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/// Per-thread span recorder behind `/g4emi/profile/traceFile`.
+///
+/// Each thread appends complete spans to its own fixed-size ring buffer
+/// (oldest spans are overwritten when it fills), so recording never takes a
+/// lock. Threads hand their buffers over at end of run and the master writes
+/// one Chrome trace-event JSON file that chrome://tracing and Perfetto open.
+namespace Trace {
+
+/// True when the calling thread records spans for the current run.
+bool Enabled();
+
+/// Monotonic nanoseconds for span starts (0 when tracing is off).
+inline std::uint64_t Now() {
+  if (!Enabled()) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now().time_since_epoch())
+                                        .count());
+}
+
+/// Record span `name` (a string literal) from `startNs` until now.
+void Complete(const char* name, std::uint64_t startNs);
+
+/// Records span `name` for its enclosing scope.
+class Span {
+ public:
+  explicit Span(const char* name) : fName(name), fStart(Now()) {}
+  ~Span() { Complete(fName, fStart); }
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+ private:
+  const char* fName;
+  std::uint64_t fStart;
+};
+
+/// Enable or disable recording on the calling thread for its next run.
+void BeginThreadRun(bool enabled);
+
+/// Hand the calling thread's spans over to the run collection.
+void EndThreadRun();
+
+/// Write the collected spans of this run to `path` and clear them.
+bool WriteRun(const std::string& path, std::string* errorMessage);
+
+}  // namespace Trace
+
+#endif
@@ -0,0 +1,412 @@
+// In-process Python binding: `import g4emi_native`.
+//
+// A `Simulation` owns the Geant4 run manager and the g4emi user
+// initializations (set up as `g4emi_batch` does), takes UI commands, and runs
+// events with rows captured in memory (include/capture.hh) instead of
+// written to HDF5. Each captured table is handed to numpy through the buffer
+// protocol, so the returned structured arrays share memory with the capture
+// buffers; nothing is copied or converted after the event rows are packed.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "ActionInitialization.hh"
+#include "DetectorConstruction.hh"
+#include "PhysicsList.hh"
+#include "SimIO.hh"
+#include "WorkerInitialization.hh"
+#include "capture.hh"
+#include "config.hh"
+#include "messenger.hh"
+#include "seed.hh"
+#include "structures.hh"
+
+#include "G4OpticalParameters.hh"
+#include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4StateManager.hh"
+#include "G4UImanager.hh"
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+/// One named field of a PEP 3118 struct format.
+struct Field {
+  const char* name;
+  std::size_t offset;
+  /// struct-module code with its count (`q`, `d`, `24s`, ...).
+  std::string code;
+  std::size_t size;
+};
+
+// PEP 3118 format for rows of `rowBytes` holding `fields` in offset order,
+// with standard sizes and native byte order; alignment gaps and the row tail
+// become pad bytes, so numpy sees the exact C++ layout.
+std::string StructFormat(const std::vector<Field>& fields, std::size_t rowBytes) {
+  std::string format = "T{=";
+  std::size_t at = 0;
+  for (const auto& field : fields) {
+    if (field.offset > at) {
+      format += std::to_string(field.offset - at) + "x";
+    }
+    format += field.code + ":" + field.name + ":";
+    at = field.offset + field.size;
+  }
+  if (rowBytes > at) {
+    format += std::to_string(rowBytes - at) + "x";
+  }
+  return format + "}";
+}
+
+std::string PrimaryFormat() {
+  using Row = SimStructures::detail::Hdf5PrimaryNativeRow;
+  const std::size_t label = SimStructures::detail::kHdf5SpeciesLabelSize;
+  return StructFormat(
+      {
+          {"gun_call_id", offsetof(Row, gun_call_id), "q", 8},
+          {"primary_track_id", offsetof(Row, primary_track_id), "i", 4},
+          {"primary_species", offsetof(Row, primary_species), std::to_string(label) + "s",
+           label},
+          {"primary_x_mm", offsetof(Row, primary_x_mm), "d", 8},
+          {"primary_y_mm", offsetof(Row, primary_y_mm), "d", 8},
+          {"primary_energy_MeV", offsetof(Row, primary_energy_MeV), "d", 8},
+          {"primary_interaction_time_ns", offsetof(Row, primary_interaction_time_ns), "d", 8},
+          {"primary_created_secondary_count", offsetof(Row, primary_created_secondary_count),
+           "q", 8},
+          {"primary_generated_optical_photon_count",
+           offsetof(Row, primary_generated_optical_photon_count), "q", 8},
+          {"primary_detected_optical_interface_photon_count",
+           offsetof(Row, primary_detected_optical_interface_photon_count), "q", 8},
+      },
+      sizeof(Row));
+}
+
+std::string SecondaryFormat() {
+  using Row = SimStructures::detail::Hdf5SecondaryNativeRow;
+  const std::size_t label = SimStructures::detail::kHdf5SpeciesLabelSize;
+  return StructFormat(
+      {
+          {"gun_call_id", offsetof(Row, gun_call_id), "q", 8},
+          {"primary_track_id", offsetof(Row, primary_track_id), "i", 4},
+          {"secondary_track_id", offsetof(Row, secondary_track_id), "i", 4},
+          {"secondary_species", offsetof(Row, secondary_species), std::to_string(label) + "s",
+           label},
+          {"secondary_origin_x_mm", offsetof(Row, secondary_origin_x_mm), "d", 8},
+          {"secondary_origin_y_mm", offsetof(Row, secondary_origin_y_mm), "d", 8},
+          {"secondary_origin_z_mm", offsetof(Row, secondary_origin_z_mm), "d", 8},
+          {"secondary_origin_energy_MeV", offsetof(Row, secondary_origin_energy_MeV), "d", 8},
+          {"secondary_end_x_mm", offsetof(Row, secondary_end_x_mm), "d", 8},
+          {"secondary_end_y_mm", offsetof(Row, secondary_end_y_mm), "d", 8},
+          {"secondary_end_z_mm", offsetof(Row, secondary_end_z_mm), "d", 8},
+      },
+      sizeof(Row));
+}
+
+std::string PhotonFormat(SimStructures::PhotonFieldMask fields) {
+  std::vector<Field> columns;
+  for (const auto& column : SimIO::detail::PhotonColumns(fields)) {
+    const char* code = column.isFloat ? "d" : (column.size == 4 ? "i" : "q");
+    columns.push_back({column.name, column.offset, code, column.size});
+  }
+  return StructFormat(columns, SimIO::PhotonRowBytes(fields));
+}
+
+std::string TransportedFormat() {
+  using Row = SimStructures::TransportedPhotonInfo;
+  return StructFormat(
+      {
+          {"source_photon_index", offsetof(Row, sourcePhotonIndex), "q", 8},
+          {"gun_call_id", offsetof(Row, gunCallId), "q", 8},
+          {"primary_track_id", offsetof(Row, primaryTrackId), "i", 4},
+          {"secondary_track_id", offsetof(Row, secondaryTrackId), "i", 4},
+          {"photon_track_id", offsetof(Row, photonTrackId), "i", 4},
+          {"intensifier_hit_x_mm", offsetof(Row, intensifierHitXmm), "d", 8},
+          {"intensifier_hit_y_mm", offsetof(Row, intensifierHitYmm), "d", 8},
+          {"intensifier_hit_z_mm", offsetof(Row, intensifierHitZmm), "d", 8},
+          {"intensifier_hit_time_ns", offsetof(Row, intensifierHitTimeNs), "d", 8},
+          {"intensifier_hit_wavelength_nm", offsetof(Row, intensifierHitWavelengthNm), "d", 8},
+          {"in_bounds", offsetof(Row, inBounds), "?", 1},
+      },
+      sizeof(Row));
+}
+
+/// `g4emi_native.RowBuffer`: one captured table, owned here and exported as
+/// a 1-D buffer of struct rows.
+struct RowBuffer {
+  PyObject_HEAD
+  std::vector<unsigned char>* bytes;
+  std::string* format;
+  Py_ssize_t rows;
+  Py_ssize_t rowBytes;
+};
+
+void RowBufferDealloc(PyObject* object) {
+  auto* self = reinterpret_cast<RowBuffer*>(object);
+  delete self->bytes;
+  delete self->format;
+  Py_TYPE(object)->tp_free(object);
+}
+
+int RowBufferGetBuffer(PyObject* object, Py_buffer* view, int flags) {
+  auto* self = reinterpret_cast<RowBuffer*>(object);
+  // Buffers must not be NULL, even with no rows.
+  static unsigned char empty = 0;
+  view->obj = object;
+  Py_INCREF(object);
+  view->buf = self->bytes->empty() ? &empty : self->bytes->data();
+  view->len = self->rows * self->rowBytes;
+  view->readonly = 0;
+  view->itemsize = self->rowBytes;
+  view->format = (flags & PyBUF_FORMAT) ? const_cast<char*>(self->format->c_str()) : nullptr;
+  view->ndim = 1;
+  view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &self->rows : nullptr;
+  view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &self->rowBytes : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+PyBufferProcs gRowBufferProcs = {RowBufferGetBuffer, nullptr};
+
+PyTypeObject gRowBufferType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+// Move `table` into a new RowBuffer described by `format`.
+PyObject* NewRowBuffer(Capture::Table table, std::string format) {
+  auto* self = PyObject_New(RowBuffer, &gRowBufferType);
+  if (!self) {
+    return nullptr;
+  }
+  self->rows = static_cast<Py_ssize_t>(table.Rows());
+  self->rowBytes = static_cast<Py_ssize_t>(table.rowBytes);
+  self->bytes = new std::vector<unsigned char>(std::move(table.bytes));
+  self->format = new std::string(std::move(format));
+  return reinterpret_cast<PyObject*>(self);
+}
+
+/// `g4emi_native.Simulation`.
+struct Simulation {
+  PyObject_HEAD
+  Config* config;
+  Messenger* messenger;
+  G4RunManager* runManager;
+};
+
+/// Geant4 allows one run manager per process.
+bool gSimulationCreated = false;
+
+bool ToRunManagerType(const std::string& backend, G4RunManagerType* out) {
+  if (backend == "default") {
+    *out = G4RunManagerType::Default;
+  } else if (backend == "tasking") {
+    *out = G4RunManagerType::TaskingOnly;
+  } else if (backend == "tbb") {
+    *out = G4RunManagerType::TBBOnly;
+  } else if (backend == "mt") {
+    *out = G4RunManagerType::MTOnly;
+  } else if (backend == "serial") {
+    *out = G4RunManagerType::SerialOnly;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int SimulationInit(PyObject* object, PyObject* args, PyObject* kwargs) {
+  auto* self = reinterpret_cast<Simulation*>(object);
+  static const char* keywords[] = {"backend", nullptr};
+  const char* backend = "default";
+  if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|s", const_cast<char**>(keywords),
+                                   &backend)) {
+    return -1;
+  }
+  if (gSimulationCreated) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "only one g4emi_native.Simulation can exist per process");
+    return -1;
+  }
+  G4RunManagerType runManagerType = G4RunManagerType::Default;
+  if (!ToRunManagerType(backend, &runManagerType)) {
+    PyErr_Format(PyExc_ValueError, "unknown run-manager backend '%s'", backend);
+    return -1;
+  }
+  gSimulationCreated = true;
+
+  Seed::SetAutoMasterSeeds();
+  self->config = new Config();
+  self->config->SetRunManagerBackend(backend);
+  self->runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+  auto* detector = new DetectorConstruction(self->config);
+  self->runManager->SetUserInitialization(detector);
+  self->messenger = new Messenger(self->config);
+  self->runManager->SetUserInitialization(new PhysicsList(self->config));
+  G4OpticalParameters::Instance()->SetScintTrackSecondariesFirst(true);
+  self->runManager->SetUserInitialization(new WorkerInitialization(self->config));
+  self->runManager->SetUserInitialization(new ActionInitialization(detector, self->config));
+  return 0;
+}
+
+void SimulationDealloc(PyObject* object) {
+  auto* self = reinterpret_cast<Simulation*>(object);
+  delete self->runManager;
+  delete self->messenger;
+  delete self->config;
+  Py_TYPE(object)->tp_free(object);
+}
+
+bool CheckInitialized(Simulation* self) {
+  if (!self->runManager) {
+    PyErr_SetString(PyExc_RuntimeError, "Simulation.__init__ was not called");
+    return false;
+  }
+  return true;
+}
+
+PyObject* SimulationCommand(PyObject* object, PyObject* args) {
+  auto* self = reinterpret_cast<Simulation*>(object);
+  const char* command = nullptr;
+  if (!PyArg_ParseTuple(args, "s", &command) || !CheckInitialized(self)) {
+    return nullptr;
+  }
+  int status = 0;
+  Py_BEGIN_ALLOW_THREADS
+  status = G4UImanager::GetUIpointer()->ApplyCommand(command);
+  Py_END_ALLOW_THREADS
+  if (status != 0) {
+    PyErr_Format(PyExc_RuntimeError, "command failed (status %d): %s", status, command);
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+PyObject* SimulationExecute(PyObject* object, PyObject* args) {
+  const char* macro = nullptr;
+  if (!PyArg_ParseTuple(args, "s", &macro)) {
+    return nullptr;
+  }
+  PyObject* command = Py_BuildValue("(s)", ("/control/execute " + std::string(macro)).c_str());
+  if (!command) {
+    return nullptr;
+  }
+  PyObject* result = SimulationCommand(object, command);
+  Py_DECREF(command);
+  return result;
+}
+
+PyObject* SimulationRun(PyObject* object, PyObject* args) {
+  auto* self = reinterpret_cast<Simulation*>(object);
+  long long events = 0;
+  if (!PyArg_ParseTuple(args, "L", &events) || !CheckInitialized(self)) {
+    return nullptr;
+  }
+  if (events < 0) {
+    PyErr_SetString(PyExc_ValueError, "events must be non-negative");
+    return nullptr;
+  }
+  // BeamOn takes a G4int.
+  if (events > std::numeric_limits<G4int>::max()) {
+    PyErr_Format(PyExc_OverflowError, "events must be at most %d",
+                 std::numeric_limits<G4int>::max());
+    return nullptr;
+  }
+  PyObject* numpy = PyImport_ImportModule("numpy");
+  if (!numpy) {
+    return nullptr;
+  }
+
+  Capture::SetEnabled(true);
+  Py_BEGIN_ALLOW_THREADS
+  if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_PreInit) {
+    self->runManager->Initialize();
+  }
+  self->runManager->BeamOn(static_cast<G4int>(events));
+  Py_END_ALLOW_THREADS
+  Capture::SetEnabled(false);
+  auto rows = Capture::Take();
+
+  std::pair<const char*, PyObject*> tables[] = {
+      {"primaries", NewRowBuffer(std::move(rows.primaries), PrimaryFormat())},
+      {"secondaries", NewRowBuffer(std::move(rows.secondaries), SecondaryFormat())},
+      {"photons", NewRowBuffer(std::move(rows.photons), PhotonFormat(rows.photonFields))},
+      {"transported_photons", NewRowBuffer(std::move(rows.transported), TransportedFormat())},
+  };
+  PyObject* result = PyDict_New();
+  for (const auto& [name, buffer] : tables) {
+    // numpy.asarray keeps the RowBuffer alive as the array's base.
+    PyObject* array =
+        result && buffer ? PyObject_CallMethod(numpy, "asarray", "O", buffer) : nullptr;
+    if (!array || PyDict_SetItemString(result, name, array) != 0) {
+      Py_CLEAR(result);
+    }
+    Py_XDECREF(array);
+  }
+  for (const auto& table : tables) {
+    Py_XDECREF(table.second);
+  }
+  Py_DECREF(numpy);
+  return result;
+}
+
+PyMethodDef gSimulationMethods[] = {
+    {"command", SimulationCommand, METH_VARARGS,
+     "command(cmd)\n--\n\nApply one UI command (/g4emi/..., /run/..., ...); raises "
+     "RuntimeError when it fails."},
+    {"execute", SimulationExecute, METH_VARARGS,
+     "execute(macro)\n--\n\nRun a macro file. Its /run/beamOn runs write HDF5 as g4emi does."},
+    {"run", SimulationRun, METH_VARARGS,
+     "run(events)\n--\n\nRun `events` events (initializing first if needed) and return a dict "
+     "of numpy structured arrays: primaries, secondaries, photons, and "
+     "transported_photons, with the HDF5 column names. The arrays share memory with the "
+     "capture buffers; no file is written."},
+    {nullptr, nullptr, 0, nullptr},
+};
+
+PyTypeObject gSimulationType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+PyModuleDef gModule = {
+    PyModuleDef_HEAD_INIT,
+    "g4emi_native",
+    "In-process g4emi simulation with rows returned as numpy arrays.",
+    -1,
+    nullptr,
+};
+}  // namespace
+
+PyMODINIT_FUNC PyInit_g4emi_native() {
+  gRowBufferType.tp_name = "g4emi_native.RowBuffer";
+  gRowBufferType.tp_basicsize = sizeof(RowBuffer);
+  gRowBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+  gRowBufferType.tp_doc = "Captured rows exported through the buffer protocol.";
+  gRowBufferType.tp_dealloc = RowBufferDealloc;
+  gRowBufferType.tp_as_buffer = &gRowBufferProcs;
+
+  gSimulationType.tp_name = "g4emi_native.Simulation";
+  gSimulationType.tp_basicsize = sizeof(Simulation);
+  gSimulationType.tp_flags = Py_TPFLAGS_DEFAULT;
+  gSimulationType.tp_doc =
+      "Simulation(backend='default')\n--\n\nThe g4emi run manager and configuration; one per "
+      "process. Configure with command() or execute(), then call run().";
+  gSimulationType.tp_new = PyType_GenericNew;
+  gSimulationType.tp_init = SimulationInit;
+  gSimulationType.tp_dealloc = SimulationDealloc;
+  gSimulationType.tp_methods = gSimulationMethods;
+
+  if (PyType_Ready(&gRowBufferType) < 0 || PyType_Ready(&gSimulationType) < 0) {
+    return nullptr;
+  }
+  PyObject* module = PyModule_Create(&gModule);
+  if (!module) {
+    return nullptr;
+  }
+  Py_INCREF(&gSimulationType);
+  if (PyModule_AddObject(module, "Simulation", reinterpret_cast<PyObject*>(&gSimulationType)) <
+      0) {
+    Py_DECREF(&gSimulationType);
+    Py_DECREF(module);
+    return nullptr;
+  }
+  return module;
+}
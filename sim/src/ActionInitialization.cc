@@ -4,6 +4,7 @@
 #include "EventAction.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
+#include "StackingAction.hh"
 #include "SteppingAction.hh"
 #include "TrackingAction.hh"
 
@@ -20,6 +21,9 @@ void ActionInitialization::Build() const {
 
   SetUserAction(new SteppingAction(fDetector, eventAction));
   SetUserAction(new TrackingAction(eventAction));
+  if (eventAction->DispatchesPhotonsToSubEvents()) {
+    SetUserAction(new StackingAction(eventAction));
+  }
 }
 
 void ActionInitialization::BuildForMaster() const {
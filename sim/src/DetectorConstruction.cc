@@ -1,6 +1,7 @@
 #include "DetectorConstruction.hh"
 #include "PhotonOpticalInterfaceSD.hh"
 #include "config.hh"
+#include "imaging.hh"
 
 #include "G4Box.hh"
 #include "G4Colour.hh"
@@ -273,6 +274,10 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
       std::isnan(opticalInterfacePosY) ? defaultOpticalInterfaceY : opticalInterfacePosY;
   const auto opticalInterfaceCenterZ =
       std::isnan(opticalInterfacePosZ) ? defaultOpticalInterfaceZ : opticalInterfacePosZ;
+  Imaging::SetInterfaceExtent(opticalInterfaceCenterX - 0.5 * opticalInterfaceX,
+                              opticalInterfaceCenterX + 0.5 * opticalInterfaceX,
+                              opticalInterfaceCenterY - 0.5 * opticalInterfaceY,
+                              opticalInterfaceCenterY + 0.5 * opticalInterfaceY);
 
   // Auto-size world from required half-extents with margin.
   const auto requiredHalfX = std::max(std::abs(scintPosX) + 0.5 * scintX,
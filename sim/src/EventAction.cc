@@ -2,26 +2,46 @@
 
 #include "SimIO.hh"
 #include "config.hh"
+#include "eventtrigger.hh"
+#include "imaging.hh"
+#include "lenssurrogate.hh"
+#include "lenstrace.hh"
+#include "outputsink.hh"
+#include "perfcounters.hh"
+#include "progress.hh"
+#include "timinghistograms.hh"
+#include "trace.hh"
 
 #include "G4AutoLock.hh"
 #include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4Exception.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4PrimaryParticle.hh"
 #include "G4PrimaryVertex.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4VUserEventInformation.hh"
 #include "G4ios.hh"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <limits>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace {
 /// Serialize appends to shared HDF5 output files across worker threads.
 G4Mutex gOutputMutex = G4MUTEX_INITIALIZER;
 
+/// Initial per-thread capacities; buffers are allocated once on the owning
+/// (possibly pinned) thread and reused across events.
+constexpr std::size_t kInitialTrackCapacity = 4096;
+constexpr std::size_t kInitialPhotonHitCapacity = 16384;
+
 /// Convert Geant4 particle names into compact labels used in output tables.
 std::string ToSpeciesLabel(const G4String& particleName) {
   if (particleName == "neutron") return "n";
@@ -38,12 +58,108 @@ std::string ToSpeciesLabel(const G4String& particleName) {
   return particleName;
 }
 
+// Trace an event's photon rows through `lens`, or evaluate `surrogate` when
+// set; rows index the event's photons until the writer offsets them by the
+// rows already in the file.
+std::vector<SimIO::TransportedPhotonInfo> TransportPhotons(
+    const LensTrace::Lens* lens,
+    const LensSurrogate::Model* surrogate,
+    const LensTransport& transport,
+    const std::vector<SimIO::PhotonInfo>& photons) {
+  // Reused across events so the batch arrays are allocated once per thread.
+  thread_local LensTrace::RayBatch batch;
+  batch.Resize(photons.size());
+  for (std::size_t i = 0; i < photons.size(); ++i) {
+    const auto& photon = photons[i];
+    batch.x[i] = photon.opticalInterfaceHitXmm;
+    batch.y[i] = photon.opticalInterfaceHitYmm;
+    batch.dx[i] = photon.opticalInterfaceHitDirX;
+    batch.dy[i] = photon.opticalInterfaceHitDirY;
+    batch.dz[i] = photon.opticalInterfaceHitDirZ;
+    batch.wavelengthNm[i] = photon.opticalInterfaceHitWavelengthNm;
+  }
+  if (surrogate) {
+    LensSurrogate::Evaluate(*surrogate, &batch);
+  } else {
+    LensTrace::Trace(*lens, &batch);
+  }
+
+  const double radius = 0.5 * transport.screenDiameter / mm;
+  const double centerX = transport.screenCenterX / mm;
+  const double centerY = transport.screenCenterY / mm;
+  std::vector<SimIO::TransportedPhotonInfo> rows;
+  rows.reserve(photons.size());
+  for (std::size_t i = 0; i < photons.size(); ++i) {
+    if (!batch.valid[i]) {
+      continue;
+    }
+    const auto& photon = photons[i];
+    SimIO::TransportedPhotonInfo row;
+    row.sourcePhotonIndex = static_cast<std::int64_t>(i);
+    row.gunCallId = photon.gunCallId;
+    row.primaryTrackId = photon.primaryTrackId;
+    row.secondaryTrackId = photon.secondaryTrackId;
+    row.photonTrackId = photon.photonTrackId;
+    row.intensifierHitXmm = batch.x[i];
+    row.intensifierHitYmm = batch.y[i];
+    row.intensifierHitZmm = batch.z[i];
+    row.intensifierHitTimeNs = photon.opticalInterfaceHitTimeNs;
+    if (photon.opticalInterfaceHitWavelengthNm > 0.0) {
+      row.intensifierHitWavelengthNm = photon.opticalInterfaceHitWavelengthNm;
+    }
+    if (radius > 0.0) {
+      row.inBounds = std::hypot(batch.x[i] - centerX, batch.y[i] - centerY) <= radius;
+    }
+    rows.push_back(row);
+  }
+  return rows;
+}
+
+#ifdef G4EMI_WITH_SUBEVENT
+/// Hits, image-only hit count, and tracked-photon count a sub-event hands
+/// back to its owning event.
+class SubEventPhotonHits : public G4VUserEventInformation {
+ public:
+  SubEventPhotonHits(std::vector<SimStructures::PhotonHitRecord> hits,
+                     std::int64_t imagedPhotons,
+                     std::int64_t trackedPhotons)
+      : fHits(std::move(hits)),
+        fImagedPhotons(imagedPhotons),
+        fTrackedPhotons(trackedPhotons) {}
+
+  void Print() const override {
+    G4cout << "SubEventPhotonHits: " << fHits.size() << " hits from " << fTrackedPhotons
+           << " photons" << G4endl;
+  }
+
+  const std::vector<SimStructures::PhotonHitRecord>& GetHits() const { return fHits; }
+  std::int64_t GetImagedPhotons() const { return fImagedPhotons; }
+  std::int64_t GetTrackedPhotons() const { return fTrackedPhotons; }
+
+ private:
+  std::vector<SimStructures::PhotonHitRecord> fHits;
+  std::int64_t fImagedPhotons = 0;
+  std::int64_t fTrackedPhotons = 0;
+};
+
+// Geant4 retires a sub-event only after MergeSubEvent returns, so the one
+// being merged still counts as remaining while it is merged.
+constexpr G4int kMergingSubEvent = 1;
+#endif
+
 }  // namespace
 
 G4ThreadLocal EventAction* EventAction::fgInstance = nullptr;
 
 EventAction::EventAction(const Config* config) : fConfig(config) {
   fgInstance = this;
+#ifdef G4EMI_WITH_SUBEVENT
+  // With the sub-event run manager the master thread owns events and worker
+  // threads only ever process sub-events.
+  fSubEventMode = fConfig && fConfig->GetRunManagerBackend() == "subevent";
+  fSubEventWorker = fSubEventMode && G4Threading::IsWorkerThread();
+#endif
+  ReserveEventState(&fState);
 }
 
 EventAction::~EventAction() { fgInstance = nullptr; }
@@ -51,18 +167,31 @@ EventAction::~EventAction() { fgInstance = nullptr; }
 EventAction* EventAction::Instance() { return fgInstance; }
 
 void EventAction::BeginOfEventAction(const G4Event* event) {
-  fPrimarySpecies = "unknown";
-  fPrimaryPosition = G4ThreeVector();
-  fPrimaryEnergy = -1.0;
-  fTrackInfo.clear();
-  fPhotonCreationInfo.clear();
-  fPendingPhotonOrigin.clear();
-  fPhotonScintillatorExit.clear();
-  fSecondaryScintillatorEndpoint.clear();
-  fPrimaryScintillatorFirstInteractionTime.clear();
-  fPrimaryActivity.clear();
-  fPhotonHits.clear();
+  const auto traceStart = Trace::Now();
+  if constexpr (PerfCounters::kEnabled) {
+    fEventStart = std::chrono::steady_clock::now();
+  }
+  ResetEventState();
+  fPhotonFields = fConfig ? fConfig->GetPhotonFields() : SimStructures::PhotonField::kAll;
+  // `/output/mode images` runs have no sinks and never take the output lock.
+  fWritesRows = (!fConfig || fConfig->GetOutputMode() != "images") && OutputSink::Active();
+  fRecordsHits = fWritesRows || TimingHistograms::Enabled() || Trigger::Enabled();
+  if (TimingHistograms::Enabled()) {
+    fPhotonFields |= SimStructures::PhotonField::kCreationTime;
+  }
+  fLens = fWritesRows ? LensTrace::ActiveLens() : nullptr;
+  fSurrogate = fWritesRows ? LensSurrogate::ActiveModel() : nullptr;
+  if (fLens || fSurrogate) {
+    fPhotonFields |= SimStructures::PhotonField::kWavelength;
+  }
+  fDispatchedPhotons = 0;
+  fTrackedPhotons = 0;
+  RecordPrimary(event);
+  Trace::Complete("BeginOfEvent", traceStart);
+  fTraceTrackingStart = Trace::Now();
+}
 
+void EventAction::RecordPrimary(const G4Event* event) {
   if (!event) {
     return;
   }
@@ -72,39 +201,205 @@ void EventAction::BeginOfEventAction(const G4Event* event) {
     return;
   }
 
-  fPrimaryPosition = primaryVertex->GetPosition();
+  fState.primaryPosition = primaryVertex->GetPosition();
   const auto* primaryParticle = primaryVertex->GetPrimary();
   if (!primaryParticle) {
     return;
   }
 
   if (const auto* def = primaryParticle->GetParticleDefinition()) {
-    fPrimarySpecies = ToSpeciesLabel(def->GetParticleName());
+    fState.primarySpecies = ToSpeciesLabel(def->GetParticleName());
   }
-  fPrimaryEnergy = primaryParticle->GetKineticEnergy();
+  fState.primaryEnergy = primaryParticle->GetKineticEnergy();
 }
 
 void EventAction::EndOfEventAction(const G4Event* event) {
-  const auto eventID = event ? event->GetEventID() : -1;
-  const auto simulatedCount = eventID + 1;
-  if (simulatedCount > 0 && (simulatedCount % 1000 == 0)) {
-    G4cout << "Simulated " << simulatedCount << " events" << G4endl;
+  Trace::Complete("Tracking", fTraceTrackingStart);
+  Trace::Span endOfEventSpan("EndOfEvent");
+#ifdef G4EMI_WITH_SUBEVENT
+  if (fSubEventWorker) {
+    // Hand hits back to the owning event; it writes the rows.
+    G4EventManager::GetEventManager()->SetUserInformation(
+        new SubEventPhotonHits(std::move(fState.photonHits), fState.imagedPhotons,
+                               fTrackedPhotons));
+    fState.photonHits.clear();
+    return;
+  }
+#endif
+
+  if constexpr (PerfCounters::kEnabled) {
+    auto& counters = PerfCounters::Local();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - fEventStart;
+    ++counters.events;
+    counters.eventSeconds += elapsed.count();
+    counters.maxEventSeconds = std::max(counters.maxEventSeconds, elapsed.count());
+    counters.peakTrackInfo = std::max(counters.peakTrackInfo, fState.trackInfo.size());
+    counters.peakPhotonCreationInfo =
+        std::max(counters.peakPhotonCreationInfo, fState.photonCreationInfo.size());
+    counters.peakPendingPhotonOrigin =
+        std::max(counters.peakPendingPhotonOrigin, fState.pendingPhotonOrigin.size());
+    counters.peakPhotonHits = std::max(counters.peakPhotonHits, fState.photonHits.size());
   }
 
   if (!event) {
     return;
   }
+  const auto eventID = event->GetEventID();
+
+  if (fDispatchedPhotons > 0) {
+    // Sub-events may still be tracking this event's photons; whichever of
+    // EndOfEventAction/MergeSubEvent sees the last of them merged writes the rows.
+    std::lock_guard<std::mutex> lock(fPendingMutex);
+    auto& pending = fPendingEvents[eventID];
+    ParkEventState(&pending);
+    pending.ended = true;
+    pending.dispatchedPhotons = fDispatchedPhotons;
+    if (event->GetNumberOfRemainingSubEvents() == 0) {
+      FinishPendingEvent(eventID, &pending);
+      fPendingEvents.erase(eventID);
+    }
+    return;
+  }
+
+  WriteEventRows(eventID, fState);
+}
+
+#ifdef G4EMI_WITH_SUBEVENT
+void EventAction::MergeSubEvent(G4Event* masterEvent, const G4Event* subEvent) {
+  if (!masterEvent || !subEvent) {
+    return;
+  }
+  const auto* returned =
+      dynamic_cast<const SubEventPhotonHits*>(subEvent->GetUserInformation());
+  if (!returned) {
+    return;
+  }
+
+  const auto eventID = masterEvent->GetEventID();
+  std::lock_guard<std::mutex> lock(fPendingMutex);
+  auto& pending = fPendingEvents[eventID];
+  pending.subEventHits.insert(pending.subEventHits.end(), returned->GetHits().begin(),
+                              returned->GetHits().end());
+  pending.subEventImagedPhotons += returned->GetImagedPhotons();
+  pending.returnedPhotons += returned->GetTrackedPhotons();
+  if (pending.ended && masterEvent->GetNumberOfRemainingSubEvents() <= kMergingSubEvent) {
+    FinishPendingEvent(eventID, &pending);
+    fPendingEvents.erase(eventID);
+  }
+}
+#endif
+
+void EventAction::FlushPendingEvents() {
+  std::lock_guard<std::mutex> lock(fPendingMutex);
+  for (auto& entry : fPendingEvents) {
+    auto& pending = entry.second;
+    G4ExceptionDescription message;
+    if (pending.ended) {
+      message << "Event " << entry.first << " still waited for sub-events at run end ("
+              << pending.returnedPhotons << " of " << pending.dispatchedPhotons
+              << " dispatched photons returned); writing the rows it has.";
+    } else {
+      message << "Sub-events of event " << entry.first << " were merged after its rows were "
+              << "written; " << pending.subEventHits.size() << " photon hits are not in the output.";
+    }
+    G4Exception("EventAction::FlushPendingEvents", "g4emi/subevent/unmerged", JustWarning,
+                message);
+    if (pending.ended) {
+      FinishPendingEvent(entry.first, &pending);
+    }
+  }
+  fPendingEvents.clear();
+}
+
+void EventAction::ResetEventState() {
+  fState.primarySpecies = "unknown";
+  fState.primaryPosition = G4ThreeVector();
+  fState.primaryEnergy = -1.0;
+  fState.trackInfo.clear();
+  fState.photonCreationInfo.clear();
+  fState.pendingPhotonOrigin.clear();
+  fState.photonScintillatorExit.clear();
+  fState.secondaryScintillatorEndpoint.clear();
+  fState.primaryScintillatorFirstInteractionTime.clear();
+  fState.primaryActivity.clear();
+  fState.photonHits.clear();
+  fState.imagedPhotons = 0;
+}
+
+void EventAction::ReserveEventState(EventState* state) {
+  state->trackInfo.reserve(kInitialTrackCapacity);
+  state->photonCreationInfo.reserve(kInitialTrackCapacity);
+  state->pendingPhotonOrigin.reserve(kInitialTrackCapacity);
+  state->photonScintillatorExit.reserve(kInitialTrackCapacity);
+  state->photonHits.reserve(kInitialPhotonHitCapacity);
+}
+
+void EventAction::ParkEventState(PendingEvent* pending) {
+  if (fSpareStates.empty()) {
+    ReserveEventState(&pending->state);
+  } else {
+    pending->state = std::move(fSpareStates.back());
+    fSpareStates.pop_back();
+  }
+  std::swap(fState, pending->state);
+}
+
+void EventAction::AppendPhotonHit(EventState* state, const PhotonHitRecord& hit) {
+  if (hit.primaryID >= 0) {
+    ++state->primaryActivity[hit.primaryID].detectedOpticalInterfacePhotonCount;
+  }
+  state->photonHits.push_back(hit);
+}
+
+void EventAction::FinishPendingEvent(G4int eventID, PendingEvent* pending) {
+  auto& state = pending->state;
+  state.photonHits.reserve(state.photonHits.size() + pending->subEventHits.size());
+  for (auto& hit : pending->subEventHits) {
+    // Sub-event threads never see the owning event's primary vertex.
+    hit.primarySpecies = state.primarySpecies;
+    hit.primaryX = state.primaryPosition.x();
+    hit.primaryY = state.primaryPosition.y();
+    AppendPhotonHit(&state, hit);
+  }
+  pending->subEventHits.clear();
+  state.imagedPhotons += pending->subEventImagedPhotons;
+  WriteEventRows(eventID, state);
+  fSpareStates.push_back(std::move(state));
+}
+
+void EventAction::WriteEventRows(G4int eventID, const EventState& state) const {
+  if (Trigger::Enabled()) {
+    if (!Trigger::Accepts(GeneratedPhotons(state), state.photonHits)) {
+      Progress::RecordEventRejected();
+      CountCompletedEvent(state);
+      return;
+    }
+    // The interface detector leaves image filling to accepted events.
+    if (Imaging::Enabled()) {
+      for (const auto& hit : state.photonHits) {
+        Imaging::Fill(hit.opticalInterfaceHitPosition.x(), hit.opticalInterfaceHitPosition.y(),
+                      hit.opticalInterfaceHitTime);
+      }
+    }
+  }
+  if (TimingHistograms::Enabled()) {
+    FillTimingHistograms(state);
+  }
+  if (!fWritesRows) {
+    CountCompletedEvent(state);
+    return;
+  }
 
-  const auto eventID64 = static_cast<std::int64_t>(event->GetEventID());
-  const std::string hdf5Path =
-      fConfig ? fConfig->GetHdf5FilePath() : "photon_optical_interface_hits.h5";
+  const auto assembleStart = Trace::Now();
+  const auto eventID64 = static_cast<std::int64_t>(eventID);
 
   std::vector<SimIO::PrimaryInfo> primaryRows;
   std::vector<SimIO::SecondaryInfo> secondaryRows;
   std::vector<SimIO::PhotonInfo> photonRows;
-  const auto resolvePrimaryInteractionTimeNs = [this](G4int primaryTrackID) -> double {
-    const auto it = fPrimaryScintillatorFirstInteractionTime.find(primaryTrackID);
-    if (it != fPrimaryScintillatorFirstInteractionTime.end()) {
+  const auto resolvePrimaryInteractionTimeNs = [&state](G4int primaryTrackID) -> double {
+    const auto it = state.primaryScintillatorFirstInteractionTime.find(primaryTrackID);
+    if (it != state.primaryScintillatorFirstInteractionTime.end()) {
       return it->second / ns;
     }
     return std::numeric_limits<double>::quiet_NaN();
@@ -112,8 +407,8 @@ void EventAction::EndOfEventAction(const G4Event* event) {
 
   // Include only primaries that created at least one secondary in scintillator.
   std::vector<G4int> primaryTrackIDs;
-  primaryTrackIDs.reserve(fPrimaryActivity.size());
-  for (const auto& entry : fPrimaryActivity) {
+  primaryTrackIDs.reserve(state.primaryActivity.size());
+  for (const auto& entry : state.primaryActivity) {
     if (entry.second.createdSecondaryCount <= 0) {
       continue;
     }
@@ -122,34 +417,36 @@ void EventAction::EndOfEventAction(const G4Event* event) {
   std::sort(primaryTrackIDs.begin(), primaryTrackIDs.end());
 
   for (const auto primaryTrackID : primaryTrackIDs) {
-    const auto activityIt = fPrimaryActivity.find(primaryTrackID);
-    if (activityIt == fPrimaryActivity.end()) {
+    const auto activityIt = state.primaryActivity.find(primaryTrackID);
+    if (activityIt == state.primaryActivity.end()) {
       continue;
     }
     const auto& activity = activityIt->second;
     SimIO::PrimaryInfo row;
     row.gunCallId = eventID64;
     row.primaryTrackId = static_cast<std::int32_t>(primaryTrackID);
-    row.primarySpecies = fPrimarySpecies;
-    row.primaryXmm = fPrimaryPosition.x() / mm;
-    row.primaryYmm = fPrimaryPosition.y() / mm;
-    row.primaryEnergyMeV = fPrimaryEnergy / MeV;
+    row.primarySpecies = state.primarySpecies;
+    row.primaryXmm = state.primaryPosition.x() / mm;
+    row.primaryYmm = state.primaryPosition.y() / mm;
+    row.primaryEnergyMeV = state.primaryEnergy / MeV;
     row.primaryInteractionTimeNs = resolvePrimaryInteractionTimeNs(primaryTrackID);
     row.primaryCreatedSecondaryCount = activity.createdSecondaryCount;
     row.primaryGeneratedOpticalPhotonCount = activity.generatedOpticalPhotonCount;
     row.primaryDetectedOpticalInterfacePhotonCount =
         activity.detectedOpticalInterfacePhotonCount;
-    if (const auto* info = FindTrackInfo(primaryTrackID)) {
-      row.primarySpecies = info->species;
-      row.primaryXmm = info->originPosition.x() / mm;
-      row.primaryYmm = info->originPosition.y() / mm;
-      row.primaryEnergyMeV = info->originEnergy / MeV;
+    const auto infoIt = state.trackInfo.find(primaryTrackID);
+    if (infoIt != state.trackInfo.end()) {
+      const auto& info = infoIt->second;
+      row.primarySpecies = info.species;
+      row.primaryXmm = info.originPosition.x() / mm;
+      row.primaryYmm = info.originPosition.y() / mm;
+      row.primaryEnergyMeV = info.originEnergy / MeV;
     }
     primaryRows.push_back(row);
   }
 
   std::unordered_set<G4int> seenSecondary;
-  for (const auto& hit : fPhotonHits) {
+  for (const auto& hit : state.photonHits) {
     if (hit.secondaryID < 0 || !seenSecondary.insert(hit.secondaryID).second) {
       continue;
     }
@@ -164,7 +461,10 @@ void EventAction::EndOfEventAction(const G4Event* event) {
     row.secondaryOriginZmm = hit.secondaryOriginPosition.z() / mm;
     row.secondaryOriginEnergyMeV = hit.secondaryOriginEnergy / MeV;
     G4ThreeVector endpoint = hit.secondaryOriginPosition;
-    FindSecondaryScintillatorEndpoint(hit.secondaryID, &endpoint);
+    const auto endpointIt = state.secondaryScintillatorEndpoint.find(hit.secondaryID);
+    if (endpointIt != state.secondaryScintillatorEndpoint.end()) {
+      endpoint = endpointIt->second;
+    }
     row.secondaryEndXmm = endpoint.x() / mm;
     row.secondaryEndYmm = endpoint.y() / mm;
     row.secondaryEndZmm = endpoint.z() / mm;
@@ -172,8 +472,8 @@ void EventAction::EndOfEventAction(const G4Event* event) {
   }
 
   // One output row per detected optical-interface photon hit.
-  photonRows.reserve(fPhotonHits.size());
-  for (const auto& hit : fPhotonHits) {
+  photonRows.reserve(state.photonHits.size());
+  for (const auto& hit : state.photonHits) {
     SimIO::PhotonInfo row;
     row.gunCallId = eventID64;
     row.primaryTrackId = static_cast<std::int32_t>(hit.primaryID);
@@ -206,82 +506,168 @@ void EventAction::EndOfEventAction(const G4Event* event) {
     photonRows.push_back(row);
   }
 
-  G4AutoLock lock(&gOutputMutex);
-  std::string error;
-  if (!SimIO::AppendHdf5(hdf5Path, primaryRows, secondaryRows, photonRows, &error)) {
-    if (error.empty()) {
-      G4cout << "Failed writing HDF5 output to " << hdf5Path << G4endl;
-    } else {
-      G4cout << error << G4endl;
+  Trace::Complete("Assemble rows", assembleStart);
+
+  std::vector<SimIO::TransportedPhotonInfo> transportedRows;
+  if ((fLens || fSurrogate) && !photonRows.empty()) {
+    const auto transportStart = Trace::Now();
+    transportedRows = TransportPhotons(
+        fLens.get(), fSurrogate.get(),
+        fConfig ? fConfig->GetLensTransport() : LensTransport{}, photonRows);
+    Trace::Complete("Lens transport", transportStart);
+  }
+
+  OutputSink::EventBatch batch;
+  batch.eventId = eventID64;
+  batch.primaries = primaryRows;
+  batch.secondaries = secondaryRows;
+  batch.photons = photonRows;
+  batch.transported = transportedRows;
+  {
+    const auto waitStart = std::chrono::steady_clock::now();
+    const auto traceWaitStart = Trace::Now();
+    G4AutoLock lock(&gOutputMutex);
+    const auto lockAcquired = std::chrono::steady_clock::now();
+    Trace::Complete("Wait output lock", traceWaitStart);
+    std::string error;
+    std::chrono::steady_clock::time_point appendStart;
+    if constexpr (PerfCounters::kEnabled) {
+      appendStart = std::chrono::steady_clock::now();
+    }
+    const auto appendTraceStart = Trace::Now();
+    const bool appended = OutputSink::Consume(batch, &error);
+    Trace::Complete("Write output", appendTraceStart);
+    // Only rows a sink keeps count as written; `null`, `shm`, and `histogram`
+    // consume them without storing them.
+    const bool stored = appended && OutputSink::StoresRows();
+    const auto encodedBytes =
+        SimIO::EncodedRowBytes(primaryRows.size(), secondaryRows.size(), photonRows.size());
+    if constexpr (PerfCounters::kEnabled) {
+      auto& counters = PerfCounters::Local();
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - appendStart;
+      ++counters.appendCalls;
+      counters.appendSeconds += elapsed.count();
+      if (appended && OutputSink::Selected("hdf5")) {
+        counters.appendBytes += encodedBytes;
+      }
+    }
+    if (!appended) {
+      if (error.empty()) {
+        G4cout << "Failed writing output rows of event " << eventID64 << G4endl;
+      } else {
+        G4cout << error << G4endl;
+      }
+    } else if (stored) {
+      Progress::RecordRowsWritten(
+          static_cast<std::int64_t>(primaryRows.size() + secondaryRows.size() +
+                                    photonRows.size()),
+          encodedBytes);
     }
+    const auto toNs = [](std::chrono::steady_clock::duration duration) {
+      return static_cast<std::int64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    };
+    Progress::RecordOutputLock(toNs(lockAcquired - waitStart),
+                               toNs(std::chrono::steady_clock::now() - lockAcquired));
+  }
+
+  CountCompletedEvent(state);
+}
+
+void EventAction::FillTimingHistograms(const EventState& state) {
+  for (const auto& hit : state.photonHits) {
+    const auto it = state.primaryScintillatorFirstInteractionTime.find(hit.primaryID);
+    const bool hasDelay = it != state.primaryScintillatorFirstInteractionTime.end();
+    TimingHistograms::Fill(hit.primarySpecies, hit.secondarySpecies, hasDelay,
+                           hasDelay ? hit.photonCreationTime - it->second : 0.0,
+                           hit.opticalInterfaceHitTime);
+  }
+}
+
+std::int64_t EventAction::GeneratedPhotons(const EventState& state) {
+  std::int64_t generatedPhotons = 0;
+  for (const auto& entry : state.primaryActivity) {
+    generatedPhotons += entry.second.generatedOpticalPhotonCount;
+  }
+  return generatedPhotons;
+}
+
+void EventAction::CountCompletedEvent(const EventState& state) {
+  // Count completions rather than event IDs: under MT, IDs finish out of order.
+  const auto completed = Progress::RecordEvent(
+      GeneratedPhotons(state),
+      static_cast<std::int64_t>(state.photonHits.size()) + state.imagedPhotons);
+  if (completed % 1000 == 0) {
+    G4cout << "Simulated " << completed << " events" << G4endl;
   }
 }
 
 void EventAction::RecordTrackInfo(G4int trackID, const TrackInfo& info) {
-  fTrackInfo[trackID] = info;
+  fState.trackInfo[trackID] = info;
 }
 
 const EventAction::TrackInfo* EventAction::FindTrackInfo(G4int trackID) const {
-  const auto it = fTrackInfo.find(trackID);
-  return (it == fTrackInfo.end()) ? nullptr : &it->second;
+  const auto it = fState.trackInfo.find(trackID);
+  return (it == fState.trackInfo.end()) ? nullptr : &it->second;
 }
 
 void EventAction::RecordPhotonCreationInfo(G4int photonTrackID,
                                            const PhotonCreationInfo& info) {
-  fPhotonCreationInfo[photonTrackID] = info;
+  fState.photonCreationInfo[photonTrackID] = info;
 }
 
 const EventAction::PhotonCreationInfo* EventAction::FindPhotonCreationInfo(
     G4int photonTrackID) const {
-  const auto it = fPhotonCreationInfo.find(photonTrackID);
-  return (it == fPhotonCreationInfo.end()) ? nullptr : &it->second;
+  const auto it = fState.photonCreationInfo.find(photonTrackID);
+  return (it == fState.photonCreationInfo.end()) ? nullptr : &it->second;
 }
 
 void EventAction::RecordPendingPhotonOrigin(const G4Track* photonTrack,
                                             const G4ThreeVector& origin) {
-  fPendingPhotonOrigin[photonTrack] = origin;
+  fState.pendingPhotonOrigin[photonTrack] = origin;
 }
 
 bool EventAction::ConsumePendingPhotonOrigin(const G4Track* photonTrack,
                                              G4ThreeVector* origin) {
-  const auto it = fPendingPhotonOrigin.find(photonTrack);
-  if (it == fPendingPhotonOrigin.end()) {
+  const auto it = fState.pendingPhotonOrigin.find(photonTrack);
+  if (it == fState.pendingPhotonOrigin.end()) {
     return false;
   }
   if (origin) {
     *origin = it->second;
   }
-  fPendingPhotonOrigin.erase(it);
+  fState.pendingPhotonOrigin.erase(it);
   return true;
 }
 
 void EventAction::RecordPhotonScintillatorExit(
     G4int photonTrackID, const G4ThreeVector& position) {
-  fPhotonScintillatorExit[photonTrackID] = position;
+  fState.photonScintillatorExit[photonTrackID] = position;
 }
 
 bool EventAction::ConsumePhotonScintillatorExit(G4int photonTrackID,
                                                 G4ThreeVector* position) {
-  const auto it = fPhotonScintillatorExit.find(photonTrackID);
-  if (it == fPhotonScintillatorExit.end()) {
+  const auto it = fState.photonScintillatorExit.find(photonTrackID);
+  if (it == fState.photonScintillatorExit.end()) {
     return false;
   }
   if (position) {
     *position = it->second;
   }
-  fPhotonScintillatorExit.erase(it);
+  fState.photonScintillatorExit.erase(it);
   return true;
 }
 
 void EventAction::RecordSecondaryScintillatorEndpoint(
     G4int secondaryTrackID, const G4ThreeVector& position) {
-  fSecondaryScintillatorEndpoint[secondaryTrackID] = position;
+  fState.secondaryScintillatorEndpoint[secondaryTrackID] = position;
 }
 
 bool EventAction::FindSecondaryScintillatorEndpoint(
     G4int secondaryTrackID, G4ThreeVector* position) const {
-  const auto it = fSecondaryScintillatorEndpoint.find(secondaryTrackID);
-  if (it == fSecondaryScintillatorEndpoint.end()) {
+  const auto it = fState.secondaryScintillatorEndpoint.find(secondaryTrackID);
+  if (it == fState.secondaryScintillatorEndpoint.end()) {
     return false;
   }
   if (position) {
@@ -292,10 +678,10 @@ bool EventAction::FindSecondaryScintillatorEndpoint(
 
 void EventAction::RecordPrimaryScintillatorFirstInteraction(
     G4int primaryTrackID, G4double globalTime) {
-  const auto it = fPrimaryScintillatorFirstInteractionTime.find(primaryTrackID);
-  if (it == fPrimaryScintillatorFirstInteractionTime.end() ||
+  const auto it = fState.primaryScintillatorFirstInteractionTime.find(primaryTrackID);
+  if (it == fState.primaryScintillatorFirstInteractionTime.end() ||
       globalTime < it->second) {
-    fPrimaryScintillatorFirstInteractionTime[primaryTrackID] = globalTime;
+    fState.primaryScintillatorFirstInteractionTime[primaryTrackID] = globalTime;
   }
 }
 
@@ -304,7 +690,7 @@ void EventAction::RecordPrimarySecondaryCreation(
   if (primaryTrackID < 0) {
     return;
   }
-  auto& activity = fPrimaryActivity[primaryTrackID];
+  auto& activity = fState.primaryActivity[primaryTrackID];
   ++activity.createdSecondaryCount;
   if (generatedOpticalPhoton) {
     ++activity.generatedOpticalPhotonCount;
@@ -312,8 +698,5 @@ void EventAction::RecordPrimarySecondaryCreation(
 }
 
 void EventAction::RecordPhotonHit(const PhotonHitRecord& hit) {
-  if (hit.primaryID >= 0) {
-    ++fPrimaryActivity[hit.primaryID].detectedOpticalInterfacePhotonCount;
-  }
-  fPhotonHits.push_back(hit);
+  AppendPhotonHit(&fState, hit);
 }
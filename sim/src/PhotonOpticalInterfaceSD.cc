@@ -1,6 +1,10 @@
 #include "PhotonOpticalInterfaceSD.hh"
 
 #include "EventAction.hh"
+#include "PhotonTrackInformation.hh"
+#include "eventtrigger.hh"
+#include "imaging.hh"
+#include "perfcounters.hh"
 
 #include "G4OpticalPhoton.hh"
 #include "G4PhysicalConstants.hh"
@@ -16,13 +20,24 @@ void FillPrimaryContext(EventAction* eventAction, EventAction::PhotonHitRecord*
   hit->primaryY = eventAction->GetPrimaryPosition().y();
 }
 
+// Position, time, and direction are always captured (the event trigger reads
+// hit times); the rest only when their `/photons` columns are selected.
 void FillOpticalInterfaceContext(const G4StepPoint* preStep,
+                                 SimStructures::PhotonFieldMask fields,
                                  EventAction::PhotonHitRecord* hit) {
+  namespace PhotonField = SimStructures::PhotonField;
   hit->opticalInterfaceHitPosition = preStep->GetPosition();
   hit->opticalInterfaceHitTime = preStep->GetGlobalTime();
   hit->opticalInterfaceHitDirection = preStep->GetMomentumDirection();
-  hit->opticalInterfaceHitPolarization = preStep->GetPolarization();
-  hit->photonCreationTime = preStep->GetGlobalTime() - preStep->GetLocalTime();
+  if (fields & PhotonField::kPolarization) {
+    hit->opticalInterfaceHitPolarization = preStep->GetPolarization();
+  }
+  if (fields & PhotonField::kCreationTime) {
+    hit->photonCreationTime = preStep->GetGlobalTime() - preStep->GetLocalTime();
+  }
+  if ((fields & (PhotonField::kEnergy | PhotonField::kWavelength)) == 0) {
+    return;
+  }
   hit->opticalInterfaceHitEnergy = preStep->GetTotalEnergy();
 
   if (hit->opticalInterfaceHitEnergy > 0.0) {
@@ -33,7 +48,12 @@ void FillOpticalInterfaceContext(const G4StepPoint* preStep,
 void FillAncestryContext(EventAction* eventAction,
                          const G4Track* track,
                          EventAction::PhotonHitRecord* hit) {
-  if (const auto* creationInfo = eventAction->FindPhotonCreationInfo(track->GetTrackID())) {
+  const auto* trackInformation =
+      dynamic_cast<const PhotonTrackInformation*>(track->GetUserInformation());
+  const auto* creationInfo = trackInformation
+                                 ? &trackInformation->GetCreationInfo()
+                                 : eventAction->FindPhotonCreationInfo(track->GetTrackID());
+  if (creationInfo) {
     hit->primaryID = creationInfo->primaryTrackID;
     hit->secondaryID = creationInfo->secondaryTrackID;
     hit->secondarySpecies = creationInfo->secondarySpecies;
@@ -77,16 +97,32 @@ G4bool PhotonOpticalInterfaceSD::ProcessHits(G4Step* step, G4TouchableHistory*)
     return false;
   }
 
+  if constexpr (PerfCounters::kEnabled) {
+    ++PerfCounters::Local().opticalPhotonsDetected;
+  }
+  // One recorded hit per detected optical photon.
+  track->SetTrackStatus(fStopAndKill);
+
+  // Under an event trigger, EventAction fills the images of accepted events.
+  if (!Trigger::Enabled()) {
+    const auto& hitPosition = preStep->GetPosition();
+    Imaging::Fill(hitPosition.x(), hitPosition.y(), preStep->GetGlobalTime());
+  }
+  if (!eventAction->RecordsHits()) {
+    eventAction->RecordImagedPhoton();
+    return true;
+  }
+
+  const auto fields = eventAction->GetPhotonFields();
   EventAction::PhotonHitRecord hit;
   hit.photonID = track->GetTrackID();
   FillPrimaryContext(eventAction, &hit);
-  FillOpticalInterfaceContext(preStep, &hit);
+  FillOpticalInterfaceContext(preStep, fields, &hit);
   FillAncestryContext(eventAction, track, &hit);
-  hit.hasPhotonScintExitPosition = eventAction->ConsumePhotonScintillatorExit(
-      track->GetTrackID(), &hit.photonScintExitPosition);
+  if (fields & SimStructures::PhotonField::kScintExit) {
+    hit.hasPhotonScintExitPosition = eventAction->ConsumePhotonScintillatorExit(
+        track->GetTrackID(), &hit.photonScintExitPosition);
+  }
   eventAction->RecordPhotonHit(hit);
-
-  // One recorded hit per detected optical photon.
-  track->SetTrackStatus(fStopAndKill);
   return true;
 }
@@ -0,0 +1,221 @@
+#include "PhysicsList.hh"
+
+#include "config.hh"
+
+#include "G4Element.hh"
+#include "G4Material.hh"
+#include "G4OpticalPhysics.hh"
+#include "G4ProductionCuts.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4RunManagerKernel.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4Version.hh"
+#include "G4ios.hh"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+/// Physics-list label used in cache keys and entry directory names.
+constexpr const char* kPhysicsListName = "FTFP_BERT_HP_optical";
+
+/// Marker written last into a complete cache entry.
+constexpr const char* kCacheMarkerFile = "g4emi_table_cache.key";
+
+// FNV-1a 64-bit hash over the canonical cache-key description.
+std::uint64_t HashText(const std::string& text) {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const unsigned char c : text) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Describe everything that invalidates stored tables, one item per line.
+std::string DescribeCacheKey(const Config* config, G4double defaultCutValue) {
+  std::ostringstream key;
+  key << std::setprecision(17);
+  key << "physics_list=" << kPhysicsListName << "\n";
+  key << "geant4_version=" << G4VERSION_NUMBER << "\n";
+  key << "scint_material_version="
+      << (config ? config->GetScintMaterialVersion() : 0) << "\n";
+  key << "default_cut_mm=" << defaultCutValue / mm << "\n";
+
+  if (const auto* regions = G4RegionStore::GetInstance()) {
+    for (const auto* region : *regions) {
+      const auto* cuts = region ? region->GetProductionCuts() : nullptr;
+      if (!cuts) {
+        continue;
+      }
+      key << "region=" << region->GetName();
+      for (G4int index = 0; index < 4; ++index) {
+        key << " " << cuts->GetProductionCut(index) / mm;
+      }
+      key << "\n";
+    }
+  }
+
+  if (const auto* materials = G4Material::GetMaterialTable()) {
+    for (const auto* material : *materials) {
+      if (!material) {
+        continue;
+      }
+      key << "material=" << material->GetName()
+          << " density=" << material->GetDensity() / (g / cm3);
+      const auto* fractions = material->GetFractionVector();
+      const auto nElements = material->GetNumberOfElements();
+      for (std::size_t i = 0; i < nElements; ++i) {
+        key << " " << material->GetElement(static_cast<G4int>(i))->GetName() << ":"
+            << (fractions ? fractions[i] : 0.0);
+      }
+      key << "\n";
+    }
+  }
+  return key.str();
+}
+
+bool HasCompleteCacheEntry(const std::filesystem::path& entry) {
+  std::error_code ec;
+  return std::filesystem::is_regular_file(entry / kCacheMarkerFile, ec) && !ec;
+}
+
+std::string UniqueSuffix() {
+  std::random_device rd;
+  std::ostringstream out;
+  out << std::hex << rd() << rd();
+  return out.str();
+}
+}  // namespace
+
+PhysicsList* PhysicsList::FromRunManager() {
+  auto* kernel = G4RunManagerKernel::GetRunManagerKernel();
+  return kernel ? dynamic_cast<PhysicsList*>(kernel->GetPhysicsList()) : nullptr;
+}
+
+PhysicsList::PhysicsList(const Config* config) : FTFP_BERT_HP(), fConfig(config) {
+  RegisterPhysics(new G4OpticalPhysics());
+}
+
+void PhysicsList::SetCuts() {
+  FTFP_BERT_HP::SetCuts();
+
+  // Tables are built and retrieved on the master; workers share them.
+  if (!G4Threading::IsMasterThread()) {
+    return;
+  }
+  fInitializeStart = std::chrono::steady_clock::now();
+  fInitialized = true;
+
+  const std::string cacheRoot = fConfig ? fConfig->GetPhysicsTableCacheDir() : "";
+  if (cacheRoot.empty()) {
+    if (!fRetrievedDirectory.empty()) {
+      ResetPhysicsTableRetrieved();
+      fRetrievedDirectory.clear();
+    }
+    return;
+  }
+
+  const std::string entry = ResolveCacheEntryDirectory(cacheRoot);
+  if (!HasCompleteCacheEntry(entry)) {
+    if (!fRetrievedDirectory.empty()) {
+      ResetPhysicsTableRetrieved();
+      fRetrievedDirectory.clear();
+    }
+    G4cout << "[PhysicsTableCache] Miss for '" << entry
+           << "'; tables will be built and stored after the first run." << G4endl;
+    return;
+  }
+
+  SetPhysicsTableRetrieved(entry);
+  fRetrievedDirectory = entry;
+  G4cout << "[PhysicsTableCache] Retrieving physics tables from '" << entry << "'."
+         << G4endl;
+}
+
+void PhysicsList::StoreTableCacheIfNeeded() {
+  if (!G4Threading::IsMasterThread() || !fInitialized) {
+    return;
+  }
+  const std::string cacheRoot = fConfig ? fConfig->GetPhysicsTableCacheDir() : "";
+  if (cacheRoot.empty() || IsPhysicsTableRetrieved()) {
+    return;
+  }
+
+  const std::filesystem::path entry = ResolveCacheEntryDirectory(cacheRoot);
+  if (HasCompleteCacheEntry(entry)) {
+    return;
+  }
+
+  // Stage into a private directory and rename it into place so concurrent
+  // jobs sharing one cache root never observe a partially written entry.
+  const std::filesystem::path staging =
+      entry.string() + ".tmp-" + UniqueSuffix();
+  std::error_code ec;
+  std::filesystem::create_directories(staging, ec);
+  if (ec) {
+    G4cout << "[PhysicsTableCache] Cannot create '" << staging.string()
+           << "': " << ec.message() << G4endl;
+    return;
+  }
+
+  if (!StorePhysicsTable(staging.string())) {
+    G4cout << "[PhysicsTableCache] Failed storing physics tables into '"
+           << staging.string() << "'." << G4endl;
+    std::filesystem::remove_all(staging, ec);
+    return;
+  }
+
+  {
+    std::ofstream marker(staging / kCacheMarkerFile);
+    marker << DescribeCacheKey(fConfig, GetDefaultCutValue());
+  }
+
+  std::filesystem::rename(staging, entry, ec);
+  if (ec) {
+    // Another job stored the same entry first; keep theirs.
+    std::filesystem::remove_all(staging, ec);
+    return;
+  }
+  G4cout << "[PhysicsTableCache] Stored physics tables into '" << entry.string()
+         << "'." << G4endl;
+}
+
+void PhysicsList::InvalidateTableCache() {
+  if (fRetrievedDirectory.empty()) {
+    return;
+  }
+  ResetPhysicsTableRetrieved();
+  fRetrievedDirectory.clear();
+  G4cout << "[PhysicsTableCache] Materials or geometry changed after initialization; "
+         << "physics tables will be rebuilt." << G4endl;
+}
+
+void PhysicsList::ReportTableCacheStartup() const {
+  if (!G4Threading::IsMasterThread() || !fInitialized || !fConfig ||
+      fConfig->GetPhysicsTableCacheDir().empty()) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - fInitializeStart;
+  std::ostringstream seconds;
+  seconds << std::fixed << std::setprecision(2) << elapsed.count();
+  G4cout << "[PhysicsTableCache] "
+         << (IsPhysicsTableRetrieved() ? "Retrieved" : "Built")
+         << " physics tables; /run/initialize to first run took " << seconds.str()
+         << " s." << G4endl;
+}
+
+std::string PhysicsList::ResolveCacheEntryDirectory(const std::string& cacheRoot) const {
+  std::ostringstream leaf;
+  leaf << kPhysicsListName << "-" << std::hex << std::setw(16) << std::setfill('0')
+       << HashText(DescribeCacheKey(fConfig, GetDefaultCutValue()));
+  return (std::filesystem::path(cacheRoot) / leaf.str()).string();
+}
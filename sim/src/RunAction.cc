@@ -1,13 +1,39 @@
 #include "RunAction.hh"
 
+#include "EventAction.hh"
+#include "PhysicsList.hh"
+#include "SimIO.hh"
+#include "affinity.hh"
 #include "config.hh"
+#include "eventtrigger.hh"
+#include "imaging.hh"
+#include "lenssurrogate.hh"
+#include "lenstrace.hh"
+#include "outputsink.hh"
+#include "perfcounters.hh"
+#include "progress.hh"
+#include "stepprofiler.hh"
+#include "timinghistograms.hh"
+#include "trace.hh"
 
 #include "G4Exception.hh"
 #include "G4ExceptionSeverity.hh"
+#include "G4MTRunManager.hh"
 #include "G4Run.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TaskRunManager.hh"
+#include "G4Threading.hh"
+#include "G4ios.hh"
 
+#include <algorithm>
 #include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace {
 // Return true when the output path has no parent or its parent exists.
@@ -20,20 +46,304 @@ bool ParentDirectoryExists(const std::string& outputFilePath) {
   std::error_code ec;
   return std::filesystem::exists(parent, ec) && !ec;
 }
+
+/// Events and busy time one worker thread reported for the current run.
+struct WorkerThroughput {
+  G4int threadID = -1;
+  int cpu = -1;
+  G4int events = 0;
+  double seconds = 0.0;
+};
+
+/// Worker reports collected until the master prints them at end of run.
+std::mutex gWorkerThroughputMutex;
+std::vector<WorkerThroughput> gWorkerThroughput;
+
+// Print one line per worker plus the spread between the slowest and fastest.
+void ReportWorkerThroughput() {
+  std::vector<WorkerThroughput> workers;
+  {
+    std::lock_guard<std::mutex> lock(gWorkerThroughputMutex);
+    workers.swap(gWorkerThroughput);
+  }
+  if (workers.empty()) {
+    return;
+  }
+  std::sort(workers.begin(), workers.end(),
+            [](const auto& a, const auto& b) { return a.threadID < b.threadID; });
+
+  std::ostringstream table;
+  table << std::fixed << std::setprecision(2);
+  double minRate = -1.0;
+  double maxRate = 0.0;
+  for (const auto& worker : workers) {
+    const double rate = worker.seconds > 0.0 ? worker.events / worker.seconds : 0.0;
+    minRate = minRate < 0.0 ? rate : std::min(minRate, rate);
+    maxRate = std::max(maxRate, rate);
+    table << "\n[g4emi]   worker " << worker.threadID << " cpu "
+          << (worker.cpu >= 0 ? std::to_string(worker.cpu) : std::string("-")) << ": "
+          << worker.events << " events in " << worker.seconds << " s (" << rate
+          << " events/s)";
+  }
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(2) << "[g4emi] Per-worker throughput ("
+         << workers.size() << " workers, " << minRate << "-" << maxRate << " events/s):"
+         << table.str();
+  G4cout << report.str() << G4endl;
+}
+
+// Size tasking task groups so each task carries about `eventsPerTask` events.
+// Geant4 derives events per task from the grain size (number of tasks) when
+// the event loop starts, which happens after BeginOfRunAction.
+void ApplyTaskGrainSize(G4int eventsPerTask, G4int eventsToProcess) {
+  auto* taskRunManager = dynamic_cast<G4TaskRunManager*>(G4RunManager::GetRunManager());
+  if (!taskRunManager) {
+    return;
+  }
+  if (eventsPerTask <= 0 || eventsToProcess <= 0) {
+    taskRunManager->SetGrainsize(0);
+    return;
+  }
+  taskRunManager->SetGrainsize((eventsToProcess + eventsPerTask - 1) / eventsPerTask);
+}
+
+/// Step-profile buckets printed to the console; `/profile` keeps all of them.
+constexpr std::size_t kProfileReportRows = 25;
+
+// Merge every thread's perf counters, print them, and store them in `/run_stats`.
+void ReportPerfCounters(const G4Run* run, const Config* config) {
+  PerfCounters::MergeLocal();
+  const auto totals = PerfCounters::TakeMerged();
+  PerfCounters::Report(run->GetRunID(), totals);
+  if (!config) {
+    return;
+  }
+  std::string error;
+  if (!SimIO::WriteRunStats(config->GetHdf5FilePath(),
+                            PerfCounters::ToRunStatistics(run->GetRunID(), totals),
+                            &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+  }
+}
+
+// Print the merged step profile and store it as `/profile`.
+void ReportStepProfile(const G4Run* run, const Config* config) {
+  const auto rows = StepProfiler::TakeRows();
+  if (rows.empty()) {
+    return;
+  }
+  StepProfiler::Report(run->GetRunID(), rows, kProfileReportRows);
+  if (!config) {
+    return;
+  }
+  std::string error;
+  if (!SimIO::WriteProfile(config->GetHdf5FilePath(), rows, &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+  }
+}
+
+// Write the spans every thread handed over for this run.
+void WriteTrace(const Config* config) {
+  const std::string path = config ? config->GetTraceFile() : "";
+  if (path.empty()) {
+    return;
+  }
+  std::string error;
+  if (!Trace::WriteRun(path, &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+    return;
+  }
+  G4cout << "[g4emi] Wrote trace to '" << path << "'." << G4endl;
+}
+
+// Write the interface images every thread handed over for this run.
+void WriteImages(const Config* config) {
+  if (!config || config->GetOutputMode() == "rows") {
+    return;
+  }
+  std::int64_t hits = 0;
+  std::string error;
+  if (!Imaging::WriteRun(config->GetHdf5FilePath(), &hits, &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+    return;
+  }
+  G4cout << "[g4emi] Wrote /images from " << hits << " interface hits." << G4endl;
+}
+
+// Write the timing histograms every thread handed over for this run.
+void WriteTimingHistograms(const Config* config) {
+  if (!config || !config->GetTimingBinning().Enabled()) {
+    return;
+  }
+  std::int64_t photons = 0;
+  std::string error;
+  if (!TimingHistograms::WriteRun(config->GetHdf5FilePath(), &photons, &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+    return;
+  }
+  G4cout << "[g4emi] Wrote /histograms/timing from " << photons << " detected photons."
+         << G4endl;
+}
+
+// Load the transport lens (or its surrogate model) on the master before
+// workers start, reusing the previous run's lens when its files are unchanged.
+void ActivateTransportLens(const Config* config) {
+  const auto transport = config ? config->GetLensTransport() : LensTransport{};
+  if (!transport.Enabled()) {
+    LensTrace::SetActiveLens(nullptr);
+    LensSurrogate::SetActiveModel(nullptr);
+    return;
+  }
+  if (config->GetOutputMode() == "images") {
+    G4cout << "[g4emi] Lens transport traces /photons rows; ignored in /output/mode images."
+           << G4endl;
+    LensTrace::SetActiveLens(nullptr);
+    LensSurrogate::SetActiveModel(nullptr);
+    return;
+  }
+  if (!transport.surrogate.empty()) {
+    LensTrace::SetActiveLens(nullptr);
+    auto model = std::make_shared<LensSurrogate::Model>();
+    std::string error;
+    if (!LensSurrogate::Load(transport.surrogate, model.get(), &error)) {
+      G4ExceptionDescription message;
+      message << "Cannot load the model for /output/transport/surrogate: " << error;
+      G4Exception("RunAction::BeginOfRunAction", "g4emi/output/transport-surrogate",
+                  FatalException, message);
+      return;
+    }
+    G4cout << "[g4emi] Lens transport through the degree-" << model->degree << " surrogate of '"
+           << model->lensName << "' (validation RMS " << model->validation.rmsErrorMm
+           << " mm) into /transported_photons." << G4endl;
+    LensSurrogate::SetActiveModel(std::move(model));
+    return;
+  }
+  LensSurrogate::SetActiveModel(nullptr);
+  const std::string smx =
+      transport.smx.empty() ? LensTrace::ResolveSmxPath(transport.lens) : transport.smx;
+  const auto active = LensTrace::ActiveLens();
+  if (active && active->zmxPath == transport.lens && active->smxPath == smx) {
+    return;
+  }
+  auto lens = std::make_shared<LensTrace::Lens>();
+  std::string error;
+  if (!LensTrace::Load(transport.lens, smx, lens.get(), &error)) {
+    G4ExceptionDescription message;
+    message << "Cannot load the lens for /output/transport/lens: " << error;
+    G4Exception("RunAction::BeginOfRunAction", "g4emi/output/transport-lens", FatalException,
+                message);
+    return;
+  }
+  G4cout << "[g4emi] Lens transport through '" << lens->name << "' (" << lens->surfaces.size()
+         << " surfaces) into /transported_photons." << G4endl;
+  LensTrace::SetActiveLens(std::move(lens));
+}
+
+// Create this run's output sinks; failing to is fatal, as no event could be
+// written (and shm readers would wait on a ring that never appears).
+void BeginOutputSinks(const Config* config) {
+  OutputSink::RunInfo info;
+  info.config = config;
+  info.hdf5Path = config->GetHdf5FilePath();
+  info.photonFields = config->GetPhotonFields();
+  // /output/mode images produces no rows for the sinks.
+  const auto sinks = config->GetOutputMode() == "images" ? std::vector<std::string>{}
+                                                         : config->GetOutputSinks();
+  std::string error;
+  if (!OutputSink::BeginRun(sinks, info, &error)) {
+    G4Exception("RunAction::BeginOfRunAction", "g4emi/output/sink", FatalException,
+                error.c_str());
+  }
+}
+
+// Apply /output/swmr/* to the HDF5 rows of this run; call after the sinks and
+// the lens are set up.
+void ConfigureSwmr(const Config* config) {
+  const auto swmr = config->GetSwmrOutput();
+  SimIO::SwmrSettings settings;
+  settings.enabled = swmr.enabled;
+  settings.flushIntervalSeconds = swmr.flushInterval / s;
+  // SWMR writers cannot create /transported_photons mid-run.
+  settings.transported = swmr.enabled && OutputSink::Selected("hdf5") &&
+                         (LensTrace::ActiveLens() || LensSurrogate::ActiveModel());
+  SimIO::SetSwmr(settings);
+}
+
+void EndOutputSinks() {
+  std::string error;
+  if (!OutputSink::EndRun(&error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+  }
+}
+
+// Record the lens and input screen next to this run's /transported_photons.
+void WriteTransportAttributes(const Config* config) {
+  const auto lens = LensTrace::ActiveLens();
+  const auto model = LensSurrogate::ActiveModel();
+  // Only the hdf5 sink writes /transported_photons.
+  if (!config || (!lens && !model) || !OutputSink::Selected("hdf5")) {
+    return;
+  }
+  const auto transport = config->GetLensTransport();
+  SimIO::TransportAttributes attributes;
+  if (model) {
+    attributes.lensName = model->lensName;
+    attributes.zmxPath = model->zmxPath;
+    attributes.smxPath = model->smxPath;
+    attributes.engine = "g4emi-surrogate";
+    attributes.surrogatePath = transport.surrogate;
+  } else {
+    attributes.lensName = lens->name;
+    attributes.zmxPath = lens->zmxPath;
+    attributes.smxPath = lens->smxPath;
+  }
+  attributes.screenDefined = transport.screenDiameter > 0.0;
+  attributes.screenDiameterMm = transport.screenDiameter / mm;
+  attributes.screenCenterXmm = transport.screenCenterX / mm;
+  attributes.screenCenterYmm = transport.screenCenterY / mm;
+  std::string error;
+  if (!SimIO::WriteTransportAttributes(config->GetHdf5FilePath(), attributes, &error)) {
+    G4cout << "[g4emi] " << error << G4endl;
+  }
+}
 }  // namespace
 
 RunAction::RunAction(const Config* config) : fConfig(config) {}
 
-void RunAction::BeginOfRunAction(const G4Run* /*run*/) {
+void RunAction::BeginOfRunAction(const G4Run* run) {
+  fRunStart = std::chrono::steady_clock::now();
+  StepProfiler::BeginThreadRun(fConfig ? fConfig->GetStepProfileInterval() : 0);
+  Trace::BeginThreadRun(fConfig && !fConfig->GetTraceFile().empty());
+  Imaging::BeginThreadRun(fConfig && fConfig->GetOutputMode() != "rows",
+                          fConfig ? fConfig->GetImageBinning() : ImageBinning{});
+  TimingHistograms::BeginThreadRun(fConfig ? fConfig->GetTimingBinning() : TimingBinning{});
+  Trigger::BeginThreadRun(fConfig ? fConfig->GetEventTrigger() : EventTrigger{},
+                          fConfig ? fConfig->GetScintYield() : 0.0);
+
   // Validate once on master before worker dispatch.
   if (!IsMaster() || fConfig == nullptr) {
     return;
   }
 
+  ApplyTaskGrainSize(fConfig->GetEventsPerTask(), run->GetNumberOfEventToBeProcessed());
+  Progress::BeginRun(run->GetRunID(), run->GetNumberOfEventToBeProcessed(),
+                     fConfig->GetProgressFile(), fConfig->GetProgressInterval() / s);
+  SimIO::BeginRun();
+  SimIO::SetPhotonFields(fConfig->GetPhotonFields());
+  ActivateTransportLens(fConfig);
+  BeginOutputSinks(fConfig);
+  ConfigureSwmr(fConfig);
+
+  if (const auto* physicsList = PhysicsList::FromRunManager()) {
+    physicsList->ReportTableCacheStartup();
+  }
+
   std::string missingPaths;
 
+  // Sinks such as shm or null never touch the file; images still do.
   const std::string hdf5Path = fConfig->GetHdf5FilePath();
-  if (!ParentDirectoryExists(hdf5Path)) {
+  const bool writesFile = OutputSink::WritesHdf5() || fConfig->GetOutputMode() != "rows";
+  if (writesFile && !ParentDirectoryExists(hdf5Path)) {
     missingPaths += "  - HDF5 target: " + hdf5Path + "\n";
   }
 
@@ -52,3 +362,61 @@ void RunAction::BeginOfRunAction(const G4Run* /*run*/) {
   G4Exception("RunAction::BeginOfRunAction", "g4emi/output/missing-directory",
               FatalException, message);
 }
+
+void RunAction::EndOfRunAction(const G4Run* run) {
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - fRunStart;
+  // Before the thread's images and histograms are merged.
+  if (auto* eventAction = EventAction::Instance()) {
+    eventAction->FlushPendingEvents();
+  }
+  StepProfiler::EndThreadRun();
+  Trace::EndThreadRun();
+  Imaging::EndThreadRun();
+  TimingHistograms::EndThreadRun();
+  if (!IsMaster()) {
+    WorkerThroughput worker;
+    worker.threadID = G4Threading::G4GetThreadId();
+    worker.cpu = Affinity::PinnedCpu();
+    worker.events = run->GetNumberOfEvent();
+    worker.seconds = elapsed.count();
+    {
+      std::lock_guard<std::mutex> lock(gWorkerThroughputMutex);
+      gWorkerThroughput.push_back(worker);
+    }
+    if constexpr (PerfCounters::kEnabled) {
+      PerfCounters::MergeLocal();
+    }
+    return;
+  }
+
+  Progress::EndRun();
+
+  const auto* mtRunManager = dynamic_cast<const G4MTRunManager*>(G4RunManager::GetRunManager());
+  std::ostringstream summary;
+  summary << std::fixed << std::setprecision(2) << "[g4emi] Run " << run->GetRunID() << ": "
+          << run->GetNumberOfEvent() << " events in " << elapsed.count() << " s ("
+          << (elapsed.count() > 0.0 ? run->GetNumberOfEvent() / elapsed.count() : 0.0)
+          << " events/s) on " << (mtRunManager ? mtRunManager->GetNumberOfThreads() : 1)
+          << " thread(s), backend '" << (fConfig ? fConfig->GetRunManagerBackend() : "default")
+          << "'.";
+  G4cout << summary.str() << G4endl;
+  if (fConfig && fConfig->GetEventTrigger().Enabled()) {
+    const auto totals = Progress::Current();
+    G4cout << "[g4emi] Event trigger rejected " << totals.eventsRejected << " of "
+           << totals.eventsCompleted << " events." << G4endl;
+  }
+  ReportWorkerThroughput();
+  if constexpr (PerfCounters::kEnabled) {
+    ReportPerfCounters(run, fConfig);
+  }
+  ReportStepProfile(run, fConfig);
+  WriteTrace(fConfig);
+  WriteImages(fConfig);
+  WriteTimingHistograms(fConfig);
+  WriteTransportAttributes(fConfig);
+  EndOutputSinks();
+
+  if (auto* physicsList = PhysicsList::FromRunManager()) {
+    physicsList->StoreTableCacheIfNeeded();
+  }
+}
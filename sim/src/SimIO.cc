@@ -1,11 +1,19 @@
 #include "SimIO.hh"
 #include "utils.hh"
 
+#include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace SimIO {
@@ -13,17 +21,172 @@ namespace {
 using Hdf5State = SimStructures::detail::Hdf5State;
 using Hdf5PrimaryNativeRow = SimStructures::detail::Hdf5PrimaryNativeRow;
 using Hdf5SecondaryNativeRow = SimStructures::detail::Hdf5SecondaryNativeRow;
-using Hdf5PhotonNativeRow = SimStructures::detail::Hdf5PhotonNativeRow;
+using Hdf5ProfileNativeRow = SimStructures::detail::Hdf5ProfileNativeRow;
 constexpr std::size_t kSpeciesLabelSize = SimStructures::detail::kHdf5SpeciesLabelSize;
 
 /// Stage subdirectory for raw simulation output.
 constexpr const char* kSimulatedPhotonsDir = "simulatedPhotons";
 
+/// How long leaving SWMR mode waits for live readers to close the file.
+constexpr std::chrono::seconds kSwmrReaderWait{30};
+
 Hdf5State& GetState() {
   static Hdf5State state;
   return state;
 }
 
+namespace PhotonField = SimStructures::PhotonField;
+
+/// One `/photons` column: where it lives in `PhotonInfo` and its native type.
+struct PhotonColumn {
+  const char* name;
+  /// Column group from `PhotonField`; 0 marks the always-written ID columns.
+  PhotonFieldMask group;
+  std::size_t sourceOffset;
+  /// 4 (int32) or 8 (int64 or double) bytes.
+  std::size_t size;
+  bool isFloat;
+};
+
+/// Every `/photons` column in file order.
+const PhotonColumn kPhotonColumns[] = {
+    {"gun_call_id", 0, offsetof(PhotonInfo, gunCallId), 8, false},
+    {"primary_track_id", 0, offsetof(PhotonInfo, primaryTrackId), 4, false},
+    {"secondary_track_id", 0, offsetof(PhotonInfo, secondaryTrackId), 4, false},
+    {"photon_track_id", 0, offsetof(PhotonInfo, photonTrackId), 4, false},
+    {"photon_creation_time_ns", PhotonField::kCreationTime,
+     offsetof(PhotonInfo, photonCreationTimeNs), 8, true},
+    {"photon_origin_x_mm", PhotonField::kOrigin,
+     offsetof(PhotonInfo, photonOriginXmm), 8, true},
+    {"photon_origin_y_mm", PhotonField::kOrigin,
+     offsetof(PhotonInfo, photonOriginYmm), 8, true},
+    {"photon_origin_z_mm", PhotonField::kOrigin,
+     offsetof(PhotonInfo, photonOriginZmm), 8, true},
+    {"photon_scint_exit_x_mm", PhotonField::kScintExit,
+     offsetof(PhotonInfo, photonScintExitXmm), 8, true},
+    {"photon_scint_exit_y_mm", PhotonField::kScintExit,
+     offsetof(PhotonInfo, photonScintExitYmm), 8, true},
+    {"photon_scint_exit_z_mm", PhotonField::kScintExit,
+     offsetof(PhotonInfo, photonScintExitZmm), 8, true},
+    {"optical_interface_hit_x_mm", PhotonField::kHitPosition,
+     offsetof(PhotonInfo, opticalInterfaceHitXmm), 8, true},
+    {"optical_interface_hit_y_mm", PhotonField::kHitPosition,
+     offsetof(PhotonInfo, opticalInterfaceHitYmm), 8, true},
+    {"optical_interface_hit_time_ns", PhotonField::kHitTime,
+     offsetof(PhotonInfo, opticalInterfaceHitTimeNs), 8, true},
+    {"optical_interface_hit_dir_x", PhotonField::kDirection,
+     offsetof(PhotonInfo, opticalInterfaceHitDirX), 8, true},
+    {"optical_interface_hit_dir_y", PhotonField::kDirection,
+     offsetof(PhotonInfo, opticalInterfaceHitDirY), 8, true},
+    {"optical_interface_hit_dir_z", PhotonField::kDirection,
+     offsetof(PhotonInfo, opticalInterfaceHitDirZ), 8, true},
+    {"optical_interface_hit_pol_x", PhotonField::kPolarization,
+     offsetof(PhotonInfo, opticalInterfaceHitPolX), 8, true},
+    {"optical_interface_hit_pol_y", PhotonField::kPolarization,
+     offsetof(PhotonInfo, opticalInterfaceHitPolY), 8, true},
+    {"optical_interface_hit_pol_z", PhotonField::kPolarization,
+     offsetof(PhotonInfo, opticalInterfaceHitPolZ), 8, true},
+    {"optical_interface_hit_energy_eV", PhotonField::kEnergy,
+     offsetof(PhotonInfo, opticalInterfaceHitEnergyEV), 8, true},
+    {"optical_interface_hit_wavelength_nm", PhotonField::kWavelength,
+     offsetof(PhotonInfo, opticalInterfaceHitWavelengthNm), 8, true},
+};
+
+/// `/output/photonFields` names: presets first, then single column groups.
+struct PhotonFieldName {
+  const char* name;
+  PhotonFieldMask fields;
+};
+
+const PhotonFieldName kPhotonFieldNames[] = {
+    {"full", PhotonField::kAll},
+    {"transport", PhotonField::kTransport},
+    {"minimal", PhotonField::kMinimal},
+    {"creation_time", PhotonField::kCreationTime},
+    {"origin", PhotonField::kOrigin},
+    {"scint_exit", PhotonField::kScintExit},
+    {"hit_position", PhotonField::kHitPosition},
+    {"hit_time", PhotonField::kHitTime},
+    {"direction", PhotonField::kDirection},
+    {"polarization", PhotonField::kPolarization},
+    {"energy", PhotonField::kEnergy},
+    {"wavelength", PhotonField::kWavelength},
+};
+constexpr std::size_t kPhotonPresetCount = 3;
+
+/// Selected columns packed with natural alignment; `full` reproduces the
+/// historical 168-byte row layout.
+struct PhotonLayout {
+  struct Column {
+    std::size_t index;
+    std::size_t offset;
+  };
+  PhotonFieldMask fields = 0;
+  std::vector<Column> columns;
+  std::size_t rowSize = 0;
+};
+
+PhotonLayout BuildPhotonLayout(PhotonFieldMask fields) {
+  PhotonLayout layout;
+  layout.fields = fields;
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < std::size(kPhotonColumns); ++i) {
+    const auto& column = kPhotonColumns[i];
+    if (column.group != 0 && (fields & column.group) == 0) {
+      continue;
+    }
+    offset = (offset + column.size - 1) / column.size * column.size;
+    layout.columns.push_back({i, offset});
+    offset += column.size;
+  }
+  layout.rowSize = (offset + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+  return layout;
+}
+
+// Layout of the open (or next created) file's `/photons` rows.
+PhotonLayout& GetPhotonLayout() {
+  static PhotonLayout layout = BuildPhotonLayout(PhotonField::kAll);
+  return layout;
+}
+
+SwmrSettings& GetSwmrSettings() {
+  static SwmrSettings settings;
+  return settings;
+}
+
+hid_t NativeType(const PhotonColumn& column) {
+  if (column.isFloat) {
+    return H5T_NATIVE_DOUBLE;
+  }
+  return column.size == 4 ? H5T_NATIVE_INT32 : H5T_NATIVE_INT64;
+}
+
+void PackPhotonRows(RowSpan<PhotonInfo> rows, const PhotonLayout& layout, unsigned char* dst) {
+  for (const auto& row : rows) {
+    // Alignment padding is written as zeros.
+    if (layout.rowSize > 0) {
+      std::memset(dst, 0, layout.rowSize);
+    }
+    const auto* src = reinterpret_cast<const unsigned char*>(&row);
+    for (const auto& column : layout.columns) {
+      const auto& source = kPhotonColumns[column.index];
+      // Fixed-size copies compile to single loads/stores.
+      if (source.size == 8) {
+        std::memcpy(dst + column.offset, src + source.sourceOffset, 8);
+      } else {
+        std::memcpy(dst + column.offset, src + source.sourceOffset, 4);
+      }
+    }
+    dst += layout.rowSize;
+  }
+}
+
+std::vector<unsigned char> PackPhotonRows(RowSpan<PhotonInfo> rows, const PhotonLayout& layout) {
+  std::vector<unsigned char> out(rows.size * layout.rowSize);
+  PackPhotonRows(rows, layout, out.data());
+  return out;
+}
+
 // Close all open HDF5 handles in the cached writer state.
 void CloseAll() {
   auto& s = GetState();
@@ -51,11 +214,20 @@ void CloseAll() {
     H5Tclose(s.photonType);
     s.photonType = -1;
   }
+  if (s.transportedDs >= 0) {
+    H5Dclose(s.transportedDs);
+    s.transportedDs = -1;
+  }
+  if (s.transportedType >= 0) {
+    H5Tclose(s.transportedType);
+    s.transportedType = -1;
+  }
   if (s.file >= 0) {
     H5Fclose(s.file);
     s.file = -1;
   }
   s.openPath.clear();
+  s.swmr = false;
 }
 
 void CopyLabel(const std::string& in, char out[kSpeciesLabelSize]) {
@@ -135,170 +307,233 @@ bool AppendNativeRows(hid_t dataset,
   return writeStatus >= 0;
 }
 
-// Ensure cached HDF5 handles are initialized for the target output file.
-bool EnsureReady(const std::string& hdf5Path, std::string* errorMessage) {
-  auto& s = GetState();
-  if (s.file >= 0 && s.openPath == hdf5Path) {
-    return true;
-  }
-
-  if (s.file >= 0 && s.openPath != hdf5Path) {
-    CloseAll();
-  }
-
-  if (!EnsureParentDirectory(hdf5Path)) {
-    if (errorMessage) {
-      *errorMessage = "Output directory does not exist for " + hdf5Path;
+// Attach each statistic to `object` as a scalar int64 or double attribute.
+bool WriteScalarAttributes(hid_t object, const std::vector<RunStatistic>& stats) {
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  bool ok = true;
+  for (const auto& stat : stats) {
+    const bool isInteger = std::holds_alternative<std::int64_t>(stat.value);
+    const hid_t type = isInteger ? H5T_NATIVE_INT64 : H5T_NATIVE_DOUBLE;
+    const hid_t attribute =
+        H5Acreate2(object, stat.name.c_str(), type, scalar, H5P_DEFAULT, H5P_DEFAULT);
+    if (attribute < 0) {
+      ok = false;
+      continue;
     }
-    return false;
+    const herr_t status =
+        isInteger ? H5Awrite(attribute, type, &std::get<std::int64_t>(stat.value))
+                  : H5Awrite(attribute, type, &std::get<double>(stat.value));
+    ok = ok && status >= 0;
+    H5Aclose(attribute);
   }
+  H5Sclose(scalar);
+  return ok;
+}
 
-  // Treat each simulation run as authoritative for its output path: recreate
-  // the file on first open so stale rows from a previous run are never appended.
-  s.file = H5Fcreate(hdf5Path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-  if (s.file < 0) {
-    if (errorMessage) {
-      *errorMessage = "Failed to open/create " + hdf5Path;
+// Attach each value to `object` as a variable-length string attribute.
+bool WriteStringAttributes(hid_t object,
+                           const std::vector<std::pair<const char*, std::string>>& values) {
+  const hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, H5T_VARIABLE);
+  H5Tset_cset(type, H5T_CSET_UTF8);
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  bool ok = true;
+  for (const auto& [name, value] : values) {
+    if (H5Aexists(object, name) > 0) {
+      H5Adelete(object, name);
     }
-    return false;
+    const hid_t attribute = H5Acreate2(object, name, type, scalar, H5P_DEFAULT, H5P_DEFAULT);
+    if (attribute < 0) {
+      ok = false;
+      continue;
+    }
+    const char* text = value.c_str();
+    ok = H5Awrite(attribute, type, &text) >= 0 && ok;
+    H5Aclose(attribute);
   }
+  H5Sclose(scalar);
+  H5Tclose(type);
+  return ok;
+}
 
-  s.openPath = hdf5Path;
-
+// Native `/primaries` row type.
+hid_t CreatePrimaryType() {
   const hid_t speciesType = CreateFixedStringType(kSpeciesLabelSize);
-
-  s.primaryType = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5PrimaryNativeRow));
-  H5Tinsert(s.primaryType, "gun_call_id",
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5PrimaryNativeRow));
+  H5Tinsert(type, "gun_call_id",
             HOFFSET(Hdf5PrimaryNativeRow, gun_call_id),
             H5T_NATIVE_INT64);
-  H5Tinsert(s.primaryType, "primary_track_id",
+  H5Tinsert(type, "primary_track_id",
             HOFFSET(Hdf5PrimaryNativeRow, primary_track_id), H5T_NATIVE_INT32);
-  H5Tinsert(s.primaryType, "primary_species",
+  H5Tinsert(type, "primary_species",
             HOFFSET(Hdf5PrimaryNativeRow, primary_species), speciesType);
-  H5Tinsert(s.primaryType, "primary_x_mm",
+  H5Tinsert(type, "primary_x_mm",
             HOFFSET(Hdf5PrimaryNativeRow, primary_x_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.primaryType, "primary_y_mm",
+  H5Tinsert(type, "primary_y_mm",
             HOFFSET(Hdf5PrimaryNativeRow, primary_y_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.primaryType, "primary_energy_MeV",
+  H5Tinsert(type, "primary_energy_MeV",
             HOFFSET(Hdf5PrimaryNativeRow, primary_energy_MeV),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.primaryType, "primary_interaction_time_ns",
+  H5Tinsert(type, "primary_interaction_time_ns",
             HOFFSET(Hdf5PrimaryNativeRow, primary_interaction_time_ns),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.primaryType, "primary_created_secondary_count",
+  H5Tinsert(type, "primary_created_secondary_count",
             HOFFSET(Hdf5PrimaryNativeRow, primary_created_secondary_count),
             H5T_NATIVE_INT64);
-  H5Tinsert(s.primaryType, "primary_generated_optical_photon_count",
+  H5Tinsert(type, "primary_generated_optical_photon_count",
             HOFFSET(Hdf5PrimaryNativeRow, primary_generated_optical_photon_count),
             H5T_NATIVE_INT64);
-  H5Tinsert(s.primaryType, "primary_detected_optical_interface_photon_count",
+  H5Tinsert(type, "primary_detected_optical_interface_photon_count",
             HOFFSET(Hdf5PrimaryNativeRow,
                     primary_detected_optical_interface_photon_count),
             H5T_NATIVE_INT64);
+  H5Tclose(speciesType);
+  return type;
+}
 
-  s.secondaryType = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5SecondaryNativeRow));
-  H5Tinsert(s.secondaryType, "gun_call_id",
+// Native `/secondaries` row type.
+hid_t CreateSecondaryType() {
+  const hid_t speciesType = CreateFixedStringType(kSpeciesLabelSize);
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5SecondaryNativeRow));
+  H5Tinsert(type, "gun_call_id",
             HOFFSET(Hdf5SecondaryNativeRow, gun_call_id), H5T_NATIVE_INT64);
-  H5Tinsert(s.secondaryType, "primary_track_id",
+  H5Tinsert(type, "primary_track_id",
             HOFFSET(Hdf5SecondaryNativeRow, primary_track_id), H5T_NATIVE_INT32);
-  H5Tinsert(s.secondaryType, "secondary_track_id",
+  H5Tinsert(type, "secondary_track_id",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_track_id),
             H5T_NATIVE_INT32);
-  H5Tinsert(s.secondaryType, "secondary_species",
+  H5Tinsert(type, "secondary_species",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_species), speciesType);
-  H5Tinsert(s.secondaryType, "secondary_origin_x_mm",
+  H5Tinsert(type, "secondary_origin_x_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_origin_x_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_origin_y_mm",
+  H5Tinsert(type, "secondary_origin_y_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_origin_y_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_origin_z_mm",
+  H5Tinsert(type, "secondary_origin_z_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_origin_z_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_origin_energy_MeV",
+  H5Tinsert(type, "secondary_origin_energy_MeV",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_origin_energy_MeV),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_end_x_mm",
+  H5Tinsert(type, "secondary_end_x_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_end_x_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_end_y_mm",
+  H5Tinsert(type, "secondary_end_y_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_end_y_mm),
             H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.secondaryType, "secondary_end_z_mm",
+  H5Tinsert(type, "secondary_end_z_mm",
             HOFFSET(Hdf5SecondaryNativeRow, secondary_end_z_mm),
             H5T_NATIVE_DOUBLE);
+  H5Tclose(speciesType);
+  return type;
+}
 
-  s.photonType = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5PhotonNativeRow));
-  H5Tinsert(s.photonType, "gun_call_id",
-            HOFFSET(Hdf5PhotonNativeRow, gun_call_id),
-            H5T_NATIVE_INT64);
-  H5Tinsert(s.photonType, "primary_track_id",
-            HOFFSET(Hdf5PhotonNativeRow, primary_track_id), H5T_NATIVE_INT32);
-  H5Tinsert(s.photonType, "secondary_track_id",
-            HOFFSET(Hdf5PhotonNativeRow, secondary_track_id),
-            H5T_NATIVE_INT32);
-  H5Tinsert(s.photonType, "photon_track_id",
-            HOFFSET(Hdf5PhotonNativeRow, photon_track_id), H5T_NATIVE_INT32);
-  H5Tinsert(s.photonType, "photon_creation_time_ns",
-            HOFFSET(Hdf5PhotonNativeRow, photon_creation_time_ns),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_origin_x_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_origin_x_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_origin_y_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_origin_y_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_origin_z_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_origin_z_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_scint_exit_x_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_scint_exit_x_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_scint_exit_y_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_scint_exit_y_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "photon_scint_exit_z_mm",
-            HOFFSET(Hdf5PhotonNativeRow, photon_scint_exit_z_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_x_mm",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_x_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_y_mm",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_y_mm),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_time_ns",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_time_ns),
-            H5T_NATIVE_DOUBLE);
+// Packed `/photons` row type for `layout`.
+hid_t CreatePhotonType(const PhotonLayout& layout) {
+  const hid_t type = H5Tcreate(H5T_COMPOUND, layout.rowSize);
+  for (const auto& column : layout.columns) {
+    const auto& source = kPhotonColumns[column.index];
+    H5Tinsert(type, source.name, column.offset, NativeType(source));
+  }
+  return type;
+}
 
-  // Optical-interface state at crossing for downstream transport.
-  H5Tinsert(s.photonType, "optical_interface_hit_dir_x",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_dir_x),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_dir_y",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_dir_y),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_dir_z",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_dir_z),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_pol_x",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_pol_x),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_pol_y",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_pol_y),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_pol_z",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_pol_z),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_energy_eV",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_energy_eV),
-            H5T_NATIVE_DOUBLE);
-  H5Tinsert(s.photonType, "optical_interface_hit_wavelength_nm",
-            HOFFSET(Hdf5PhotonNativeRow, optical_interface_hit_wavelength_nm),
-            H5T_NATIVE_DOUBLE);
+// Native (unpacked) `/transported_photons` row type.
+hid_t CreateTransportedType() {
+  using Row = SimStructures::TransportedPhotonInfo;
+  // h5py reads this int8 enum as numpy bool.
+  const hid_t boolType = H5Tenum_create(H5T_NATIVE_INT8);
+  const std::int8_t no = 0;
+  const std::int8_t yes = 1;
+  H5Tenum_insert(boolType, "FALSE", &no);
+  H5Tenum_insert(boolType, "TRUE", &yes);
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Row));
+  H5Tinsert(type, "source_photon_index", HOFFSET(Row, sourcePhotonIndex), H5T_NATIVE_INT64);
+  H5Tinsert(type, "gun_call_id", HOFFSET(Row, gunCallId), H5T_NATIVE_INT64);
+  H5Tinsert(type, "primary_track_id", HOFFSET(Row, primaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "secondary_track_id", HOFFSET(Row, secondaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "photon_track_id", HOFFSET(Row, photonTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "intensifier_hit_x_mm", HOFFSET(Row, intensifierHitXmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_y_mm", HOFFSET(Row, intensifierHitYmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_z_mm", HOFFSET(Row, intensifierHitZmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_time_ns", HOFFSET(Row, intensifierHitTimeNs), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_wavelength_nm",
+            HOFFSET(Row, intensifierHitWavelengthNm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "in_bounds", HOFFSET(Row, inBounds), boolType);
+  H5Tclose(boolType);
+  return type;
+}
 
-  H5Tclose(speciesType);
+// Open or create `/transported_photons`, stored packed like the Python stage's rows.
+bool EnsureTransportedDataset() {
+  auto& s = GetState();
+  if (s.transportedDs >= 0) {
+    return true;
+  }
+  if (s.transportedType < 0) {
+    s.transportedType = CreateTransportedType();
+  }
+  const hid_t fileType = H5Tcopy(s.transportedType);
+  H5Tpack(fileType);
+  s.transportedDs = CreateExtendableDataset(s.file, "/transported_photons", fileType);
+  H5Tclose(fileType);
+  return s.transportedDs >= 0;
+}
+
+// Fixed-size contiguous dataset whose rows are read from `table.path`.
+bool CreateExternalDataset(hid_t file, const char* name, hid_t rowType, const RawTable& table) {
+  hsize_t dims[1] = {table.rows};
+  const hid_t space = H5Screate_simple(1, dims, nullptr);
+  const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  // The rows are already on disk; a fill value would overwrite them.
+  H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER);
+  const hsize_t bytes = table.rows * H5Tget_size(rowType);
+  if (bytes > 0) {
+    H5Pset_external(dcpl, table.path.c_str(), 0, bytes);
+  }
+  const hid_t ds = H5Dcreate2(file, name, rowType, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  H5Pclose(dcpl);
+  H5Sclose(space);
+  if (ds < 0) {
+    return false;
+  }
+  H5Dclose(ds);
+  return true;
+}
+
+// H5Lexists fails on a missing parent, so check `path` one component at a time.
+bool LinkExists(hid_t location, const std::string& path) {
+  std::size_t end = path.find('/', 1);
+  while (true) {
+    const std::string prefix = path.substr(0, end);
+    if (H5Lexists(location, prefix.c_str(), H5P_DEFAULT) <= 0) {
+      return false;
+    }
+    if (end == std::string::npos) {
+      return true;
+    }
+    end = path.find('/', end + 1);
+  }
+}
+
+// File access for the output file: the latest format when SWMR is enabled.
+hid_t CreateFileAccess() {
+  const hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+  if (GetSwmrSettings().enabled) {
+    H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST);
+  }
+  return fapl;
+}
+
+// Create (or, in an existing file, open) the row tables of the open file.
+bool OpenTables(std::string* errorMessage) {
+  auto& s = GetState();
+  s.primaryType = CreatePrimaryType();
+  s.secondaryType = CreateSecondaryType();
+  s.photonType = CreatePhotonType(GetPhotonLayout());
 
   s.primariesDs = CreateExtendableDataset(s.file, "/primaries", s.primaryType);
   s.secondariesDs = CreateExtendableDataset(s.file, "/secondaries", s.secondaryType);
@@ -306,22 +541,160 @@ bool EnsureReady(const std::string& hdf5Path, std::string* errorMessage) {
 
   if (s.primariesDs < 0 || s.secondariesDs < 0 || s.photonsDs < 0) {
     if (errorMessage) {
-      *errorMessage = "Failed to initialize datasets in " + hdf5Path;
+      *errorMessage = "Failed to initialize datasets in " + s.openPath;
     }
     return false;
   }
+  if (H5Lexists(s.file, "/transported_photons", H5P_DEFAULT) > 0) {
+    return EnsureTransportedDataset();
+  }
+  return true;
+}
 
-  if (!s.registeredAtExit) {
-    std::atexit(CloseAll);
-    s.registeredAtExit = true;
+// Enter SWMR-write mode; every dataset the run appends to must exist first.
+bool StartSwmr(std::string* errorMessage) {
+  auto& s = GetState();
+  if ((GetSwmrSettings().transported && !EnsureTransportedDataset()) ||
+      H5Fstart_swmr_write(s.file) < 0) {
+    if (errorMessage) {
+      *errorMessage = "Failed to start SWMR writing of " + s.openPath;
+    }
+    return false;
   }
+  s.swmr = true;
+  s.lastFlush = std::chrono::steady_clock::now();
+  return true;
+}
+
+// Objects cannot be created during SWMR writing, and HDF5 1.10 has no way to
+// stop it, so reopen the file for ordinary read/write access. SWMR readers
+// cannot follow structural changes, so the reopen keeps HDF5's file lock and
+// waits up to kSwmrReaderWait for readers to close the file.
+bool LeaveSwmr(std::string* errorMessage) {
+  auto& s = GetState();
+  const std::string path = s.openPath;
+  CloseAll();
+  const hid_t fapl = CreateFileAccess();
+  const auto deadline = std::chrono::steady_clock::now() + kSwmrReaderWait;
+  bool announced = false;
+  for (;;) {
+    // Silence HDF5's error stack while readers still hold the lock; the last
+    // attempt reports normally.
+    if (std::chrono::steady_clock::now() >= deadline) {
+      s.file = H5Fopen(path.c_str(), H5F_ACC_RDWR, fapl);
+      break;
+    }
+    H5E_BEGIN_TRY { s.file = H5Fopen(path.c_str(), H5F_ACC_RDWR, fapl); }
+    H5E_END_TRY;
+    if (s.file >= 0) {
+      break;
+    }
+    if (!announced) {
+      std::cerr << "Waiting for SWMR readers to close " << path << std::endl;
+      announced = true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  H5Pclose(fapl);
+  if (s.file < 0) {
+    // Leave the rows alone: no later write this run may recreate the file.
+    s.failedPath = path;
+    if (errorMessage) {
+      *errorMessage = "Failed to reopen " + path +
+                      " after SWMR writing: readers still had it open after " +
+                      std::to_string(kSwmrReaderWait.count()) +
+                      " s (the rows written so far are complete)";
+    }
+    return false;
+  }
+  s.openPath = path;
+  return OpenTables(errorMessage);
+}
+
+// Flush appended rows for SWMR readers once the flush interval has passed.
+void FlushIfDue() {
+  auto& s = GetState();
+  if (!s.swmr) {
+    return;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  const std::chrono::duration<double> sinceFlush = now - s.lastFlush;
+  if (sinceFlush.count() >= GetSwmrSettings().flushIntervalSeconds) {
+    H5Fflush(s.file, H5F_SCOPE_LOCAL);
+    s.lastFlush = now;
+  }
+}
+
+// Ensure cached HDF5 handles are initialized for the target output file.
+// `forRows` callers only append rows and may run in SWMR mode; any other
+// write first leaves it.
+bool EnsureReady(const std::string& hdf5Path, std::string* errorMessage, bool forRows = false) {
+  auto& s = GetState();
+  if (hdf5Path == s.failedPath) {
+    if (errorMessage) {
+      *errorMessage =
+          "Skipped writing " + hdf5Path + ": it could not be reopened after SWMR writing";
+    }
+    return false;
+  }
+  if (s.file >= 0 && s.openPath != hdf5Path) {
+    CloseAll();
+  }
+
+  if (s.file < 0) {
+    if (!EnsureParentDirectory(hdf5Path)) {
+      if (errorMessage) {
+        *errorMessage = "Output directory does not exist for " + hdf5Path;
+      }
+      return false;
+    }
+
+    // Treat each simulation run as authoritative for its output path: recreate
+    // the file on its first open in a run so stale rows from a previous run are
+    // never appended, and reopen it afterwards so this run's rows are kept.
+    const bool created = std::find(s.createdPaths.begin(), s.createdPaths.end(), hdf5Path) !=
+                         s.createdPaths.end();
+    const hid_t fapl = CreateFileAccess();
+    s.file = created ? H5Fopen(hdf5Path.c_str(), H5F_ACC_RDWR, fapl)
+                     : H5Fcreate(hdf5Path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl);
+    H5Pclose(fapl);
+    if (s.file < 0) {
+      if (errorMessage) {
+        *errorMessage = "Failed to open/create " + hdf5Path;
+      }
+      return false;
+    }
+
+    if (!created) {
+      s.createdPaths.push_back(hdf5Path);
+    }
+    s.openPath = hdf5Path;
+    if (!OpenTables(errorMessage)) {
+      return false;
+    }
 
+    if (!s.registeredAtExit) {
+      std::atexit(CloseAll);
+      s.registeredAtExit = true;
+    }
+  }
+
+  if (forRows && !s.swmr && GetSwmrSettings().enabled) {
+    return StartSwmr(errorMessage);
+  }
+  if (!forRows && s.swmr) {
+    return LeaveSwmr(errorMessage);
+  }
   return true;
 }
 
-std::vector<Hdf5PrimaryNativeRow> ToNative(const std::vector<PrimaryInfo>& rows) {
+}  // namespace
+
+namespace detail {
+
+std::vector<Hdf5PrimaryNativeRow> ToNative(RowSpan<PrimaryInfo> rows) {
   std::vector<Hdf5PrimaryNativeRow> out;
-  out.reserve(rows.size());
+  out.reserve(rows.size);
   for (const auto& row : rows) {
     Hdf5PrimaryNativeRow native{};
     native.gun_call_id = row.gunCallId;
@@ -341,9 +714,9 @@ std::vector<Hdf5PrimaryNativeRow> ToNative(const std::vector<PrimaryInfo>& rows)
   return out;
 }
 
-std::vector<Hdf5SecondaryNativeRow> ToNative(const std::vector<SecondaryInfo>& rows) {
+std::vector<Hdf5SecondaryNativeRow> ToNative(RowSpan<SecondaryInfo> rows) {
   std::vector<Hdf5SecondaryNativeRow> out;
-  out.reserve(rows.size());
+  out.reserve(rows.size);
   for (const auto& row : rows) {
     Hdf5SecondaryNativeRow native{};
     native.gun_call_id = row.gunCallId;
@@ -362,38 +735,24 @@ std::vector<Hdf5SecondaryNativeRow> ToNative(const std::vector<SecondaryInfo>& r
   return out;
 }
 
-std::vector<Hdf5PhotonNativeRow> ToNative(const std::vector<PhotonInfo>& rows) {
-  std::vector<Hdf5PhotonNativeRow> out;
-  out.reserve(rows.size());
-  for (const auto& row : rows) {
-    Hdf5PhotonNativeRow native{};
-    native.gun_call_id = row.gunCallId;
-    native.primary_track_id = row.primaryTrackId;
-    native.secondary_track_id = row.secondaryTrackId;
-    native.photon_track_id = row.photonTrackId;
-    native.photon_creation_time_ns = row.photonCreationTimeNs;
-    native.photon_origin_x_mm = row.photonOriginXmm;
-    native.photon_origin_y_mm = row.photonOriginYmm;
-    native.photon_origin_z_mm = row.photonOriginZmm;
-    native.photon_scint_exit_x_mm = row.photonScintExitXmm;
-    native.photon_scint_exit_y_mm = row.photonScintExitYmm;
-    native.photon_scint_exit_z_mm = row.photonScintExitZmm;
-    native.optical_interface_hit_x_mm = row.opticalInterfaceHitXmm;
-    native.optical_interface_hit_y_mm = row.opticalInterfaceHitYmm;
-    native.optical_interface_hit_time_ns = row.opticalInterfaceHitTimeNs;
-    native.optical_interface_hit_dir_x = row.opticalInterfaceHitDirX;
-    native.optical_interface_hit_dir_y = row.opticalInterfaceHitDirY;
-    native.optical_interface_hit_dir_z = row.opticalInterfaceHitDirZ;
-    native.optical_interface_hit_pol_x = row.opticalInterfaceHitPolX;
-    native.optical_interface_hit_pol_y = row.opticalInterfaceHitPolY;
-    native.optical_interface_hit_pol_z = row.opticalInterfaceHitPolZ;
-    native.optical_interface_hit_energy_eV = row.opticalInterfaceHitEnergyEV;
-    native.optical_interface_hit_wavelength_nm = row.opticalInterfaceHitWavelengthNm;
-    out.push_back(native);
+std::vector<unsigned char> PackPhotons(RowSpan<PhotonInfo> rows, PhotonFieldMask fields) {
+  return PackPhotonRows(rows, BuildPhotonLayout(fields));
+}
+
+void PackPhotons(RowSpan<PhotonInfo> rows, PhotonFieldMask fields, unsigned char* out) {
+  PackPhotonRows(rows, BuildPhotonLayout(fields), out);
+}
+
+std::vector<PhotonColumnInfo> PhotonColumns(PhotonFieldMask fields) {
+  std::vector<PhotonColumnInfo> out;
+  for (const auto& column : BuildPhotonLayout(fields).columns) {
+    const auto& source = kPhotonColumns[column.index];
+    out.push_back({source.name, column.offset, source.size, source.isFloat});
   }
   return out;
 }
-}  // namespace
+
+}  // namespace detail
 
 // Normalize a run name into a directory-safe token.
 std::string NormalizeRunName(const std::string& value) {
@@ -491,19 +850,109 @@ std::string ComposeOutputPath(const std::string& base,
   return (runDir / baseLeaf).string() + extension;
 }
 
+// Accept presets and column groups; the union of every listed name is selected.
+bool ParsePhotonFields(const std::string& value,
+                       PhotonFieldMask* fields,
+                       std::string* errorMessage) {
+  std::string normalized = Utils::ToLower(Utils::Unquote(Utils::Trim(value)));
+  std::replace(normalized.begin(), normalized.end(), ',', ' ');
+  std::istringstream stream(normalized);
+  PhotonFieldMask selected = 0;
+  for (std::string token; stream >> token;) {
+    const auto it = std::find_if(std::begin(kPhotonFieldNames), std::end(kPhotonFieldNames),
+                                 [&token](const PhotonFieldName& entry) {
+                                   return token == entry.name;
+                                 });
+    if (it == std::end(kPhotonFieldNames)) {
+      if (errorMessage) {
+        std::string known;
+        for (const auto& entry : kPhotonFieldNames) {
+          known += known.empty() ? "" : ", ";
+          known += entry.name;
+        }
+        *errorMessage = "unknown photon field '" + token + "' (expected " + known + ")";
+      }
+      return false;
+    }
+    selected |= it->fields;
+  }
+  if (selected == 0) {
+    if (errorMessage) {
+      *errorMessage = "no photon fields given";
+    }
+    return false;
+  }
+  if (fields) {
+    *fields = selected;
+  }
+  return true;
+}
+
+// Name a preset exactly, otherwise list the selected column groups.
+std::string DescribePhotonFields(PhotonFieldMask fields) {
+  std::string groups;
+  for (std::size_t i = 0; i < std::size(kPhotonFieldNames); ++i) {
+    const auto& entry = kPhotonFieldNames[i];
+    if (i < kPhotonPresetCount) {
+      if (fields == entry.fields) {
+        return entry.name;
+      }
+      continue;
+    }
+    if ((fields & entry.fields) != 0) {
+      groups += groups.empty() ? "" : ",";
+      groups += entry.name;
+    }
+  }
+  return groups;
+}
+
+std::size_t PhotonRowBytes(PhotonFieldMask fields) {
+  return BuildPhotonLayout(fields).rowSize;
+}
+
+void BeginRun() {
+  auto& s = GetState();
+  s.createdPaths.clear();
+  s.failedPath.clear();
+}
+
+// Swap the `/photons` layout; an open file keeps its schema, so close it.
+void SetPhotonFields(PhotonFieldMask fields) {
+  auto& layout = GetPhotonLayout();
+  if (layout.fields == fields) {
+    return;
+  }
+  CloseAll();
+  layout = BuildPhotonLayout(fields);
+}
+
+void SetSwmr(const SwmrSettings& settings) {
+  auto& current = GetSwmrSettings();
+  if (current.enabled == settings.enabled && current.transported == settings.transported &&
+      current.flushIntervalSeconds == settings.flushIntervalSeconds) {
+    return;
+  }
+  // The file format and the tables created up front depend on the settings.
+  if (current.enabled != settings.enabled || current.transported != settings.transported) {
+    CloseAll();
+  }
+  current = settings;
+}
+
 // Append semantic row containers into /primaries, /secondaries, and /photons.
 bool AppendHdf5(const std::string& hdf5Path,
-                const std::vector<PrimaryInfo>& primaryRows,
-                const std::vector<SecondaryInfo>& secondaryRows,
-                const std::vector<PhotonInfo>& photonRows,
+                RowSpan<PrimaryInfo> primaryRows,
+                RowSpan<SecondaryInfo> secondaryRows,
+                RowSpan<PhotonInfo> photonRows,
                 std::string* errorMessage) {
-  if (!EnsureReady(hdf5Path, errorMessage)) {
+  if (!EnsureReady(hdf5Path, errorMessage, true)) {
     return false;
   }
 
-  auto primaryNative = ToNative(primaryRows);
-  auto secondaryNative = ToNative(secondaryRows);
-  auto photonNative = ToNative(photonRows);
+  auto primaryNative = detail::ToNative(primaryRows);
+  auto secondaryNative = detail::ToNative(secondaryRows);
+  const auto photonNative = PackPhotonRows(photonRows, GetPhotonLayout());
 
   auto& s = GetState();
   if (!primaryNative.empty() &&
@@ -524,16 +973,317 @@ bool AppendHdf5(const std::string& hdf5Path,
     return false;
   }
 
-  if (!photonNative.empty() &&
+  if (!photonRows.empty() &&
       !AppendNativeRows(s.photonsDs, s.photonType, photonNative.data(),
-                        static_cast<hsize_t>(photonNative.size()))) {
+                        static_cast<hsize_t>(photonRows.size))) {
     if (errorMessage) {
       *errorMessage = "Failed appending /photons rows to " + hdf5Path;
     }
     return false;
   }
 
+  FlushIfDue();
+  return true;
+}
+
+std::int64_t PhotonRowCount(const std::string& hdf5Path) {
+  const auto& s = GetState();
+  if (s.file < 0 || s.openPath != hdf5Path || s.photonsDs < 0) {
+    return 0;
+  }
+  const hid_t space = H5Dget_space(s.photonsDs);
+  hsize_t dims[1] = {0};
+  H5Sget_simple_extent_dims(space, dims, nullptr);
+  H5Sclose(space);
+  return static_cast<std::int64_t>(dims[0]);
+}
+
+// Append traced photons to `/transported_photons`.
+bool AppendTransported(const std::string& hdf5Path,
+                       RowSpan<TransportedPhotonInfo> rows,
+                       std::int64_t sourcePhotonIndexBase,
+                       std::string* errorMessage) {
+  if (!EnsureReady(hdf5Path, errorMessage, true)) {
+    return false;
+  }
+  // Creating the table ends SWMR writing unless SwmrSettings::transported
+  // created it up front.
+  if (GetState().swmr && GetState().transportedDs < 0 && !LeaveSwmr(errorMessage)) {
+    return false;
+  }
+  std::vector<TransportedPhotonInfo> rebased(rows.begin(), rows.end());
+  for (auto& row : rebased) {
+    row.sourcePhotonIndex += sourcePhotonIndexBase;
+  }
+  auto& s = GetState();
+  if (!EnsureTransportedDataset() ||
+      !AppendNativeRows(s.transportedDs, s.transportedType, rebased.data(),
+                        static_cast<hsize_t>(rebased.size()))) {
+    if (errorMessage) {
+      *errorMessage = "Failed appending /transported_photons rows to " + hdf5Path;
+    }
+    return false;
+  }
+  FlushIfDue();
   return true;
 }
 
+// Root attributes as written by `src/optics/OpticalTransport.py`.
+bool WriteTransportAttributes(const std::string& hdf5Path,
+                              const TransportAttributes& attributes,
+                              std::string* errorMessage) {
+  if (!EnsureReady(hdf5Path, errorMessage)) {
+    return false;
+  }
+  auto& s = GetState();
+  bool ok = EnsureTransportedDataset();
+
+  std::vector<std::pair<const char*, std::string>> strings = {
+      {"lens_name", attributes.lensName},
+      {"lens_zmx_path", attributes.zmxPath},
+      {"object_plane", "scintillator_back_face"},
+      {"optical_interface_represents", "lens_entrance_plane"},
+      {"transport_engine", attributes.engine}};
+  if (!attributes.smxPath.empty()) {
+    strings.emplace_back("lens_smx_path", attributes.smxPath);
+  }
+  if (!attributes.surrogatePath.empty()) {
+    strings.emplace_back("lens_surrogate_path", attributes.surrogatePath);
+  }
+  ok = WriteStringAttributes(s.file, strings) && ok;
+
+  const auto writeAttribute = [&s](const char* name, hid_t type, hid_t space,
+                                   const void* value) {
+    if (H5Aexists(s.file, name) > 0) {
+      H5Adelete(s.file, name);
+    }
+    const hid_t attribute = H5Acreate2(s.file, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    if (attribute < 0) {
+      return false;
+    }
+    const bool written = H5Awrite(attribute, type, value) >= 0;
+    H5Aclose(attribute);
+    return written;
+  };
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  const std::int8_t defined = attributes.screenDefined ? 1 : 0;
+  const hid_t boolType = H5Tget_member_type(s.transportedType,
+                                            H5Tget_member_index(s.transportedType, "in_bounds"));
+  ok = writeAttribute("intensifier_input_screen_defined", boolType, scalar, &defined) && ok;
+  H5Tclose(boolType);
+  if (attributes.screenDefined) {
+    ok = writeAttribute("intensifier_input_screen_diameter_mm", H5T_NATIVE_DOUBLE, scalar,
+                        &attributes.screenDiameterMm) &&
+         ok;
+    const hsize_t dims[1] = {2};
+    const hid_t pair = H5Screate_simple(1, dims, nullptr);
+    const double center[2] = {attributes.screenCenterXmm, attributes.screenCenterYmm};
+    ok = writeAttribute("intensifier_input_screen_center_mm", H5T_NATIVE_DOUBLE, pair,
+                        center) &&
+         ok;
+    H5Sclose(pair);
+  }
+  H5Sclose(scalar);
+
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed writing transport attributes to " + hdf5Path;
+  }
+  return ok;
+}
+
+// Index the raw sink's row files as external datasets of a new file.
+bool WriteRawIndex(const std::string& hdf5Path,
+                   const RawTables& tables,
+                   std::string* errorMessage) {
+  if (!EnsureParentDirectory(hdf5Path)) {
+    *errorMessage = "Output directory does not exist for " + hdf5Path;
+    return false;
+  }
+  const hid_t file = H5Fcreate(hdf5Path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (file < 0) {
+    *errorMessage = "Failed to create " + hdf5Path;
+    return false;
+  }
+  const struct {
+    const char* name;
+    const RawTable& table;
+    hid_t type;
+  } datasets[] = {
+      {"/primaries", tables.primaries, CreatePrimaryType()},
+      {"/secondaries", tables.secondaries, CreateSecondaryType()},
+      {"/photons", tables.photons, CreatePhotonType(BuildPhotonLayout(tables.photonFields))},
+      {"/transported_photons", tables.transported, CreateTransportedType()},
+  };
+  bool ok = true;
+  for (const auto& dataset : datasets) {
+    // Like the hdf5 sink, only runs that transported photons have the table.
+    const bool wanted = dataset.table.rows > 0 || &dataset.table != &tables.transported;
+    if (wanted && !CreateExternalDataset(file, dataset.name, dataset.type, dataset.table)) {
+      ok = false;
+    }
+    H5Tclose(dataset.type);
+  }
+  ok = H5Fclose(file) >= 0 && ok;
+  if (!ok) {
+    *errorMessage = "Failed writing the raw row index " + hdf5Path;
+  }
+  return ok;
+}
+
+// Release cached HDF5 handles so the file is complete on disk.
+void Close() { CloseAll(); }
+
+// Write `/run_stats` attributes, replacing any left by an earlier run.
+bool WriteRunStats(const std::string& hdf5Path,
+                   const std::vector<RunStatistic>& stats,
+                   std::string* errorMessage) {
+  if (!EnsureReady(hdf5Path, errorMessage)) {
+    return false;
+  }
+
+  auto& s = GetState();
+  constexpr const char* kGroupName = "/run_stats";
+  if (H5Lexists(s.file, kGroupName, H5P_DEFAULT) > 0) {
+    H5Ldelete(s.file, kGroupName, H5P_DEFAULT);
+  }
+  const hid_t group =
+      H5Gcreate2(s.file, kGroupName, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+  if (group < 0) {
+    if (errorMessage) {
+      *errorMessage = "Failed creating /run_stats in " + hdf5Path;
+    }
+    return false;
+  }
+
+  const bool ok = WriteScalarAttributes(group, stats);
+  H5Gclose(group);
+
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed writing /run_stats attributes to " + hdf5Path;
+  }
+  return ok;
+}
+
+// Write uint64 count datasets under `groupPath`, replacing any left by an earlier run.
+bool WriteCounts(const std::string& hdf5Path,
+                 const std::string& groupPath,
+                 const std::vector<CountsInfo>& datasets,
+                 const std::vector<RunStatistic>& attributes,
+                 std::string* errorMessage) {
+  if (!EnsureReady(hdf5Path, errorMessage)) {
+    return false;
+  }
+
+  auto& s = GetState();
+  if (LinkExists(s.file, groupPath)) {
+    H5Ldelete(s.file, groupPath.c_str(), H5P_DEFAULT);
+  }
+  const hid_t linkProps = H5Pcreate(H5P_LINK_CREATE);
+  H5Pset_create_intermediate_group(linkProps, 1);
+  const hid_t group =
+      H5Gcreate2(s.file, groupPath.c_str(), linkProps, H5P_DEFAULT, H5P_DEFAULT);
+  if (group < 0) {
+    H5Pclose(linkProps);
+    if (errorMessage) {
+      *errorMessage = "Failed creating " + groupPath + " in " + hdf5Path;
+    }
+    return false;
+  }
+
+  bool ok = WriteScalarAttributes(group, attributes);
+  for (const auto& dataset : datasets) {
+    const std::vector<hsize_t> dims(dataset.shape.begin(), dataset.shape.end());
+    const hid_t space = H5Screate_simple(static_cast<int>(dims.size()), dims.data(), nullptr);
+    const hid_t ds = H5Dcreate2(group, dataset.name.c_str(), H5T_STD_U64LE, space,
+                                linkProps, H5P_DEFAULT, H5P_DEFAULT);
+    if (ds < 0) {
+      ok = false;
+      H5Sclose(space);
+      continue;
+    }
+    if (!dataset.counts.empty()) {
+      ok = H5Dwrite(ds, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                    dataset.counts.data()) >= 0 &&
+           ok;
+    }
+    ok = WriteScalarAttributes(ds, dataset.attributes) && ok;
+    H5Dclose(ds);
+    H5Sclose(space);
+  }
+  H5Gclose(group);
+  H5Pclose(linkProps);
+
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed writing " + groupPath + " to " + hdf5Path;
+  }
+  return ok;
+}
+
+// Write `/profile` as a fixed-size dataset, replacing one left by an earlier run.
+bool WriteProfile(const std::string& hdf5Path,
+                  const std::vector<ProfileInfo>& rows,
+                  std::string* errorMessage) {
+  if (!EnsureReady(hdf5Path, errorMessage)) {
+    return false;
+  }
+
+  constexpr std::size_t kLabelSize = SimStructures::detail::kHdf5ProfileLabelSize;
+  std::vector<Hdf5ProfileNativeRow> native(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    auto& out = native[i];
+    std::memset(&out, 0, sizeof(out));
+    std::strncpy(out.particle, rows[i].particle.c_str(), kLabelSize - 1);
+    std::strncpy(out.process, rows[i].process.c_str(), kLabelSize - 1);
+    std::strncpy(out.volume, rows[i].volume.c_str(), kLabelSize - 1);
+    out.steps = rows[i].steps;
+    out.seconds = rows[i].seconds;
+    out.fraction = rows[i].fraction;
+  }
+
+  const hid_t labelType = CreateFixedStringType(kLabelSize);
+  const hid_t rowType = H5Tcreate(H5T_COMPOUND, sizeof(Hdf5ProfileNativeRow));
+  H5Tinsert(rowType, "particle", HOFFSET(Hdf5ProfileNativeRow, particle), labelType);
+  H5Tinsert(rowType, "process", HOFFSET(Hdf5ProfileNativeRow, process), labelType);
+  H5Tinsert(rowType, "volume", HOFFSET(Hdf5ProfileNativeRow, volume), labelType);
+  H5Tinsert(rowType, "steps", HOFFSET(Hdf5ProfileNativeRow, steps), H5T_NATIVE_INT64);
+  H5Tinsert(rowType, "seconds", HOFFSET(Hdf5ProfileNativeRow, seconds),
+            H5T_NATIVE_DOUBLE);
+  H5Tinsert(rowType, "fraction", HOFFSET(Hdf5ProfileNativeRow, fraction),
+            H5T_NATIVE_DOUBLE);
+  H5Tclose(labelType);
+
+  auto& s = GetState();
+  constexpr const char* kDatasetName = "/profile";
+  if (H5Lexists(s.file, kDatasetName, H5P_DEFAULT) > 0) {
+    H5Ldelete(s.file, kDatasetName, H5P_DEFAULT);
+  }
+  hsize_t dims[1] = {static_cast<hsize_t>(native.size())};
+  const hid_t space = H5Screate_simple(1, dims, nullptr);
+  const hid_t ds = H5Dcreate2(s.file, kDatasetName, rowType, space, H5P_DEFAULT,
+                              H5P_DEFAULT, H5P_DEFAULT);
+  bool ok = ds >= 0;
+  if (ok && !native.empty()) {
+    ok = H5Dwrite(ds, rowType, H5S_ALL, H5S_ALL, H5P_DEFAULT, native.data()) >= 0;
+  }
+  if (ds >= 0) {
+    H5Dclose(ds);
+  }
+  H5Sclose(space);
+  H5Tclose(rowType);
+
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed writing /profile to " + hdf5Path;
+  }
+  return ok;
+}
+
+// Size rows by their native compound layouts (datasets are stored uncompressed).
+std::int64_t EncodedRowBytes(std::size_t primaryRows,
+                             std::size_t secondaryRows,
+                             std::size_t photonRows) {
+  return static_cast<std::int64_t>(primaryRows * sizeof(Hdf5PrimaryNativeRow) +
+                                   secondaryRows * sizeof(Hdf5SecondaryNativeRow) +
+                                   photonRows * GetPhotonLayout().rowSize);
+}
+
 }  // namespace SimIO
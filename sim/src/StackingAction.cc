@@ -0,0 +1,19 @@
+#include "StackingAction.hh"
+
+#include "EventAction.hh"
+
+#include "G4OpticalPhoton.hh"
+#include "G4Track.hh"
+
+StackingAction::StackingAction(EventAction* eventAction) : fEventAction(eventAction) {}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track) {
+#ifdef G4EMI_WITH_SUBEVENT
+  if (fEventAction && track && fEventAction->DispatchesPhotonsToSubEvents() &&
+      track->GetParticleDefinition() == G4OpticalPhoton::OpticalPhotonDefinition()) {
+    fEventAction->RecordSubEventPhotonDispatched();
+    return static_cast<G4ClassificationOfNewTrack>(fSubEvent_0 + kOpticalPhotonSubEventType);
+  }
+#endif
+  return fUrgent;
+}
@@ -2,6 +2,9 @@
 
 #include "DetectorConstruction.hh"
 #include "EventAction.hh"
+#include "PhotonTrackInformation.hh"
+#include "perfcounters.hh"
+#include "stepprofiler.hh"
 
 #include "G4LogicalVolume.hh"
 #include "G4OpticalPhoton.hh"
@@ -44,6 +47,7 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
   if (!step || !fEventAction || !fDetector) {
     return;
   }
+  StepProfiler::OnStep(step);
 
   const auto* preStepPoint = step->GetPreStepPoint();
   if (!preStepPoint) {
@@ -59,6 +63,9 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
   if (preLogicalVolume != fDetector->GetScoringVolume()) {
     return;
   }
+  if constexpr (PerfCounters::kEnabled) {
+    ++PerfCounters::Local().scintillatorSteps;
+  }
 
   const auto* track = step->GetTrack();
   const auto* postStepPoint = step->GetPostStepPoint();
@@ -71,9 +78,11 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
     }
   }
 
+  // Exit positions are only looked up when `/photons` keeps scint_exit columns.
   if (track && postStepPoint &&
       track->GetParticleDefinition() == opticalPhoton &&
-      postStepPoint->GetStepStatus() == fGeomBoundary) {
+      postStepPoint->GetStepStatus() == fGeomBoundary &&
+      (fEventAction->GetPhotonFields() & SimStructures::PhotonField::kScintExit)) {
     const auto* postVolume = postStepPoint->GetTouchableHandle()->GetVolume();
     const auto* postLogicalVolume =
         postVolume ? postVolume->GetLogicalVolume() : nullptr;
@@ -95,6 +104,9 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
   }
 
   const G4int primaryTrackID = ResolvePrimaryTrackID(track, fEventAction);
+  const G4bool attachAncestry = track && fEventAction->DispatchesPhotonsToSubEvents();
+  const auto* parentInfo = attachAncestry ? fEventAction->FindTrackInfo(track->GetTrackID())
+                                          : nullptr;
 
   for (const auto* secondary : *secondaries) {
     if (!secondary) {
@@ -105,7 +117,25 @@ void SteppingAction::UserSteppingAction(const G4Step* step) {
     if (!isOpticalPhoton) {
       continue;
     }
+    if constexpr (PerfCounters::kEnabled) {
+      ++PerfCounters::Local().opticalPhotonsCreated;
+    }
+
+    if (!attachAncestry) {
+      fEventAction->RecordPendingPhotonOrigin(secondary, secondary->GetPosition());
+      continue;
+    }
 
-    fEventAction->RecordPendingPhotonOrigin(secondary, secondary->GetPosition());
+    // Sub-event workers cannot see this event's maps; carry ancestry on the track.
+    EventAction::PhotonCreationInfo info;
+    info.primaryTrackID = primaryTrackID;
+    info.secondaryTrackID = track->GetTrackID();
+    info.scintOriginPosition = secondary->GetPosition();
+    if (parentInfo) {
+      info.secondarySpecies = parentInfo->species;
+      info.secondaryOriginPosition = parentInfo->originPosition;
+      info.secondaryOriginEnergy = parentInfo->originEnergy;
+    }
+    secondary->SetUserInformation(new PhotonTrackInformation(info));
   }
 }
@@ -1,6 +1,9 @@
 #include "TrackingAction.hh"
 
 #include "EventAction.hh"
+#include "PhotonTrackInformation.hh"
+#include "perfcounters.hh"
+#include "stepprofiler.hh"
 
 #include "G4ParticleDefinition.hh"
 #include "G4Track.hh"
@@ -45,6 +48,7 @@ TrackingAction::TrackingAction(EventAction* eventAction)
     : fEventAction(eventAction) {}
 
 void TrackingAction::PreUserTrackingAction(const G4Track* track) {
+  StepProfiler::OnTrackStart();
   if (!fEventAction || !track) {
     return;
   }
@@ -58,8 +62,20 @@ void TrackingAction::PreUserTrackingAction(const G4Track* track) {
   trackInfo.originEnergy = track->GetVertexKineticEnergy();
   trackInfo.primaryTrackID = ResolvePrimaryTrackID(track, fEventAction);
   fEventAction->RecordTrackInfo(trackID, trackInfo);
+  if constexpr (PerfCounters::kEnabled) {
+    ++PerfCounters::Local().tracksBySpecies[trackInfo.species];
+  }
 
   if (IsOpticalPhoton(particleName)) {
+    if constexpr (PerfCounters::kEnabled) {
+      ++PerfCounters::Local().opticalPhotonsTracked;
+    }
+    if (dynamic_cast<const PhotonTrackInformation*>(track->GetUserInformation())) {
+      // Ancestry travels with the track; only count it for the owning event.
+      fEventAction->RecordSubEventPhotonTracked();
+      return;
+    }
+
     EventAction::PhotonCreationInfo info;
     info.primaryTrackID = trackInfo.primaryTrackID;
     info.secondaryTrackID = parentID;
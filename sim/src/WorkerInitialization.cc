@@ -0,0 +1,35 @@
+#include "WorkerInitialization.hh"
+
+#include "affinity.hh"
+#include "config.hh"
+
+#include "G4Threading.hh"
+#include "G4ios.hh"
+
+#include <string>
+
+WorkerInitialization::WorkerInitialization(const Config* config) : fConfig(config) {}
+
+void WorkerInitialization::WorkerInitialize() const {
+  if (!fConfig) {
+    return;
+  }
+
+  Affinity::Policy policy;
+  if (!Affinity::ParsePolicy(fConfig->GetPinThreadsPolicy(), &policy, nullptr) ||
+      policy.kind == Affinity::Policy::Kind::None) {
+    return;
+  }
+
+  const auto order = Affinity::CpuOrder(policy);
+  const G4int threadID = G4Threading::G4GetThreadId();
+  if (order.empty() || threadID < 0) {
+    return;
+  }
+
+  const int cpu = order[static_cast<std::size_t>(threadID) % order.size()];
+  std::string error;
+  if (!Affinity::PinCurrentThread(cpu, &error)) {
+    G4cout << "[g4emi] Worker " << threadID << " not pinned: " << error << "." << G4endl;
+  }
+}
@@ -0,0 +1,220 @@
+#include "affinity.hh"
+
+#include "utils.hh"
+
+#include "G4Types.hh"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+/// CPU recorded by the last successful `PinCurrentThread` on this thread.
+G4ThreadLocal int tPinnedCpu = -1;
+
+/// CPU ids at or above this cannot be pinned to.
+#if defined(CPU_SETSIZE)
+constexpr long kMaxCpus = CPU_SETSIZE;
+#else
+constexpr long kMaxCpus = 1024;
+#endif
+
+// Parse a CPU id at `text`; false unless it starts with a digit.
+bool ParseCpuId(const char* text, long* cpu, char** end) {
+  if (!std::isdigit(static_cast<unsigned char>(*text))) {
+    return false;
+  }
+  *cpu = std::strtol(text, end, 10);
+  return *cpu < kMaxCpus;
+}
+
+// Parse a Linux-style CPU list ("0-3,8,10-11") into CPU ids in listed order.
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus) {
+  std::string normalized = text;
+  std::replace(normalized.begin(), normalized.end(), ' ', ',');
+  std::istringstream stream(normalized);
+  for (std::string item; std::getline(stream, item, ',');) {
+    if (item.empty()) {
+      continue;
+    }
+    char* end = nullptr;
+    long first = 0;
+    if (!ParseCpuId(item.c_str(), &first, &end)) {
+      return false;
+    }
+    long last = first;
+    if (*end == '-' && !ParseCpuId(end + 1, &last, &end)) {
+      return false;
+    }
+    if (*end != '\0' || last < first) {
+      return false;
+    }
+    for (long cpu = first; cpu <= last; ++cpu) {
+      cpus->push_back(static_cast<int>(cpu));
+    }
+  }
+  return !cpus->empty();
+}
+
+// CPUs this process may run on (respects cgroup/batch-scheduler masks).
+std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    const unsigned count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < count; ++cpu) {
+      cpus.push_back(static_cast<int>(cpu));
+    }
+  }
+  return cpus;
+}
+
+// Allowed CPUs grouped by NUMA node (one group when sysfs topology is missing).
+std::vector<std::vector<int>> CpusByNode() {
+  const std::vector<int> allowed = AllowedCpus();
+  std::vector<std::vector<int>> nodes;
+
+  std::error_code ec;
+  const std::filesystem::path nodeRoot = "/sys/devices/system/node";
+  std::vector<std::filesystem::path> nodeDirs;
+  for (const auto& entry : std::filesystem::directory_iterator(nodeRoot, ec)) {
+    const auto name = entry.path().filename().string();
+    if (name.rfind("node", 0) == 0 && name.size() > 4 &&
+        std::all_of(name.begin() + 4, name.end(),
+                    [](unsigned char c) { return std::isdigit(c) != 0; })) {
+      nodeDirs.push_back(entry.path());
+    }
+  }
+  std::sort(nodeDirs.begin(), nodeDirs.end(), [](const auto& a, const auto& b) {
+    return std::stoi(a.filename().string().substr(4)) <
+           std::stoi(b.filename().string().substr(4));
+  });
+
+  for (const auto& dir : nodeDirs) {
+    std::ifstream file(dir / "cpulist");
+    std::string line;
+    std::vector<int> nodeCpus;
+    if (!std::getline(file, line) || !ParseCpuList(Utils::Trim(line), &nodeCpus)) {
+      continue;
+    }
+    std::vector<int> usable;
+    for (const int cpu : nodeCpus) {
+      if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+        usable.push_back(cpu);
+      }
+    }
+    if (!usable.empty()) {
+      nodes.push_back(usable);
+    }
+  }
+
+  if (nodes.empty()) {
+    nodes.push_back(allowed);
+  }
+  return nodes;
+}
+}  // namespace
+
+namespace Affinity {
+
+bool ParsePolicy(const std::string& text, Policy* out, std::string* errorMessage) {
+  const std::string value = Utils::ToLower(Utils::Unquote(Utils::Trim(text)));
+  Policy policy;
+  if (value.empty() || value == "none") {
+    policy.kind = Policy::Kind::None;
+  } else if (value == "compact") {
+    policy.kind = Policy::Kind::Compact;
+  } else if (value == "scatter") {
+    policy.kind = Policy::Kind::Scatter;
+  } else if (ParseCpuList(value, &policy.cpus)) {
+    policy.kind = Policy::Kind::Explicit;
+  } else {
+    if (errorMessage) {
+      *errorMessage = "Expected none, compact, scatter, or a CPU list such as 0,2,8-15; got '" +
+                      text + "'";
+    }
+    return false;
+  }
+  *out = policy;
+  return true;
+}
+
+std::vector<int> CpuOrder(const Policy& policy) {
+  switch (policy.kind) {
+    case Policy::Kind::None:
+      return {};
+    case Policy::Kind::Explicit:
+      return policy.cpus;
+    case Policy::Kind::Compact: {
+      std::vector<int> order;
+      for (const auto& node : CpusByNode()) {
+        order.insert(order.end(), node.begin(), node.end());
+      }
+      return order;
+    }
+    case Policy::Kind::Scatter: {
+      const auto nodes = CpusByNode();
+      std::vector<int> order;
+      for (std::size_t index = 0;; ++index) {
+        const auto before = order.size();
+        for (const auto& node : nodes) {
+          if (index < node.size()) {
+            order.push_back(node[index]);
+          }
+        }
+        if (order.size() == before) {
+          break;
+        }
+      }
+      return order;
+    }
+  }
+  return {};
+}
+
+bool PinCurrentThread(int cpu, std::string* errorMessage) {
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  const int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  if (rc != 0) {
+    if (errorMessage) {
+      *errorMessage = "pthread_setaffinity_np(cpu " + std::to_string(cpu) +
+                      ") failed: " + std::strerror(rc);
+    }
+    return false;
+  }
+  tPinnedCpu = cpu;
+  return true;
+#else
+  if (errorMessage) {
+    *errorMessage = "Thread pinning is not supported on this platform";
+  }
+  return false;
+#endif
+}
+
+int PinnedCpu() { return tPinnedCpu; }
+
+}  // namespace Affinity
@@ -0,0 +1,63 @@
+#include "capture.hh"
+
+#include "SimIO.hh"
+
+#include <atomic>
+#include <utility>
+
+namespace {
+std::atomic<bool> gEnabled{false};
+Capture::Rows gRows;
+
+// Empty tables with their row sizes set, so empty captures still describe
+// their rows.
+Capture::Rows EmptyRows(SimStructures::PhotonFieldMask photonFields) {
+  Capture::Rows rows;
+  rows.primaries.rowBytes = sizeof(SimStructures::detail::Hdf5PrimaryNativeRow);
+  rows.secondaries.rowBytes = sizeof(SimStructures::detail::Hdf5SecondaryNativeRow);
+  rows.photons.rowBytes = SimIO::PhotonRowBytes(photonFields);
+  rows.transported.rowBytes = sizeof(SimStructures::TransportedPhotonInfo);
+  rows.photonFields = photonFields;
+  return rows;
+}
+
+void AppendBytes(Capture::Table* table, const void* data, std::size_t bytes) {
+  const auto* begin = static_cast<const unsigned char*>(data);
+  table->bytes.insert(table->bytes.end(), begin, begin + bytes);
+}
+}  // namespace
+
+namespace Capture {
+
+void SetEnabled(bool enabled) { gEnabled = enabled; }
+
+bool Enabled() { return gEnabled; }
+
+void BeginRun(SimStructures::PhotonFieldMask photonFields) { gRows = EmptyRows(photonFields); }
+
+std::int64_t PhotonRowCount() { return static_cast<std::int64_t>(gRows.photons.Rows()); }
+
+void Append(SimStructures::RowSpan<SimStructures::PrimaryInfo> primaryRows,
+            SimStructures::RowSpan<SimStructures::SecondaryInfo> secondaryRows,
+            SimStructures::RowSpan<SimStructures::PhotonInfo> photonRows,
+            SimStructures::RowSpan<SimStructures::TransportedPhotonInfo> transportedRows) {
+  const std::int64_t photonRowBase = PhotonRowCount();
+  const auto primaries = SimIO::detail::ToNative(primaryRows);
+  AppendBytes(&gRows.primaries, primaries.data(),
+              primaries.size() * sizeof(primaries.front()));
+  const auto secondaries = SimIO::detail::ToNative(secondaryRows);
+  AppendBytes(&gRows.secondaries, secondaries.data(),
+              secondaries.size() * sizeof(secondaries.front()));
+  auto& photons = gRows.photons;
+  const std::size_t photonBytes = photons.bytes.size();
+  photons.bytes.resize(photonBytes + photonRows.size * photons.rowBytes);
+  SimIO::detail::PackPhotons(photonRows, gRows.photonFields, photons.bytes.data() + photonBytes);
+  for (auto row : transportedRows) {
+    row.sourcePhotonIndex += photonRowBase;
+    AppendBytes(&gRows.transported, &row, sizeof(row));
+  }
+}
+
+Rows Take() { return std::exchange(gRows, EmptyRows(gRows.photonFields)); }
+
+}  // namespace Capture
@@ -4,8 +4,10 @@
 
 #include "G4SystemOfUnits.hh"
 
+#include <algorithm>
 #include <filesystem>
 #include <limits>
+#include <sstream>
 
 namespace {
 constexpr G4int kScintillationComponentCount = 3;
@@ -49,7 +51,22 @@ Config::Config()
       fScintMaterialVersion(0),
       fOutputFilename("data/photon_optical_interface_hits"),
       fOutputPath(""),
-      fOutputRunName("") {}
+      fOutputRunName(""),
+      fPhotonFields(SimStructures::PhotonField::kAll),
+      fOutputMode("rows"),
+      fOutputSinks({"hdf5"}),
+      fTimingBinning({0, 200.0 * ns, 200.0 * ns}),
+      fSwmrOutput({false, 1.0 * s}),
+      fPhysicsTableCacheDir(""),
+      fRunThreads(-1),
+      fEventsPerTask(0),
+      fPhotonsPerSubEvent(5000),
+      fPinThreadsPolicy("none"),
+      fRunManagerBackend("default"),
+      fStepProfileInterval(0),
+      fTraceFile(""),
+      fProgressFile(""),
+      fProgressInterval(1.0 * s) {}
 
 G4double Config::GetScintX() const {
   std::lock_guard<std::mutex> lock(fMutex);
@@ -427,3 +444,262 @@ std::string Config::GetHdf5FilePath() const {
   return SimIO::ComposeOutputPath(fOutputFilename, fOutputPath, fOutputRunName,
                                   ".h5");
 }
+
+SimStructures::PhotonFieldMask Config::GetPhotonFields() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPhotonFields;
+}
+
+void Config::SetPhotonFields(SimStructures::PhotonFieldMask value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPhotonFields = value;
+}
+
+std::string Config::GetOutputMode() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fOutputMode;
+}
+
+void Config::SetOutputMode(const std::string& value) {
+  std::string normalized = Utils::ToLower(Utils::Unquote(Utils::Trim(value)));
+  if (normalized.empty()) {
+    normalized = "rows";
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fOutputMode = normalized;
+}
+
+std::vector<std::string> Config::GetOutputSinks() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fOutputSinks;
+}
+
+void Config::SetOutputSinks(const std::vector<std::string>& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fOutputSinks = value;
+}
+
+ImageBinning Config::GetImageBinning() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fImageBinning;
+}
+
+void Config::SetImageBinning(const ImageBinning& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fImageBinning = value;
+}
+
+TimingBinning Config::GetTimingBinning() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fTimingBinning;
+}
+
+void Config::SetTimingBinning(const TimingBinning& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fTimingBinning = value;
+}
+
+LensTransport Config::GetLensTransport() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fLensTransport;
+}
+
+void Config::SetLensTransport(const LensTransport& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fLensTransport = value;
+}
+
+ShmStream Config::GetShmStream() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fShmStream;
+}
+
+void Config::SetShmStream(const ShmStream& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fShmStream = value;
+}
+
+RawStream Config::GetRawStream() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fRawStream;
+}
+
+void Config::SetRawStream(const RawStream& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fRawStream = value;
+}
+
+SwmrOutput Config::GetSwmrOutput() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fSwmrOutput;
+}
+
+void Config::SetSwmrOutput(const SwmrOutput& value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fSwmrOutput = value;
+}
+
+std::string Config::GetPhysicsTableCacheDir() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPhysicsTableCacheDir;
+}
+
+void Config::SetPhysicsTableCacheDir(const std::string& value) {
+  std::string normalized = Utils::Unquote(Utils::Trim(value));
+  if (!normalized.empty()) {
+    normalized = std::filesystem::path(normalized).lexically_normal().string();
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPhysicsTableCacheDir = normalized;
+}
+
+G4int Config::GetRunThreads() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fRunThreads;
+}
+
+void Config::SetRunThreads(G4int value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fRunThreads = std::max(value, -1);
+}
+
+G4int Config::GetEventsPerTask() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fEventsPerTask;
+}
+
+void Config::SetEventsPerTask(G4int value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventsPerTask = std::max(value, 0);
+}
+
+std::string Config::GetPinThreadsPolicy() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPinThreadsPolicy;
+}
+
+void Config::SetPinThreadsPolicy(const std::string& value) {
+  std::string normalized = Utils::ToLower(Utils::Unquote(Utils::Trim(value)));
+  if (normalized.empty()) {
+    normalized = "none";
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPinThreadsPolicy = normalized;
+}
+
+G4int Config::GetPhotonsPerSubEvent() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fPhotonsPerSubEvent;
+}
+
+void Config::SetPhotonsPerSubEvent(G4int value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fPhotonsPerSubEvent = std::max(value, 1);
+}
+
+std::string Config::GetRunManagerBackend() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fRunManagerBackend;
+}
+
+void Config::SetRunManagerBackend(const std::string& value) {
+  const std::string normalized = NormalizeRunManagerBackend(value);
+  std::lock_guard<std::mutex> lock(fMutex);
+  fRunManagerBackend = normalized;
+}
+
+std::string Config::NormalizeRunManagerBackend(const std::string& value) {
+  const std::string normalized = Utils::ToLower(Utils::Unquote(Utils::Trim(value)));
+  return normalized.empty() ? "default" : normalized;
+}
+
+G4int Config::GetStepProfileInterval() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fStepProfileInterval;
+}
+
+void Config::SetStepProfileInterval(G4int value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fStepProfileInterval = std::max(value, 0);
+}
+
+std::string Config::GetTraceFile() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fTraceFile;
+}
+
+void Config::SetTraceFile(const std::string& value) {
+  std::string normalized = Utils::Unquote(Utils::Trim(value));
+  if (!normalized.empty()) {
+    normalized = std::filesystem::path(normalized).lexically_normal().string();
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fTraceFile = normalized;
+}
+
+std::string Config::GetProgressFile() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fProgressFile;
+}
+
+void Config::SetProgressFile(const std::string& value) {
+  std::string normalized = Utils::Unquote(Utils::Trim(value));
+  if (!normalized.empty()) {
+    normalized = std::filesystem::path(normalized).lexically_normal().string();
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fProgressFile = normalized;
+}
+
+G4double Config::GetProgressInterval() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fProgressInterval;
+}
+
+void Config::SetProgressInterval(G4double value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fProgressInterval = value > 0.0 ? value : 1.0 * s;
+}
+
+EventTrigger Config::GetEventTrigger() const {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fEventTrigger;
+}
+
+void Config::SetTriggerMinPhotons(G4int value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventTrigger.minPhotons = std::max(value, 0);
+}
+
+void Config::SetTriggerMinEnergyProxy(G4double value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventTrigger.minEnergyProxy = std::max(value, 0.0);
+}
+
+void Config::SetTriggerSecondarySpecies(const std::string& value) {
+  std::string normalized = Utils::Unquote(Utils::Trim(value));
+  std::replace(normalized.begin(), normalized.end(), ',', ' ');
+  std::istringstream stream(normalized);
+  std::vector<std::string> species;
+  for (std::string token; stream >> token;) {
+    species.push_back(token);
+  }
+
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventTrigger.secondarySpecies = std::move(species);
+}
+
+void Config::SetTriggerTimeMin(G4double value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventTrigger.timeMin = value;
+}
+
+void Config::SetTriggerTimeMax(G4double value) {
+  std::lock_guard<std::mutex> lock(fMutex);
+  fEventTrigger.timeMax = value;
+}
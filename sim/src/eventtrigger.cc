@@ -0,0 +1,66 @@
+#include "eventtrigger.hh"
+
+#include "config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+
+namespace {
+/// The run's criteria on one thread.
+struct State {
+  EventTrigger trigger;
+  G4double scintYield = 0.0;
+  bool enabled = false;
+};
+
+thread_local State tState;
+}  // namespace
+
+namespace Trigger {
+
+void BeginThreadRun(const EventTrigger& trigger, G4double scintYield) {
+  tState.trigger = trigger;
+  tState.scintYield = scintYield;
+  tState.enabled = trigger.Enabled();
+}
+
+bool Enabled() { return tState.enabled; }
+
+bool Accepts(std::int64_t generatedPhotons,
+             const std::vector<SimStructures::PhotonHitRecord>& hits) {
+  return Accepts(tState.trigger, tState.scintYield, generatedPhotons, hits);
+}
+
+bool Accepts(const EventTrigger& trigger,
+             G4double scintYield,
+             std::int64_t generatedPhotons,
+             const std::vector<SimStructures::PhotonHitRecord>& hits) {
+  // Scintillation photons scale with deposited energy (quenching ignored).
+  if (trigger.minEnergyProxy > 0.0 &&
+      generatedPhotons < trigger.minEnergyProxy / MeV * scintYield) {
+    return false;
+  }
+
+  const bool timeWindow = trigger.HasTimeWindow();
+  const G4int required = std::max<G4int>(trigger.minPhotons, timeWindow ? 1 : 0);
+  bool speciesSeen = trigger.secondarySpecies.empty();
+  G4int photons = 0;
+  for (const auto& hit : hits) {
+    if (timeWindow && (hit.opticalInterfaceHitTime < trigger.timeMin ||
+                       hit.opticalInterfaceHitTime > trigger.timeMax)) {
+      continue;
+    }
+    ++photons;
+    if (!speciesSeen) {
+      speciesSeen = std::find(trigger.secondarySpecies.begin(), trigger.secondarySpecies.end(),
+                              hit.secondarySpecies) != trigger.secondarySpecies.end();
+    }
+    if (speciesSeen && photons >= required) {
+      return true;
+    }
+  }
+  return speciesSeen && photons >= required;
+}
+
+}  // namespace Trigger
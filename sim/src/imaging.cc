@@ -0,0 +1,237 @@
+#include "imaging.hh"
+
+#include "SimIO.hh"
+#include "config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+/// Binning resolved against the interface extent, with bins per unit precomputed.
+struct Layout {
+  G4int binsX = 0;
+  G4int binsY = 0;
+  G4int timeBins = 0;
+  G4double xMin = 0.0;
+  G4double xMax = 0.0;
+  G4double yMin = 0.0;
+  G4double yMax = 0.0;
+  G4double timeMin = 0.0;
+  G4double timeMax = 0.0;
+  G4double scaleX = 0.0;
+  G4double scaleY = 0.0;
+  G4double scaleT = 0.0;
+
+  std::size_t Cells() const { return static_cast<std::size_t>(binsX) * binsY; }
+};
+
+/// Counts owned by one thread (or, once handed over, the run totals).
+struct Image {
+  bool enabled = false;
+  Layout layout;
+  /// Allocated on the first in-range hit so idle threads never pay for them.
+  std::vector<std::uint64_t> xy;
+  std::vector<std::uint64_t> xyt;
+  std::uint64_t hits = 0;
+  std::uint64_t outsideXY = 0;
+  std::uint64_t outsideT = 0;
+};
+
+thread_local Image tImage;
+
+std::mutex gExtentMutex;
+G4double gExtent[4] = {0.0, 0.0, 0.0, 0.0};
+
+std::mutex gMergedMutex;
+Image gMerged;
+
+Layout Resolve(const ImageBinning& binning) {
+  G4double range[4];
+  Layout layout;
+  const bool valid = Imaging::ResolveRange(binning, range);
+  layout.xMin = range[0];
+  layout.xMax = range[1];
+  layout.yMin = range[2];
+  layout.yMax = range[3];
+  if (!valid) {
+    return layout;
+  }
+  layout.binsX = std::max(1, binning.binsX);
+  layout.binsY = std::max(1, binning.binsY);
+  layout.scaleX = layout.binsX / (layout.xMax - layout.xMin);
+  layout.scaleY = layout.binsY / (layout.yMax - layout.yMin);
+  if (binning.HasTimeSlices()) {
+    layout.timeBins = binning.timeBins;
+    layout.timeMin = binning.timeMin;
+    layout.timeMax = binning.timeMax;
+    layout.scaleT = layout.timeBins / (layout.timeMax - layout.timeMin);
+  }
+  return layout;
+}
+
+void Allocate(Image* image) {
+  const auto cells = image->layout.Cells();
+  image->xy.assign(cells, 0);
+  image->xyt.assign(cells * image->layout.timeBins, 0);
+}
+
+void Accumulate(std::vector<std::uint64_t>* total, std::vector<std::uint64_t>* part) {
+  if (total->empty()) {
+    total->swap(*part);
+    return;
+  }
+  for (std::size_t i = 0; i < part->size(); ++i) {
+    (*total)[i] += (*part)[i];
+  }
+  part->clear();
+}
+
+std::vector<SimIO::RunStatistic> RangeAttributes(const Layout& layout) {
+  return {{"x_min_mm", layout.xMin / mm},
+          {"x_max_mm", layout.xMax / mm},
+          {"y_min_mm", layout.yMin / mm},
+          {"y_max_mm", layout.yMax / mm}};
+}
+}  // namespace
+
+namespace Imaging {
+
+void SetInterfaceExtent(G4double xMin, G4double xMax, G4double yMin, G4double yMax) {
+  std::lock_guard<std::mutex> lock(gExtentMutex);
+  gExtent[0] = xMin;
+  gExtent[1] = xMax;
+  gExtent[2] = yMin;
+  gExtent[3] = yMax;
+}
+
+bool ResolveRange(const ImageBinning& binning, G4double range[4]) {
+  G4double extent[4];
+  {
+    std::lock_guard<std::mutex> lock(gExtentMutex);
+    std::copy(std::begin(gExtent), std::end(gExtent), extent);
+  }
+  range[0] = binning.xMax > binning.xMin ? binning.xMin : extent[0];
+  range[1] = binning.xMax > binning.xMin ? binning.xMax : extent[1];
+  range[2] = binning.yMax > binning.yMin ? binning.yMin : extent[2];
+  range[3] = binning.yMax > binning.yMin ? binning.yMax : extent[3];
+  return range[1] > range[0] && range[3] > range[2];
+}
+
+void BeginThreadRun(bool enabled, const ImageBinning& binning) {
+  auto& image = tImage;
+  image.layout = enabled ? Resolve(binning) : Layout{};
+  image.enabled = enabled && image.layout.binsX > 0;
+  image.xy.clear();
+  image.xyt.clear();
+  image.hits = 0;
+  image.outsideXY = 0;
+  image.outsideT = 0;
+}
+
+bool Enabled() {
+  return tImage.enabled;
+}
+
+void Fill(G4double x, G4double y, G4double t) {
+  auto& image = tImage;
+  if (!image.enabled) {
+    return;
+  }
+  ++image.hits;
+  const auto& layout = image.layout;
+  const G4double fx = (x - layout.xMin) * layout.scaleX;
+  const G4double fy = (y - layout.yMin) * layout.scaleY;
+  if (!(fx >= 0.0 && fx < layout.binsX && fy >= 0.0 && fy < layout.binsY)) {
+    ++image.outsideXY;
+    return;
+  }
+  if (image.xy.empty()) {
+    Allocate(&image);
+  }
+  const auto cell =
+      static_cast<std::size_t>(fy) * layout.binsX + static_cast<std::size_t>(fx);
+  ++image.xy[cell];
+  if (layout.timeBins == 0) {
+    return;
+  }
+  const G4double ft = (t - layout.timeMin) * layout.scaleT;
+  if (!(ft >= 0.0 && ft < layout.timeBins)) {
+    ++image.outsideT;
+    return;
+  }
+  ++image.xyt[static_cast<std::size_t>(ft) * layout.Cells() + cell];
+}
+
+void EndThreadRun() {
+  auto& image = tImage;
+  if (!image.enabled) {
+    return;
+  }
+  image.enabled = false;
+
+  std::lock_guard<std::mutex> lock(gMergedMutex);
+  if (!gMerged.enabled) {
+    gMerged.enabled = true;
+    gMerged.layout = image.layout;
+  }
+  if (!image.xy.empty()) {
+    Accumulate(&gMerged.xy, &image.xy);
+    Accumulate(&gMerged.xyt, &image.xyt);
+  }
+  gMerged.hits += image.hits;
+  gMerged.outsideXY += image.outsideXY;
+  gMerged.outsideT += image.outsideT;
+}
+
+bool WriteRun(const std::string& hdf5Path, std::int64_t* hits, std::string* errorMessage) {
+  Image merged;
+  {
+    std::lock_guard<std::mutex> lock(gMergedMutex);
+    std::swap(merged, gMerged);
+  }
+  if (hits) {
+    *hits = static_cast<std::int64_t>(merged.hits);
+  }
+  if (!merged.enabled) {
+    return true;
+  }
+
+  // Runs without in-range hits still write zero images of the requested shape.
+  const auto& layout = merged.layout;
+  if (merged.xy.empty()) {
+    Allocate(&merged);
+  }
+
+  std::vector<SimIO::CountsInfo> images;
+  SimIO::CountsInfo xy;
+  xy.name = "xy";
+  xy.shape = {static_cast<std::size_t>(layout.binsY), static_cast<std::size_t>(layout.binsX)};
+  xy.counts = std::move(merged.xy);
+  xy.attributes = RangeAttributes(layout);
+  images.push_back(std::move(xy));
+  if (layout.timeBins > 0) {
+    SimIO::CountsInfo xyt;
+    xyt.name = "xyt";
+    xyt.shape = {static_cast<std::size_t>(layout.timeBins),
+                 static_cast<std::size_t>(layout.binsY),
+                 static_cast<std::size_t>(layout.binsX)};
+    xyt.counts = std::move(merged.xyt);
+    xyt.attributes = RangeAttributes(layout);
+    xyt.attributes.push_back({"t_min_ns", layout.timeMin / ns});
+    xyt.attributes.push_back({"t_max_ns", layout.timeMax / ns});
+    images.push_back(std::move(xyt));
+  }
+
+  const std::vector<SimIO::RunStatistic> attributes = {
+      {"hits", static_cast<std::int64_t>(merged.hits)},
+      {"outside_xy", static_cast<std::int64_t>(merged.outsideXY)},
+      {"outside_t", static_cast<std::int64_t>(merged.outsideT)}};
+  return SimIO::WriteCounts(hdf5Path, "/images", images, attributes, errorMessage);
+}
+
+}  // namespace Imaging
@@ -0,0 +1,313 @@
+#include "intensifier.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace {
+// Philox4x32 round multipliers and Weyl key increments.
+constexpr std::uint32_t kPhiloxM0 = 0xD2511F53u;
+constexpr std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+constexpr std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+constexpr std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+constexpr int kPhiloxRounds = 10;
+constexpr double kTwoPi = 6.283185307179586476925286766559;
+
+inline void MulHiLo(std::uint32_t a, std::uint32_t b, std::uint32_t* hi, std::uint32_t* lo) {
+  const std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+  *hi = static_cast<std::uint32_t>(product >> 32);
+  *lo = static_cast<std::uint32_t>(product);
+}
+
+bool ReportInvalid(std::string* errorMessage, const char* message) {
+  if (errorMessage) {
+    *errorMessage = message;
+  }
+  return false;
+}
+
+std::vector<double> ParseList(const std::string& value) {
+  std::vector<double> values;
+  std::istringstream list(value);
+  for (std::string item; std::getline(list, item, ',');) {
+    values.push_back(std::stod(item));
+  }
+  return values;
+}
+}  // namespace
+
+namespace Intensifier {
+
+bool ValidateParams(const Params& params, std::string* errorMessage) {
+  const auto& wavelengths = params.qeWavelengthNm;
+  const auto& values = params.qeValues;
+  if (wavelengths.empty()) {
+    return ReportInvalid(errorMessage, "qe_wavelength_nm must not be empty");
+  }
+  if (wavelengths.size() != values.size()) {
+    return ReportInvalid(errorMessage, "qe_wavelength_nm and qe_values must share one length");
+  }
+  for (std::size_t i = 1; i < wavelengths.size(); ++i) {
+    if (wavelengths[i] - wavelengths[i - 1] < 0.0) {
+      return ReportInvalid(errorMessage, "qe_wavelength_nm must be monotonic increasing");
+    }
+  }
+  if (!(params.collectionEfficiency >= 0.0 && params.collectionEfficiency <= 1.0)) {
+    return ReportInvalid(errorMessage, "collection_efficiency must be in [0, 1]");
+  }
+  if (params.ttsSigmaNs < 0.0) {
+    return ReportInvalid(errorMessage, "tts_sigma_ns must be non-negative");
+  }
+  for (const double value : values) {
+    if (value < 0.0 || value > 1.0) {
+      return ReportInvalid(errorMessage, "qe_values must lie in [0, 1]");
+    }
+  }
+  if (!(params.stage1MeanGain > 0.0 && params.stage1GainShape > 0.0 &&
+        params.stage2MeanGain > 0.0 && params.stage2GainShape > 0.0 && params.gainRef > 0.0)) {
+    return ReportInvalid(errorMessage,
+                         "MCP mean gains, gain shapes, and gain_ref must be strictly positive");
+  }
+  if (params.spreadSigma0Mm < 0.0) {
+    return ReportInvalid(errorMessage, "spread_sigma0_mm must be non-negative");
+  }
+  if (!(params.phosphorGain > 0.0)) {
+    return ReportInvalid(errorMessage, "phosphor_gain must be strictly positive");
+  }
+  if (params.decayFastNs < 0.0 || params.decaySlowNs < 0.0) {
+    return ReportInvalid(errorMessage, "decay_fast_ns and decay_slow_ns must be non-negative");
+  }
+  if (!(params.fastFraction >= 0.0 && params.fastFraction <= 1.0)) {
+    return ReportInvalid(errorMessage, "fast_fraction must be in [0, 1]");
+  }
+  if (params.psfSigmaMm < 0.0) {
+    return ReportInvalid(errorMessage, "psf_sigma_mm must be non-negative");
+  }
+  return true;
+}
+
+bool ApplyOption(const std::string& flag, const std::string& value, Params* params) {
+  struct Scalar {
+    const char* flag;
+    double Params::*field;
+  };
+  static const Scalar kScalars[] = {
+      {"--collection-efficiency", &Params::collectionEfficiency},
+      {"--tts-sigma", &Params::ttsSigmaNs},
+      {"--stage1-mean-gain", &Params::stage1MeanGain},
+      {"--stage1-gain-shape", &Params::stage1GainShape},
+      {"--stage2-mean-gain", &Params::stage2MeanGain},
+      {"--stage2-gain-shape", &Params::stage2GainShape},
+      {"--gain-ref", &Params::gainRef},
+      {"--spread-sigma0", &Params::spreadSigma0Mm},
+      {"--spread-gain-exponent", &Params::spreadGainExponent},
+      {"--phosphor-gain", &Params::phosphorGain},
+      {"--decay-fast", &Params::decayFastNs},
+      {"--decay-slow", &Params::decaySlowNs},
+      {"--fast-fraction", &Params::fastFraction},
+      {"--psf-sigma", &Params::psfSigmaMm},
+  };
+  if (flag == "--qe-wavelengths") {
+    params->qeWavelengthNm = ParseList(value);
+    return true;
+  }
+  if (flag == "--qe-values") {
+    params->qeValues = ParseList(value);
+    return true;
+  }
+  for (const auto& scalar : kScalars) {
+    if (flag == scalar.flag) {
+      params->*scalar.field = std::stod(value);
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* OptionsUsage() {
+  return "  --qe-wavelengths LIST      Comma-separated QE wavelengths, nm (default: 350,500,650).\n"
+         "  --qe-values LIST           Comma-separated QE values (default: 0.15,0.25,0.05).\n"
+         "  --collection-efficiency X  Photocathode collection efficiency (default: 1).\n"
+         "  --tts-sigma NS             Transit-time spread (default: 0).\n"
+         "  --stage1-mean-gain X       MCP stage-1 mean gain (default: 8).\n"
+         "  --stage1-gain-shape X      MCP stage-1 gamma shape (default: 2).\n"
+         "  --stage2-mean-gain X       MCP stage-2 mean gain (default: 800).\n"
+         "  --stage2-gain-shape X      MCP stage-2 gamma shape (default: 2).\n"
+         "  --gain-ref X               Gain of the reference spread (default: 1000).\n"
+         "  --spread-sigma0 MM         MCP spread at the reference gain (default: 0.03).\n"
+         "  --spread-gain-exponent X   MCP spread gain exponent (default: 0.4).\n"
+         "  --phosphor-gain X          Phosphor gain (default: 1).\n"
+         "  --decay-fast NS            Fast phosphor decay (default: 70).\n"
+         "  --decay-slow NS            Slow phosphor decay (default: 200).\n"
+         "  --fast-fraction X          Fast decay fraction (default: 0.9).\n"
+         "  --psf-sigma MM             Phosphor PSF sigma (default: 0.04).\n";
+}
+
+Philox::Philox(std::uint64_t seed, std::uint64_t stream)
+    : fKey{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+      fCounter{0, 0, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(stream >> 32)},
+      fBlock{0, 0, 0, 0} {}
+
+void Philox::Refill() {
+  std::uint32_t c[4] = {fCounter[0], fCounter[1], fCounter[2], fCounter[3]};
+  std::uint32_t k0 = fKey[0];
+  std::uint32_t k1 = fKey[1];
+  for (int round = 0; round < kPhiloxRounds; ++round) {
+    std::uint32_t hi0, lo0, hi1, lo1;
+    MulHiLo(kPhiloxM0, c[0], &hi0, &lo0);
+    MulHiLo(kPhiloxM1, c[2], &hi1, &lo1);
+    c[0] = hi1 ^ c[1] ^ k0;
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ k1;
+    c[3] = lo0;
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+  std::copy(c, c + 4, fBlock);
+  // A photon draws far fewer than 2^64 blocks, so the lower half never carries.
+  if (++fCounter[0] == 0) {
+    ++fCounter[1];
+  }
+  fUsed = 0;
+}
+
+std::uint32_t Philox::Next() {
+  if (fUsed == 4) {
+    Refill();
+  }
+  return fBlock[fUsed++];
+}
+
+double Philox::Uniform() {
+  const std::uint64_t high = Next() >> 5;
+  const std::uint64_t low = Next() >> 6;
+  return static_cast<double>((high << 26) | low) * (1.0 / 9007199254740992.0);
+}
+
+double Philox::Normal() {
+  if (fHasSpare) {
+    fHasSpare = false;
+    return fSpare;
+  }
+  // 1 - Uniform() lies in (0, 1], keeping the logarithm finite.
+  const double radius = std::sqrt(-2.0 * std::log(1.0 - Uniform()));
+  const double angle = kTwoPi * Uniform();
+  fSpare = radius * std::sin(angle);
+  fHasSpare = true;
+  return radius * std::cos(angle);
+}
+
+double Philox::Exponential() {
+  return -std::log(1.0 - Uniform());
+}
+
+double Philox::Gamma(double shape) {
+  if (shape < 1.0) {
+    // Boost: Gamma(a) = Gamma(a + 1) * U^(1/a).
+    return Gamma(shape + 1.0) * std::pow(1.0 - Uniform(), 1.0 / shape);
+  }
+  const double d = shape - 1.0 / 3.0;
+  const double c = 1.0 / std::sqrt(9.0 * d);
+  for (;;) {
+    double x;
+    double v;
+    do {
+      x = Normal();
+      v = 1.0 + c * x;
+    } while (v <= 0.0);
+    v = v * v * v;
+    const double u = Uniform();
+    const double x2 = x * x;
+    if (u < 1.0 - 0.0331 * x2 * x2) {
+      return d * v;
+    }
+    if (std::log(u) < 0.5 * x2 + d * (1.0 - v + std::log(v))) {
+      return d * v;
+    }
+  }
+}
+
+double InterpolateQe(const Params& params, double wavelengthNm) {
+  const auto& xp = params.qeWavelengthNm;
+  const auto& fp = params.qeValues;
+  if (wavelengthNm != wavelengthNm) {
+    return wavelengthNm;
+  }
+  if (wavelengthNm < xp.front() || wavelengthNm > xp.back()) {
+    return 0.0;
+  }
+  if (wavelengthNm == xp.back()) {
+    return fp.back();
+  }
+  // Last knot at or below the wavelength, as `np.interp` picks it.
+  const std::size_t j =
+      static_cast<std::size_t>(std::upper_bound(xp.begin(), xp.end(), wavelengthNm) - xp.begin()) -
+      1;
+  const double slope = (fp[j + 1] - fp[j]) / (xp[j + 1] - xp[j]);
+  return slope * (wavelengthNm - xp[j]) + fp[j];
+}
+
+void Process(const Params& params,
+             std::uint64_t seed,
+             const Photon* photons,
+             std::size_t count,
+             bool requireInBounds,
+             std::vector<OutputEvent>* events) {
+  const double stage1Scale = params.stage1MeanGain / params.stage1GainShape;
+  const double stage2Scale = params.stage2MeanGain / params.stage2GainShape;
+  for (std::size_t i = 0; i < count; ++i) {
+    const Photon& photon = photons[i];
+    if (requireInBounds && !photon.inBounds) {
+      continue;
+    }
+    Philox rng(seed, static_cast<std::uint64_t>(photon.sourcePhotonIndex));
+
+    // Photocathode: clip(QE * collection efficiency) detection, then TTS.
+    const double probability = std::min(
+        std::max(InterpolateQe(params, photon.wavelengthNm) * params.collectionEfficiency, 0.0),
+        1.0);
+    if (!(rng.Uniform() < probability)) {
+      continue;
+    }
+    double timeNs = photon.timeNs;
+    if (params.ttsSigmaNs > 0.0) {
+      timeNs += params.ttsSigmaNs * rng.Normal();
+    }
+
+    // MCP: two gamma gain stages and a gain-dependent spread.
+    const double totalGain = (rng.Gamma(params.stage1GainShape) * stage1Scale) *
+                             (rng.Gamma(params.stage2GainShape) * stage2Scale);
+    double xMm = photon.xMm;
+    double yMm = photon.yMm;
+    const double spreadMm =
+        params.spreadSigma0Mm * std::pow(totalGain / params.gainRef, params.spreadGainExponent);
+    if (spreadMm > 0.0) {
+      xMm += spreadMm * rng.Normal();
+      yMm += spreadMm * rng.Normal();
+    }
+
+    // Phosphor: fast/slow exponential delay and PSF blur.
+    const bool fast = rng.Uniform() < params.fastFraction;
+    const double delayNs = rng.Exponential() * (fast ? params.decayFastNs : params.decaySlowNs);
+    if (params.psfSigmaMm > 0.0) {
+      xMm += params.psfSigmaMm * rng.Normal();
+      yMm += params.psfSigmaMm * rng.Normal();
+    }
+
+    OutputEvent event;
+    event.sourcePhotonIndex = photon.sourcePhotonIndex;
+    event.gunCallId = photon.gunCallId;
+    event.primaryTrackId = photon.primaryTrackId;
+    event.secondaryTrackId = photon.secondaryTrackId;
+    event.photonTrackId = photon.photonTrackId;
+    event.outputXmm = xMm;
+    event.outputYmm = yMm;
+    event.outputTimeNs = timeNs + delayNs;
+    event.signalAmplitudeArb = params.phosphorGain * totalGain;
+    event.totalGain = totalGain;
+    event.wavelengthNm = photon.wavelengthNm;
+    events->push_back(event);
+  }
+}
+
+}  // namespace Intensifier
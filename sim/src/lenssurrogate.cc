@@ -0,0 +1,1088 @@
+#include "lenssurrogate.hh"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <utility>
+
+namespace {
+/// Format tag and version written to every model file.
+constexpr const char* kFormat = "g4emi-lens-surrogate";
+constexpr int kFormatVersion = 1;
+
+/// Rays evaluated together; keeps the per-chunk basis tables in L2.
+constexpr std::size_t kChunk = 256;
+
+/// Image samples more vignetted than this still anchor the image-point fit,
+/// and aperture samples used beyond this are left out of the clearance fit.
+constexpr double kImageFitClearance = -0.1;
+constexpr double kMaxFittedUse = 1.25;
+
+/// Domain scan: positions and slopes of the meridional pass, then per axis
+/// of the skew-ray pass, and the steepest slope scanned.
+constexpr int kScanMeridionalPositions = 121;
+constexpr int kScanMeridionalSlopes = 1201;
+constexpr int kScanSkewPositions = 9;
+constexpr int kScanSkewSlopes = 41;
+const double kScanMaxSlope = std::tan(85.0 * 3.14159265358979323846 / 180.0);
+
+std::mutex gActiveModelMutex;
+std::shared_ptr<const LensSurrogate::Model> gActiveModel;
+
+double InverseLambda2(double wavelengthNm) { return 1.0e6 / (wavelengthNm * wavelengthNm); }
+
+// Chief-ray entrance offset along slope component `u` for squared slope `s2`.
+double ChiefOffset(const LensSurrogate::Model& model, double u, double s2) {
+  return u * (model.chiefRay[0] + model.chiefRay[1] * s2);
+}
+
+// One ray in model coordinates: pupil and field vectors scaled to the
+// domain box, and the Legendre arguments built from their invariants.
+struct RayInputs {
+  double px = 0.0;
+  double py = 0.0;
+  double fx = 0.0;
+  double fy = 0.0;
+  std::array<double, LensSurrogate::kInvariants> t{};
+};
+
+// Legendre P_0..P_degree at `t` into `out[0..degree]`.
+void Legendre(double t, int degree, double* out) {
+  out[0] = 1.0;
+  if (degree > 0) {
+    out[1] = t;
+  }
+  for (int k = 1; k < degree; ++k) {
+    out[k + 1] = ((2 * k + 1) * t * out[k] - k * out[k - 1]) / (k + 1);
+  }
+}
+
+// Every exponent tuple with total degree <= `degree` and at most
+// `wavelengthDegree` in the wavelength invariant, lowest degree first.
+std::vector<std::array<std::uint8_t, LensSurrogate::kInvariants>> Exponents(
+    int degree, int wavelengthDegree) {
+  std::vector<std::array<std::uint8_t, LensSurrogate::kInvariants>> terms;
+  for (int total = 0; total <= degree; ++total) {
+    std::array<std::uint8_t, LensSurrogate::kInvariants> e{};
+    // Odometer over the leading invariants; the last takes the remainder.
+    const auto fill = [&](auto&& self, std::size_t input, int left) -> void {
+      if (input + 1 == LensSurrogate::kInvariants) {
+        e[input] = static_cast<std::uint8_t>(left);
+        if (left <= wavelengthDegree) {
+          terms.push_back(e);
+        }
+        return;
+      }
+      for (int k = left; k >= 0; --k) {
+        e[input] = static_cast<std::uint8_t>(k);
+        self(self, input + 1, left - k);
+      }
+    };
+    fill(fill, 0, total);
+  }
+  return terms;
+}
+
+// Constants of `ModelInputs`, derived once per model so rays pay for one
+// division of their own.
+struct InputScale {
+  explicit InputScale(const LensSurrogate::Model& model)
+      : model(model),
+        inversePupil(1.0 / model.pupilRadiusMm),
+        inverseSlope(1.0 / model.maxSlope) {
+    const double wLow = InverseLambda2(model.wavelengthMaxNm);
+    const double wHigh = InverseLambda2(model.wavelengthMinNm);
+    wavelengthCenter = 0.5 * (wLow + wHigh);
+    wavelengthScale = wHigh > wLow ? 2.0 / (wHigh - wLow) : 0.0;
+  }
+
+  const LensSurrogate::Model& model;
+  double inversePupil;
+  double inverseSlope;
+  double wavelengthCenter = 0.0;
+  double wavelengthScale = 0.0;
+};
+
+// Model coordinates of ray `i`; false outside the pupil and slope box.
+// Wavelengths are clamped into the fitted range.
+bool ModelInputs(const InputScale& scale,
+                 const LensTrace::RayBatch& rays,
+                 std::size_t i,
+                 RayInputs* in) {
+  const auto& model = scale.model;
+  const double dz = rays.dz[i];
+  if (!(dz != 0.0) || !std::isfinite(rays.x[i]) || !std::isfinite(rays.y[i])) {
+    return false;
+  }
+  const double inverseDz = 1.0 / dz;
+  const double u = rays.dx[i] * inverseDz;
+  const double v = rays.dy[i] * inverseDz;
+  const double shift = ChiefOffset(model, 1.0, u * u + v * v);
+  in->px = (rays.x[i] - u * shift) * scale.inversePupil;
+  in->py = (rays.y[i] - v * shift) * scale.inversePupil;
+  in->fx = u * scale.inverseSlope;
+  in->fy = v * scale.inverseSlope;
+  if (!(std::max(std::max(std::abs(in->px), std::abs(in->py)),
+                 std::max(std::abs(in->fx), std::abs(in->fy))) <= 1.0)) {
+    return false;
+  }
+  double lambda = rays.wavelengthNm[i] > 0.0 ? rays.wavelengthNm[i] : model.primaryWavelengthNm;
+  lambda = std::clamp(lambda, model.wavelengthMinNm, model.wavelengthMaxNm);
+  // |p|^2 and |f|^2 lie in [0, 2] and p.f in [-2, 2] over the box.
+  in->t[0] = in->px * in->px + in->py * in->py - 1.0;
+  in->t[1] = 0.5 * (in->px * in->fx + in->py * in->fy);
+  in->t[2] = in->fx * in->fx + in->fy * in->fy - 1.0;
+  in->t[3] = (InverseLambda2(lambda) - scale.wavelengthCenter) * scale.wavelengthScale;
+  return true;
+}
+
+// Scalar basis values for one ray.
+void BasisRow(const LensSurrogate::Model& model, const RayInputs& in, double* row) {
+  double p[LensSurrogate::kInvariants][32];
+  for (std::size_t j = 0; j < LensSurrogate::kInvariants; ++j) {
+    Legendre(in.t[j], model.degree, p[j]);
+  }
+  for (std::size_t k = 0; k < model.Terms(); ++k) {
+    const auto& e = model.exponents[k];
+    row[k] = p[0][e[0]] * p[1][e[1]] * p[2][e[2]] * p[3][e[3]];
+  }
+}
+
+// Per-chunk inputs of `Evaluate`, one row of `kChunk` values each: the
+// pupil and field vectors, then the four invariants.
+constexpr std::size_t kInputRows = 8;
+constexpr std::size_t kInvariantRow = 4;
+/// Rays whose term sums stay in registers in `SumTerms`; divides `kChunk`.
+constexpr std::size_t kLanes = 8;
+
+// A basis prefix split into products of two factors: P(t0) P(t1) and
+// P(t2) P(t3). Each distinct factor is computed once per ray, so a term
+// costs one product instead of three.
+struct BasisPlan {
+  /// Highest Legendre degree used per invariant.
+  std::array<int, LensSurrogate::kInvariants> degree{};
+  /// Distinct (e0, e1) factors, then distinct (e2, e3) factors.
+  std::vector<std::array<std::uint8_t, 2>> lowFactors;
+  std::vector<std::array<std::uint8_t, 2>> highFactors;
+  /// Factor rows of each term; high rows follow the low ones.
+  std::vector<std::array<std::uint16_t, 2>> termFactors;
+};
+
+BasisPlan PlanBasis(const LensSurrogate::Model& model, std::size_t terms) {
+  BasisPlan plan;
+  const auto row = [](std::vector<std::array<std::uint8_t, 2>>* factors,
+                      std::array<std::uint8_t, 2> factor) {
+    const auto it = std::find(factors->begin(), factors->end(), factor);
+    if (it != factors->end()) {
+      return static_cast<std::uint16_t>(it - factors->begin());
+    }
+    factors->push_back(factor);
+    return static_cast<std::uint16_t>(factors->size() - 1);
+  };
+  std::vector<std::array<std::uint16_t, 2>> rows;
+  for (std::size_t k = 0; k < terms; ++k) {
+    const auto& e = model.exponents[k];
+    for (std::size_t j = 0; j < LensSurrogate::kInvariants; ++j) {
+      plan.degree[j] = std::max<int>(plan.degree[j], e[j]);
+    }
+    rows.push_back({row(&plan.lowFactors, {e[0], e[1]}), row(&plan.highFactors, {e[2], e[3]})});
+  }
+  const auto low = static_cast<std::uint16_t>(plan.lowFactors.size());
+  for (const auto& r : rows) {
+    plan.termFactors.push_back({r[0], static_cast<std::uint16_t>(low + r[1])});
+  }
+  return plan;
+}
+
+// Per-thread buffers of `Evaluate`, each a stack of `kChunk`-value rows.
+struct BasisScratch {
+  std::vector<double> inputs;
+  /// Legendre values [invariant][degree][slot].
+  std::vector<double> legendre;
+  std::vector<double> factors;
+  /// Term sums [output][slot].
+  std::vector<double> sums;
+  std::vector<std::size_t> slots;
+  std::size_t width = 0;
+
+  void Reserve(const BasisPlan& plan, std::size_t outputs) {
+    width = static_cast<std::size_t>(
+                *std::max_element(plan.degree.begin(), plan.degree.end())) + 1;
+    inputs.resize(kInputRows * kChunk);
+    legendre.resize(LensSurrogate::kInvariants * width * kChunk);
+    factors.resize((plan.lowFactors.size() + plan.highFactors.size()) * kChunk);
+    sums.resize(outputs * kChunk);
+    slots.resize(kChunk);
+  }
+};
+
+// sums[first + o][slot] over the plan's terms for `kOutputs` outputs, with
+// the partial sums of `kLanes` rays held in registers across all terms.
+template <std::size_t kOutputs>
+void SumTerms(const BasisPlan& plan,
+              const double* coefficients,
+              std::size_t first,
+              std::size_t count,
+              BasisScratch* scratch) {
+  const std::size_t terms = plan.termFactors.size();
+  const double* factors = scratch->factors.data();
+  for (std::size_t r0 = 0; r0 < count; r0 += kLanes) {
+    double sum[kOutputs][kLanes] = {};
+    for (std::size_t k = 0; k < terms; ++k) {
+      const double* low = factors + plan.termFactors[k][0] * kChunk + r0;
+      const double* high = factors + plan.termFactors[k][1] * kChunk + r0;
+      double product[kLanes];
+      for (std::size_t l = 0; l < kLanes; ++l) {
+        product[l] = low[l] * high[l];
+      }
+      for (std::size_t o = 0; o < kOutputs; ++o) {
+        const double c = coefficients[(first + o) * terms + k];
+        for (std::size_t l = 0; l < kLanes; ++l) {
+          sum[o][l] += c * product[l];
+        }
+      }
+    }
+    for (std::size_t o = 0; o < kOutputs; ++o) {
+      std::copy(sum[o], sum[o] + kLanes, scratch->sums.data() + (first + o) * kChunk + r0);
+    }
+  }
+}
+
+// Evaluate `outputs` expansions over the plan's terms for the first `count`
+// slots of `scratch->inputs` into `scratch->sums`.
+void SumBasis(const BasisPlan& plan,
+              const double* coefficients,
+              std::size_t outputs,
+              std::size_t count,
+              BasisScratch* scratch) {
+  // Whole register blocks; the padding slots hold stale but finite inputs.
+  const std::size_t lanes = (count + kLanes - 1) / kLanes * kLanes;
+  const std::size_t width = scratch->width;
+  double* legendre = scratch->legendre.data();
+  for (std::size_t j = 0; j < LensSurrogate::kInvariants; ++j) {
+    const double* t = scratch->inputs.data() + (kInvariantRow + j) * kChunk;
+    double* p = legendre + j * width * kChunk;
+    std::fill(p, p + lanes, 1.0);
+    if (plan.degree[j] > 0) {
+      std::copy(t, t + lanes, p + kChunk);
+    }
+    for (int d = 1; d < plan.degree[j]; ++d) {
+      const double* previous = p + (d - 1) * kChunk;
+      const double* current = p + d * kChunk;
+      double* next = p + (d + 1) * kChunk;
+      const double a = (2.0 * d + 1.0) / (d + 1.0);
+      const double b = static_cast<double>(d) / (d + 1.0);
+      for (std::size_t r = 0; r < lanes; ++r) {
+        next[r] = a * t[r] * current[r] - b * previous[r];
+      }
+    }
+  }
+  const auto fillFactors = [&](const std::vector<std::array<std::uint8_t, 2>>& list,
+                               std::size_t firstInvariant, double* out) {
+    for (const auto& factor : list) {
+      const double* p = legendre + (firstInvariant * width + factor[0]) * kChunk;
+      const double* q = legendre + ((firstInvariant + 1) * width + factor[1]) * kChunk;
+      for (std::size_t r = 0; r < lanes; ++r) {
+        out[r] = p[r] * q[r];
+      }
+      out += kChunk;
+    }
+  };
+  fillFactors(plan.lowFactors, 0, scratch->factors.data());
+  fillFactors(plan.highFactors, 2, scratch->factors.data() + plan.lowFactors.size() * kChunk);
+
+  for (std::size_t first = 0; first < outputs; first += 3) {
+    switch (std::min<std::size_t>(3, outputs - first)) {
+      case 1:
+        SumTerms<1>(plan, coefficients, first, lanes, scratch);
+        break;
+      case 2:
+        SumTerms<2>(plan, coefficients, first, lanes, scratch);
+        break;
+      default:
+        SumTerms<3>(plan, coefficients, first, lanes, scratch);
+        break;
+    }
+  }
+}
+
+// Least squares via the normal equations: accumulate with `Add`, then `Solve`
+// for one coefficient vector per right-hand side.
+class NormalEquations {
+ public:
+  NormalEquations(std::size_t terms, std::size_t outputs)
+      : fTerms(terms), fOutputs(outputs), fGram(terms * terms), fRhs(outputs * terms) {}
+
+  void Add(const double* row, const double* values) {
+    for (std::size_t j = 0; j < fTerms; ++j) {
+      double* gram = fGram.data() + j * fTerms;
+      const double rj = row[j];
+      for (std::size_t k = j; k < fTerms; ++k) {
+        gram[k] += rj * row[k];
+      }
+      for (std::size_t o = 0; o < fOutputs; ++o) {
+        fRhs[o * fTerms + j] += rj * values[o];
+      }
+    }
+    ++fRows;
+  }
+
+  std::size_t Rows() const { return fRows; }
+
+  // Cholesky with a small ridge; false when the system is singular.
+  bool Solve(std::vector<double>* coefficients) {
+    const std::size_t n = fTerms;
+    double largest = 0.0;
+    for (std::size_t j = 0; j < n; ++j) {
+      largest = std::max(largest, fGram[j * n + j]);
+    }
+    const double ridge = 1.0e-12 * largest;
+    std::vector<double> l(n * n, 0.0);
+    for (std::size_t j = 0; j < n; ++j) {
+      double diagonal = fGram[j * n + j] + ridge;
+      for (std::size_t k = 0; k < j; ++k) {
+        diagonal -= l[j * n + k] * l[j * n + k];
+      }
+      if (!(diagonal > 0.0)) {
+        return false;
+      }
+      l[j * n + j] = std::sqrt(diagonal);
+      for (std::size_t i = j + 1; i < n; ++i) {
+        double sum = fGram[j * n + i];
+        for (std::size_t k = 0; k < j; ++k) {
+          sum -= l[i * n + k] * l[j * n + k];
+        }
+        l[i * n + j] = sum / l[j * n + j];
+      }
+    }
+    coefficients->assign(fOutputs * n, 0.0);
+    for (std::size_t o = 0; o < fOutputs; ++o) {
+      double* c = coefficients->data() + o * n;
+      const double* b = fRhs.data() + o * n;
+      for (std::size_t i = 0; i < n; ++i) {
+        double sum = b[i];
+        for (std::size_t k = 0; k < i; ++k) {
+          sum -= l[i * n + k] * c[k];
+        }
+        c[i] = sum / l[i * n + i];
+      }
+      for (std::size_t i = n; i-- > 0;) {
+        double sum = c[i];
+        for (std::size_t k = i + 1; k < n; ++k) {
+          sum -= l[k * n + i] * c[k];
+        }
+        c[i] = sum / l[i * n + i];
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::size_t fTerms;
+  std::size_t fOutputs;
+  std::size_t fRows = 0;
+  std::vector<double> fGram;
+  std::vector<double> fRhs;
+};
+
+// Rays at the primary wavelength, traced with clipping.
+struct ScanBatch {
+  LensTrace::RayBatch rays;
+  /// Larger slope component of each ray, kept since tracing overwrites directions.
+  std::vector<double> slopes;
+
+  void Add(double wavelengthNm, double x, double y, double u, double v) {
+    slopes.push_back(std::max(std::abs(u), std::abs(v)));
+    const std::size_t i = rays.Size();
+    rays.Resize(i + 1);
+    rays.x[i] = x;
+    rays.y[i] = y;
+    rays.dx[i] = u;
+    rays.dy[i] = v;
+    rays.dz[i] = 1.0;
+    rays.wavelengthNm[i] = wavelengthNm;
+  }
+};
+
+// Fill the model domain. A fine meridional scan (the lens is rotationally
+// symmetric) finds the transmitted slopes and, from the middle of each
+// slope's transmitted span, the chief-ray offset; a skew-ray grid up to 1.5x
+// the meridional slope then widens the domain if a skew ray reaches further.
+bool ScanDomain(const LensTrace::Lens& lens, double radiusMm, LensSurrogate::Model* model) {
+  const double lambda = lens.primaryWavelengthNm;
+  ScanBatch scan;
+  for (int su = 0; su < kScanMeridionalSlopes; ++su) {
+    const double u = kScanMaxSlope * (2.0 * su / (kScanMeridionalSlopes - 1) - 1.0);
+    for (int px = 0; px < kScanMeridionalPositions; ++px) {
+      scan.Add(lambda, radiusMm * (2.0 * px / (kScanMeridionalPositions - 1) - 1.0), 0.0, u,
+               0.0);
+    }
+  }
+  LensTrace::Trace(lens, &scan.rays);
+
+  // Per slope, the transmitted entrance span; fit its midpoint with an odd cubic.
+  double slope = 0.0;
+  double m11 = 0.0, m13 = 0.0, m33 = 0.0, b1 = 0.0, b3 = 0.0;
+  for (int su = 0; su < kScanMeridionalSlopes; ++su) {
+    double low = std::numeric_limits<double>::infinity();
+    double high = -low;
+    const std::size_t first = static_cast<std::size_t>(su) * kScanMeridionalPositions;
+    for (int px = 0; px < kScanMeridionalPositions; ++px) {
+      const std::size_t i = first + px;
+      if (scan.rays.valid[i]) {
+        const double x = radiusMm * (2.0 * px / (kScanMeridionalPositions - 1) - 1.0);
+        low = std::min(low, x);
+        high = std::max(high, x);
+      }
+    }
+    if (low > high) {
+      continue;
+    }
+    const double u = kScanMaxSlope * (2.0 * su / (kScanMeridionalSlopes - 1) - 1.0);
+    slope = std::max(slope, std::abs(u));
+    const double mid = 0.5 * (low + high);
+    m11 += u * u;
+    m13 += u * u * u * u;
+    m33 += u * u * u * u * u * u;
+    b1 += u * mid;
+    b3 += u * u * u * mid;
+  }
+  if (slope == 0.0) {
+    return false;
+  }
+  const double det = m11 * m33 - m13 * m13;
+  model->chiefRay = det > 0.0 ? std::array<double, 2>{(b1 * m33 - b3 * m13) / det,
+                                                      (m11 * b3 - m13 * b1) / det}
+                              : std::array<double, 2>{m11 > 0.0 ? b1 / m11 : 0.0, 0.0};
+
+  const double positionStep = 2.0 * radiusMm / (kScanMeridionalPositions - 1);
+  const double slopeStep = 2.0 * kScanMaxSlope / (kScanMeridionalSlopes - 1);
+  double pupil = 0.0;
+  for (std::size_t i = 0; i < scan.rays.Size(); ++i) {
+    if (scan.rays.valid[i]) {
+      const std::size_t su = i / kScanMeridionalPositions;
+      const std::size_t px = i % kScanMeridionalPositions;
+      const double u = kScanMaxSlope * (2.0 * su / (kScanMeridionalSlopes - 1) - 1.0);
+      const double x = radiusMm * (2.0 * px / (kScanMeridionalPositions - 1) - 1.0);
+      pupil = std::max(pupil, std::abs(x - ChiefOffset(*model, u, u * u)));
+    }
+  }
+  model->pupilRadiusMm = pupil + positionStep;
+  model->maxSlope = slope + slopeStep;
+
+  // Skew rays over the pupil box found so far.
+  ScanBatch skew;
+  const double limit = 1.5 * model->maxSlope;
+  for (int sv = 0; sv < kScanSkewSlopes; ++sv) {
+    for (int su = 0; su < kScanSkewSlopes; ++su) {
+      const double u = limit * (2.0 * su / (kScanSkewSlopes - 1) - 1.0);
+      const double v = limit * (2.0 * sv / (kScanSkewSlopes - 1) - 1.0);
+      const double shift = ChiefOffset(*model, 1.0, u * u + v * v);
+      for (int py = 0; py < kScanSkewPositions; ++py) {
+        for (int px = 0; px < kScanSkewPositions; ++px) {
+          const double x = model->pupilRadiusMm * (2.0 * px / (kScanSkewPositions - 1) - 1.0);
+          const double y = model->pupilRadiusMm * (2.0 * py / (kScanSkewPositions - 1) - 1.0);
+          skew.Add(lambda, x + u * shift, y + v * shift, u, v);
+        }
+      }
+    }
+  }
+  LensTrace::Trace(lens, &skew.rays);
+  for (std::size_t i = 0; i < skew.rays.Size(); ++i) {
+    if (skew.rays.valid[i]) {
+      model->maxSlope = std::max(model->maxSlope,
+                                 skew.slopes[i] + 2.0 * limit / (kScanSkewSlopes - 1));
+    }
+  }
+  return true;
+}
+
+// Smallest set of apertures that reproduces every sample's vignetting: each
+// surface that alone clips some sample, then greedily whatever covers the rest.
+std::vector<int> LimitingApertures(const LensTrace::Lens& lens,
+                                   const LensTrace::RayBatch& rays,
+                                   const std::vector<double>& use) {
+  const std::size_t n = rays.Size();
+  const std::size_t surfaces = lens.surfaces.size();
+  std::vector<std::vector<int>> clippedBy(n);
+  for (std::size_t s = 1; s < surfaces; ++s) {
+    const double semi = lens.surfaces[s].semiDiameter;
+    if (semi <= 0.0) {
+      continue;
+    }
+    const double limit = 1.0 + 1.0e-5 / semi;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (rays.valid[i] && use[s * n + i] > limit) {
+        clippedBy[i].push_back(static_cast<int>(s));
+      }
+    }
+  }
+  std::vector<int> chosen;
+  const auto covered = [&chosen](const std::vector<int>& set) {
+    return std::any_of(set.begin(), set.end(), [&chosen](int s) {
+      return std::find(chosen.begin(), chosen.end(), s) != chosen.end();
+    });
+  };
+  for (const auto& set : clippedBy) {
+    if (set.size() == 1 && !covered(set)) {
+      chosen.push_back(set.front());
+    }
+  }
+  for (;;) {
+    std::vector<std::size_t> votes(surfaces, 0);
+    for (const auto& set : clippedBy) {
+      if (!set.empty() && !covered(set)) {
+        for (int s : set) {
+          ++votes[s];
+        }
+      }
+    }
+    const auto best = std::max_element(votes.begin(), votes.end());
+    if (*best == 0) {
+      break;
+    }
+    chosen.push_back(static_cast<int>(best - votes.begin()));
+  }
+  std::sort(chosen.begin(), chosen.end());
+  return chosen;
+}
+
+// Chebyshev nodes on [-1, 1], dense toward the ends where fits ring.
+std::vector<double> Nodes(int count) {
+  std::vector<double> nodes(count);
+  for (int k = 0; k < count; ++k) {
+    nodes[k] = -std::cos(3.14159265358979323846 * (k + 0.5) / count);
+  }
+  return nodes;
+}
+
+bool WriteAttribute(hid_t file, const char* name, hid_t type, hid_t space, const void* value) {
+  const hid_t attribute = H5Acreate2(file, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+  if (attribute < 0) {
+    return false;
+  }
+  const bool written = H5Awrite(attribute, type, value) >= 0;
+  H5Aclose(attribute);
+  return written;
+}
+
+bool ReadAttribute(hid_t file, const char* name, hid_t type, void* value) {
+  if (H5Aexists(file, name) <= 0) {
+    return false;
+  }
+  const hid_t attribute = H5Aopen(file, name, H5P_DEFAULT);
+  const bool read = H5Aread(attribute, type, value) >= 0;
+  H5Aclose(attribute);
+  return read;
+}
+
+bool ReadStringAttribute(hid_t file, const char* name, std::string* value) {
+  if (H5Aexists(file, name) <= 0) {
+    return false;
+  }
+  const hid_t attribute = H5Aopen(file, name, H5P_DEFAULT);
+  const hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, H5T_VARIABLE);
+  H5Tset_cset(type, H5T_CSET_UTF8);
+  char* text = nullptr;
+  const bool read = H5Aread(attribute, type, &text) >= 0 && text;
+  if (read) {
+    *value = text;
+    H5free_memory(text);
+  }
+  H5Tclose(type);
+  H5Aclose(attribute);
+  return read;
+}
+}  // namespace
+
+namespace LensSurrogate {
+
+bool Fit(const LensTrace::Lens& lens,
+         const FitOptions& options,
+         Model* model,
+         std::string* errorMessage) {
+  const auto fail = [errorMessage](const std::string& message) {
+    if (errorMessage) {
+      *errorMessage = message;
+    }
+    return false;
+  };
+  if (options.degree < 1 || options.degree > 12 || options.maskDegree < 1 ||
+      options.maskDegree > options.degree) {
+    return fail("polynomial degrees must satisfy 1 <= mask degree <= degree <= 12");
+  }
+  // The invariants are quadratic in the grid axes, and an axis with k points
+  // only pins down polynomials of degree below k.
+  if (options.gridPoints <= 2 * options.degree) {
+    return fail("the sampling grid needs more than twice the degree in points per axis");
+  }
+  if (options.wavelengthDegree < 0 || options.wavelengthPoints <= options.wavelengthDegree) {
+    return fail("the wavelength grid needs more points than the wavelength degree");
+  }
+  if (!(options.wavelengthMinNm > 0.0) || options.wavelengthMaxNm < options.wavelengthMinNm) {
+    return fail("invalid wavelength range");
+  }
+
+  Model fitted;
+  fitted.lensName = lens.name;
+  fitted.zmxPath = lens.zmxPath;
+  fitted.smxPath = lens.smxPath;
+  fitted.degree = options.degree;
+  fitted.maskDegree = options.maskDegree;
+  const double radius =
+      options.radiusMm > 0.0 ? options.radiusMm : lens.surfaces[1].semiDiameter;
+  if (!(radius > 0.0)) {
+    return fail("the first surface has no semi-diameter; set the entrance radius");
+  }
+  fitted.wavelengthMinNm = options.wavelengthMinNm;
+  fitted.wavelengthMaxNm = options.wavelengthMaxNm;
+  fitted.primaryWavelengthNm = lens.primaryWavelengthNm;
+  if (!ScanDomain(lens, radius, &fitted)) {
+    return fail("no ray from the entrance disc reaches the image surface");
+  }
+  fitted.exponents = Exponents(options.degree, options.wavelengthDegree);
+
+  // Sample the domain on a Chebyshev grid and trace it without clipping.
+  const auto nodes = Nodes(options.gridPoints);
+  const auto wavelengthNodes =
+      options.wavelengthPoints == 1 ? std::vector<double>{0.0} : Nodes(options.wavelengthPoints);
+  LensTrace::RayBatch samples;
+  for (double tw : wavelengthNodes) {
+    const double wLow = InverseLambda2(fitted.wavelengthMaxNm);
+    const double wHigh = InverseLambda2(fitted.wavelengthMinNm);
+    const double w = 0.5 * (wLow + wHigh) + 0.5 * tw * (wHigh - wLow);
+    for (double tv : nodes) {
+      for (double tu : nodes) {
+        for (double ty : nodes) {
+          for (double tx : nodes) {
+            const std::size_t i = samples.Size();
+            samples.Resize(i + 1);
+            const double u = tu * fitted.maxSlope;
+            const double v = tv * fitted.maxSlope;
+            const double shift = ChiefOffset(fitted, 1.0, u * u + v * v);
+            samples.x[i] = tx * fitted.pupilRadiusMm + u * shift;
+            samples.y[i] = ty * fitted.pupilRadiusMm + v * shift;
+            samples.dx[i] = u;
+            samples.dy[i] = v;
+            samples.dz[i] = 1.0;
+            samples.wavelengthNm[i] = 1.0e3 / std::sqrt(w);
+          }
+        }
+      }
+    }
+  }
+  LensTrace::RayBatch traced = samples;
+  std::vector<double> use;
+  LensTrace::TraceUnclipped(lens, &traced, &use);
+  fitted.apertureSurfaces = LimitingApertures(lens, traced, use);
+
+  const std::size_t n = samples.Size();
+  const std::size_t terms = fitted.Terms();
+  const std::size_t maskTerms = fitted.MaskTerms();
+  const std::size_t apertures = fitted.apertureSurfaces.size();
+  // Image x and y share the A (pupil) and B (field) coefficients, so each
+  // sample contributes one row per component.
+  NormalEquations lateral(2 * terms, 1);
+  NormalEquations axial(terms, 1);
+  std::vector<NormalEquations> clearance(apertures, NormalEquations(maskTerms, 1));
+  std::vector<double> basis(terms);
+  std::vector<double> row(2 * terms);
+  const InputScale scale(fitted);
+  RayInputs in;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!traced.valid[i] || !ModelInputs(scale, samples, i, &in)) {
+      continue;
+    }
+    BasisRow(fitted, in, basis.data());
+    // An aperture only decides rays that cleared the ones before it; rays
+    // far outside an earlier aperture graze lens rims and would skew its fit.
+    double nearest = 1.0;
+    for (std::size_t a = 0; a < apertures; ++a) {
+      const double value = use[fitted.apertureSurfaces[a] * n + i];
+      if (nearest > kImageFitClearance && value <= kMaxFittedUse) {
+        const double target = 1.0 - value * value;
+        clearance[a].Add(basis.data(), &target);
+      }
+      nearest = std::min(nearest, 1.0 - value);
+    }
+    if (nearest <= kImageFitClearance) {
+      continue;
+    }
+    for (std::size_t k = 0; k < terms; ++k) {
+      row[k] = basis[k] * in.px;
+      row[terms + k] = basis[k] * in.fx;
+    }
+    lateral.Add(row.data(), &traced.x[i]);
+    for (std::size_t k = 0; k < terms; ++k) {
+      row[k] = basis[k] * in.py;
+      row[terms + k] = basis[k] * in.fy;
+    }
+    lateral.Add(row.data(), &traced.y[i]);
+    axial.Add(basis.data(), &traced.z[i]);
+  }
+
+  std::vector<double> axialCoefficients;
+  if (axial.Rows() < 2 * terms || !lateral.Solve(&fitted.imageCoefficients) ||
+      !axial.Solve(&axialCoefficients)) {
+    return fail("too few transmitted samples for a degree-" + std::to_string(options.degree) +
+                " fit; raise the grid size or lower the degree");
+  }
+  fitted.imageCoefficients.insert(fitted.imageCoefficients.end(), axialCoefficients.begin(),
+                                  axialCoefficients.end());
+  std::vector<double> solved;
+  for (std::size_t a = 0; a < apertures; ++a) {
+    if (clearance[a].Rows() < maskTerms || !clearance[a].Solve(&solved)) {
+      return fail("too few samples to fit the aperture of surface " +
+                  std::to_string(fitted.apertureSurfaces[a]));
+    }
+    fitted.apertureCoefficients.insert(fitted.apertureCoefficients.end(), solved.begin(),
+                                       solved.end());
+  }
+
+  *model = std::move(fitted);
+  return true;
+}
+
+std::size_t Model::MaskTerms() const {
+  return static_cast<std::size_t>(
+      std::count_if(exponents.begin(), exponents.end(), [this](const auto& e) {
+        int total = 0;
+        for (std::uint8_t d : e) {
+          total += d;
+        }
+        return total <= maskDegree;
+      }));
+}
+
+void Evaluate(const Model& model, LensTrace::RayBatch* batch) {
+  auto& rays = *batch;
+  const std::size_t n = rays.Size();
+  const std::size_t apertures = model.apertureSurfaces.size();
+  const BasisPlan maskPlan = PlanBasis(model, model.MaskTerms());
+  const BasisPlan imagePlan = PlanBasis(model, model.Terms());
+
+  const InputScale scale(model);
+  thread_local BasisScratch scratch;
+  scratch.Reserve(imagePlan, std::max<std::size_t>(3, apertures));
+  double* inputs = scratch.inputs.data();
+  RayInputs in;
+  for (std::size_t begin = 0; begin < n; begin += kChunk) {
+    const std::size_t end = std::min(n, begin + kChunk);
+    // Rays inside the domain take consecutive slots.
+    std::size_t count = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+      rays.valid[i] = 0;
+      if (!ModelInputs(scale, rays, i, &in)) {
+        continue;
+      }
+      const double values[kInputRows] = {in.px,   in.py,   in.fx,   in.fy,
+                                         in.t[0], in.t[1], in.t[2], in.t[3]};
+      for (std::size_t row = 0; row < kInputRows; ++row) {
+        inputs[row * kChunk + count] = values[row];
+      }
+      scratch.slots[count++] = i;
+    }
+
+    // Apertures first; survivors' inputs are packed down so the image pass
+    // only sees transmitted rays.
+    if (apertures > 0 && count > 0) {
+      SumBasis(maskPlan, model.apertureCoefficients.data(), apertures, count, &scratch);
+      std::size_t kept = 0;
+      for (std::size_t r = 0; r < count; ++r) {
+        bool transmitted = true;
+        for (std::size_t a = 0; a < apertures; ++a) {
+          transmitted = transmitted && scratch.sums[a * kChunk + r] > 0.0;
+        }
+        if (!transmitted) {
+          continue;
+        }
+        if (kept != r) {
+          for (std::size_t row = 0; row < kInputRows; ++row) {
+            inputs[row * kChunk + kept] = inputs[row * kChunk + r];
+          }
+          scratch.slots[kept] = scratch.slots[r];
+        }
+        ++kept;
+      }
+      count = kept;
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    // Image point A p + B f, with A, B, and z scalar in the invariants.
+    SumBasis(imagePlan, model.imageCoefficients.data(), 3, count, &scratch);
+    const double* sums = scratch.sums.data();
+    for (std::size_t r = 0; r < count; ++r) {
+      const double a = sums[r];
+      const double b = sums[kChunk + r];
+      const std::size_t i = scratch.slots[r];
+      rays.valid[i] = 1;
+      rays.x[i] = a * inputs[r] + b * inputs[2 * kChunk + r];
+      rays.y[i] = a * inputs[kChunk + r] + b * inputs[3 * kChunk + r];
+      rays.z[i] = sums[2 * kChunk + r];
+    }
+  }
+}
+
+Statistics Compare(const LensTrace::Lens& lens,
+                   const Model& model,
+                   const LensTrace::RayBatch& rays) {
+  LensTrace::RayBatch exact = rays;
+  LensTrace::RayBatch approximate = rays;
+  LensTrace::Trace(lens, &exact);
+  Evaluate(model, &approximate);
+
+  Statistics stats;
+  stats.rays = rays.Size();
+  std::vector<double> errors;
+  double squares = 0.0;
+  for (std::size_t i = 0; i < stats.rays; ++i) {
+    stats.exactTransmitted += exact.valid[i] ? 1 : 0;
+    stats.modelTransmitted += approximate.valid[i] ? 1 : 0;
+    if (approximate.valid[i] && !exact.valid[i]) {
+      ++stats.falsePass;
+    } else if (exact.valid[i] && !approximate.valid[i]) {
+      ++stats.falseBlock;
+    } else if (exact.valid[i]) {
+      const double error = std::hypot(approximate.x[i] - exact.x[i], approximate.y[i] - exact.y[i]);
+      errors.push_back(error);
+      squares += error * error;
+    }
+  }
+  if (!errors.empty()) {
+    stats.rmsErrorMm = std::sqrt(squares / static_cast<double>(errors.size()));
+    stats.maxErrorMm = *std::max_element(errors.begin(), errors.end());
+    const auto p99 = errors.begin() + static_cast<std::ptrdiff_t>(0.99 * (errors.size() - 1));
+    std::nth_element(errors.begin(), p99, errors.end());
+    stats.p99ErrorMm = *p99;
+  }
+  return stats;
+}
+
+LensTrace::RayBatch SampleDomain(const Model& model, std::size_t count, std::uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  std::uniform_real_distribution<double> wavelength(model.wavelengthMinNm,
+                                                    model.wavelengthMaxNm);
+  LensTrace::RayBatch rays;
+  rays.Resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const double u = model.maxSlope * unit(rng);
+    const double v = model.maxSlope * unit(rng);
+    const double shift = ChiefOffset(model, 1.0, u * u + v * v);
+    rays.x[i] = model.pupilRadiusMm * unit(rng) + u * shift;
+    rays.y[i] = model.pupilRadiusMm * unit(rng) + v * shift;
+    rays.dx[i] = u;
+    rays.dy[i] = v;
+    rays.dz[i] = 1.0;
+    rays.wavelengthNm[i] = wavelength(rng);
+  }
+  return rays;
+}
+
+bool Save(const std::string& path, const Model& model, std::string* errorMessage) {
+  const hid_t file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (file < 0) {
+    if (errorMessage) {
+      *errorMessage = "Failed to create " + path;
+    }
+    return false;
+  }
+  bool ok = true;
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  const hid_t text = H5Tcopy(H5T_C_S1);
+  H5Tset_size(text, H5T_VARIABLE);
+  H5Tset_cset(text, H5T_CSET_UTF8);
+  const std::pair<const char*, std::string> strings[] = {{"format", kFormat},
+                                                         {"lens_name", model.lensName},
+                                                         {"lens_zmx_path", model.zmxPath},
+                                                         {"lens_smx_path", model.smxPath}};
+  for (const auto& [name, value] : strings) {
+    const char* data = value.c_str();
+    ok = WriteAttribute(file, name, text, scalar, &data) && ok;
+  }
+  ok = WriteAttribute(file, "format_version", H5T_NATIVE_INT, scalar, &kFormatVersion) && ok;
+  ok = WriteAttribute(file, "degree", H5T_NATIVE_INT, scalar, &model.degree) && ok;
+  ok = WriteAttribute(file, "mask_degree", H5T_NATIVE_INT, scalar, &model.maskDegree) && ok;
+  const std::pair<const char*, double> numbers[] = {
+      {"pupil_radius_mm", model.pupilRadiusMm},
+      {"chief_ray_linear_mm", model.chiefRay[0]},
+      {"chief_ray_cubic_mm", model.chiefRay[1]},
+      {"max_slope", model.maxSlope},
+      {"wavelength_min_nm", model.wavelengthMinNm},
+      {"wavelength_max_nm", model.wavelengthMaxNm},
+      {"primary_wavelength_nm", model.primaryWavelengthNm},
+      {"validation_rms_error_mm", model.validation.rmsErrorMm},
+      {"validation_p99_error_mm", model.validation.p99ErrorMm},
+      {"validation_max_error_mm", model.validation.maxErrorMm}};
+  for (const auto& [name, value] : numbers) {
+    ok = WriteAttribute(file, name, H5T_NATIVE_DOUBLE, scalar, &value) && ok;
+  }
+  const std::pair<const char*, std::uint64_t> counts[] = {
+      {"validation_rays", model.validation.rays},
+      {"validation_exact_transmitted", model.validation.exactTransmitted},
+      {"validation_model_transmitted", model.validation.modelTransmitted},
+      {"validation_false_pass", model.validation.falsePass},
+      {"validation_false_block", model.validation.falseBlock}};
+  for (const auto& [name, value] : counts) {
+    ok = WriteAttribute(file, name, H5T_NATIVE_UINT64, scalar, &value) && ok;
+  }
+  H5Tclose(text);
+  H5Sclose(scalar);
+
+  const auto writeDataset = [file](const char* name, hid_t type, int rank, const hsize_t* dims,
+                                   const void* data) {
+    const hid_t space = H5Screate_simple(rank, dims, nullptr);
+    const hid_t dataset =
+        H5Dcreate2(file, name, type, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    const bool empty = H5Sget_simple_extent_npoints(space) == 0;
+    const bool written =
+        dataset >= 0 &&
+        (empty || H5Dwrite(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) >= 0);
+    if (dataset >= 0) {
+      H5Dclose(dataset);
+    }
+    H5Sclose(space);
+    return written;
+  };
+  const hsize_t exponentDims[2] = {model.Terms(), kInvariants};
+  ok = writeDataset("exponents", H5T_NATIVE_UINT8, 2, exponentDims, model.exponents.data()) &&
+       ok;
+  const hsize_t imageDims[2] = {3, model.Terms()};
+  ok = writeDataset("image_coefficients", H5T_NATIVE_DOUBLE, 2, imageDims,
+                    model.imageCoefficients.data()) &&
+       ok;
+  const hsize_t apertureDims[2] = {model.apertureSurfaces.size(), model.MaskTerms()};
+  ok = writeDataset("aperture_surfaces", H5T_NATIVE_INT, 1, apertureDims,
+                    model.apertureSurfaces.data()) &&
+       ok;
+  ok = writeDataset("aperture_coefficients", H5T_NATIVE_DOUBLE, 2, apertureDims,
+                    model.apertureCoefficients.data()) &&
+       ok;
+  ok = H5Fclose(file) >= 0 && ok;
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed writing surrogate model to " + path;
+  }
+  return ok;
+}
+
+bool Load(const std::string& path, Model* model, std::string* errorMessage) {
+  const auto fail = [errorMessage, &path](const std::string& message) {
+    if (errorMessage) {
+      *errorMessage = path + ": " + message;
+    }
+    return false;
+  };
+  if (H5Fis_hdf5(path.c_str()) <= 0) {
+    return fail("not an HDF5 file");
+  }
+  const hid_t file = H5Fopen(path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  if (file < 0) {
+    return fail("cannot open");
+  }
+  Model loaded;
+  std::string format;
+  int version = 0;
+  bool ok = ReadStringAttribute(file, "format", &format) && format == kFormat &&
+            ReadAttribute(file, "format_version", H5T_NATIVE_INT, &version) &&
+            version == kFormatVersion;
+  ok = ok && ReadAttribute(file, "degree", H5T_NATIVE_INT, &loaded.degree) &&
+       ReadAttribute(file, "mask_degree", H5T_NATIVE_INT, &loaded.maskDegree) &&
+       ReadAttribute(file, "pupil_radius_mm", H5T_NATIVE_DOUBLE, &loaded.pupilRadiusMm) &&
+       ReadAttribute(file, "chief_ray_linear_mm", H5T_NATIVE_DOUBLE, &loaded.chiefRay[0]) &&
+       ReadAttribute(file, "chief_ray_cubic_mm", H5T_NATIVE_DOUBLE, &loaded.chiefRay[1]) &&
+       ReadAttribute(file, "max_slope", H5T_NATIVE_DOUBLE, &loaded.maxSlope) &&
+       ReadAttribute(file, "wavelength_min_nm", H5T_NATIVE_DOUBLE, &loaded.wavelengthMinNm) &&
+       ReadAttribute(file, "wavelength_max_nm", H5T_NATIVE_DOUBLE, &loaded.wavelengthMaxNm) &&
+       ReadAttribute(file, "primary_wavelength_nm", H5T_NATIVE_DOUBLE,
+                     &loaded.primaryWavelengthNm);
+  if (!ok) {
+    H5Fclose(file);
+    return fail("not a g4emi lens surrogate (version " + std::to_string(kFormatVersion) + ")");
+  }
+  ReadStringAttribute(file, "lens_name", &loaded.lensName);
+  ReadStringAttribute(file, "lens_zmx_path", &loaded.zmxPath);
+  ReadStringAttribute(file, "lens_smx_path", &loaded.smxPath);
+  ReadAttribute(file, "validation_rms_error_mm", H5T_NATIVE_DOUBLE,
+                &loaded.validation.rmsErrorMm);
+  ReadAttribute(file, "validation_p99_error_mm", H5T_NATIVE_DOUBLE,
+                &loaded.validation.p99ErrorMm);
+  ReadAttribute(file, "validation_max_error_mm", H5T_NATIVE_DOUBLE,
+                &loaded.validation.maxErrorMm);
+  const std::pair<const char*, std::size_t*> counts[] = {
+      {"validation_rays", &loaded.validation.rays},
+      {"validation_exact_transmitted", &loaded.validation.exactTransmitted},
+      {"validation_model_transmitted", &loaded.validation.modelTransmitted},
+      {"validation_false_pass", &loaded.validation.falsePass},
+      {"validation_false_block", &loaded.validation.falseBlock}};
+  for (const auto& [name, value] : counts) {
+    std::uint64_t count = 0;
+    ReadAttribute(file, name, H5T_NATIVE_UINT64, &count);
+    *value = static_cast<std::size_t>(count);
+  }
+
+  // Datasets: size each from its extent, then read.
+  const auto readDataset = [file](const char* name, hid_t type, std::size_t rowWidth,
+                                  auto* out) {
+    if (H5Lexists(file, name, H5P_DEFAULT) <= 0) {
+      return false;
+    }
+    const hid_t dataset = H5Dopen2(file, name, H5P_DEFAULT);
+    const hid_t space = H5Dget_space(dataset);
+    hsize_t dims[2] = {0, 0};
+    const int rank = H5Sget_simple_extent_dims(space, dims, nullptr);
+    H5Sclose(space);
+    const std::size_t elements = rank == 2 ? dims[0] * dims[1] : rank == 1 ? dims[0] : 0;
+    out->resize(elements / rowWidth);
+    const bool read = elements % rowWidth == 0 &&
+                      (elements == 0 ||
+                       H5Dread(dataset, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, out->data()) >= 0);
+    H5Dclose(dataset);
+    return read;
+  };
+  ok = readDataset("exponents", H5T_NATIVE_UINT8, kInvariants, &loaded.exponents) &&
+       readDataset("image_coefficients", H5T_NATIVE_DOUBLE, 1, &loaded.imageCoefficients) &&
+       readDataset("aperture_surfaces", H5T_NATIVE_INT, 1, &loaded.apertureSurfaces) &&
+       readDataset("aperture_coefficients", H5T_NATIVE_DOUBLE, 1,
+                   &loaded.apertureCoefficients);
+  H5Fclose(file);
+  if (!ok) {
+    return fail("missing or unreadable model datasets");
+  }
+  const bool consistent =
+      loaded.degree >= 1 && loaded.degree <= 12 && loaded.maskDegree >= 1 &&
+      loaded.maskDegree <= loaded.degree && loaded.pupilRadiusMm > 0.0 &&
+      loaded.maxSlope > 0.0 && loaded.wavelengthMinNm > 0.0 &&
+      loaded.wavelengthMaxNm >= loaded.wavelengthMinNm &&
+      loaded.imageCoefficients.size() == 3 * loaded.Terms() &&
+      loaded.apertureCoefficients.size() ==
+          loaded.apertureSurfaces.size() * loaded.MaskTerms() &&
+      std::all_of(loaded.exponents.begin(), loaded.exponents.end(), [&loaded](const auto& e) {
+        return std::all_of(e.begin(), e.end(), [&loaded](std::uint8_t d) {
+          return d <= loaded.degree;
+        });
+      });
+  if (!consistent) {
+    return fail("inconsistent model contents");
+  }
+  *model = std::move(loaded);
+  return true;
+}
+
+void SetActiveModel(std::shared_ptr<const Model> model) {
+  std::lock_guard<std::mutex> lock(gActiveModelMutex);
+  gActiveModel = std::move(model);
+}
+
+std::shared_ptr<const Model> ActiveModel() {
+  std::lock_guard<std::mutex> lock(gActiveModelMutex);
+  return gActiveModel;
+}
+
+}  // namespace LensSurrogate
@@ -0,0 +1,516 @@
+#include "lenstrace.hh"
+
+#include "utils.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+/// Fraunhofer d, F, and C lines (um) defining nd and Vd.
+constexpr double kLambdaD = 0.5875618;
+constexpr double kLambdaF = 0.4861327;
+constexpr double kLambdaC = 0.6562725;
+
+/// Aperture slack (mm) and aspheric intersection tolerance, as in rayoptics.
+constexpr double kApertureFuzz = 1.0e-5;
+constexpr double kIntersectionTolerance = 1.0e-12;
+constexpr int kMaxIntersectionIterations = 20;
+
+/// Short names accepted in place of a bundled `.zmx` file, as in `LensModels`.
+const std::pair<const char*, const char*> kLensAliases[] = {
+    {"canon50", "CanonEF50mmf1.0L.zmx"},
+    {"canon_ef50", "CanonEF50mmf1.0L.zmx"},
+    {"nikkor80-200", "Nikkor80-200mmf2.8D.zmx"},
+    {"nikkor80_200", "Nikkor80-200mmf2.8D.zmx"},
+};
+
+std::mutex gActiveLensMutex;
+std::shared_ptr<const LensTrace::Lens> gActiveLens;
+
+std::filesystem::path RepositoryPath(const std::filesystem::path& relative) {
+#ifdef G4EMI_REPO_ROOT
+  return std::filesystem::path(G4EMI_REPO_ROOT) / relative;
+#else
+  return std::filesystem::current_path() / relative;
+#endif
+}
+
+bool IsFile(const std::filesystem::path& path) {
+  std::error_code ec;
+  return std::filesystem::is_regular_file(path, ec) && !ec;
+}
+
+// Read a prescription, folding the UTF-16LE files newer Zemax versions write
+// down to ASCII.
+bool ReadText(const std::string& path, std::string* text) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  text->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  if (text->size() >= 2 && static_cast<unsigned char>((*text)[0]) == 0xFF &&
+      static_cast<unsigned char>((*text)[1]) == 0xFE) {
+    std::string narrow;
+    narrow.reserve(text->size() / 2);
+    for (std::size_t i = 2; i + 1 < text->size(); i += 2) {
+      narrow.push_back((*text)[i]);
+    }
+    text->swap(narrow);
+  }
+  return true;
+}
+
+// `zmxFile` of the `lenses/catalog.yaml` entry keyed `id` (or of the catalog
+// default when `id` is "default"); empty when there is no such entry.
+std::string CatalogZmxFile(const std::string& id) {
+  std::ifstream in(RepositoryPath("lenses/catalog.yaml"));
+  std::string wanted = id;
+  std::string entry;
+  for (std::string line; std::getline(in, line);) {
+    const std::string trimmed = Utils::Trim(line);
+    const auto colon = trimmed.find(':');
+    if (trimmed.empty() || trimmed[0] == '#' || colon == std::string::npos) {
+      continue;
+    }
+    const std::string key = Utils::Trim(trimmed.substr(0, colon));
+    const std::string value = Utils::Unquote(Utils::Trim(trimmed.substr(colon + 1)));
+    const auto indent = line.find_first_not_of(' ');
+    if (indent == 0 && key == "default" && Utils::ToLower(id) == "default") {
+      wanted = value;
+    } else if (indent == 2) {
+      entry = key;
+    } else if (indent > 2 && key == "zmxFile" && entry == wanted) {
+      return value;
+    }
+  }
+  return "";
+}
+
+bool ParseNumber(const std::string& token, double* value) {
+  if (Utils::ToLower(token) == "infinity") {
+    *value = std::numeric_limits<double>::infinity();
+    return true;
+  }
+  char* end = nullptr;
+  *value = std::strtod(token.c_str(), &end);
+  return end != token.c_str() && *end == '\0';
+}
+
+// `.smx` files map glass names to `mg.ModelGlass(nd, vd, 'NAME')` strings.
+std::map<std::string, std::pair<double, double>> ReadModelGlasses(const std::string& text) {
+  std::map<std::string, std::pair<double, double>> glasses;
+  std::istringstream lines(text);
+  for (std::string line; std::getline(lines, line);) {
+    const auto keyStart = line.find('"');
+    const auto keyEnd = keyStart == std::string::npos ? keyStart : line.find('"', keyStart + 1);
+    const auto args = line.find("ModelGlass(");
+    if (keyEnd == std::string::npos || args == std::string::npos) {
+      continue;
+    }
+    std::string values = line.substr(args + 11);
+    std::replace(values.begin(), values.end(), ',', ' ');
+    std::istringstream stream(values);
+    double nd = 0.0;
+    double vd = 0.0;
+    if (stream >> nd >> vd) {
+      glasses[line.substr(keyStart + 1, keyEnd - keyStart - 1)] = {nd, vd};
+    }
+  }
+  return glasses;
+}
+
+// Two-term Cauchy fit n = A + B / lambda^2 through nd and nF - nC = (nd - 1) / Vd.
+void FitIndex(double nd, double vd, LensTrace::Surface* surface) {
+  surface->indexB = 0.0;
+  if (vd > 0.0) {
+    surface->indexB = (nd - 1.0) / vd /
+                      (1.0 / (kLambdaF * kLambdaF) - 1.0 / (kLambdaC * kLambdaC));
+  }
+  surface->indexA = nd - surface->indexB / (kLambdaD * kLambdaD);
+}
+
+// Move a ray from the previous vertex frame onto `surface`; false when it misses.
+bool Intersect(const LensTrace::Surface& surface,
+               double dx,
+               double dy,
+               double dz,
+               double* x,
+               double* y,
+               double* z,
+               double* nx,
+               double* ny,
+               double* nz) {
+  const double c = surface.curvature;
+  const double k1 = 1.0 + surface.conic;
+  if (!surface.aspheric) {
+    // Roots of c(x^2 + y^2 + (1+k) z^2) - 2z = 0 along the ray; this form
+    // picks the one nearest the vertex and stays exact as c -> 0.
+    const double f = c * (*x * *x + *y * *y + k1 * *z * *z) - 2.0 * *z;
+    const double b = c * (*x * dx + *y * dy + k1 * *z * dz) - dz;
+    const double a = c * (1.0 + surface.conic * dz * dz);
+    const double disc = b * b - a * f;
+    if (disc < 0.0) {
+      return false;
+    }
+    const double denominator = b + std::copysign(std::sqrt(disc), b);
+    if (denominator == 0.0) {
+      return false;
+    }
+    const double s = -f / denominator;
+    *x += s * dx;
+    *y += s * dy;
+    *z += s * dz;
+    *nx = -c * *x;
+    *ny = -c * *y;
+    *nz = 1.0 - c * k1 * *z;
+  } else {
+    // Newton iteration on z - sag(r^2) from the vertex-plane crossing.
+    const double s0 = -*z / dz;
+    *x += s0 * dx;
+    *y += s0 * dy;
+    *z = 0.0;
+    const auto& a = surface.asphere;
+    double slope = 0.0;
+    for (int i = 0;; ++i) {
+      const double rho = *x * *x + *y * *y;
+      const double root = 1.0 - k1 * c * c * rho;
+      if (root <= 0.0) {
+        return false;
+      }
+      const double sq = std::sqrt(root);
+      double poly = 0.0;
+      double dpoly = 0.0;
+      for (std::size_t j = a.size(); j-- > 0;) {
+        poly = poly * rho + a[j];
+        dpoly = dpoly * rho + static_cast<double>(j + 1) * a[j];
+      }
+      const double sag = c * rho / (1.0 + sq) + poly * rho;
+      slope = 0.5 * c / sq + dpoly;
+      const double g = *z - sag;
+      if (std::abs(g) < kIntersectionTolerance) {
+        break;
+      }
+      if (i == kMaxIntersectionIterations) {
+        return false;
+      }
+      const double dg = dz - 2.0 * slope * (*x * dx + *y * dy);
+      if (dg == 0.0) {
+        return false;
+      }
+      const double step = g / dg;
+      *x -= step * dx;
+      *y -= step * dy;
+      *z -= step * dz;
+    }
+    *nx = -2.0 * slope * *x;
+    *ny = -2.0 * slope * *y;
+    *nz = 1.0;
+  }
+  const double norm = std::sqrt(*nx * *nx + *ny * *ny + *nz * *nz);
+  *nx /= norm;
+  *ny /= norm;
+  *nz /= norm;
+  return std::isfinite(*x) && std::isfinite(*y) && std::isfinite(*z);
+}
+
+// Shared surface loop. With `apertureUse` null rays are clipped at each
+// semi-diameter; otherwise nothing is clipped and r / semiDiameter at every
+// apertured surface is stored instead.
+void TraceImpl(const LensTrace::Lens& lens, LensTrace::RayBatch* batch, double* apertureUse) {
+  auto& rays = *batch;
+  const std::size_t n = rays.Size();
+  const auto& surfaces = lens.surfaces;
+
+  // Per-ray 1/lambda^2 and the index of the medium the ray is in.
+  std::vector<double> inverseLambda2(n);
+  std::vector<double> index(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    double norm = std::sqrt(rays.dx[i] * rays.dx[i] + rays.dy[i] * rays.dy[i] +
+                            rays.dz[i] * rays.dz[i]);
+    rays.valid[i] = std::isfinite(rays.x[i]) && std::isfinite(rays.y[i]) &&
+                    std::isfinite(norm) && norm > 0.0;
+    // Travel toward the image whichever way the interface hit pointed.
+    norm = rays.dz[i] < 0.0 ? -norm : norm;
+    rays.dx[i] /= norm;
+    rays.dy[i] /= norm;
+    rays.dz[i] /= norm;
+    rays.z[i] = 0.0;
+    const double lambda = rays.wavelengthNm[i] > 0.0 ? rays.wavelengthNm[i]
+                                                      : lens.primaryWavelengthNm;
+    inverseLambda2[i] = 1.0e6 / (lambda * lambda);
+    index[i] = surfaces[0].indexA + surfaces[0].indexB * inverseLambda2[i];
+  }
+
+  // One pass per surface keeps each surface's constants in registers across
+  // the whole batch.
+  for (std::size_t s = 1; s < surfaces.size(); ++s) {
+    const auto& surface = surfaces[s];
+    // The object gap is rebased to zero: rays start on surface 1's vertex plane.
+    const double gap = s == 1 ? 0.0 : surfaces[s - 1].thickness;
+    const bool image = s + 1 == surfaces.size();
+    const double clip = surface.semiDiameter > 0.0 ? surface.semiDiameter + kApertureFuzz
+                                                   : std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!rays.valid[i]) {
+        continue;
+      }
+      double x = rays.x[i];
+      double y = rays.y[i];
+      double z = rays.z[i] - gap;
+      double dx = rays.dx[i];
+      double dy = rays.dy[i];
+      double dz = rays.dz[i];
+      double nx = 0.0;
+      double ny = 0.0;
+      double nz = 0.0;
+      if (!Intersect(surface, dx, dy, dz, &x, &y, &z, &nx, &ny, &nz)) {
+        rays.valid[i] = 0;
+        continue;
+      }
+      if (apertureUse) {
+        if (surface.semiDiameter > 0.0) {
+          apertureUse[s * n + i] = std::sqrt(x * x + y * y) / surface.semiDiameter;
+        }
+      } else if (x * x + y * y > clip * clip) {
+        rays.valid[i] = 0;
+        continue;
+      }
+      rays.x[i] = x;
+      rays.y[i] = y;
+      rays.z[i] = z;
+      if (image) {
+        continue;
+      }
+
+      // Vector Snell's law; a negative radicand is total internal reflection.
+      const double after = surface.indexA + surface.indexB * inverseLambda2[i];
+      const double mu = index[i] / after;
+      double cosI = nx * dx + ny * dy + nz * dz;
+      if (cosI < 0.0) {
+        nx = -nx;
+        ny = -ny;
+        nz = -nz;
+        cosI = -cosI;
+      }
+      const double radicand = 1.0 - mu * mu * (1.0 - cosI * cosI);
+      if (radicand < 0.0) {
+        rays.valid[i] = 0;
+        continue;
+      }
+      const double g = std::sqrt(radicand) - mu * cosI;
+      rays.dx[i] = mu * dx + g * nx;
+      rays.dy[i] = mu * dy + g * ny;
+      rays.dz[i] = mu * dz + g * nz;
+      index[i] = after;
+    }
+  }
+}
+}  // namespace
+
+namespace LensTrace {
+
+void RayBatch::Resize(std::size_t n) {
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  dx.resize(n);
+  dy.resize(n);
+  dz.resize(n);
+  wavelengthNm.resize(n);
+  valid.resize(n);
+}
+
+std::string ResolveZmxPath(const std::string& value) {
+  std::string name = Utils::Unquote(Utils::Trim(value));
+  const std::string alias = Utils::ToLower(name);
+  for (const auto& [token, file] : kLensAliases) {
+    if (alias == token) {
+      name = file;
+    }
+  }
+  if (const std::string catalogFile = CatalogZmxFile(name); !catalogFile.empty()) {
+    name = catalogFile;
+  }
+  const std::filesystem::path candidate(name);
+  const std::filesystem::path zmxDir = RepositoryPath("lenses/zmxFiles");
+  for (const auto& path : {candidate, RepositoryPath(candidate), zmxDir / candidate,
+                           zmxDir / (candidate.filename().string() + ".zmx")}) {
+    if (IsFile(path)) {
+      return std::filesystem::absolute(path).lexically_normal().string();
+    }
+  }
+  return "";
+}
+
+std::string ResolveSmxPath(const std::string& zmxPath) {
+  const std::filesystem::path zmx(zmxPath);
+  std::filesystem::path candidate = zmx;
+  candidate.replace_extension(".smx");
+  if (IsFile(candidate)) {
+    return candidate.string();
+  }
+  candidate = RepositoryPath("lenses/smxFiles") / (zmx.stem().string() + ".smx");
+  return IsFile(candidate) ? candidate.lexically_normal().string() : "";
+}
+
+bool Load(const std::string& zmxPath,
+          const std::string& smxPath,
+          Lens* lens,
+          std::string* errorMessage) {
+  const auto fail = [errorMessage, &zmxPath](const std::string& message) {
+    if (errorMessage) {
+      *errorMessage = zmxPath + ": " + message;
+    }
+    return false;
+  };
+
+  std::string text;
+  if (!ReadText(zmxPath, &text)) {
+    return fail("cannot read lens file");
+  }
+  std::map<std::string, std::pair<double, double>> modelGlasses;
+  if (!smxPath.empty()) {
+    std::string smx;
+    if (!ReadText(smxPath, &smx)) {
+      return fail("cannot read glass file " + smxPath);
+    }
+    modelGlasses = ReadModelGlasses(smx);
+  }
+
+  Lens parsed;
+  parsed.name = std::filesystem::path(zmxPath).stem().string();
+  parsed.zmxPath = zmxPath;
+  parsed.smxPath = smxPath;
+  std::map<int, double> wavelengths;
+  int primaryWavelength = 0;
+
+  std::istringstream lines(text);
+  for (std::string line; std::getline(lines, line);) {
+    std::istringstream stream(line);
+    std::vector<std::string> tokens{std::istream_iterator<std::string>(stream),
+                                    std::istream_iterator<std::string>()};
+    if (tokens.empty()) {
+      continue;
+    }
+    const std::string& key = tokens[0];
+    double value = 0.0;
+    if (key == "UNIT") {
+      if (tokens.size() < 2 || Utils::ToLower(tokens[1]) != "mm") {
+        return fail("only UNIT MM prescriptions are supported");
+      }
+    } else if (key == "WAVM" && tokens.size() >= 4) {
+      double weight = 0.0;
+      if (ParseNumber(tokens[2], &value) && ParseNumber(tokens[3], &weight) &&
+          weight > 0.0) {
+        wavelengths[std::atoi(tokens[1].c_str())] = value * 1000.0;
+      }
+    } else if (key == "PWAV" && tokens.size() >= 2) {
+      primaryWavelength = std::atoi(tokens[1].c_str());
+    } else if (key == "SURF") {
+      parsed.surfaces.emplace_back();
+    }
+    if (parsed.surfaces.empty() || key == "SURF") {
+      continue;
+    }
+
+    auto& surface = parsed.surfaces.back();
+    if (key == "TYPE") {
+      if (tokens.size() < 2 || (tokens[1] != "STANDARD" && tokens[1] != "EVENASPH")) {
+        return fail("unsupported surface type '" + (tokens.size() > 1 ? tokens[1] : "") +
+                    "' on surface " + std::to_string(parsed.surfaces.size() - 1));
+      }
+      surface.aspheric = tokens[1] == "EVENASPH";
+    } else if (key == "CURV" && tokens.size() >= 2 && ParseNumber(tokens[1], &value)) {
+      surface.curvature = value;
+    } else if (key == "CONI" && tokens.size() >= 2 && ParseNumber(tokens[1], &value)) {
+      surface.conic = value;
+    } else if (key == "PARM" && tokens.size() >= 3 && ParseNumber(tokens[2], &value)) {
+      const int term = std::atoi(tokens[1].c_str());
+      if (term >= 1 && term <= static_cast<int>(surface.asphere.size())) {
+        surface.asphere[term - 1] = value;
+      }
+    } else if (key == "DISZ" && tokens.size() >= 2 && ParseNumber(tokens[1], &value)) {
+      surface.thickness = value;
+    } else if (key == "DIAM" && tokens.size() >= 2 && ParseNumber(tokens[1], &value)) {
+      surface.semiDiameter = value;
+    } else if (key == "STOP") {
+      surface.stop = true;
+    } else if (key == "GLAS" && tokens.size() >= 2) {
+      surface.glass = tokens[1];
+      if (Utils::ToLower(surface.glass) == "mirror") {
+        return fail("mirror surfaces are not supported");
+      }
+      double nd = 0.0;
+      double vd = 0.0;
+      const auto model = modelGlasses.find(surface.glass);
+      if (model != modelGlasses.end()) {
+        nd = model->second.first;
+        vd = model->second.second;
+      } else if (tokens.size() < 6 || !ParseNumber(tokens[4], &nd) ||
+                 !ParseNumber(tokens[5], &vd) || nd <= 1.0) {
+        return fail("glass '" + surface.glass + "' has no nd/Vd in the lens file");
+      }
+      FitIndex(nd, vd, &surface);
+    }
+  }
+
+  if (parsed.surfaces.size() < 2) {
+    return fail("no surfaces found");
+  }
+  for (std::size_t i = 1; i + 1 < parsed.surfaces.size(); ++i) {
+    if (!std::isfinite(parsed.surfaces[i].thickness)) {
+      return fail("infinite spacing after surface " + std::to_string(i));
+    }
+  }
+  // Surfaces are traced as even aspheres only when they carry terms.
+  for (auto& surface : parsed.surfaces) {
+    surface.aspheric =
+        surface.aspheric && std::any_of(surface.asphere.begin(), surface.asphere.end(),
+                                        [](double term) { return term != 0.0; });
+  }
+  for (const auto& [index, wavelength] : wavelengths) {
+    if (std::find(parsed.wavelengthsNm.begin(), parsed.wavelengthsNm.end(), wavelength) ==
+        parsed.wavelengthsNm.end()) {
+      parsed.wavelengthsNm.push_back(wavelength);
+    }
+  }
+  const auto primary = wavelengths.find(primaryWavelength);
+  if (primary != wavelengths.end()) {
+    parsed.primaryWavelengthNm = primary->second;
+  } else if (!parsed.wavelengthsNm.empty()) {
+    parsed.primaryWavelengthNm = parsed.wavelengthsNm.front();
+  }
+
+  *lens = std::move(parsed);
+  return true;
+}
+
+void Trace(const Lens& lens, RayBatch* batch) { TraceImpl(lens, batch, nullptr); }
+
+void TraceUnclipped(const Lens& lens, RayBatch* batch, std::vector<double>* apertureUse) {
+  apertureUse->assign(lens.surfaces.size() * batch->Size(),
+                      std::numeric_limits<double>::quiet_NaN());
+  TraceImpl(lens, batch, apertureUse->data());
+}
+
+void SetActiveLens(std::shared_ptr<const Lens> lens) {
+  std::lock_guard<std::mutex> lock(gActiveLensMutex);
+  gActiveLens = std::move(lens);
+}
+
+std::shared_ptr<const Lens> ActiveLens() {
+  std::lock_guard<std::mutex> lock(gActiveLensMutex);
+  return gActiveLens;
+}
+
+}  // namespace LensTrace
@@ -1,10 +1,20 @@
 #include "messenger.hh"
 
+#include "PhysicsList.hh"
+#include "SimIO.hh"
+#include "affinity.hh"
 #include "config.hh"
+#include "lenstrace.hh"
+#include "outputsink.hh"
+#include "utils.hh"
 
 #include "G4ApplicationState.hh"
+#include "G4Exception.hh"
+#include "G4MTRunManager.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
+#include "G4UIcmdWithABool.hh"
 #include "G4UIcmdWithADouble.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh"
 #include "G4UIcmdWithAnInteger.hh"
@@ -15,6 +25,7 @@
 #include "G4ios.hh"
 
 #include <algorithm>
+#include <filesystem>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -77,6 +88,15 @@ bool ParseListWithOptionalUnit(const G4String& rawValue,
   }
   return true;
 }
+
+// Warn about a rejected value and fail `command`, so batch macros stop
+// instead of running on with the previous setting.
+void RejectValue(G4UIcommand* command, const char* code, const std::string& message) {
+  G4ExceptionDescription description;
+  description << message;
+  G4Exception("Messenger::SetNewValue", code, JustWarning, description);
+  command->CommandFailed(description);
+}
 }  // namespace
 
 Messenger::Messenger(Config* config) : fConfig(config) {
@@ -98,6 +118,37 @@ Messenger::Messenger(Config* config) : fConfig(config) {
   fOutputDir = new G4UIdirectory("/output/");
   fOutputDir->SetGuidance("Output controls");
 
+  fG4emiDir = new G4UIdirectory("/g4emi/");
+  fG4emiDir->SetGuidance("g4emi application controls");
+
+  fPhysicsDir = new G4UIdirectory("/g4emi/physics/");
+  fPhysicsDir->SetGuidance("Physics-list controls");
+
+  fRunDir = new G4UIdirectory("/g4emi/run/");
+  fRunDir->SetGuidance("Run-manager threading and event-dispatch controls");
+
+  fProfileDir = new G4UIdirectory("/g4emi/profile/");
+  fProfileDir->SetGuidance("Profiling controls");
+
+  fTriggerDir = new G4UIdirectory("/g4emi/trigger/");
+  fTriggerDir->SetGuidance("Event trigger applied before output rows are written");
+
+  fImageDir = new G4UIdirectory("/output/image/");
+  fImageDir->SetGuidance("Interface-hit image binning for /output/mode images|both");
+
+  fTimingDir = new G4UIdirectory("/output/timing/");
+  fTimingDir->SetGuidance("Per-species photon timing histograms written to /histograms/timing");
+
+  fTransportDir = new G4UIdirectory("/output/transport/");
+  fTransportDir->SetGuidance("In-process lens transport written to /transported_photons");
+
+  fShmDir = new G4UIdirectory("/output/shm/");
+  fShmDir->SetGuidance("Shared-memory ring of the shm output sink (/output/sink)");
+  fRawDir = new G4UIdirectory("/output/raw/");
+  fRawDir->SetGuidance("Flat row files of the raw output sink (/output/sink)");
+  fSwmrDir = new G4UIdirectory("/output/swmr/");
+  fSwmrDir->SetGuidance("Live reading of the HDF5 rows while a run writes them (SWMR)");
+
   fGeomMaterialCmd = new G4UIcmdWithAString("/scintillator/geom/material", this);
   fGeomMaterialCmd->SetGuidance("Set scintillator material name (EJ200 or NIST name)");
   fGeomMaterialCmd->SetParameterName("material", false);
@@ -299,9 +350,381 @@ Messenger::Messenger(Config* config) : fConfig(config) {
       "Set optional run name; outputs go under <output/path>/<runname>/ when path is set, otherwise data/<runname>/. Use \"\" to clear.");
   fOutputRunNameCmd->SetParameterName("runname", false);
   fOutputRunNameCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fOutputPhotonFieldsCmd = new G4UIcmdWithAString("/output/photonFields", this);
+  fOutputPhotonFieldsCmd->SetGuidance(
+      "Select /photons columns: presets minimal, transport, full (default), and/or groups creation_time, origin, scint_exit, hit_position, hit_time, direction, polarization, energy, wavelength. Track-ID columns are always written.");
+  fOutputPhotonFieldsCmd->SetParameterName("fields", false);
+  fOutputPhotonFieldsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fOutputModeCmd = new G4UIcmdWithAString("/output/mode", this);
+  fOutputModeCmd->SetGuidance(
+      "Select interface output: rows (default) writes /photons hit rows, images accumulates /images histograms without hit rows, both writes both.");
+  fOutputModeCmd->SetParameterName("mode", false);
+  fOutputModeCmd->SetCandidates("rows images both");
+  fOutputModeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fOutputSinkCmd = new G4UIcmdWithAString("/output/sink", this);
+  fOutputSinkCmd->SetGuidance(
+      "Select where accepted events' rows go, one or more of: hdf5 (default) appends /primaries, /secondaries, /photons, /transported_photons to the HDF5 file; shm publishes /photons batches to the /output/shm/* ring; raw appends native rows to flat files indexed by an HDF5 file (/output/raw/*); histogram fills /histograms/photons; null discards rows.");
+  fOutputSinkCmd->SetParameterName("sinks", false);
+  fOutputSinkCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageBinsXCmd = new G4UIcmdWithAnInteger("/output/image/binsX", this);
+  fImageBinsXCmd->SetGuidance("Set the number of image bins along X (default 256)");
+  fImageBinsXCmd->SetParameterName("bins", false);
+  fImageBinsXCmd->SetRange("bins >= 1");
+  fImageBinsXCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageBinsYCmd = new G4UIcmdWithAnInteger("/output/image/binsY", this);
+  fImageBinsYCmd->SetGuidance("Set the number of image bins along Y (default 256)");
+  fImageBinsYCmd->SetParameterName("bins", false);
+  fImageBinsYCmd->SetRange("bins >= 1");
+  fImageBinsYCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageXMinCmd = new G4UIcmdWithADoubleAndUnit("/output/image/xMin", this);
+  fImageXMinCmd->SetGuidance(
+      "Set the image lower X edge in world coordinates (the interface face is used while xMax <= xMin)");
+  fImageXMinCmd->SetParameterName("x", false);
+  fImageXMinCmd->SetUnitCategory("Length");
+  fImageXMinCmd->SetDefaultUnit("mm");
+  fImageXMinCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageXMaxCmd = new G4UIcmdWithADoubleAndUnit("/output/image/xMax", this);
+  fImageXMaxCmd->SetGuidance("Set the image upper X edge in world coordinates");
+  fImageXMaxCmd->SetParameterName("x", false);
+  fImageXMaxCmd->SetUnitCategory("Length");
+  fImageXMaxCmd->SetDefaultUnit("mm");
+  fImageXMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageYMinCmd = new G4UIcmdWithADoubleAndUnit("/output/image/yMin", this);
+  fImageYMinCmd->SetGuidance(
+      "Set the image lower Y edge in world coordinates (the interface face is used while yMax <= yMin)");
+  fImageYMinCmd->SetParameterName("y", false);
+  fImageYMinCmd->SetUnitCategory("Length");
+  fImageYMinCmd->SetDefaultUnit("mm");
+  fImageYMinCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageYMaxCmd = new G4UIcmdWithADoubleAndUnit("/output/image/yMax", this);
+  fImageYMaxCmd->SetGuidance("Set the image upper Y edge in world coordinates");
+  fImageYMaxCmd->SetParameterName("y", false);
+  fImageYMaxCmd->SetUnitCategory("Length");
+  fImageYMaxCmd->SetDefaultUnit("mm");
+  fImageYMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageTimeBinsCmd = new G4UIcmdWithAnInteger("/output/image/timeBins", this);
+  fImageTimeBinsCmd->SetGuidance(
+      "Set the number of /images/xyt time slices; 0 (default) writes only /images/xy");
+  fImageTimeBinsCmd->SetParameterName("bins", false);
+  fImageTimeBinsCmd->SetRange("bins >= 0");
+  fImageTimeBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageTimeMinCmd = new G4UIcmdWithADoubleAndUnit("/output/image/timeMin", this);
+  fImageTimeMinCmd->SetGuidance("Set the start of the /images/xyt interface-hit time range");
+  fImageTimeMinCmd->SetParameterName("time", false);
+  fImageTimeMinCmd->SetUnitCategory("Time");
+  fImageTimeMinCmd->SetDefaultUnit("ns");
+  fImageTimeMinCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fImageTimeMaxCmd = new G4UIcmdWithADoubleAndUnit("/output/image/timeMax", this);
+  fImageTimeMaxCmd->SetGuidance("Set the end of the /images/xyt interface-hit time range");
+  fImageTimeMaxCmd->SetParameterName("time", false);
+  fImageTimeMaxCmd->SetUnitCategory("Time");
+  fImageTimeMaxCmd->SetDefaultUnit("ns");
+  fImageTimeMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTimingBinsCmd = new G4UIcmdWithAnInteger("/output/timing/bins", this);
+  fTimingBinsCmd->SetGuidance(
+      "Set bins per creation-delay and arrival-time histogram; 0 (default) disables timing histograms");
+  fTimingBinsCmd->SetParameterName("bins", false);
+  fTimingBinsCmd->SetRange("bins >= 0");
+  fTimingBinsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTimingDelayMaxCmd = new G4UIcmdWithADoubleAndUnit("/output/timing/delayMax", this);
+  fTimingDelayMaxCmd->SetGuidance(
+      "Set the upper edge of the photon creation-delay histograms (default 200 ns)");
+  fTimingDelayMaxCmd->SetParameterName("time", false);
+  fTimingDelayMaxCmd->SetUnitCategory("Time");
+  fTimingDelayMaxCmd->SetDefaultUnit("ns");
+  fTimingDelayMaxCmd->SetRange("time > 0.");
+  fTimingDelayMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTimingArrivalMaxCmd = new G4UIcmdWithADoubleAndUnit("/output/timing/arrivalMax", this);
+  fTimingArrivalMaxCmd->SetGuidance(
+      "Set the upper edge of the interface-arrival time histograms (default 200 ns)");
+  fTimingArrivalMaxCmd->SetParameterName("time", false);
+  fTimingArrivalMaxCmd->SetUnitCategory("Time");
+  fTimingArrivalMaxCmd->SetDefaultUnit("ns");
+  fTimingArrivalMaxCmd->SetRange("time > 0.");
+  fTimingArrivalMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportLensCmd = new G4UIcmdWithAString("/output/transport/lens", this);
+  fTransportLensCmd->SetGuidance(
+      "Trace detected photons through this .zmx lens (path, lenses/zmxFiles name, or alias) into /transported_photons. Use \"\" to disable.");
+  fTransportLensCmd->SetParameterName("lens", false);
+  fTransportLensCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportSmxCmd = new G4UIcmdWithAString("/output/transport/smx", this);
+  fTransportSmxCmd->SetGuidance(
+      "Set the .smx glass overrides for the transport lens; \"\" (default) uses the .smx matching the lens file");
+  fTransportSmxCmd->SetParameterName("smx", false);
+  fTransportSmxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportSurrogateCmd = new G4UIcmdWithAString("/output/transport/surrogate", this);
+  fTransportSurrogateCmd->SetGuidance(
+      "Transport with this g4emi_lenssurrogate model file instead of tracing the lens exactly; \"\" (default) traces /output/transport/lens");
+  fTransportSurrogateCmd->SetParameterName("model", false);
+  fTransportSurrogateCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportScreenDiameterCmd =
+      new G4UIcmdWithADoubleAndUnit("/output/transport/screenDiameter", this);
+  fTransportScreenDiameterCmd->SetGuidance(
+      "Set the intensifier input-screen diameter used for in_bounds; 0 (default) marks every hit in bounds");
+  fTransportScreenDiameterCmd->SetParameterName("diameter", false);
+  fTransportScreenDiameterCmd->SetUnitCategory("Length");
+  fTransportScreenDiameterCmd->SetDefaultUnit("mm");
+  fTransportScreenDiameterCmd->SetRange("diameter >= 0.");
+  fTransportScreenDiameterCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportScreenCenterXCmd =
+      new G4UIcmdWithADoubleAndUnit("/output/transport/screenCenterX", this);
+  fTransportScreenCenterXCmd->SetGuidance("Set the intensifier input-screen center X in the image plane");
+  fTransportScreenCenterXCmd->SetParameterName("x", false);
+  fTransportScreenCenterXCmd->SetUnitCategory("Length");
+  fTransportScreenCenterXCmd->SetDefaultUnit("mm");
+  fTransportScreenCenterXCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTransportScreenCenterYCmd =
+      new G4UIcmdWithADoubleAndUnit("/output/transport/screenCenterY", this);
+  fTransportScreenCenterYCmd->SetGuidance("Set the intensifier input-screen center Y in the image plane");
+  fTransportScreenCenterYCmd->SetParameterName("y", false);
+  fTransportScreenCenterYCmd->SetUnitCategory("Length");
+  fTransportScreenCenterYCmd->SetDefaultUnit("mm");
+  fTransportScreenCenterYCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fShmNameCmd = new G4UIcmdWithAString("/output/shm/name", this);
+  fShmNameCmd->SetGuidance(
+      "Set the shm_open name of the ring the shm output sink publishes to (default /g4emi_photons)");
+  fShmNameCmd->SetParameterName("name", false);
+  fShmNameCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fShmSizeCmd = new G4UIcmdWithAnInteger("/output/shm/sizeMB", this);
+  fShmSizeCmd->SetGuidance(
+      "Set the ring data size in MiB, rounded up to a power of two (default 64)");
+  fShmSizeCmd->SetParameterName("size", false);
+  fShmSizeCmd->SetRange("size >= 1");
+  fShmSizeCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fShmPolicyCmd = new G4UIcmdWithAString("/output/shm/policy", this);
+  fShmPolicyCmd->SetGuidance(
+      "When readers holding a slot fall a full ring behind: block (default) waits for them, drop discards the event's batch");
+  fShmPolicyCmd->SetParameterName("policy", false);
+  fShmPolicyCmd->SetCandidates("block drop");
+  fShmPolicyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fShmBlockTimeoutCmd = new G4UIcmdWithADoubleAndUnit("/output/shm/blockTimeout", this);
+  fShmBlockTimeoutCmd->SetGuidance(
+      "Drop a batch after waiting this long for readers under policy block; 0 (default) waits while readers live");
+  fShmBlockTimeoutCmd->SetParameterName("timeout", false);
+  fShmBlockTimeoutCmd->SetUnitCategory("Time");
+  fShmBlockTimeoutCmd->SetDefaultUnit("ms");
+  fShmBlockTimeoutCmd->SetRange("timeout >= 0.");
+  fShmBlockTimeoutCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fRawDirectoryCmd = new G4UIcmdWithAString("/output/raw/directory", this);
+  fRawDirectoryCmd->SetGuidance(
+      "Set the directory for the raw sink's row files and index.h5; \"\" (default) uses <HDF5 file stem>_raw next to the HDF5 file");
+  fRawDirectoryCmd->SetParameterName("dir", false);
+  fRawDirectoryCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fRawBufferCmd = new G4UIcmdWithAnInteger("/output/raw/bufferMB", this);
+  fRawBufferCmd->SetGuidance("Set the write buffer per raw row file in MiB (default 8)");
+  fRawBufferCmd->SetParameterName("size", false);
+  fRawBufferCmd->SetRange("size >= 1");
+  fRawBufferCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fRawDirectCmd = new G4UIcmdWithABool("/output/raw/direct", this);
+  fRawDirectCmd->SetGuidance(
+      "Write raw row files with O_DIRECT, bypassing the page cache (default false); file systems without O_DIRECT fall back to buffered writes");
+  fRawDirectCmd->SetParameterName("direct", false);
+  fRawDirectCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fSwmrEnableCmd = new G4UIcmdWithABool("/output/swmr/enable", this);
+  fSwmrEnableCmd->SetGuidance(
+      "Write the HDF5 rows in SWMR mode so readers can open the file during a run (default false); needs HDF5 >= 1.10 to read");
+  fSwmrEnableCmd->SetParameterName("enable", false);
+  fSwmrEnableCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fSwmrFlushIntervalCmd = new G4UIcmdWithADoubleAndUnit("/output/swmr/flushInterval", this);
+  fSwmrFlushIntervalCmd->SetGuidance(
+      "Set the shortest time between flushes that make appended rows visible to SWMR readers (default 1 s); 0 flushes every event");
+  fSwmrFlushIntervalCmd->SetParameterName("interval", false);
+  fSwmrFlushIntervalCmd->SetUnitCategory("Time");
+  fSwmrFlushIntervalCmd->SetDefaultUnit("s");
+  fSwmrFlushIntervalCmd->SetRange("interval >= 0.");
+  fSwmrFlushIntervalCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fPhysicsTableCacheDirCmd = new G4UIcmdWithAString("/g4emi/physics/tableCacheDir", this);
+  fPhysicsTableCacheDirCmd->SetGuidance(
+      "Set physics-table cache directory; tables are stored after the first run and retrieved by later runs with the same physics list, materials, and cuts. Use \"\" to disable.");
+  fPhysicsTableCacheDirCmd->SetParameterName("dir", false);
+  fPhysicsTableCacheDirCmd->AvailableForStates(G4State_PreInit);
+
+  fRunThreadsCmd = new G4UIcmdWithAnInteger("/g4emi/run/threads", this);
+  fRunThreadsCmd->SetGuidance(
+      "Set number of worker threads (0 uses every available core). Ignored by the serial backend.");
+  fRunThreadsCmd->SetParameterName("threads", false);
+  fRunThreadsCmd->SetRange("threads >= 0");
+  fRunThreadsCmd->AvailableForStates(G4State_PreInit);
+
+  fRunEventsPerTaskCmd = new G4UIcmdWithAnInteger("/g4emi/run/eventsPerTask", this);
+  fRunEventsPerTaskCmd->SetGuidance(
+      "Set events handed to a worker per task (tasking) or per seed batch (mt). 0 restores the Geant4 heuristic.");
+  fRunEventsPerTaskCmd->SetParameterName("eventsPerTask", false);
+  fRunEventsPerTaskCmd->SetRange("eventsPerTask >= 0");
+  fRunEventsPerTaskCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fRunTaskingBackendCmd = new G4UIcmdWithAString("/g4emi/run/taskingBackend", this);
+  fRunTaskingBackendCmd->SetGuidance(
+      "Select the run-manager backend. Read before the run manager is created, so it must appear on the command line (-b) or in the top-level macro.");
+  fRunTaskingBackendCmd->SetParameterName("backend", false);
+#ifdef G4EMI_WITH_SUBEVENT
+  fRunTaskingBackendCmd->SetCandidates("default tasking tbb mt serial subevent");
+#else
+  fRunTaskingBackendCmd->SetCandidates("default tasking tbb mt serial");
+#endif
+  fRunTaskingBackendCmd->AvailableForStates(G4State_PreInit);
+
+  fRunPhotonsPerSubEventCmd = new G4UIcmdWithAnInteger("/g4emi/run/photonsPerSubEvent", this);
+  fRunPhotonsPerSubEventCmd->SetGuidance(
+      "Set optical photons per sub-event for the subevent backend. Read at startup like taskingBackend.");
+  fRunPhotonsPerSubEventCmd->SetParameterName("photons", false);
+  fRunPhotonsPerSubEventCmd->SetRange("photons > 0");
+  fRunPhotonsPerSubEventCmd->AvailableForStates(G4State_PreInit);
+
+  fRunPinThreadsCmd = new G4UIcmdWithAString("/g4emi/run/pinThreads", this);
+  fRunPinThreadsCmd->SetGuidance(
+      "Pin worker threads at start: none, compact (fill one NUMA node first), scatter (alternate nodes), or a CPU list such as 0,2,8-15.");
+  fRunPinThreadsCmd->SetParameterName("policy", false);
+  fRunPinThreadsCmd->AvailableForStates(G4State_PreInit);
+
+  fRunProgressFileCmd = new G4UIcmdWithAString("/g4emi/run/progressFile", this);
+  fRunProgressFileCmd->SetGuidance(
+      "Append one JSON progress snapshot per interval to this file during each run (events, photons, rows, bytes, rate, ETA). Use \"\" to disable.");
+  fRunProgressFileCmd->SetParameterName("path", false);
+  fRunProgressFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fRunProgressIntervalCmd =
+      new G4UIcmdWithADoubleAndUnit("/g4emi/run/progressInterval", this);
+  fRunProgressIntervalCmd->SetGuidance("Set the time between progress-file snapshots");
+  fRunProgressIntervalCmd->SetParameterName("interval", false);
+  fRunProgressIntervalCmd->SetUnitCategory("Time");
+  fRunProgressIntervalCmd->SetDefaultUnit("s");
+  fRunProgressIntervalCmd->SetRange("interval > 0.");
+  fRunProgressIntervalCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fProfileStepsCmd = new G4UIcmdWithAnInteger("/g4emi/profile/steps", this);
+  fProfileStepsCmd->SetGuidance(
+      "Profile step time by particle, process, and volume, sampling every Nth step (1 profiles every step, 0 disables). Results are printed and written to /profile at end of run.");
+  fProfileStepsCmd->SetParameterName("sampleEvery", false);
+  fProfileStepsCmd->SetRange("sampleEvery >= 0");
+  fProfileStepsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fProfileTraceFileCmd = new G4UIcmdWithAString("/g4emi/profile/traceFile", this);
+  fProfileTraceFileCmd->SetGuidance(
+      "Record per-thread event, row-assembly, output-lock, and AppendHdf5 spans and write them as Chrome trace-event JSON at end of each run. Use \"\" to disable.");
+  fProfileTraceFileCmd->SetParameterName("path", false);
+  fProfileTraceFileCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTriggerMinPhotonsCmd = new G4UIcmdWithAnInteger("/g4emi/trigger/minPhotons", this);
+  fTriggerMinPhotonsCmd->SetGuidance(
+      "Write only events with at least this many detected photons (inside the time window when one is set). 0 disables.");
+  fTriggerMinPhotonsCmd->SetParameterName("photons", false);
+  fTriggerMinPhotonsCmd->SetRange("photons >= 0");
+  fTriggerMinPhotonsCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTriggerMinEnergyProxyCmd =
+      new G4UIcmdWithADoubleAndUnit("/g4emi/trigger/minEnergyProxy", this);
+  fTriggerMinEnergyProxyCmd->SetGuidance(
+      "Write only events whose generated scintillation photons correspond to at least this energy at the configured yield. 0 disables.");
+  fTriggerMinEnergyProxyCmd->SetParameterName("energy", false);
+  fTriggerMinEnergyProxyCmd->SetUnitCategory("Energy");
+  fTriggerMinEnergyProxyCmd->SetDefaultUnit("MeV");
+  fTriggerMinEnergyProxyCmd->SetRange("energy >= 0.");
+  fTriggerMinEnergyProxyCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTriggerSecondarySpeciesCmd =
+      new G4UIcmdWithAString("/g4emi/trigger/secondarySpecies", this);
+  fTriggerSecondarySpeciesCmd->SetGuidance(
+      "Write only events with a detected photon from one of these secondary species (output labels such as p, alpha, electron). Use \"\" to disable.");
+  fTriggerSecondarySpeciesCmd->SetParameterName("species", false);
+  fTriggerSecondarySpeciesCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTriggerTimeMinCmd = new G4UIcmdWithADoubleAndUnit("/g4emi/trigger/timeMin", this);
+  fTriggerTimeMinCmd->SetGuidance("Set the start of the trigger's interface-hit time window");
+  fTriggerTimeMinCmd->SetParameterName("time", false);
+  fTriggerTimeMinCmd->SetUnitCategory("Time");
+  fTriggerTimeMinCmd->SetDefaultUnit("ns");
+  fTriggerTimeMinCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+
+  fTriggerTimeMaxCmd = new G4UIcmdWithADoubleAndUnit("/g4emi/trigger/timeMax", this);
+  fTriggerTimeMaxCmd->SetGuidance(
+      "Set the end of the trigger's interface-hit time window (<= timeMin disables the window)");
+  fTriggerTimeMaxCmd->SetParameterName("time", false);
+  fTriggerTimeMaxCmd->SetUnitCategory("Time");
+  fTriggerTimeMaxCmd->SetDefaultUnit("ns");
+  fTriggerTimeMaxCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
 }
 
 Messenger::~Messenger() {
+  delete fTriggerTimeMaxCmd;
+  delete fTriggerTimeMinCmd;
+  delete fTriggerSecondarySpeciesCmd;
+  delete fTriggerMinEnergyProxyCmd;
+  delete fTriggerMinPhotonsCmd;
+
+  delete fProfileTraceFileCmd;
+  delete fProfileStepsCmd;
+  delete fRunProgressIntervalCmd;
+  delete fRunProgressFileCmd;
+  delete fRunPinThreadsCmd;
+  delete fRunPhotonsPerSubEventCmd;
+  delete fRunTaskingBackendCmd;
+  delete fRunEventsPerTaskCmd;
+  delete fRunThreadsCmd;
+
+  delete fPhysicsTableCacheDirCmd;
+
+  delete fSwmrFlushIntervalCmd;
+  delete fSwmrEnableCmd;
+  delete fRawDirectCmd;
+  delete fRawBufferCmd;
+  delete fRawDirectoryCmd;
+  delete fShmBlockTimeoutCmd;
+  delete fShmPolicyCmd;
+  delete fShmSizeCmd;
+  delete fShmNameCmd;
+  delete fTransportScreenCenterYCmd;
+  delete fTransportScreenCenterXCmd;
+  delete fTransportScreenDiameterCmd;
+  delete fTransportSurrogateCmd;
+  delete fTransportSmxCmd;
+  delete fTransportLensCmd;
+  delete fTimingArrivalMaxCmd;
+  delete fTimingDelayMaxCmd;
+  delete fTimingBinsCmd;
+  delete fImageTimeMaxCmd;
+  delete fImageTimeMinCmd;
+  delete fImageTimeBinsCmd;
+  delete fImageYMaxCmd;
+  delete fImageYMinCmd;
+  delete fImageXMaxCmd;
+  delete fImageXMinCmd;
+  delete fImageBinsYCmd;
+  delete fImageBinsXCmd;
+  delete fOutputSinkCmd;
+  delete fOutputModeCmd;
+  delete fOutputPhotonFieldsCmd;
   delete fOutputRunNameCmd;
   delete fOutputFilenameCmd;
   delete fOutputPathCmd;
@@ -338,6 +761,17 @@ Messenger::~Messenger() {
   delete fGeomScintXCmd;
   delete fGeomMaterialCmd;
 
+  delete fSwmrDir;
+  delete fRawDir;
+  delete fShmDir;
+  delete fTransportDir;
+  delete fTimingDir;
+  delete fImageDir;
+  delete fTriggerDir;
+  delete fProfileDir;
+  delete fRunDir;
+  delete fPhysicsDir;
+  delete fG4emiDir;
   delete fOutputDir;
   delete fOpticalInterfaceGeomDir;
   delete fOpticalInterfaceDir;
@@ -599,6 +1033,390 @@ void Messenger::SetNewValue(G4UIcommand* command, G4String newValue) {
     G4cout << "HDF5 path: '" << fConfig->GetHdf5FilePath() << "'." << G4endl;
     return;
   }
+
+  if (command == fOutputPhotonFieldsCmd) {
+    SimIO::PhotonFieldMask fields = 0;
+    std::string error;
+    if (!SimIO::ParsePhotonFields(newValue, &fields, &error)) {
+      RejectValue(command, "g4emi/output/photon-fields",
+                  "Invalid photonFields value: " + error + ".");
+      return;
+    }
+    fConfig->SetPhotonFields(fields);
+    G4cout << "Photon fields set to '" << SimIO::DescribePhotonFields(fields) << "' ("
+           << SimIO::PhotonRowBytes(fields) << "-byte /photons rows)." << G4endl;
+    return;
+  }
+
+  if (command == fOutputModeCmd) {
+    fConfig->SetOutputMode(newValue);
+    G4cout << "Output mode set to '" << fConfig->GetOutputMode() << "'." << G4endl;
+    return;
+  }
+
+  if (command == fOutputSinkCmd) {
+    std::vector<std::string> sinks;
+    std::string error;
+    if (!OutputSink::ParseSinks(newValue, &sinks, &error)) {
+      RejectValue(command, "g4emi/output/sink", "Invalid output sink value: " + error + ".");
+      return;
+    }
+    fConfig->SetOutputSinks(sinks);
+    std::string joined;
+    for (const auto& sink : sinks) {
+      joined += joined.empty() ? sink : " " + sink;
+    }
+    G4cout << "Output sinks set to '" << joined << "'." << G4endl;
+    return;
+  }
+
+  if (command == fImageBinsXCmd || command == fImageBinsYCmd ||
+      command == fImageTimeBinsCmd) {
+    auto binning = fConfig->GetImageBinning();
+    if (command == fImageBinsXCmd) {
+      binning.binsX = fImageBinsXCmd->GetNewIntValue(newValue);
+    } else if (command == fImageBinsYCmd) {
+      binning.binsY = fImageBinsYCmd->GetNewIntValue(newValue);
+    } else {
+      binning.timeBins = fImageTimeBinsCmd->GetNewIntValue(newValue);
+    }
+    fConfig->SetImageBinning(binning);
+    G4cout << "Image bins set to " << binning.binsX << " x " << binning.binsY << " x "
+           << binning.timeBins << " (x, y, t)." << G4endl;
+    return;
+  }
+
+  if (command == fImageXMinCmd || command == fImageXMaxCmd || command == fImageYMinCmd ||
+      command == fImageYMaxCmd) {
+    auto binning = fConfig->GetImageBinning();
+    const G4double value =
+        static_cast<G4UIcmdWithADoubleAndUnit*>(command)->GetNewDoubleValue(newValue);
+    if (command == fImageXMinCmd) {
+      binning.xMin = value;
+    } else if (command == fImageXMaxCmd) {
+      binning.xMax = value;
+    } else if (command == fImageYMinCmd) {
+      binning.yMin = value;
+    } else {
+      binning.yMax = value;
+    }
+    fConfig->SetImageBinning(binning);
+    G4cout << "Image range set to X ";
+    if (binning.xMax > binning.xMin) {
+      G4cout << "[" << binning.xMin / mm << ", " << binning.xMax / mm << "] mm";
+    } else {
+      G4cout << "interface face";
+    }
+    G4cout << ", Y ";
+    if (binning.yMax > binning.yMin) {
+      G4cout << "[" << binning.yMin / mm << ", " << binning.yMax / mm << "] mm";
+    } else {
+      G4cout << "interface face";
+    }
+    G4cout << "." << G4endl;
+    return;
+  }
+
+  if (command == fImageTimeMinCmd || command == fImageTimeMaxCmd) {
+    auto binning = fConfig->GetImageBinning();
+    if (command == fImageTimeMinCmd) {
+      binning.timeMin = fImageTimeMinCmd->GetNewDoubleValue(newValue);
+    } else {
+      binning.timeMax = fImageTimeMaxCmd->GetNewDoubleValue(newValue);
+    }
+    fConfig->SetImageBinning(binning);
+    G4cout << "Image time range set to [" << binning.timeMin / ns << ", "
+           << binning.timeMax / ns << "] ns." << G4endl;
+    return;
+  }
+
+  if (command == fTimingBinsCmd || command == fTimingDelayMaxCmd ||
+      command == fTimingArrivalMaxCmd) {
+    auto binning = fConfig->GetTimingBinning();
+    if (command == fTimingBinsCmd) {
+      binning.bins = fTimingBinsCmd->GetNewIntValue(newValue);
+    } else if (command == fTimingDelayMaxCmd) {
+      binning.delayMax = fTimingDelayMaxCmd->GetNewDoubleValue(newValue);
+    } else {
+      binning.arrivalMax = fTimingArrivalMaxCmd->GetNewDoubleValue(newValue);
+    }
+    fConfig->SetTimingBinning(binning);
+    if (binning.Enabled()) {
+      G4cout << "Timing histograms set to " << binning.bins << " bins over [0, "
+             << binning.delayMax / ns << "] ns creation delay and [0, "
+             << binning.arrivalMax / ns << "] ns arrival." << G4endl;
+    } else {
+      G4cout << "Timing histograms disabled." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fTransportLensCmd || command == fTransportSmxCmd ||
+      command == fTransportSurrogateCmd) {
+    auto transport = fConfig->GetLensTransport();
+    const std::string value = Utils::Unquote(Utils::Trim(newValue));
+    std::string resolved;
+    if (!value.empty()) {
+      resolved = command == fTransportLensCmd
+                     ? LensTrace::ResolveZmxPath(value)
+                     : std::filesystem::absolute(value).lexically_normal().string();
+      if (resolved.empty() || !std::filesystem::exists(resolved)) {
+        RejectValue(command, "g4emi/output/transport-file",
+                    "Transport file '" + value + "' not found; setting unchanged.");
+        return;
+      }
+    }
+    if (command == fTransportLensCmd) {
+      transport.lens = resolved;
+    } else if (command == fTransportSmxCmd) {
+      transport.smx = resolved;
+    } else {
+      transport.surrogate = resolved;
+    }
+    fConfig->SetLensTransport(transport);
+    if (!transport.Enabled()) {
+      G4cout << "Lens transport disabled." << G4endl;
+    } else if (!transport.surrogate.empty()) {
+      G4cout << "Lens transport set to surrogate model '" << transport.surrogate << "'."
+             << G4endl;
+    } else {
+      G4cout << "Lens transport set to '" << transport.lens << "'"
+             << (transport.smx.empty() ? std::string() : " with glasses '" + transport.smx + "'")
+             << "." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fTransportScreenDiameterCmd || command == fTransportScreenCenterXCmd ||
+      command == fTransportScreenCenterYCmd) {
+    auto transport = fConfig->GetLensTransport();
+    if (command == fTransportScreenDiameterCmd) {
+      transport.screenDiameter = fTransportScreenDiameterCmd->GetNewDoubleValue(newValue);
+    } else if (command == fTransportScreenCenterXCmd) {
+      transport.screenCenterX = fTransportScreenCenterXCmd->GetNewDoubleValue(newValue);
+    } else {
+      transport.screenCenterY = fTransportScreenCenterYCmd->GetNewDoubleValue(newValue);
+    }
+    fConfig->SetLensTransport(transport);
+    G4cout << "Transport input screen set to diameter " << transport.screenDiameter / mm
+           << " mm centered at (" << transport.screenCenterX / mm << ", "
+           << transport.screenCenterY / mm << ") mm." << G4endl;
+    return;
+  }
+
+  if (command == fShmNameCmd || command == fShmSizeCmd || command == fShmPolicyCmd ||
+      command == fShmBlockTimeoutCmd) {
+    auto stream = fConfig->GetShmStream();
+    if (command == fShmNameCmd) {
+      stream.name = Utils::Unquote(Utils::Trim(newValue));
+    } else if (command == fShmSizeCmd) {
+      stream.sizeMiB = fShmSizeCmd->GetNewIntValue(newValue);
+    } else if (command == fShmPolicyCmd) {
+      stream.policy = Utils::Trim(newValue);
+    } else {
+      stream.blockTimeout = fShmBlockTimeoutCmd->GetNewDoubleValue(newValue);
+    }
+    fConfig->SetShmStream(stream);
+    G4cout << "Shared-memory stream set to '" << stream.name << "' (" << stream.sizeMiB
+           << " MiB, policy " << stream.policy << ")." << G4endl;
+    return;
+  }
+
+  if (command == fRawDirectoryCmd || command == fRawBufferCmd || command == fRawDirectCmd) {
+    auto raw = fConfig->GetRawStream();
+    if (command == fRawDirectoryCmd) {
+      raw.directory = Utils::Unquote(Utils::Trim(newValue));
+    } else if (command == fRawBufferCmd) {
+      raw.bufferMiB = fRawBufferCmd->GetNewIntValue(newValue);
+    } else {
+      raw.direct = fRawDirectCmd->GetNewBoolValue(newValue);
+    }
+    fConfig->SetRawStream(raw);
+    G4cout << "Raw row files set to '"
+           << (raw.directory.empty() ? "<HDF5 file stem>_raw" : raw.directory) << "' ("
+           << raw.bufferMiB << " MiB buffers, " << (raw.direct ? "O_DIRECT" : "buffered")
+           << ")." << G4endl;
+    return;
+  }
+
+  if (command == fSwmrEnableCmd || command == fSwmrFlushIntervalCmd) {
+    auto swmr = fConfig->GetSwmrOutput();
+    if (command == fSwmrEnableCmd) {
+      swmr.enabled = fSwmrEnableCmd->GetNewBoolValue(newValue);
+    } else {
+      swmr.flushInterval = fSwmrFlushIntervalCmd->GetNewDoubleValue(newValue);
+    }
+    fConfig->SetSwmrOutput(swmr);
+    G4cout << "SWMR live reading " << (swmr.enabled ? "enabled" : "disabled") << " (flush every "
+           << swmr.flushInterval / s << " s)." << G4endl;
+    return;
+  }
+
+  if (command == fPhysicsTableCacheDirCmd) {
+    fConfig->SetPhysicsTableCacheDir(newValue);
+    const auto cacheDir = fConfig->GetPhysicsTableCacheDir();
+    if (cacheDir.empty()) {
+      G4cout << "Physics-table cache disabled." << G4endl;
+    } else {
+      G4cout << "Physics-table cache directory set to '" << cacheDir << "'." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fRunThreadsCmd) {
+    const G4int requested = fRunThreadsCmd->GetNewIntValue(newValue);
+    fConfig->SetRunThreads(requested);
+    auto* mtRunManager = dynamic_cast<G4MTRunManager*>(G4RunManager::GetRunManager());
+    if (!mtRunManager) {
+      G4cout << "Serial run manager active; /g4emi/run/threads ignored." << G4endl;
+      return;
+    }
+    const G4int threads = requested > 0 ? requested : G4Threading::G4GetNumberOfCores();
+    mtRunManager->SetNumberOfThreads(threads);
+    G4cout << "Worker threads set to " << threads << "." << G4endl;
+    return;
+  }
+
+  if (command == fRunEventsPerTaskCmd) {
+    const G4int eventsPerTask = fRunEventsPerTaskCmd->GetNewIntValue(newValue);
+    fConfig->SetEventsPerTask(eventsPerTask);
+    auto* mtRunManager = dynamic_cast<G4MTRunManager*>(G4RunManager::GetRunManager());
+    if (!mtRunManager) {
+      G4cout << "Serial run manager active; /g4emi/run/eventsPerTask ignored." << G4endl;
+      return;
+    }
+    // Tasking also derives its task grain size from this at run start (RunAction).
+    mtRunManager->SetEventModulo(eventsPerTask);
+    if (eventsPerTask == 0) {
+      G4cout << "Events per task reset to the Geant4 heuristic." << G4endl;
+    } else {
+      G4cout << "Events per task set to " << eventsPerTask << "." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fRunTaskingBackendCmd) {
+    const auto activeBackend = fConfig->GetRunManagerBackend();
+    const auto requested = Config::NormalizeRunManagerBackend(newValue);
+    if (requested != activeBackend) {
+      G4cout << "Run-manager backend '" << requested << "' ignored; '" << activeBackend
+             << "' was selected at startup. Pass -b " << requested
+             << " or set it in the top-level macro." << G4endl;
+      return;
+    }
+    G4cout << "Run-manager backend: '" << activeBackend << "'." << G4endl;
+    return;
+  }
+
+  if (command == fRunPhotonsPerSubEventCmd) {
+    const G4int photons = fRunPhotonsPerSubEventCmd->GetNewIntValue(newValue);
+    const G4int activePhotons = fConfig->GetPhotonsPerSubEvent();
+    if (photons != activePhotons) {
+      G4cout << "Photons per sub-event " << photons << " ignored; " << activePhotons
+             << " was registered at startup." << G4endl;
+      return;
+    }
+    G4cout << "Photons per sub-event: " << activePhotons << "." << G4endl;
+    return;
+  }
+
+  if (command == fRunPinThreadsCmd) {
+    Affinity::Policy policy;
+    std::string error;
+    if (!Affinity::ParsePolicy(newValue, &policy, &error)) {
+      RejectValue(command, "g4emi/run/pin-threads", "Invalid pinThreads value: " + error + ".");
+      return;
+    }
+    fConfig->SetPinThreadsPolicy(newValue);
+    G4cout << "Worker pinning policy set to '" << fConfig->GetPinThreadsPolicy() << "'."
+           << G4endl;
+    return;
+  }
+
+  if (command == fRunProgressFileCmd) {
+    fConfig->SetProgressFile(newValue);
+    const auto progressFile = fConfig->GetProgressFile();
+    if (progressFile.empty()) {
+      G4cout << "Progress file disabled." << G4endl;
+    } else {
+      G4cout << "Progress file set to '" << progressFile << "'." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fProfileStepsCmd) {
+    fConfig->SetStepProfileInterval(fProfileStepsCmd->GetNewIntValue(newValue));
+    const G4int interval = fConfig->GetStepProfileInterval();
+    if (interval == 0) {
+      G4cout << "Step profiler disabled." << G4endl;
+    } else {
+      G4cout << "Step profiler sampling every " << interval << " step(s)." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fProfileTraceFileCmd) {
+    fConfig->SetTraceFile(newValue);
+    const auto traceFile = fConfig->GetTraceFile();
+    if (traceFile.empty()) {
+      G4cout << "Trace recording disabled." << G4endl;
+    } else {
+      G4cout << "Trace file set to '" << traceFile << "'." << G4endl;
+    }
+    return;
+  }
+
+  if (command == fRunProgressIntervalCmd) {
+    fConfig->SetProgressInterval(fRunProgressIntervalCmd->GetNewDoubleValue(newValue));
+    G4cout << "Progress interval set to " << fConfig->GetProgressInterval() / s << " s."
+           << G4endl;
+    return;
+  }
+
+  if (command == fTriggerMinPhotonsCmd) {
+    fConfig->SetTriggerMinPhotons(fTriggerMinPhotonsCmd->GetNewIntValue(newValue));
+    G4cout << "Trigger minimum detected photons set to "
+           << fConfig->GetEventTrigger().minPhotons << "." << G4endl;
+    return;
+  }
+
+  if (command == fTriggerMinEnergyProxyCmd) {
+    fConfig->SetTriggerMinEnergyProxy(fTriggerMinEnergyProxyCmd->GetNewDoubleValue(newValue));
+    G4cout << "Trigger minimum energy proxy set to "
+           << fConfig->GetEventTrigger().minEnergyProxy / MeV << " MeV." << G4endl;
+    return;
+  }
+
+  if (command == fTriggerSecondarySpeciesCmd) {
+    fConfig->SetTriggerSecondarySpecies(newValue);
+    const auto species = fConfig->GetEventTrigger().secondarySpecies;
+    if (species.empty()) {
+      G4cout << "Trigger secondary-species requirement disabled." << G4endl;
+    } else {
+      G4cout << "Trigger requires a detected photon from:";
+      for (const auto& label : species) {
+        G4cout << " " << label;
+      }
+      G4cout << G4endl;
+    }
+    return;
+  }
+
+  if (command == fTriggerTimeMinCmd || command == fTriggerTimeMaxCmd) {
+    if (command == fTriggerTimeMinCmd) {
+      fConfig->SetTriggerTimeMin(fTriggerTimeMinCmd->GetNewDoubleValue(newValue));
+    } else {
+      fConfig->SetTriggerTimeMax(fTriggerTimeMaxCmd->GetNewDoubleValue(newValue));
+    }
+    const auto trigger = fConfig->GetEventTrigger();
+    if (trigger.HasTimeWindow()) {
+      G4cout << "Trigger time window set to [" << trigger.timeMin / ns << ", "
+             << trigger.timeMax / ns << "] ns." << G4endl;
+    } else {
+      G4cout << "Trigger time window disabled." << G4endl;
+    }
+    return;
+  }
 }
 
 void Messenger::NotifyGeometryChanged() const {
@@ -607,6 +1425,10 @@ void Messenger::NotifyGeometryChanged() const {
     // Mark geometry dirty; users can rebuild with reinitialize/initialize commands.
     runManager->GeometryHasBeenModified();
   }
+  if (auto* physicsList = PhysicsList::FromRunManager()) {
+    // Cached tables describe the old materials; rebuild them for the next run.
+    physicsList->InvalidateTableCache();
+  }
   G4cout << "Geometry updated. Run /run/reinitializeGeometry, then /run/initialize, then /vis/drawVolume."
          << G4endl;
 }
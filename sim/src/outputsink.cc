@@ -0,0 +1,494 @@
+#include "outputsink.hh"
+
+#include "SimIO.hh"
+#include "capture.hh"
+#include "config.hh"
+#include "imaging.hh"
+#include "rawfile.hh"
+#include "shmring.hh"
+#include "utils.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+namespace {
+/// Appends rows to the run's HDF5 file through the cached `SimIO` writer.
+class Hdf5Sink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo& run, std::string*) override {
+    fPath = run.hdf5Path;
+    return true;
+  }
+
+  bool Consume(const OutputSink::EventBatch& batch, std::string* errorMessage) override {
+    // Transported rows point at /photons rows of this file.
+    const std::int64_t photonRowBase =
+        batch.transported.empty() ? 0 : SimIO::PhotonRowCount(fPath);
+    if (!SimIO::AppendHdf5(fPath, batch.primaries, batch.secondaries, batch.photons,
+                           errorMessage)) {
+      return false;
+    }
+    return batch.transported.empty() ||
+           SimIO::AppendTransported(fPath, batch.transported, photonRowBase, errorMessage);
+  }
+
+  bool WritesHdf5() const override { return true; }
+  bool StoresRows() const override { return true; }
+
+ private:
+  std::string fPath;
+};
+
+/// Publishes `/photons` batches to the `/output/shm/*` ring.
+class ShmSink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo& run, std::string* errorMessage) override {
+    const auto stream = run.config ? run.config->GetShmStream() : ShmStream{};
+    ShmRing::WriterSettings settings;
+    settings.name = stream.name;
+    settings.dataBytes = static_cast<std::size_t>(stream.sizeMiB) << 20;
+    settings.blockTimeout =
+        std::chrono::milliseconds(static_cast<std::int64_t>(stream.blockTimeout / ms));
+    if (!ShmRing::ParsePolicy(stream.policy, &settings.policy)) {
+      *errorMessage = "Unknown /output/shm/policy '" + stream.policy + "'.";
+      return false;
+    }
+    if (!ShmRing::BeginRun(settings, run.photonFields, errorMessage)) {
+      return false;
+    }
+    G4cout << "[g4emi] Streaming /photons batches to shared memory '" << stream.name
+           << "' (policy " << ShmRing::PolicyName(settings.policy) << ")." << G4endl;
+    return true;
+  }
+
+  bool Consume(const OutputSink::EventBatch& batch, std::string*) override {
+    ShmRing::Publish(batch.eventId, batch.photons);
+    return true;
+  }
+
+  bool EndRun(const OutputSink::RunInfo&, std::string*) override {
+    const auto stats = ShmRing::EndRun();
+    G4cout << "[g4emi] Shared-memory stream: " << stats.publishedBatches << " batches ("
+           << stats.publishedRows << " photon rows) published, " << stats.droppedBatches
+           << " batches (" << stats.droppedRows << " rows) dropped." << G4endl;
+    return true;
+  }
+};
+
+/// Appends native rows to one flat file per table through large aligned
+/// buffers, then indexes the files as external datasets of an HDF5 file.
+class RawSink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo& run, std::string* errorMessage) override {
+    const auto raw = run.config ? run.config->GetRawStream() : RawStream{};
+    std::filesystem::path directory = raw.directory;
+    if (directory.empty()) {
+      const std::filesystem::path hdf5(run.hdf5Path);
+      directory = hdf5.parent_path() / (hdf5.stem().string() + "_raw");
+    }
+    std::error_code ec;
+    fDirectory = std::filesystem::absolute(directory, ec);
+    // Like the HDF5 file, only the leaf is created; its parent must exist.
+    std::filesystem::create_directory(fDirectory, ec);
+    if (ec) {
+      *errorMessage = "Cannot create raw output directory " + fDirectory.string() + ": " +
+                      ec.message();
+      return false;
+    }
+    fPhotonFields = run.photonFields;
+    fRowBytes = {sizeof(SimStructures::detail::Hdf5PrimaryNativeRow),
+                 sizeof(SimStructures::detail::Hdf5SecondaryNativeRow),
+                 SimIO::PhotonRowBytes(fPhotonFields),
+                 sizeof(SimStructures::TransportedPhotonInfo)};
+    const std::size_t bufferBytes = static_cast<std::size_t>(raw.bufferMiB) << 20;
+    for (std::size_t i = 0; i < kTables; ++i) {
+      const auto path = (fDirectory / kFileNames[i]).string();
+      if (!fFiles[i].Open(path, bufferBytes, raw.direct, errorMessage)) {
+        std::string ignored;
+        for (std::size_t j = 0; j < i; ++j) {
+          fFiles[j].Close(&ignored);
+        }
+        return false;
+      }
+    }
+    fPhotonRows = 0;
+    G4cout << "[g4emi] Writing raw rows to " << fDirectory.string()
+           << (fFiles[kPhotons].Direct() ? " (O_DIRECT)." : ".") << G4endl;
+    if (raw.direct && !fFiles[kPhotons].Direct()) {
+      G4cout << "[g4emi] O_DIRECT is not supported there; raw rows go through the page cache."
+             << G4endl;
+    }
+    return true;
+  }
+
+  bool Consume(const OutputSink::EventBatch& batch, std::string* errorMessage) override {
+    bool ok = true;
+    if (!batch.primaries.empty()) {
+      const auto rows = SimIO::detail::ToNative(batch.primaries);
+      ok = fFiles[kPrimaries].Append(rows.data(), rows.size() * fRowBytes[kPrimaries]) && ok;
+    }
+    if (!batch.secondaries.empty()) {
+      const auto rows = SimIO::detail::ToNative(batch.secondaries);
+      ok = fFiles[kSecondaries].Append(rows.data(), rows.size() * fRowBytes[kSecondaries]) && ok;
+    }
+    // Photon rows are packed straight into the write buffer when they fit.
+    const std::size_t photonBytes = batch.photons.size * fRowBytes[kPhotons];
+    if (photonBytes > 0) {
+      if (auto* out = fFiles[kPhotons].Claim(photonBytes)) {
+        SimIO::detail::PackPhotons(batch.photons, fPhotonFields, out);
+      } else {
+        const auto packed = SimIO::detail::PackPhotons(batch.photons, fPhotonFields);
+        ok = fFiles[kPhotons].Append(packed.data(), packed.size()) && ok;
+      }
+    }
+    for (auto row : batch.transported) {
+      row.sourcePhotonIndex += fPhotonRows;
+      ok = fFiles[kTransported].Append(&row, sizeof(row)) && ok;
+    }
+    fPhotonRows += static_cast<std::int64_t>(batch.photons.size);
+    if (!ok) {
+      // EndRun reports the first write error itself.
+      *errorMessage = "Failed writing raw rows to " + fDirectory.string();
+    }
+    return ok;
+  }
+
+  bool StoresRows() const override { return true; }
+
+  bool EndRun(const OutputSink::RunInfo&, std::string* errorMessage) override {
+    bool ok = true;
+    SimIO::RawTables tables;
+    tables.photonFields = fPhotonFields;
+    SimIO::RawTable* entries[kTables] = {&tables.primaries, &tables.secondaries,
+                                         &tables.photons, &tables.transported};
+    for (std::size_t i = 0; i < kTables; ++i) {
+      std::string error;
+      if (!fFiles[i].Close(&error) && ok) {
+        ok = false;
+        *errorMessage = error;
+      }
+      entries[i]->path = fFiles[i].Path();
+      entries[i]->rows = fFiles[i].Bytes() / fRowBytes[i];
+    }
+    if (!ok) {
+      return false;
+    }
+    const auto index = (fDirectory / "index.h5").string();
+    if (!SimIO::WriteRawIndex(index, tables, errorMessage)) {
+      return false;
+    }
+    G4cout << "[g4emi] Raw rows: " << tables.photons.rows << " photons, "
+           << tables.primaries.rows << " primaries, " << tables.secondaries.rows
+           << " secondaries, " << tables.transported.rows << " transported; index " << index
+           << G4endl;
+    return true;
+  }
+
+ private:
+  enum Table : std::size_t { kPrimaries, kSecondaries, kPhotons, kTransported, kTables };
+  static constexpr const char* kFileNames[kTables] = {
+      "primaries.bin", "secondaries.bin", "photons.bin", "transported_photons.bin"};
+
+  std::filesystem::path fDirectory;
+  SimStructures::PhotonFieldMask fPhotonFields = SimStructures::PhotonField::kAll;
+  std::array<std::size_t, kTables> fRowBytes{};
+  std::array<RawFile::Writer, kTables> fFiles;
+  std::int64_t fPhotonRows = 0;
+};
+
+/// Bins the accepted photons into `/histograms/photons`: detected photons per
+/// event and an x/y image on the `/output/image/*` grid. Unlike `/images`,
+/// which counts every interface hit, only events that reach the sinks count.
+class HistogramSink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo& run, std::string*) override {
+    fPath = run.hdf5Path;
+    const auto binning = run.config ? run.config->GetImageBinning() : ImageBinning{};
+    G4double range[4] = {0.0, 0.0, 0.0, 0.0};
+    fHasImage = Imaging::ResolveRange(binning, range);
+    fBinsX = std::max(1, binning.binsX);
+    fBinsY = std::max(1, binning.binsY);
+    fXMin = range[0] / mm;
+    fXMax = range[1] / mm;
+    fYMin = range[2] / mm;
+    fYMax = range[3] / mm;
+    fPerEvent.assign(kMultiplicityBins, 0);
+    fXY.assign(fHasImage ? static_cast<std::size_t>(fBinsX) * fBinsY : 0, 0);
+    fEvents = 0;
+    fPhotons = 0;
+    fOutsideXY = 0;
+    return true;
+  }
+
+  bool Consume(const OutputSink::EventBatch& batch, std::string*) override {
+    ++fEvents;
+    fPhotons += batch.photons.size;
+    ++fPerEvent[std::min<std::size_t>(batch.photons.size, kMultiplicityBins - 1)];
+    if (!fHasImage) {
+      return true;
+    }
+    const double scaleX = fBinsX / (fXMax - fXMin);
+    const double scaleY = fBinsY / (fYMax - fYMin);
+    for (const auto& photon : batch.photons) {
+      const double fx = (photon.opticalInterfaceHitXmm - fXMin) * scaleX;
+      const double fy = (photon.opticalInterfaceHitYmm - fYMin) * scaleY;
+      if (!(fx >= 0.0 && fx < fBinsX && fy >= 0.0 && fy < fBinsY)) {
+        ++fOutsideXY;
+        continue;
+      }
+      ++fXY[static_cast<std::size_t>(fy) * fBinsX + static_cast<std::size_t>(fx)];
+    }
+    return true;
+  }
+
+  bool EndRun(const OutputSink::RunInfo&, std::string* errorMessage) override {
+    std::vector<SimIO::CountsInfo> datasets;
+    SimIO::CountsInfo perEvent;
+    perEvent.name = "photons_per_event";
+    perEvent.shape = {kMultiplicityBins};
+    perEvent.counts = std::move(fPerEvent);
+    perEvent.attributes = {{"overflow_from", static_cast<std::int64_t>(kMultiplicityBins - 1)}};
+    datasets.push_back(std::move(perEvent));
+    if (fHasImage) {
+      SimIO::CountsInfo xy;
+      xy.name = "xy";
+      xy.shape = {static_cast<std::size_t>(fBinsY), static_cast<std::size_t>(fBinsX)};
+      xy.counts = std::move(fXY);
+      xy.attributes = {{"x_min_mm", fXMin}, {"x_max_mm", fXMax},
+                       {"y_min_mm", fYMin}, {"y_max_mm", fYMax}};
+      datasets.push_back(std::move(xy));
+    }
+    const std::vector<SimIO::RunStatistic> attributes = {
+        {"events", static_cast<std::int64_t>(fEvents)},
+        {"photons", static_cast<std::int64_t>(fPhotons)},
+        {"outside_xy", static_cast<std::int64_t>(fOutsideXY)}};
+    return SimIO::WriteCounts(fPath, "/histograms/photons", datasets, attributes,
+                              errorMessage);
+  }
+
+  bool WritesHdf5() const override { return true; }
+
+ private:
+  /// Events with this many photons or more share the last bin.
+  static constexpr std::size_t kMultiplicityBins = 1024;
+
+  std::string fPath;
+  bool fHasImage = false;
+  G4int fBinsX = 1;
+  G4int fBinsY = 1;
+  double fXMin = 0.0;
+  double fXMax = 0.0;
+  double fYMin = 0.0;
+  double fYMax = 0.0;
+  std::vector<std::uint64_t> fPerEvent;
+  std::vector<std::uint64_t> fXY;
+  std::uint64_t fEvents = 0;
+  std::uint64_t fPhotons = 0;
+  std::uint64_t fOutsideXY = 0;
+};
+
+/// Discards everything.
+class NullSink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo&, std::string*) override { return true; }
+  bool Consume(const OutputSink::EventBatch&, std::string*) override { return true; }
+};
+
+/// Hands rows to `Capture` for the `g4emi_native` module.
+class CaptureSink : public OutputSink::Sink {
+ public:
+  bool BeginRun(const OutputSink::RunInfo& run, std::string*) override {
+    Capture::BeginRun(run.photonFields);
+    return true;
+  }
+
+  bool Consume(const OutputSink::EventBatch& batch, std::string*) override {
+    Capture::Append(batch.primaries, batch.secondaries, batch.photons, batch.transported);
+    return true;
+  }
+
+  bool StoresRows() const override { return true; }
+};
+
+template <typename T>
+std::unique_ptr<OutputSink::Sink> Make() {
+  return std::make_unique<T>();
+}
+
+struct Entry {
+  std::string name;
+  OutputSink::Factory factory;
+};
+
+/// Registry; built-ins are listed before anything `Register` adds.
+std::mutex gRegistryMutex;
+std::vector<Entry> gRegistry = {
+    {"hdf5", &Make<Hdf5Sink>},
+    {"shm", &Make<ShmSink>},
+    {"raw", &Make<RawSink>},
+    {"histogram", &Make<HistogramSink>},
+    {"null", &Make<NullSink>},
+};
+
+/// The current run's sinks; written by the master only while no worker runs.
+struct Run {
+  OutputSink::RunInfo info;
+  std::vector<std::string> names;
+  std::vector<std::unique_ptr<OutputSink::Sink>> sinks;
+};
+
+Run gRun;
+
+OutputSink::Factory FindFactory(const std::string& name) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  for (const auto& entry : gRegistry) {
+    if (entry.name == name) {
+      return entry.factory;
+    }
+  }
+  return nullptr;
+}
+}  // namespace
+
+namespace OutputSink {
+
+void Register(const std::string& name, Factory factory) {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  for (auto& entry : gRegistry) {
+    if (entry.name == name) {
+      entry.factory = factory;
+      return;
+    }
+  }
+  gRegistry.push_back({name, factory});
+}
+
+std::vector<std::string> Names() {
+  std::lock_guard<std::mutex> lock(gRegistryMutex);
+  std::vector<std::string> names;
+  for (const auto& entry : gRegistry) {
+    names.push_back(entry.name);
+  }
+  return names;
+}
+
+bool ParseSinks(const std::string& value,
+                std::vector<std::string>* names,
+                std::string* errorMessage) {
+  std::string normalized = Utils::ToLower(Utils::Unquote(Utils::Trim(value)));
+  std::replace(normalized.begin(), normalized.end(), ',', ' ');
+  std::istringstream tokens(normalized);
+  std::vector<std::string> selected;
+  for (std::string token; tokens >> token;) {
+    if (!FindFactory(token)) {
+      if (errorMessage) {
+        std::string known;
+        for (const auto& name : Names()) {
+          known += known.empty() ? "" : ", ";
+          known += name;
+        }
+        *errorMessage = "unknown output sink '" + token + "' (expected " + known + ")";
+      }
+      return false;
+    }
+    if (std::find(selected.begin(), selected.end(), token) == selected.end()) {
+      selected.push_back(token);
+    }
+  }
+  if (selected.empty()) {
+    if (errorMessage) {
+      *errorMessage = "no output sink given";
+    }
+    return false;
+  }
+  if (names) {
+    *names = std::move(selected);
+  }
+  return true;
+}
+
+bool BeginRun(const std::vector<std::string>& names,
+              const RunInfo& run,
+              std::string* errorMessage) {
+  std::string ignored;
+  EndRun(&ignored);
+  std::vector<std::unique_ptr<Sink>> sinks;
+  std::vector<std::string> selected;
+  if (Capture::Enabled()) {
+    sinks.push_back(Make<CaptureSink>());
+    selected.push_back("capture");
+  } else {
+    selected = names;
+    for (const auto& name : names) {
+      const auto factory = FindFactory(name);
+      if (!factory) {
+        *errorMessage = "Unknown output sink '" + name + "'.";
+        return false;
+      }
+      sinks.push_back(factory());
+    }
+  }
+  for (std::size_t i = 0; i < sinks.size(); ++i) {
+    if (!sinks[i]->BeginRun(run, errorMessage)) {
+      // Unwind the sinks already begun, so none is left half-open.
+      for (std::size_t j = 0; j < i; ++j) {
+        sinks[j]->EndRun(run, &ignored);
+      }
+      return false;
+    }
+  }
+  gRun.info = run;
+  gRun.names = std::move(selected);
+  gRun.sinks = std::move(sinks);
+  return true;
+}
+
+bool Consume(const EventBatch& batch, std::string* errorMessage) {
+  bool ok = true;
+  for (const auto& sink : gRun.sinks) {
+    std::string error;
+    if (!sink->Consume(batch, &error) && ok) {
+      ok = false;
+      *errorMessage = error;
+    }
+  }
+  return ok;
+}
+
+bool Active() { return !gRun.sinks.empty(); }
+
+bool WritesHdf5() {
+  return std::any_of(gRun.sinks.begin(), gRun.sinks.end(),
+                     [](const auto& sink) { return sink->WritesHdf5(); });
+}
+
+bool StoresRows() {
+  return std::any_of(gRun.sinks.begin(), gRun.sinks.end(),
+                     [](const auto& sink) { return sink->StoresRows(); });
+}
+
+bool Selected(const std::string& name) {
+  return std::find(gRun.names.begin(), gRun.names.end(), name) != gRun.names.end();
+}
+
+bool EndRun(std::string* errorMessage) {
+  bool ok = true;
+  for (const auto& sink : gRun.sinks) {
+    std::string error;
+    if (!sink->EndRun(gRun.info, &error) && ok) {
+      ok = false;
+      *errorMessage = error;
+    }
+  }
+  gRun = Run{};
+  return ok;
+}
+
+}  // namespace OutputSink
@@ -0,0 +1,109 @@
+#include "perfcounters.hh"
+
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+/// Run totals; worker blocks are folded in at each worker's end of run.
+std::mutex gMergedMutex;
+PerfCounters::Block gMerged;
+
+double Ratio(double numerator, double denominator) {
+  return denominator > 0.0 ? numerator / denominator : 0.0;
+}
+}  // namespace
+
+namespace PerfCounters {
+
+void Block::Merge(const Block& other) {
+  scintillatorSteps += other.scintillatorSteps;
+  for (const auto& [species, count] : other.tracksBySpecies) {
+    tracksBySpecies[species] += count;
+  }
+  opticalPhotonsCreated += other.opticalPhotonsCreated;
+  opticalPhotonsTracked += other.opticalPhotonsTracked;
+  opticalPhotonsDetected += other.opticalPhotonsDetected;
+  events += other.events;
+  eventSeconds += other.eventSeconds;
+  maxEventSeconds = std::max(maxEventSeconds, other.maxEventSeconds);
+  appendCalls += other.appendCalls;
+  appendSeconds += other.appendSeconds;
+  appendBytes += other.appendBytes;
+  peakTrackInfo = std::max(peakTrackInfo, other.peakTrackInfo);
+  peakPhotonCreationInfo = std::max(peakPhotonCreationInfo, other.peakPhotonCreationInfo);
+  peakPendingPhotonOrigin = std::max(peakPendingPhotonOrigin, other.peakPendingPhotonOrigin);
+  peakPhotonHits = std::max(peakPhotonHits, other.peakPhotonHits);
+}
+
+void MergeLocal() {
+  auto& local = Local();
+  {
+    std::lock_guard<std::mutex> lock(gMergedMutex);
+    gMerged.Merge(local);
+  }
+  local = Block();
+}
+
+Block TakeMerged() {
+  std::lock_guard<std::mutex> lock(gMergedMutex);
+  Block totals = std::move(gMerged);
+  gMerged = Block();
+  return totals;
+}
+
+void Report(int runID, const Block& totals) {
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(3) << "[g4emi] Run " << runID
+         << " counters:"
+         << "\n[g4emi]   scintillator steps: " << totals.scintillatorSteps
+         << "\n[g4emi]   optical photons: " << totals.opticalPhotonsCreated << " created, "
+         << totals.opticalPhotonsTracked << " tracked, " << totals.opticalPhotonsDetected
+         << " detected, " << totals.opticalPhotonsTracked - totals.opticalPhotonsDetected
+         << " killed before the interface"
+         << "\n[g4emi]   events: " << totals.events << ", "
+         << Ratio(totals.eventSeconds, static_cast<double>(totals.events)) * 1e3
+         << " ms mean, " << totals.maxEventSeconds * 1e3 << " ms max"
+         << "\n[g4emi]   AppendHdf5: " << totals.appendCalls << " calls, "
+         << totals.appendSeconds << " s, " << totals.appendBytes << " bytes"
+         << "\n[g4emi]   peak per-event sizes: trackInfo " << totals.peakTrackInfo
+         << ", photonCreationInfo " << totals.peakPhotonCreationInfo
+         << ", pendingPhotonOrigin " << totals.peakPendingPhotonOrigin << ", photonHits "
+         << totals.peakPhotonHits << "\n[g4emi]   tracks:";
+  for (const auto& [species, count] : totals.tracksBySpecies) {
+    report << " " << species << "=" << count;
+  }
+  G4cout << report.str() << G4endl;
+}
+
+std::vector<SimIO::RunStatistic> ToRunStatistics(int runID, const Block& totals) {
+  const auto count = [](auto value) { return static_cast<std::int64_t>(value); };
+  std::vector<SimIO::RunStatistic> stats = {
+      {"run_id", count(runID)},
+      {"scintillator_steps", totals.scintillatorSteps},
+      {"optical_photons_created", totals.opticalPhotonsCreated},
+      {"optical_photons_tracked", totals.opticalPhotonsTracked},
+      {"optical_photons_detected", totals.opticalPhotonsDetected},
+      {"optical_photons_killed",
+       totals.opticalPhotonsTracked - totals.opticalPhotonsDetected},
+      {"events", totals.events},
+      {"event_wall_time_s", totals.eventSeconds},
+      {"event_wall_time_max_s", totals.maxEventSeconds},
+      {"append_hdf5_calls", totals.appendCalls},
+      {"append_hdf5_time_s", totals.appendSeconds},
+      {"append_hdf5_bytes", totals.appendBytes},
+      {"peak_track_info", count(totals.peakTrackInfo)},
+      {"peak_photon_creation_info", count(totals.peakPhotonCreationInfo)},
+      {"peak_pending_photon_origin", count(totals.peakPendingPhotonOrigin)},
+      {"peak_photon_hits", count(totals.peakPhotonHits)},
+  };
+  for (const auto& [species, tracks] : totals.tracksBySpecies) {
+    stats.push_back({"tracks_" + species, tracks});
+  }
+  return stats;
+}
+
+}  // namespace PerfCounters
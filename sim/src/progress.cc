@@ -0,0 +1,177 @@
+#include "progress.hh"
+
+#include "G4ios.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+/// Counters updated by worker threads with relaxed atomics; the reporter only
+/// needs a consistent-enough snapshot, not ordering between counters.
+struct Counters {
+  std::atomic<std::int64_t> eventsCompleted{0};
+  std::atomic<std::int64_t> eventsRejected{0};
+  std::atomic<std::int64_t> photonsGenerated{0};
+  std::atomic<std::int64_t> photonsDetected{0};
+  std::atomic<std::int64_t> rowsWritten{0};
+  std::atomic<std::int64_t> bytesWritten{0};
+  std::atomic<std::int64_t> outputWaitNs{0};
+  std::atomic<std::int64_t> outputHeldNs{0};
+};
+
+Counters gCounters;
+
+/// Reporter state; only touched by the master thread and the reporter itself.
+struct Reporter {
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stop = false;
+  std::thread thread;
+  std::ofstream file;
+  /// Last path written by this process; a new path starts a fresh file.
+  std::string path;
+  G4int runID = 0;
+  std::int64_t eventsTotal = 0;
+  std::chrono::steady_clock::time_point start;
+};
+
+Reporter gReporter;
+
+// Append one JSON object describing the current counters.
+void WriteSnapshot(const char* state) {
+  const double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - gReporter.start)
+          .count();
+  const auto events = gCounters.eventsCompleted.load(std::memory_order_relaxed);
+  const double rate = elapsed > 0.0 ? events / elapsed : 0.0;
+  const auto remaining = gReporter.eventsTotal - events;
+
+  std::ostringstream line;
+  line << std::fixed << std::setprecision(3) << "{\"run\": " << gReporter.runID
+       << ", \"state\": \"" << state << "\", \"elapsed_s\": " << elapsed
+       << ", \"events_completed\": " << events
+       << ", \"events_total\": " << gReporter.eventsTotal
+       << ", \"events_rejected\": "
+       << gCounters.eventsRejected.load(std::memory_order_relaxed)
+       << ", \"photons_generated\": "
+       << gCounters.photonsGenerated.load(std::memory_order_relaxed)
+       << ", \"photons_detected\": "
+       << gCounters.photonsDetected.load(std::memory_order_relaxed)
+       << ", \"rows_written\": " << gCounters.rowsWritten.load(std::memory_order_relaxed)
+       << ", \"bytes_written\": " << gCounters.bytesWritten.load(std::memory_order_relaxed)
+       << ", \"output_wait_s\": "
+       << gCounters.outputWaitNs.load(std::memory_order_relaxed) / 1e9
+       << ", \"output_held_s\": "
+       << gCounters.outputHeldNs.load(std::memory_order_relaxed) / 1e9
+       << ", \"events_per_s\": " << rate << ", \"eta_s\": ";
+  if (rate > 0.0 && remaining >= 0) {
+    line << remaining / rate;
+  } else {
+    line << "null";
+  }
+  line << "}\n";
+  // Flush every line so readers never see a partial snapshot for long.
+  gReporter.file << line.str() << std::flush;
+}
+
+void ReportLoop(std::chrono::duration<double> interval) {
+  std::unique_lock<std::mutex> lock(gReporter.mutex);
+  while (!gReporter.wake.wait_for(lock, interval, [] { return gReporter.stop; })) {
+    WriteSnapshot("running");
+  }
+}
+}  // namespace
+
+namespace Progress {
+
+void BeginRun(G4int runID, std::int64_t eventsTotal, const std::string& path,
+              double intervalSeconds) {
+  EndRun();
+
+  gCounters.eventsCompleted.store(0, std::memory_order_relaxed);
+  gCounters.eventsRejected.store(0, std::memory_order_relaxed);
+  gCounters.photonsGenerated.store(0, std::memory_order_relaxed);
+  gCounters.photonsDetected.store(0, std::memory_order_relaxed);
+  gCounters.rowsWritten.store(0, std::memory_order_relaxed);
+  gCounters.bytesWritten.store(0, std::memory_order_relaxed);
+  gCounters.outputWaitNs.store(0, std::memory_order_relaxed);
+  gCounters.outputHeldNs.store(0, std::memory_order_relaxed);
+
+  if (path.empty()) {
+    return;
+  }
+
+  // Later runs in the same process append to the file their first run created.
+  const auto mode = path == gReporter.path ? std::ios::app : std::ios::trunc;
+  gReporter.file.open(path, std::ios::out | mode);
+  if (!gReporter.file) {
+    G4cout << "[g4emi] Cannot open progress file '" << path << "'; progress disabled."
+           << G4endl;
+    return;
+  }
+  gReporter.path = path;
+  gReporter.runID = runID;
+  gReporter.eventsTotal = eventsTotal;
+  gReporter.start = std::chrono::steady_clock::now();
+  gReporter.stop = false;
+  WriteSnapshot("start");
+  gReporter.thread =
+      std::thread(ReportLoop, std::chrono::duration<double>(intervalSeconds > 0.0
+                                                                ? intervalSeconds
+                                                                : 1.0));
+}
+
+void EndRun() {
+  if (!gReporter.thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(gReporter.mutex);
+    gReporter.stop = true;
+  }
+  gReporter.wake.notify_all();
+  gReporter.thread.join();
+  WriteSnapshot("done");
+  gReporter.file.close();
+}
+
+std::int64_t RecordEvent(std::int64_t photonsGenerated, std::int64_t photonsDetected) {
+  gCounters.photonsGenerated.fetch_add(photonsGenerated, std::memory_order_relaxed);
+  gCounters.photonsDetected.fetch_add(photonsDetected, std::memory_order_relaxed);
+  return gCounters.eventsCompleted.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void RecordEventRejected() {
+  gCounters.eventsRejected.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordRowsWritten(std::int64_t rows, std::int64_t bytes) {
+  gCounters.rowsWritten.fetch_add(rows, std::memory_order_relaxed);
+  gCounters.bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void RecordOutputLock(std::int64_t waitNs, std::int64_t heldNs) {
+  gCounters.outputWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+  gCounters.outputHeldNs.fetch_add(heldNs, std::memory_order_relaxed);
+}
+
+Totals Current() {
+  Totals totals;
+  totals.eventsCompleted = gCounters.eventsCompleted.load(std::memory_order_relaxed);
+  totals.eventsRejected = gCounters.eventsRejected.load(std::memory_order_relaxed);
+  totals.photonsGenerated = gCounters.photonsGenerated.load(std::memory_order_relaxed);
+  totals.photonsDetected = gCounters.photonsDetected.load(std::memory_order_relaxed);
+  totals.rowsWritten = gCounters.rowsWritten.load(std::memory_order_relaxed);
+  totals.bytesWritten = gCounters.bytesWritten.load(std::memory_order_relaxed);
+  totals.outputWaitSeconds = gCounters.outputWaitNs.load(std::memory_order_relaxed) / 1e9;
+  totals.outputHeldSeconds = gCounters.outputHeldNs.load(std::memory_order_relaxed) / 1e9;
+  return totals;
+}
+
+}  // namespace Progress
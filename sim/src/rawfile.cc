@@ -0,0 +1,145 @@
+#include "rawfile.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace RawFile {
+
+Writer::~Writer() {
+  std::string ignored;
+  Close(&ignored);
+}
+
+bool Writer::Open(const std::string& path, std::size_t bufferBytes, bool direct,
+                  std::string* errorMessage) {
+  std::string ignored;
+  Close(&ignored);
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  int fd = -1;
+  if (direct) {
+    fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+  }
+  fDirect = fd >= 0;
+  if (fd < 0) {
+    fd = ::open(path.c_str(), flags, 0644);
+  }
+  if (fd < 0) {
+    *errorMessage = "Cannot create " + path + ": " + std::strerror(errno);
+    return false;
+  }
+  fCapacity = (std::max<std::size_t>(bufferBytes, 2 * kAlign) + kAlign - 1) / kAlign * kAlign;
+  fBuffer = static_cast<unsigned char*>(std::aligned_alloc(kAlign, fCapacity));
+  if (!fBuffer) {
+    ::close(fd);
+    *errorMessage = "Cannot allocate the write buffer for " + path;
+    return false;
+  }
+  fFd = fd;
+  fPath = path;
+  fUsed = 0;
+  fOffset = 0;
+  fError.clear();
+  return true;
+}
+
+bool Writer::Append(const void* data, std::size_t bytes) {
+  const auto* from = static_cast<const unsigned char*>(data);
+  while (bytes > 0) {
+    if (fUsed == fCapacity && !Flush()) {
+      return false;
+    }
+    const std::size_t chunk = std::min(bytes, fCapacity - fUsed);
+    std::memcpy(fBuffer + fUsed, from, chunk);
+    fUsed += chunk;
+    from += chunk;
+    bytes -= chunk;
+  }
+  return true;
+}
+
+unsigned char* Writer::Claim(std::size_t bytes) {
+  // After a flush at most kAlign - 1 bytes stay behind.
+  if (fFd < 0 || bytes > fCapacity - kAlign) {
+    return nullptr;
+  }
+  if (fCapacity - fUsed < bytes && !Flush()) {
+    return nullptr;
+  }
+  unsigned char* at = fBuffer + fUsed;
+  fUsed += bytes;
+  return at;
+}
+
+bool Writer::Flush() {
+  const std::size_t bytes = fDirect ? fUsed / kAlign * kAlign : fUsed;
+  if (bytes == 0) {
+    return fError.empty();
+  }
+  if (!WriteAt(fBuffer, bytes, fOffset)) {
+    return false;
+  }
+  std::memmove(fBuffer, fBuffer + bytes, fUsed - bytes);
+  fUsed -= bytes;
+  fOffset += bytes;
+  return true;
+}
+
+bool Writer::WriteAt(const unsigned char* data, std::size_t bytes, std::uint64_t offset) {
+  while (bytes > 0) {
+    const ssize_t written = ::pwrite(fFd, data, bytes, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      if (fError.empty()) {
+        fError = "Failed writing " + fPath + ": " + std::strerror(errno);
+      }
+      return false;
+    }
+    data += written;
+    bytes -= static_cast<std::size_t>(written);
+    offset += static_cast<std::uint64_t>(written);
+  }
+  return true;
+}
+
+bool Writer::Close(std::string* errorMessage) {
+  if (fFd < 0) {
+    return true;
+  }
+  bool ok = Flush();
+  if (ok && fUsed > 0) {
+    // The unaligned tail cannot go through O_DIRECT; finish it buffered.
+    if (fDirect) {
+      ::fcntl(fFd, F_SETFL, ::fcntl(fFd, F_GETFL) & ~O_DIRECT);
+    }
+    ok = WriteAt(fBuffer, fUsed, fOffset);
+    if (ok) {
+      fOffset += fUsed;
+      fUsed = 0;
+    }
+  }
+  if (::close(fFd) != 0 && ok) {
+    fError = "Failed closing " + fPath + ": " + std::strerror(errno);
+    ok = false;
+  }
+  fFd = -1;
+  if (!ok) {
+    *errorMessage = fError;
+  }
+  Release();
+  return ok;
+}
+
+void Writer::Release() {
+  std::free(fBuffer);
+  fBuffer = nullptr;
+  fCapacity = 0;
+}
+
+}  // namespace RawFile
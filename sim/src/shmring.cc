@@ -0,0 +1,419 @@
+#include "shmring.hh"
+
+#include "SimIO.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace {
+constexpr std::size_t kPageBytes = 4096;
+constexpr std::size_t kMinDataBytes = std::size_t{1} << 20;
+/// How often a blocked or dropping writer looks for readers whose process exited.
+constexpr std::chrono::milliseconds kReapInterval{100};
+constexpr std::chrono::microseconds kBlockPoll{50};
+
+/// Writer state; only touched under the caller's output lock (and by the
+/// master at run start and end).
+struct Writer {
+  ShmRing::Header* header = nullptr;
+  unsigned char* data = nullptr;
+  std::size_t mappedBytes = 0;
+  std::string name;
+  ShmRing::WriterSettings settings;
+  SimStructures::PhotonFieldMask photonFields = SimStructures::PhotonField::kAll;
+  ShmRing::WriterStats stats;
+  /// Last dead-reader check on the drop path.
+  std::chrono::steady_clock::time_point lastReap{};
+};
+
+Writer gWriter;
+
+std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+std::size_t HeaderBytes() { return AlignUp(sizeof(ShmRing::Header), kPageBytes); }
+
+// `shm_open` names start with one slash; accept them without it too.
+std::string SegmentName(const std::string& name) {
+  return !name.empty() && name.front() == '/' ? name : "/" + name;
+}
+
+std::string ErrnoText(const std::string& what) { return what + ": " + std::strerror(errno); }
+
+// Free claimed slots whose process no longer exists, so a crashed reader
+// cannot stall a blocking writer forever.
+void ReapDeadReaders(ShmRing::Header* header) {
+  for (auto& slot : header->readers) {
+    if (slot.active.load(std::memory_order_acquire) != 1) {
+      continue;
+    }
+    const auto pid = slot.pid.load(std::memory_order_relaxed);
+    if (pid > 0 && ::kill(pid, 0) != 0 && errno == ESRCH) {
+      slot.active.store(0, std::memory_order_release);
+    }
+  }
+}
+
+// True once every claimed reader has consumed enough that writing up to
+// ring position `end` leaves its unread batches intact.
+bool ReadersLeaveRoom(const ShmRing::Header* header, std::uint64_t end) {
+  for (const auto& slot : header->readers) {
+    if (slot.active.load(std::memory_order_acquire) == 1 &&
+        end - slot.cursor.load(std::memory_order_acquire) > header->dataBytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool WaitForReaders(std::uint64_t end) {
+  auto* header = gWriter.header;
+  if (ReadersLeaveRoom(header, end)) {
+    return true;
+  }
+  if (gWriter.settings.policy == ShmRing::Policy::kDrop) {
+    // Without the reap, one crashed reader would drop every later batch.
+    const auto now = std::chrono::steady_clock::now();
+    if (now - gWriter.lastReap < kReapInterval) {
+      return false;
+    }
+    gWriter.lastReap = now;
+    ReapDeadReaders(header);
+    return ReadersLeaveRoom(header, end);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  auto lastReap = start;
+  for (;;) {
+    std::this_thread::sleep_for(kBlockPoll);
+    if (ReadersLeaveRoom(header, end)) {
+      return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    if (gWriter.settings.blockTimeout.count() > 0 &&
+        now - start >= gWriter.settings.blockTimeout) {
+      return false;
+    }
+    if (now - lastReap >= kReapInterval) {
+      ReapDeadReaders(header);
+      lastReap = now;
+    }
+  }
+}
+}  // namespace
+
+namespace ShmRing {
+
+bool ParsePolicy(const std::string& value, Policy* policy) {
+  if (value == "block") {
+    *policy = Policy::kBlock;
+  } else if (value == "drop") {
+    *policy = Policy::kDrop;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* PolicyName(Policy policy) { return policy == Policy::kDrop ? "drop" : "block"; }
+
+bool BeginRun(const WriterSettings& settings,
+              SimStructures::PhotonFieldMask photonFields,
+              std::string* errorMessage) {
+  EndRun();
+  const auto columns = SimIO::detail::PhotonColumns(photonFields);
+  if (columns.size() > kMaxColumns) {
+    if (errorMessage) {
+      *errorMessage = "Too many /photons columns for the shared-memory ring.";
+    }
+    return false;
+  }
+
+  std::size_t dataBytes = kMinDataBytes;
+  while (dataBytes < settings.dataBytes) {
+    dataBytes <<= 1;
+  }
+  const std::size_t headerBytes = HeaderBytes();
+  const std::string name = SegmentName(settings.name);
+
+  // Replace, never reuse: readers still mapping an old segment see it closed.
+  ::shm_unlink(name.c_str());
+  const int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0666);
+  if (fd < 0) {
+    if (errorMessage) {
+      *errorMessage = ErrnoText("Failed creating shared-memory ring '" + name + "'");
+    }
+    return false;
+  }
+  const std::size_t mappedBytes = headerBytes + dataBytes;
+  void* address = MAP_FAILED;
+  if (::ftruncate(fd, static_cast<off_t>(mappedBytes)) == 0) {
+    address = ::mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (address == MAP_FAILED) {
+    if (errorMessage) {
+      *errorMessage = ErrnoText("Failed sizing shared-memory ring '" + name + "'");
+    }
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  ::close(fd);
+
+  auto* header = new (address) Header();
+  header->version = kVersion;
+  header->headerBytes = static_cast<std::uint32_t>(headerBytes);
+  header->dataBytes = dataBytes;
+  header->rowBytes = static_cast<std::uint32_t>(SimIO::PhotonRowBytes(photonFields));
+  header->photonFields = photonFields;
+  header->columnCount = static_cast<std::uint32_t>(columns.size());
+  header->policy = static_cast<std::uint32_t>(settings.policy);
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    auto& column = header->columns[i];
+    std::strncpy(column.name, columns[i].name, sizeof(column.name) - 1);
+    column.offset = static_cast<std::uint32_t>(columns[i].offset);
+    column.size = static_cast<std::uint32_t>(columns[i].size);
+    column.isFloat = columns[i].isFloat ? 1 : 0;
+  }
+  // Readers check the magic last-written, so they never see a half-built header.
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+
+  gWriter.header = header;
+  gWriter.data = static_cast<unsigned char*>(address) + headerBytes;
+  gWriter.mappedBytes = mappedBytes;
+  gWriter.name = name;
+  gWriter.settings = settings;
+  gWriter.settings.dataBytes = dataBytes;
+  gWriter.photonFields = photonFields;
+  gWriter.stats = WriterStats{};
+  gWriter.lastReap = {};
+  return true;
+}
+
+bool Active() { return gWriter.header != nullptr; }
+
+void Publish(std::int64_t eventId, SimStructures::RowSpan<SimStructures::PhotonInfo> photonRows) {
+  auto* header = gWriter.header;
+  if (!header) {
+    return;
+  }
+  const auto sequence = header->offeredBatches.load(std::memory_order_relaxed);
+  const std::uint64_t rowBytes = std::uint64_t{header->rowBytes} * photonRows.size;
+  const std::uint64_t dataBytes = header->dataBytes;
+  const std::uint64_t recordBytes = AlignUp(sizeof(RecordHeader) + rowBytes, kRecordAlign);
+  const std::uint64_t position = header->head.load(std::memory_order_relaxed);
+  const std::uint64_t toEnd = dataBytes - (position & (dataBytes - 1));
+  // A batch never straddles the end of the data area; the tail is padded.
+  const std::uint64_t wrapBytes = recordBytes > toEnd ? toEnd : 0;
+  const std::uint64_t end = position + wrapBytes + recordBytes;
+
+  if (recordBytes > dataBytes / 2 || !WaitForReaders(end)) {
+    header->droppedBatches.fetch_add(1, std::memory_order_relaxed);
+    header->droppedRows.fetch_add(photonRows.size, std::memory_order_relaxed);
+    header->offeredBatches.store(sequence + 1, std::memory_order_release);
+    ++gWriter.stats.droppedBatches;
+    gWriter.stats.droppedRows += photonRows.size;
+    return;
+  }
+
+  header->reserved.store(end, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (wrapBytes > 0) {
+    RecordHeader wrap{};
+    wrap.rowCount = kWrapRecord;
+    wrap.recordBytes = static_cast<std::uint32_t>(wrapBytes);
+    std::memcpy(gWriter.data + (position & (dataBytes - 1)), &wrap, sizeof(wrap));
+  }
+  RecordHeader record{};
+  record.sequence = sequence;
+  record.eventId = eventId;
+  record.rowCount = static_cast<std::uint32_t>(photonRows.size);
+  record.recordBytes = static_cast<std::uint32_t>(recordBytes);
+  unsigned char* at = gWriter.data + ((position + wrapBytes) & (dataBytes - 1));
+  std::memcpy(at, &record, sizeof(record));
+  // Rows are packed straight into the ring, with no staging copy.
+  SimIO::detail::PackPhotons(photonRows, gWriter.photonFields, at + sizeof(record));
+  header->offeredBatches.store(sequence + 1, std::memory_order_relaxed);
+  header->head.store(end, std::memory_order_release);
+  ++gWriter.stats.publishedBatches;
+  gWriter.stats.publishedRows += photonRows.size;
+}
+
+WriterStats EndRun() {
+  const auto stats = gWriter.stats;
+  if (gWriter.header) {
+    gWriter.header->closed.store(1, std::memory_order_release);
+    ::munmap(gWriter.header, gWriter.mappedBytes);
+    ::shm_unlink(gWriter.name.c_str());
+  }
+  gWriter = Writer{};
+  return stats;
+}
+
+Reader::~Reader() { Close(); }
+
+void Reader::Close() {
+  if (fSlot) {
+    fSlot->active.store(0, std::memory_order_release);
+    fSlot = nullptr;
+  }
+  if (fHeader) {
+    ::munmap(fHeader, fMappedBytes);
+    fHeader = nullptr;
+  }
+  fData = nullptr;
+}
+
+bool Reader::Open(const std::string& name,
+                  bool claimSlot,
+                  bool fromNewest,
+                  std::string* errorMessage) {
+  Close();
+  const std::string segment = SegmentName(name);
+  const auto fail = [&](const std::string& message) {
+    if (errorMessage) {
+      *errorMessage = message;
+    }
+    Close();
+    return false;
+  };
+
+  const int fd = ::shm_open(segment.c_str(), claimSlot ? O_RDWR : O_RDONLY, 0);
+  if (fd < 0) {
+    return fail(ErrnoText("Failed opening shared-memory ring '" + segment + "'"));
+  }
+  struct stat info {};
+  void* address = MAP_FAILED;
+  if (::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= HeaderBytes()) {
+    fMappedBytes = static_cast<std::size_t>(info.st_size);
+    address = ::mmap(nullptr, fMappedBytes, claimSlot ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, fd, 0);
+  }
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    return fail("Shared-memory ring '" + segment + "' is not ready.");
+  }
+  fHeader = static_cast<Header*>(address);
+  const bool magicMatches = std::memcmp(fHeader->magic, kMagic, sizeof(kMagic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!magicMatches || fHeader->version != kVersion ||
+      fHeader->headerBytes + fHeader->dataBytes != fMappedBytes) {
+    return fail("'" + segment + "' is not a g4emi ring (version " +
+                std::to_string(kVersion) + ").");
+  }
+  fData = static_cast<const unsigned char*>(address) + fHeader->headerBytes;
+
+  const auto head = fHeader->head.load(std::memory_order_acquire);
+  const bool wrapped = fHeader->reserved.load(std::memory_order_relaxed) > fHeader->dataBytes;
+  // Batch boundaries are only known from the start of the ring or its head.
+  fCursor = fromNewest || wrapped ? head : 0;
+  fSequenceKnown = fCursor == 0;
+  fNextSequence = 0;
+  fLost = 0;
+  fOverruns = 0;
+
+  if (claimSlot) {
+    for (auto& slot : fHeader->readers) {
+      std::uint32_t expected = 0;
+      // 2 holds the slot while its cursor is set; the writer only honors 1.
+      if (slot.active.compare_exchange_strong(expected, 2, std::memory_order_acq_rel)) {
+        slot.cursor.store(fCursor, std::memory_order_relaxed);
+        slot.pid.store(static_cast<std::int32_t>(::getpid()), std::memory_order_relaxed);
+        slot.active.store(1, std::memory_order_release);
+        fSlot = &slot;
+        break;
+      }
+    }
+    if (!fSlot) {
+      return fail("All " + std::to_string(kMaxReaders) + " reader slots of '" + segment +
+                  "' are claimed.");
+    }
+  }
+  return true;
+}
+
+Reader::Status Reader::Next(Batch* batch) {
+  if (!fHeader) {
+    return Status::kClosed;
+  }
+  const std::uint64_t dataBytes = fHeader->dataBytes;
+  const auto overrun = [&]() {
+    ++fOverruns;
+    fCursor = fHeader->head.load(std::memory_order_acquire);
+    if (fSlot) {
+      fSlot->cursor.store(fCursor, std::memory_order_release);
+    }
+  };
+
+  for (;;) {
+    const bool closed = fHeader->closed.load(std::memory_order_acquire) != 0;
+    const auto head = fHeader->head.load(std::memory_order_acquire);
+    if (fCursor == head) {
+      if (!closed) {
+        return Status::kEmpty;
+      }
+      // Batches dropped after the last published one are lost too.
+      const auto offered = fHeader->offeredBatches.load(std::memory_order_relaxed);
+      if (fSequenceKnown && offered > fNextSequence) {
+        fLost += offered - fNextSequence;
+        fNextSequence = offered;
+      }
+      return Status::kClosed;
+    }
+    if (head - fCursor > dataBytes) {
+      overrun();
+      continue;
+    }
+
+    const std::uint64_t offset = fCursor & (dataBytes - 1);
+    RecordHeader record{};
+    std::memcpy(&record, fData + offset, sizeof(record));
+    const bool wrap = record.rowCount == kWrapRecord;
+    const std::uint64_t rowBytes =
+        wrap ? 0 : static_cast<std::uint64_t>(record.rowCount) * fHeader->rowBytes;
+    const bool sane = record.recordBytes >= sizeof(record) &&
+                      record.recordBytes % kRecordAlign == 0 &&
+                      record.recordBytes <= dataBytes - offset &&
+                      sizeof(record) + rowBytes <= record.recordBytes;
+    if (sane && !wrap) {
+      batch->rows.assign(fData + offset + sizeof(record),
+                         fData + offset + sizeof(record) + rowBytes);
+    }
+    // Everything copied above is only trusted if the writer has not since
+    // started writing over it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!sane || fHeader->reserved.load(std::memory_order_relaxed) > fCursor + dataBytes) {
+      overrun();
+      continue;
+    }
+
+    fCursor += record.recordBytes;
+    if (fSlot) {
+      fSlot->cursor.store(fCursor, std::memory_order_release);
+    }
+    if (wrap) {
+      continue;
+    }
+    if (fSequenceKnown && record.sequence > fNextSequence) {
+      fLost += record.sequence - fNextSequence;
+    }
+    fNextSequence = record.sequence + 1;
+    fSequenceKnown = true;
+    batch->sequence = record.sequence;
+    batch->eventId = record.eventId;
+    batch->rowCount = record.rowCount;
+    return Status::kBatch;
+  }
+}
+
+}  // namespace ShmRing
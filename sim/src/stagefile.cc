@@ -0,0 +1,282 @@
+#include "stagefile.hh"
+
+#include "intensifier.hh"
+#include "timepix.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+namespace StageFile {
+
+hid_t InterfaceHitType(hid_t photonFileType, std::string* errorMessage) {
+  struct Column {
+    const char* name;
+    std::size_t offset;
+    hid_t type;
+    bool required;
+  };
+  const Column columns[] = {
+      {"gun_call_id", HOFFSET(InterfaceHit, gunCallId), H5T_NATIVE_INT64, false},
+      {"primary_track_id", HOFFSET(InterfaceHit, primaryTrackId), H5T_NATIVE_INT32, false},
+      {"secondary_track_id", HOFFSET(InterfaceHit, secondaryTrackId), H5T_NATIVE_INT32, false},
+      {"photon_track_id", HOFFSET(InterfaceHit, photonTrackId), H5T_NATIVE_INT32, false},
+      {"optical_interface_hit_x_mm", HOFFSET(InterfaceHit, x), H5T_NATIVE_DOUBLE, true},
+      {"optical_interface_hit_y_mm", HOFFSET(InterfaceHit, y), H5T_NATIVE_DOUBLE, true},
+      {"optical_interface_hit_time_ns", HOFFSET(InterfaceHit, timeNs), H5T_NATIVE_DOUBLE, false},
+      {"optical_interface_hit_dir_x", HOFFSET(InterfaceHit, dx), H5T_NATIVE_DOUBLE, true},
+      {"optical_interface_hit_dir_y", HOFFSET(InterfaceHit, dy), H5T_NATIVE_DOUBLE, true},
+      {"optical_interface_hit_dir_z", HOFFSET(InterfaceHit, dz), H5T_NATIVE_DOUBLE, true},
+      {"optical_interface_hit_wavelength_nm", HOFFSET(InterfaceHit, wavelengthNm),
+       H5T_NATIVE_DOUBLE, false},
+  };
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(InterfaceHit));
+  for (const auto& column : columns) {
+    if (H5Tget_member_index(photonFileType, column.name) >= 0) {
+      H5Tinsert(type, column.name, column.offset, column.type);
+    } else if (column.required) {
+      if (errorMessage) {
+        *errorMessage = std::string("/photons has no '") + column.name +
+                        "' column; rerun with /output/photonFields transport or full";
+      }
+      H5Tclose(type);
+      return -1;
+    }
+  }
+  return type;
+}
+
+hid_t TransportedPhotonType() {
+  using Photon = Intensifier::Photon;
+  // Matches the int8 enum h5py and `SimIO` store numpy bools as.
+  const hid_t boolType = H5Tenum_create(H5T_NATIVE_INT8);
+  const std::int8_t no = 0;
+  const std::int8_t yes = 1;
+  H5Tenum_insert(boolType, "FALSE", &no);
+  H5Tenum_insert(boolType, "TRUE", &yes);
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Photon));
+  H5Tinsert(type, "source_photon_index", HOFFSET(Photon, sourcePhotonIndex), H5T_NATIVE_INT64);
+  H5Tinsert(type, "gun_call_id", HOFFSET(Photon, gunCallId), H5T_NATIVE_INT64);
+  H5Tinsert(type, "primary_track_id", HOFFSET(Photon, primaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "secondary_track_id", HOFFSET(Photon, secondaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "photon_track_id", HOFFSET(Photon, photonTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "intensifier_hit_x_mm", HOFFSET(Photon, xMm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_y_mm", HOFFSET(Photon, yMm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_time_ns", HOFFSET(Photon, timeNs), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "intensifier_hit_wavelength_nm", HOFFSET(Photon, wavelengthNm),
+            H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "in_bounds", HOFFSET(Photon, inBounds), boolType);
+  H5Tclose(boolType);
+  return type;
+}
+
+// The file copy is packed like `_INTENSIFIER_OUTPUT_DTYPE` in `src/intensifier/io.py`.
+hid_t IntensifierEventType() {
+  using Event = Intensifier::OutputEvent;
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Event));
+  H5Tinsert(type, "source_photon_index", HOFFSET(Event, sourcePhotonIndex), H5T_NATIVE_INT64);
+  H5Tinsert(type, "gun_call_id", HOFFSET(Event, gunCallId), H5T_NATIVE_INT64);
+  H5Tinsert(type, "primary_track_id", HOFFSET(Event, primaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "secondary_track_id", HOFFSET(Event, secondaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "photon_track_id", HOFFSET(Event, photonTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "output_x_mm", HOFFSET(Event, outputXmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "output_y_mm", HOFFSET(Event, outputYmm), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "output_time_ns", HOFFSET(Event, outputTimeNs), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "signal_amplitude_arb", HOFFSET(Event, signalAmplitudeArb), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "total_gain", HOFFSET(Event, totalGain), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "wavelength_nm", HOFFSET(Event, wavelengthNm), H5T_NATIVE_DOUBLE);
+  return type;
+}
+
+// The file copy is packed like the numpy dtype in `src/sensor/io.py`.
+hid_t TimepixHitType() {
+  using Hit = Timepix::Hit;
+  const hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(Hit));
+  H5Tinsert(type, "gun_call_id", HOFFSET(Hit, gunCallId), H5T_NATIVE_INT64);
+  H5Tinsert(type, "primary_track_id", HOFFSET(Hit, primaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "secondary_track_id", HOFFSET(Hit, secondaryTrackId), H5T_NATIVE_INT32);
+  H5Tinsert(type, "x_pixel", HOFFSET(Hit, xPixel), H5T_NATIVE_INT32);
+  H5Tinsert(type, "y_pixel", HOFFSET(Hit, yPixel), H5T_NATIVE_INT32);
+  H5Tinsert(type, "time_of_arrival_ns", HOFFSET(Hit, timeOfArrivalNs), H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "time_over_threshold_ns", HOFFSET(Hit, timeOverThresholdNs),
+            H5T_NATIVE_DOUBLE);
+  H5Tinsert(type, "contribution_count", HOFFSET(Hit, contributionCount), H5T_NATIVE_INT32);
+  return type;
+}
+
+hid_t CreateTable(hid_t file, const char* name, hid_t memoryType, hsize_t chunkRows) {
+  const hid_t fileType = H5Tcopy(memoryType);
+  H5Tpack(fileType);
+  const hsize_t initial = 0;
+  const hsize_t unlimited = H5S_UNLIMITED;
+  const hid_t space = H5Screate_simple(1, &initial, &unlimited);
+  const hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dcpl, 1, &chunkRows);
+  const hid_t dataset = H5Dcreate2(file, name, fileType, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+  H5Pclose(dcpl);
+  H5Sclose(space);
+  H5Tclose(fileType);
+  return dataset;
+}
+
+hsize_t RowCount(hid_t dataset) {
+  const hid_t space = H5Dget_space(dataset);
+  hsize_t rows = 0;
+  H5Sget_simple_extent_dims(space, &rows, nullptr);
+  H5Sclose(space);
+  return rows;
+}
+
+bool ReadRows(hid_t dataset, hid_t memoryType, hsize_t first, hsize_t count, void* rows) {
+  if (count == 0) {
+    return true;
+  }
+  const hid_t fileSpace = H5Dget_space(dataset);
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &first, nullptr, &count, nullptr);
+  const hid_t memorySpace = H5Screate_simple(1, &count, nullptr);
+  const bool ok = H5Dread(dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, rows) >= 0;
+  H5Sclose(memorySpace);
+  H5Sclose(fileSpace);
+  return ok;
+}
+
+bool AppendRows(hid_t dataset, hid_t memoryType, const void* rows, std::size_t count) {
+  if (count == 0) {
+    return true;
+  }
+  hsize_t offset = RowCount(dataset);
+  const hsize_t rowCount = count;
+  const hsize_t extent = offset + rowCount;
+  if (H5Dset_extent(dataset, &extent) < 0) {
+    return false;
+  }
+  const hid_t fileSpace = H5Dget_space(dataset);
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &offset, nullptr, &rowCount, nullptr);
+  const hid_t memorySpace = H5Screate_simple(1, &rowCount, nullptr);
+  const bool ok = H5Dwrite(dataset, memoryType, memorySpace, fileSpace, H5P_DEFAULT, rows) >= 0;
+  H5Sclose(memorySpace);
+  H5Sclose(fileSpace);
+  return ok;
+}
+
+bool CopyEventTables(hid_t source, hid_t destination) {
+  bool ok = true;
+  for (const char* name : {"primaries", "secondaries"}) {
+    if (H5Lexists(source, name, H5P_DEFAULT) <= 0) {
+      continue;
+    }
+    if (H5Lexists(destination, name, H5P_DEFAULT) > 0) {
+      ok = H5Ldelete(destination, name, H5P_DEFAULT) >= 0 && ok;
+    }
+    ok = H5Ocopy(source, name, destination, name, H5P_DEFAULT, H5P_DEFAULT) >= 0 && ok;
+  }
+  return ok;
+}
+
+bool FinishTransportFile(const std::string& inputPath,
+                         const std::string& outputPath,
+                         std::string* errorMessage) {
+  const hid_t input = H5Fopen(inputPath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  const hid_t output = H5Fopen(outputPath.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  bool ok = input >= 0 && output >= 0;
+  for (const char* name : {"primaries", "secondaries", "photons"}) {
+    if (ok && H5Lexists(output, name, H5P_DEFAULT) > 0) {
+      ok = H5Ldelete(output, name, H5P_DEFAULT) >= 0;
+    }
+  }
+  ok = ok && CopyEventTables(input, output);
+  if (output >= 0) {
+    H5Fclose(output);
+  }
+  if (input >= 0) {
+    H5Fclose(input);
+  }
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed copying /primaries and /secondaries from " + inputPath;
+  }
+  return ok;
+}
+
+bool CopyAttribute(hid_t source, hid_t destination, const char* name) {
+  if (H5Aexists(source, name) <= 0) {
+    return false;
+  }
+  const hid_t attribute = H5Aopen(source, name, H5P_DEFAULT);
+  const hid_t type = H5Aget_type(attribute);
+  const hid_t space = H5Aget_space(attribute);
+  const hssize_t points = H5Sget_simple_extent_npoints(space);
+  std::vector<unsigned char> value(static_cast<std::size_t>(points) * H5Tget_size(type));
+  bool copied = false;
+  if (H5Aread(attribute, type, value.data()) >= 0) {
+    const hid_t copy = H5Acreate2(destination, name, type, space, H5P_DEFAULT, H5P_DEFAULT);
+    if (copy >= 0) {
+      copied = H5Awrite(copy, type, value.data()) >= 0;
+      H5Aclose(copy);
+    }
+    if (H5Tis_variable_str(type) > 0) {
+      H5Dvlen_reclaim(type, space, H5P_DEFAULT, value.data());
+    }
+  }
+  H5Sclose(space);
+  H5Tclose(type);
+  H5Aclose(attribute);
+  return copied;
+}
+
+bool WriteStringAttribute(hid_t object, const char* name, const std::string& value) {
+  const hid_t type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(type, H5T_VARIABLE);
+  H5Tset_cset(type, H5T_CSET_UTF8);
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  const hid_t attribute = H5Acreate2(object, name, type, scalar, H5P_DEFAULT, H5P_DEFAULT);
+  bool ok = false;
+  if (attribute >= 0) {
+    const char* text = value.c_str();
+    ok = H5Awrite(attribute, type, &text) >= 0;
+    H5Aclose(attribute);
+  }
+  H5Sclose(scalar);
+  H5Tclose(type);
+  return ok;
+}
+
+bool WriteUint64Attribute(hid_t object, const char* name, std::uint64_t value) {
+  const hid_t scalar = H5Screate(H5S_SCALAR);
+  const hid_t attribute =
+      H5Acreate2(object, name, H5T_STD_U64LE, scalar, H5P_DEFAULT, H5P_DEFAULT);
+  bool ok = false;
+  if (attribute >= 0) {
+    ok = H5Awrite(attribute, H5T_NATIVE_UINT64, &value) >= 0;
+    H5Aclose(attribute);
+  }
+  H5Sclose(scalar);
+  return ok;
+}
+
+std::string UtcNowIso() {
+  const auto now = std::chrono::system_clock::now();
+  const std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+  const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          now.time_since_epoch()).count() % 1000000;
+  std::tm utc{};
+  gmtime_r(&seconds, &utc);
+  char text[64];
+  std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+  char full[80];
+  std::snprintf(full, sizeof(full), "%s.%06lld+00:00", text, static_cast<long long>(micros));
+  return full;
+}
+
+std::string AbsolutePath(const std::string& path) {
+  char* resolved = realpath(path.c_str(), nullptr);
+  if (!resolved) {
+    return path;
+  }
+  std::string absolute(resolved);
+  std::free(resolved);
+  return absolute;
+}
+
+}  // namespace StageFile
@@ -0,0 +1,139 @@
+#include "stepprofiler.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4Step.hh"
+#include "G4StepPoint.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VProcess.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+namespace {
+using NamedKey = std::tuple<std::string, std::string, std::string>;
+
+/// Named run totals; per-thread process pointers differ, names do not.
+struct NamedEntry {
+  double steps = 0.0;
+  double seconds = 0.0;
+};
+
+std::mutex gTotalsMutex;
+std::map<NamedKey, NamedEntry> gTotals;
+
+/// Tick/steady_clock pair taken at thread run start to calibrate ticks.
+struct Calibration {
+  std::uint64_t ticks = 0;
+  std::chrono::steady_clock::time_point time;
+};
+
+thread_local Calibration tCalibration;
+}  // namespace
+
+namespace StepProfiler {
+
+void Record(ThreadState* state, const G4Step* step, std::uint64_t ticks) {
+  Key key;
+  key.particle = step->GetTrack()->GetParticleDefinition();
+  if (const auto* postStepPoint = step->GetPostStepPoint()) {
+    key.process = postStepPoint->GetProcessDefinedStep();
+  }
+  if (const auto* volume = step->GetPreStepPoint()->GetPhysicalVolume()) {
+    key.volume = volume->GetLogicalVolume();
+  }
+  auto& entry = state->entries[key];
+  ++entry.steps;
+  entry.ticks += ticks;
+}
+
+void BeginThreadRun(G4int sampleEvery) {
+  auto& state = Local();
+  state.sampleEvery = std::max(sampleEvery, 0);
+  state.countdown = state.sampleEvery;
+  state.armed = false;
+  state.entries.clear();
+  tCalibration.ticks = ReadTicks();
+  tCalibration.time = std::chrono::steady_clock::now();
+}
+
+void EndThreadRun() {
+  auto& state = Local();
+  if (state.sampleEvery <= 0) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - tCalibration.time;
+  const double elapsedTicks = static_cast<double>(ReadTicks() - tCalibration.ticks);
+  const double secondsPerTick = elapsedTicks > 0.0 ? elapsed.count() / elapsedTicks : 0.0;
+  const double scale = static_cast<double>(state.sampleEvery);
+
+  std::lock_guard<std::mutex> lock(gTotalsMutex);
+  for (const auto& [key, entry] : state.entries) {
+    NamedKey name{key.particle ? std::string(key.particle->GetParticleName()) : "unknown",
+                  key.process ? std::string(key.process->GetProcessName()) : "none",
+                  key.volume ? std::string(key.volume->GetName()) : "OutOfWorld"};
+    auto& total = gTotals[name];
+    total.steps += entry.steps * scale;
+    total.seconds += entry.ticks * secondsPerTick * scale;
+  }
+  state.entries.clear();
+  state.sampleEvery = 0;
+}
+
+std::vector<SimIO::ProfileInfo> TakeRows() {
+  std::map<NamedKey, NamedEntry> totals;
+  {
+    std::lock_guard<std::mutex> lock(gTotalsMutex);
+    totals.swap(gTotals);
+  }
+
+  double totalSeconds = 0.0;
+  for (const auto& entry : totals) {
+    totalSeconds += entry.second.seconds;
+  }
+  std::vector<SimIO::ProfileInfo> rows;
+  rows.reserve(totals.size());
+  for (const auto& [name, entry] : totals) {
+    SimIO::ProfileInfo row;
+    std::tie(row.particle, row.process, row.volume) = name;
+    row.steps = static_cast<std::int64_t>(entry.steps + 0.5);
+    row.seconds = entry.seconds;
+    row.fraction = totalSeconds > 0.0 ? entry.seconds / totalSeconds : 0.0;
+    rows.push_back(std::move(row));
+  }
+  std::sort(rows.begin(), rows.end(),
+            [](const auto& a, const auto& b) { return a.seconds > b.seconds; });
+  return rows;
+}
+
+void Report(G4int runID, const std::vector<SimIO::ProfileInfo>& rows, std::size_t limit) {
+  if (rows.empty()) {
+    return;
+  }
+  std::ostringstream table;
+  table << "[g4emi] Run " << runID << " step profile (top "
+        << std::min(limit, rows.size()) << " of " << rows.size() << " buckets):\n"
+        << "[g4emi]   " << std::setw(7) << "share" << std::setw(12) << "seconds"
+        << std::setw(14) << "steps" << std::setw(12) << "ns/step"
+        << "  particle / process / volume";
+  table << std::fixed;
+  for (std::size_t i = 0; i < rows.size() && i < limit; ++i) {
+    const auto& row = rows[i];
+    table << "\n[g4emi]   " << std::setprecision(1) << std::setw(6) << row.fraction * 100.0
+          << "%" << std::setprecision(3) << std::setw(12) << row.seconds << std::setw(14)
+          << row.steps << std::setprecision(1) << std::setw(12)
+          << (row.steps > 0 ? row.seconds * 1e9 / row.steps : 0.0) << "  " << row.particle
+          << " / " << row.process << " / " << row.volume;
+  }
+  G4cout << table.str() << G4endl;
+}
+
+}  // namespace StepProfiler
@@ -0,0 +1,331 @@
+#include "timepix.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace {
+// Events handed to `Drain`'s consumer per call.
+constexpr std::size_t kDrainBatch = 1 << 16;
+// Smallest per-chunk read buffer while merging spilled chunks.
+constexpr std::size_t kMinMergeBuffer = 1 << 10;
+
+// Sorted range of events, consumed from the front during a k-way merge.
+struct Cursor {
+  const Timepix::Event* next;
+  const Timepix::Event* end;
+};
+
+// Heap order so the earliest head is on top.
+struct LaterHead {
+  bool operator()(const Cursor& a, const Cursor& b) const {
+    return Timepix::EventBefore(*b.next, *a.next);
+  }
+};
+}  // namespace
+
+namespace Timepix {
+
+bool ApplyOption(const std::string& flag, const std::string& value, Params* params) {
+  if (flag == "--pixels-x") {
+    params->pixelsX = std::stoi(value);
+  } else if (flag == "--pixels-y") {
+    params->pixelsY = std::stoi(value);
+  } else if (flag == "--pixel-pitch") {
+    params->pixelPitchMm = std::stod(value);
+  } else if (flag == "--max-tot") {
+    params->maxTotNs = std::stod(value);
+  } else if (flag == "--dead-time") {
+    params->deadTimeNs = std::stod(value);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* OptionsUsage() {
+  return "  --pixels-x N             Pixels along x (default: 256).\n"
+         "  --pixels-y N             Pixels along y (default: 256).\n"
+         "  --pixel-pitch MM         Pixel pitch (default: 0.055).\n"
+         "  --max-tot NS             ToT ceiling (default: 25550).\n"
+         "  --dead-time NS           Dead time after each hit (default: 475).\n";
+}
+
+bool ValidateParams(const Params& params, std::string* errorMessage) {
+  if (params.pixelsX <= 0 || params.pixelsY <= 0 || !(params.pixelPitchMm > 0.0) ||
+      !(params.maxTotNs > 0.0) || !(params.deadTimeNs >= 0.0)) {
+    if (errorMessage) {
+      *errorMessage =
+          "pixel counts, pitch, and max ToT must be positive and dead time non-negative";
+    }
+    return false;
+  }
+  return true;
+}
+
+bool MapToPixel(const Params& params,
+                double xMm,
+                double yMm,
+                std::int32_t* xPixel,
+                std::int32_t* yPixel) {
+  const double halfWidthMm = params.SensorWidthMm() / 2.0;
+  const double halfHeightMm = params.SensorHeightMm() / 2.0;
+  if (!(xMm >= -halfWidthMm && xMm < halfWidthMm && yMm >= -halfHeightMm &&
+        yMm < halfHeightMm)) {
+    return false;
+  }
+  *xPixel = static_cast<std::int32_t>(std::floor((xMm + halfWidthMm) / params.pixelPitchMm));
+  *yPixel = static_cast<std::int32_t>(std::floor((yMm + halfHeightMm) / params.pixelPitchMm));
+  return true;
+}
+
+EventSorter::EventSorter(std::size_t chunkEvents)
+    : fChunkEvents(std::max<std::size_t>(chunkEvents, 1)) {}
+
+EventSorter::~EventSorter() {
+  if (fSpill) {
+    std::fclose(fSpill);
+  }
+}
+
+// Sort each single-event run of the chunk, then merge the runs into `fSorted`.
+void EventSorter::SortChunk() {
+  std::vector<Cursor> runs;
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i <= fChunk.size(); ++i) {
+    if (i < fChunk.size() && fChunk[i].gunCallId == fChunk[begin].gunCallId) {
+      continue;
+    }
+    Event* first = fChunk.data() + begin;
+    Event* last = fChunk.data() + i;
+    if (!std::is_sorted(first, last, EventBefore)) {
+      std::sort(first, last, EventBefore);
+    }
+    runs.push_back({first, last});
+    begin = i;
+  }
+
+  fSorted.clear();
+  if (runs.size() == 1) {
+    fSorted.swap(fChunk);
+  } else if (!runs.empty()) {
+    fSorted.reserve(fChunk.size());
+    std::priority_queue<Cursor, std::vector<Cursor>, LaterHead> heap(LaterHead{},
+                                                                     std::move(runs));
+    // Events rarely overlap in time, so copy from the earliest run until it
+    // passes the next run's head rather than paying a heap step per row.
+    while (!heap.empty()) {
+      Cursor cursor = heap.top();
+      heap.pop();
+      const Event* limit = heap.empty() ? nullptr : heap.top().next;
+      do {
+        fSorted.push_back(*cursor.next);
+      } while (++cursor.next != cursor.end && (!limit || EventBefore(*cursor.next, *limit)));
+      if (cursor.next != cursor.end) {
+        heap.push(cursor);
+      }
+    }
+  }
+  fChunk.clear();
+}
+
+bool EventSorter::Spill(std::string* errorMessage) {
+  if (!fSpill) {
+    fSpill = std::tmpfile();
+    if (!fSpill) {
+      if (errorMessage) {
+        *errorMessage = "Cannot create a temporary file for sorted Timepix events";
+      }
+      return false;
+    }
+  }
+  if (std::fseek(fSpill, 0, SEEK_END) != 0) {
+    return false;
+  }
+  Run run;
+  run.offset = std::ftell(fSpill);
+  run.count = fSorted.size();
+  if (std::fwrite(fSorted.data(), sizeof(Event), run.count, fSpill) != run.count) {
+    if (errorMessage) {
+      *errorMessage = "Failed writing sorted Timepix events to the temporary file";
+    }
+    return false;
+  }
+  fRuns.push_back(run);
+  ++fSpilled;
+  fSorted.clear();
+  return true;
+}
+
+bool EventSorter::Add(const Event* events, std::size_t count, std::string* errorMessage) {
+  while (count > 0) {
+    if (fChunk.size() == fChunkEvents) {
+      SortChunk();
+      if (!Spill(errorMessage)) {
+        return false;
+      }
+    }
+    if (fChunk.capacity() < fChunkEvents) {
+      fChunk.reserve(fChunkEvents);
+    }
+    const std::size_t take = std::min(count, fChunkEvents - fChunk.size());
+    fChunk.insert(fChunk.end(), events, events + take);
+    events += take;
+    count -= take;
+  }
+  return true;
+}
+
+bool EventSorter::Drain(const std::function<void(const Event*, std::size_t)>& consume,
+                        std::string* errorMessage) {
+  SortChunk();
+  if (fRuns.empty()) {
+    for (std::size_t i = 0; i < fSorted.size(); i += kDrainBatch) {
+      consume(fSorted.data() + i, std::min(kDrainBatch, fSorted.size() - i));
+    }
+    fSorted.clear();
+    return true;
+  }
+  if (!fSorted.empty() && !Spill(errorMessage)) {
+    return false;
+  }
+  std::vector<Event>().swap(fChunk);
+  std::vector<Event>().swap(fSorted);
+
+  // One read buffer per spilled chunk, together about one chunk in size.
+  const std::size_t bufferEvents = std::max(kMinMergeBuffer, fChunkEvents / fRuns.size());
+  std::vector<std::vector<Event>> buffers(fRuns.size());
+  const auto refill = [&](std::size_t run, Cursor* cursor) {
+    auto& source = fRuns[run];
+    auto& buffer = buffers[run];
+    const std::size_t count = std::min(bufferEvents, source.count);
+    buffer.resize(count);
+    if (count == 0 || std::fseek(fSpill, source.offset, SEEK_SET) != 0 ||
+        std::fread(buffer.data(), sizeof(Event), count, fSpill) != count) {
+      return false;
+    }
+    source.offset += static_cast<long>(count * sizeof(Event));
+    source.count -= count;
+    *cursor = {buffer.data(), buffer.data() + count};
+    return true;
+  };
+
+  // Heap entries carry their chunk so an exhausted buffer can be refilled.
+  struct Head {
+    Cursor cursor;
+    std::size_t run;
+  };
+  const auto later = [](const Head& a, const Head& b) {
+    return EventBefore(*b.cursor.next, *a.cursor.next);
+  };
+  std::priority_queue<Head, std::vector<Head>, decltype(later)> heap(later);
+  for (std::size_t run = 0; run < fRuns.size(); ++run) {
+    Head head{{nullptr, nullptr}, run};
+    if (refill(run, &head.cursor)) {
+      heap.push(head);
+    }
+  }
+
+  std::vector<Event> batch;
+  batch.reserve(kDrainBatch);
+  bool ok = true;
+  while (ok && !heap.empty()) {
+    Head head = heap.top();
+    heap.pop();
+    const Event* limit = heap.empty() ? nullptr : heap.top().cursor.next;
+    for (;;) {
+      batch.push_back(*head.cursor.next);
+      if (batch.size() == kDrainBatch) {
+        consume(batch.data(), batch.size());
+        batch.clear();
+      }
+      if (++head.cursor.next == head.cursor.end) {
+        if (fRuns[head.run].count == 0) {
+          break;
+        }
+        if (!refill(head.run, &head.cursor)) {
+          ok = false;
+          break;
+        }
+      }
+      if (limit && !EventBefore(*head.cursor.next, *limit)) {
+        heap.push(head);
+        break;
+      }
+    }
+  }
+  if (ok && !batch.empty()) {
+    consume(batch.data(), batch.size());
+  }
+  std::fclose(fSpill);
+  fSpill = nullptr;
+  fRuns.clear();
+  if (!ok && errorMessage) {
+    *errorMessage = "Failed reading sorted Timepix events from the temporary file";
+  }
+  return ok;
+}
+
+Engine::Engine(const Params& params)
+    : fParams(params),
+      fStride(static_cast<std::size_t>(params.pixelsX) + 1),
+      fHitEndNs(fStride * (static_cast<std::size_t>(params.pixelsY) + 1),
+                -std::numeric_limits<double>::infinity()),
+      fHitIndex(fHitEndNs.size(), 0) {}
+
+void Engine::Consume(const Event& event) {
+  fNowNs = event.timeNs;
+  const std::size_t pixel =
+      static_cast<std::size_t>(event.yPixel) * fStride + static_cast<std::size_t>(event.xPixel);
+  // Same operand order as the Python `min` calls so NaNs propagate alike.
+  const double totNs = std::min(event.amplitude, fParams.maxTotNs);
+  double& hitEndNs = fHitEndNs[pixel];
+
+  if (event.timeNs < hitEndNs) {
+    // Still over threshold: extend the open hit.
+    const double mergedTotNs = std::min(fParams.maxTotNs, (hitEndNs - event.timeNs) + totNs);
+    hitEndNs = event.timeNs + mergedTotNs;
+    auto& pending = fPending[static_cast<std::size_t>(fHitIndex[pixel] - fReleased)];
+    pending.hit.timeOverThresholdNs = mergedTotNs;
+    pending.hit.contributionCount += 1;
+    pending.endNs = hitEndNs;
+    return;
+  }
+  if (event.timeNs < hitEndNs + fParams.deadTimeNs) {
+    return;
+  }
+
+  PendingHit pending;
+  pending.hit.gunCallId = event.gunCallId;
+  pending.hit.primaryTrackId = event.primaryTrackId;
+  pending.hit.secondaryTrackId = event.secondaryTrackId;
+  pending.hit.xPixel = event.xPixel;
+  pending.hit.yPixel = event.yPixel;
+  pending.hit.timeOverThresholdNs = totNs;
+  pending.hit.contributionCount = 1;
+  pending.endNs = event.timeNs + totNs;
+  hitEndNs = pending.endNs;
+  fHitIndex[pixel] = HitCount();
+  fPending.push_back(pending);
+}
+
+void Engine::TakeFinished(std::vector<Hit>* hits) {
+  // Later events are no earlier than `fNowNs`, and only an event before a
+  // hit's end merges into it. A NaN end never merges either.
+  while (!fPending.empty() && !(fPending.front().endNs > fNowNs)) {
+    hits->push_back(fPending.front().hit);
+    fPending.pop_front();
+    ++fReleased;
+  }
+}
+
+void Engine::Finish(std::vector<Hit>* hits) {
+  for (const auto& pending : fPending) {
+    hits->push_back(pending.hit);
+  }
+  fReleased += fPending.size();
+  fPending.clear();
+}
+
+}  // namespace Timepix
@@ -0,0 +1,199 @@
+#include "timinghistograms.hh"
+
+#include "SimIO.hh"
+#include "config.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+/// One fixed-range histogram plus the entries that fell outside it.
+struct Counts {
+  std::vector<std::uint64_t> bins;
+  std::uint64_t underflow = 0;
+  std::uint64_t overflow = 0;
+};
+
+/// Creation-delay and arrival histograms for one species label.
+struct SpeciesHistograms {
+  Counts delay;
+  Counts arrival;
+};
+
+/// Counts owned by one thread (or, once handed over, the run totals).
+struct Histograms {
+  bool enabled = false;
+  TimingBinning binning;
+  std::map<std::string, SpeciesHistograms> primary;
+  std::map<std::string, SpeciesHistograms> secondary;
+  std::uint64_t photons = 0;
+  std::uint64_t missingDelay = 0;
+};
+
+thread_local Histograms tHistograms;
+
+std::mutex gMergedMutex;
+Histograms gMerged;
+
+void Add(Counts* counts, G4int bins, G4double max, G4double value) {
+  if (counts->bins.empty()) {
+    counts->bins.assign(bins, 0);
+  }
+  if (value < 0.0) {
+    ++counts->underflow;
+    return;
+  }
+  const G4double bin = value * bins / max;
+  if (!(bin < bins)) {
+    ++counts->overflow;
+    return;
+  }
+  ++counts->bins[static_cast<std::size_t>(bin)];
+}
+
+void Accumulate(Counts* total, Counts* part) {
+  if (total->bins.empty()) {
+    total->bins.swap(part->bins);
+  } else {
+    for (std::size_t i = 0; i < part->bins.size(); ++i) {
+      total->bins[i] += part->bins[i];
+    }
+  }
+  total->underflow += part->underflow;
+  total->overflow += part->overflow;
+}
+
+void AccumulateSpecies(std::map<std::string, SpeciesHistograms>* total,
+                       std::map<std::string, SpeciesHistograms>* part) {
+  for (auto& [species, histograms] : *part) {
+    auto& merged = (*total)[species];
+    Accumulate(&merged.delay, &histograms.delay);
+    Accumulate(&merged.arrival, &histograms.arrival);
+  }
+  part->clear();
+}
+
+// Append one dataset per species; species without entries in `counts` are skipped.
+void AppendDatasets(const std::string& prefix,
+                    Counts SpeciesHistograms::*counts,
+                    G4double max,
+                    std::map<std::string, SpeciesHistograms>* bySpecies,
+                    std::vector<SimIO::CountsInfo>* datasets) {
+  for (auto& [species, histograms] : *bySpecies) {
+    auto& source = histograms.*counts;
+    if (source.bins.empty()) {
+      continue;
+    }
+    SimIO::CountsInfo dataset;
+    // Species labels are HDF5 link names here; '/' would add a group level.
+    std::string label = species.empty() ? std::string("unknown") : species;
+    std::replace(label.begin(), label.end(), '/', '_');
+    dataset.name = prefix + label;
+    dataset.shape = {source.bins.size()};
+    dataset.counts = std::move(source.bins);
+    dataset.attributes = {{"range_min_ns", 0.0},
+                          {"range_max_ns", max / ns},
+                          {"underflow", static_cast<std::int64_t>(source.underflow)},
+                          {"overflow", static_cast<std::int64_t>(source.overflow)}};
+    datasets->push_back(std::move(dataset));
+  }
+}
+}  // namespace
+
+namespace TimingHistograms {
+
+void BeginThreadRun(const TimingBinning& binning) {
+  auto& histograms = tHistograms;
+  histograms.enabled = binning.Enabled();
+  histograms.binning = binning;
+  histograms.primary.clear();
+  histograms.secondary.clear();
+  histograms.photons = 0;
+  histograms.missingDelay = 0;
+}
+
+bool Enabled() {
+  return tHistograms.enabled;
+}
+
+void Fill(const std::string& primarySpecies,
+          const std::string& secondarySpecies,
+          bool hasDelay,
+          G4double creationDelay,
+          G4double arrivalTime) {
+  auto& histograms = tHistograms;
+  if (!histograms.enabled) {
+    return;
+  }
+  ++histograms.photons;
+  const auto& binning = histograms.binning;
+  auto& primary = histograms.primary[primarySpecies];
+  auto& secondary = histograms.secondary[secondarySpecies];
+  Add(&primary.arrival, binning.bins, binning.arrivalMax, arrivalTime);
+  Add(&secondary.arrival, binning.bins, binning.arrivalMax, arrivalTime);
+  if (!hasDelay) {
+    ++histograms.missingDelay;
+    return;
+  }
+  Add(&primary.delay, binning.bins, binning.delayMax, creationDelay);
+  Add(&secondary.delay, binning.bins, binning.delayMax, creationDelay);
+}
+
+void EndThreadRun() {
+  auto& histograms = tHistograms;
+  if (!histograms.enabled) {
+    return;
+  }
+  histograms.enabled = false;
+
+  std::lock_guard<std::mutex> lock(gMergedMutex);
+  if (!gMerged.enabled) {
+    gMerged.enabled = true;
+    gMerged.binning = histograms.binning;
+  }
+  AccumulateSpecies(&gMerged.primary, &histograms.primary);
+  AccumulateSpecies(&gMerged.secondary, &histograms.secondary);
+  gMerged.photons += histograms.photons;
+  gMerged.missingDelay += histograms.missingDelay;
+}
+
+bool WriteRun(const std::string& hdf5Path, std::int64_t* photons, std::string* errorMessage) {
+  Histograms merged;
+  {
+    std::lock_guard<std::mutex> lock(gMergedMutex);
+    std::swap(merged, gMerged);
+  }
+  if (photons) {
+    *photons = static_cast<std::int64_t>(merged.photons);
+  }
+  if (!merged.enabled) {
+    return true;
+  }
+
+  const auto& binning = merged.binning;
+  std::vector<SimIO::CountsInfo> datasets;
+  AppendDatasets("creation_delay/primary/", &SpeciesHistograms::delay, binning.delayMax,
+                 &merged.primary, &datasets);
+  AppendDatasets("creation_delay/secondary/", &SpeciesHistograms::delay, binning.delayMax,
+                 &merged.secondary, &datasets);
+  AppendDatasets("arrival/primary/", &SpeciesHistograms::arrival, binning.arrivalMax,
+                 &merged.primary, &datasets);
+  AppendDatasets("arrival/secondary/", &SpeciesHistograms::arrival, binning.arrivalMax,
+                 &merged.secondary, &datasets);
+
+  const std::vector<SimIO::RunStatistic> attributes = {
+      {"photons", static_cast<std::int64_t>(merged.photons)},
+      {"missing_interaction_time", static_cast<std::int64_t>(merged.missingDelay)},
+      {"bins", static_cast<std::int64_t>(binning.bins)},
+      {"creation_delay_max_ns", binning.delayMax / ns},
+      {"arrival_max_ns", binning.arrivalMax / ns}};
+  return SimIO::WriteCounts(hdf5Path, "/histograms/timing", datasets, attributes,
+                            errorMessage);
+}
+
+}  // namespace TimingHistograms
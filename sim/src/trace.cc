@@ -0,0 +1,150 @@
+#include "trace.hh"
+
+#include "G4Threading.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace {
+/// Spans kept per thread and run; older spans are overwritten beyond this.
+constexpr std::size_t kRingCapacity = 1 << 18;
+
+struct Record {
+  const char* name = nullptr;
+  std::uint64_t startNs = 0;
+  std::uint64_t durationNs = 0;
+};
+
+/// Owner-only ring buffer; no other thread touches it until EndThreadRun.
+struct Ring {
+  bool enabled = false;
+  std::vector<Record> records;
+  std::size_t next = 0;
+  std::uint64_t written = 0;
+};
+
+thread_local Ring tRing;
+
+/// Spans handed over by finished threads, tagged with their Geant4 thread id.
+struct ThreadRecord {
+  G4int threadID = -1;
+  Record record;
+};
+
+std::mutex gCollectedMutex;
+std::vector<ThreadRecord> gCollected;
+std::uint64_t gDropped = 0;
+
+std::string ThreadName(G4int threadID) {
+  return threadID < 0 ? "G4 master" : "G4WT" + std::to_string(threadID);
+}
+}  // namespace
+
+namespace Trace {
+
+bool Enabled() {
+  return tRing.enabled;
+}
+
+void Complete(const char* name, std::uint64_t startNs) {
+  auto& ring = tRing;
+  if (!ring.enabled) {
+    return;
+  }
+  const auto endNs = Now();
+  ring.records[ring.next] = Record{name, startNs, endNs > startNs ? endNs - startNs : 0};
+  ring.next = (ring.next + 1) % ring.records.size();
+  ++ring.written;
+}
+
+void BeginThreadRun(bool enabled) {
+  auto& ring = tRing;
+  ring.enabled = enabled;
+  ring.next = 0;
+  ring.written = 0;
+  if (enabled && ring.records.size() != kRingCapacity) {
+    // Allocated on the owning thread so pages land on its NUMA node.
+    ring.records.assign(kRingCapacity, Record{});
+  }
+}
+
+void EndThreadRun() {
+  auto& ring = tRing;
+  if (!ring.enabled) {
+    return;
+  }
+  ring.enabled = false;
+  const auto kept = static_cast<std::size_t>(
+      std::min<std::uint64_t>(ring.written, ring.records.size()));
+  const std::size_t first = ring.written > ring.records.size() ? ring.next : 0;
+  const G4int threadID = G4Threading::G4GetThreadId();
+
+  std::lock_guard<std::mutex> lock(gCollectedMutex);
+  gCollected.reserve(gCollected.size() + kept);
+  for (std::size_t i = 0; i < kept; ++i) {
+    gCollected.push_back({threadID, ring.records[(first + i) % ring.records.size()]});
+  }
+  gDropped += ring.written - kept;
+}
+
+bool WriteRun(const std::string& path, std::string* errorMessage) {
+  std::vector<ThreadRecord> records;
+  std::uint64_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(gCollectedMutex);
+    records.swap(gCollected);
+    std::swap(dropped, gDropped);
+  }
+  if (records.empty()) {
+    return true;
+  }
+
+  std::ofstream out(path, std::ios::out | std::ios::trunc);
+  if (!out) {
+    if (errorMessage) {
+      *errorMessage = "Cannot open trace file '" + path + "'";
+    }
+    return false;
+  }
+
+  std::uint64_t originNs = records.front().record.startNs;
+  std::set<G4int> threads;
+  for (const auto& entry : records) {
+    originNs = std::min(originNs, entry.record.startNs);
+    threads.insert(entry.threadID);
+  }
+
+  // Trace-event timestamps are microseconds; keep nanosecond resolution.
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", "
+       << "\"otherData\": {\"dropped_spans\": " << dropped << "}, \"traceEvents\": [";
+  const char* separator = "\n";
+  for (const auto threadID : threads) {
+    json << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+         << threadID << ", \"args\": {\"name\": \"" << ThreadName(threadID) << "\"}}";
+    separator = ",\n";
+  }
+  for (const auto& entry : records) {
+    json << separator << "{\"name\": \"" << entry.record.name
+         << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << entry.threadID
+         << ", \"ts\": " << (entry.record.startNs - originNs) / 1e3
+         << ", \"dur\": " << entry.record.durationNs / 1e3 << "}";
+    separator = ",\n";
+  }
+  json << "\n]}\n";
+  out << json.str();
+  if (!out) {
+    if (errorMessage) {
+      *errorMessage = "Failed writing trace file '" + path + "'";
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace Trace
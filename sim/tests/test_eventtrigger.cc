@@ -0,0 +1,72 @@
+// Event-trigger acceptance (include/eventtrigger.hh) on hand-built events.
+
+#include "config.hh"
+#include "eventtrigger.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+int gFailures = 0;
+
+void Expect(bool condition, const char* what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << '\n';
+    ++gFailures;
+  }
+}
+
+SimStructures::PhotonHitRecord Hit(G4double time, const char* secondarySpecies = "e-") {
+  SimStructures::PhotonHitRecord hit;
+  hit.opticalInterfaceHitTime = time;
+  hit.secondarySpecies = secondarySpecies;
+  return hit;
+}
+}  // namespace
+
+int main() {
+  const G4double yield = 10000.0;
+
+  EventTrigger none;
+  Expect(!none.Enabled(), "default trigger is disabled");
+  Expect(Trigger::Accepts(none, yield, 0, {}), "default trigger accepts an empty event");
+
+  EventTrigger window;
+  window.timeMin = 10.0 * ns;
+  window.timeMax = 20.0 * ns;
+  Expect(window.Enabled(), "time window alone enables the trigger");
+  Expect(!Trigger::Accepts(window, yield, 100, {}), "window alone rejects an event without hits");
+  Expect(!Trigger::Accepts(window, yield, 100, {Hit(5.0 * ns), Hit(25.0 * ns)}),
+         "window alone rejects an event with hits only outside it");
+  Expect(Trigger::Accepts(window, yield, 100, {Hit(5.0 * ns), Hit(15.0 * ns)}),
+         "window alone accepts an event with one hit inside it");
+
+  EventTrigger photons = window;
+  photons.minPhotons = 2;
+  Expect(!Trigger::Accepts(photons, yield, 100, {Hit(12.0 * ns), Hit(30.0 * ns)}),
+         "minPhotons counts only hits inside the window");
+  Expect(Trigger::Accepts(photons, yield, 100, {Hit(12.0 * ns), Hit(18.0 * ns)}),
+         "minPhotons accepts enough hits inside the window");
+
+  EventTrigger species = window;
+  species.secondarySpecies = {"p"};
+  Expect(!Trigger::Accepts(species, yield, 100, {Hit(15.0 * ns), Hit(30.0 * ns, "p")}),
+         "secondarySpecies needs its hit inside the window");
+  Expect(Trigger::Accepts(species, yield, 100, {Hit(15.0 * ns), Hit(16.0 * ns, "p")}),
+         "secondarySpecies accepts its hit inside the window");
+
+  EventTrigger energy;
+  energy.minEnergyProxy = 0.5 * MeV;
+  Expect(!Trigger::Accepts(energy, yield, 4999, {Hit(1.0 * ns)}),
+         "minEnergyProxy rejects too few generated photons");
+  Expect(Trigger::Accepts(energy, yield, 5000, {}), "minEnergyProxy accepts enough photons");
+
+  if (gFailures > 0) {
+    std::cerr << gFailures << " check(s) failed\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
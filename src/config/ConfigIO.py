@@ -97,6 +97,7 @@ DEFAULT_GENERATED_MACRO_FILENAME = "generated_from_config.mac"
 DEFAULT_OUTPUT_FILENAME_BASE = "photon_optical_interface_hits"
 DEFAULT_TRANSPORT_OUTPUT_FILENAME_BASE = "photons_intensifier_hits"
 DEFAULT_RUN_LOG_FILENAME_BASE = "runLog"
+DEFAULT_RUN_PROGRESS_FILENAME_BASE = "runProgress"
 DEFAULT_OPTICAL_INTERFACE_THICKNESS_MM = 0.1
 SUB_RUN_NUMBER_WIDTH = 4
 
@@ -228,6 +229,18 @@ def run_log_filename(config: SimConfig) -> str:
         + ".txt"
     )
 
+
+def run_progress_filename(config: SimConfig) -> str:
+    """Return canonical JSON-lines progress filename for one configured sub-run."""
+
+    return (
+        artifact_stem_for_sub_run(
+            DEFAULT_RUN_PROGRESS_FILENAME_BASE,
+            config.metadata.run_environment.sub_run_number,
+        )
+        + ".jsonl"
+    )
+
 def _require_yaml_dependency() -> Any:
     """Return PyYAML module object or raise a dependency error.
 
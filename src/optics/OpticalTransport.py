@@ -810,7 +810,8 @@ def _require_photon_fields(
     if missing:
         raise KeyError(
             "Input /photons dataset is missing required fields: "
-            f"{missing}"
+            f"{missing}. Simulate with `/output/photonFields transport` "
+            "(or `full`) to keep them."
         )
 
 
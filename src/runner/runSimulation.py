@@ -2,17 +2,22 @@
 
 from __future__ import annotations
 
+import functools
+import json
 from pathlib import Path
 import re
 import shlex
 import subprocess
 import sys
+import threading
+from typing import Any
 
 try:
     from src.common.logger import get_logger, log_stage, resolve_run_log_path
     from src.config.ConfigIO import prepare_simulation_run
     from src.config.ConfigIO import (
         resolve_run_environment_paths,
+        run_progress_filename,
         simulated_output_filename,
     )
     from src.config.SimConfig import SimConfig
@@ -22,16 +27,28 @@ except ModuleNotFoundError:
     from src.config.ConfigIO import prepare_simulation_run
     from src.config.ConfigIO import (
         resolve_run_environment_paths,
+        run_progress_filename,
         simulated_output_filename,
     )
     from src.config.SimConfig import SimConfig
 
 
 _SIMULATED_EVENTS_PATTERN = re.compile(r"Simulated\s+(\d+)\s+events\b")
+_PROGRESS_POLL_SECONDS = 0.5
+_HELP_PROBE_TIMEOUT_SECONDS = 30.0
 
 
-def _simulation_command(config: SimConfig, macro_path: Path) -> list[str]:
-    """Build subprocess command tokens from `config.runner.binary` + macro."""
+def _simulation_command(
+    config: SimConfig,
+    macro_path: Path,
+    *,
+    progress_path: Path | None = None,
+) -> list[str]:
+    """Build subprocess command tokens from `config.runner.binary` + macro.
+
+    When ``progress_path`` is given, g4emi is asked to write JSON-lines
+    progress snapshots there via ``/g4emi/run/progressFile``.
+    """
 
     try:
         tokens = shlex.split(config.runner.binary)
@@ -41,7 +58,34 @@ def _simulation_command(config: SimConfig, macro_path: Path) -> list[str]:
         ) from exc
     if not tokens:
         raise ValueError("`runner.binary` did not resolve to an executable command.")
-    return [*tokens, str(macro_path)]
+    # Quoted so Geant4 keeps paths with spaces as one parameter.
+    progress_args = (
+        []
+        if progress_path is None
+        else ["-c", f'/g4emi/run/progressFile "{progress_path}"']
+    )
+    return [*tokens, *progress_args, str(macro_path)]
+
+
+@functools.lru_cache(maxsize=None)
+def _supports_progress_file(binary: str) -> bool:
+    """Return whether ``binary`` accepts ``-c /g4emi/run/progressFile``.
+
+    Probed once per binary from its ``--help`` text. Binaries that predate the
+    option, or that fail the probe, report progress on stdout only.
+    """
+
+    try:
+        probe = subprocess.run(
+            [*shlex.split(binary), "--help"],
+            capture_output=True,
+            text=True,
+            timeout=_HELP_PROBE_TIMEOUT_SECONDS,
+            check=False,
+        )
+    except (ValueError, OSError, subprocess.TimeoutExpired):
+        return False
+    return "/g4emi/run/progressFile" in probe.stdout + probe.stderr
 
 
 def _simulation_total_events(config: SimConfig) -> int | None:
@@ -61,7 +105,121 @@ def _parse_simulated_events(line: str) -> int | None:
     return int(match.group(1))
 
 
-def _write_progress(current: int, total: int) -> None:
+def _parse_progress_snapshot(line: str) -> dict[str, Any] | None:
+    """Decode one JSON-lines snapshot written by ``/g4emi/run/progressFile``."""
+
+    try:
+        snapshot = json.loads(line)
+    except json.JSONDecodeError:
+        return None
+    if not isinstance(snapshot, dict) or "events_completed" not in snapshot:
+        return None
+    return snapshot
+
+
+class _ProgressFileReader:
+    """Incrementally read complete snapshots appended to a progress file."""
+
+    def __init__(self, path: Path):
+        self._path = path
+        self._offset = 0
+        self._partial = ""
+
+    def poll(self) -> dict[str, Any] | None:
+        """Return the newest complete snapshot appended since the last poll."""
+
+        try:
+            with self._path.open("r", encoding="utf-8") as handle:
+                handle.seek(self._offset)
+                chunk = handle.read()
+                self._offset = handle.tell()
+        except FileNotFoundError:
+            return None
+
+        lines = (self._partial + chunk).split("\n")
+        # Keep a trailing line the writer has not finished yet.
+        self._partial = lines.pop()
+        latest = None
+        for line in lines:
+            snapshot = _parse_progress_snapshot(line)
+            if snapshot is not None:
+                latest = snapshot
+        return latest
+
+
+class _ProgressDisplay:
+    """Serialize progress-bar updates from the progress file and stdout.
+
+    Snapshots from the progress file win; stdout ``Simulated N events`` lines
+    only drive the bar until the first snapshot arrives (older binaries never
+    write one).
+    """
+
+    def __init__(self, total_events: int):
+        self.total_events = total_events
+        self.last_progress = 0
+        self.displayed = False
+        self._from_file = False
+        self._lock = threading.Lock()
+
+    def update_from_snapshot(self, snapshot: dict[str, Any]) -> None:
+        with self._lock:
+            self._from_file = True
+            total = int(snapshot.get("events_total") or self.total_events)
+            self._show(
+                int(snapshot["events_completed"]),
+                total,
+                rate=snapshot.get("events_per_s"),
+                eta=snapshot.get("eta_s"),
+            )
+
+    def update_from_stdout(self, line: str) -> None:
+        progress = _parse_simulated_events(line)
+        if progress is None:
+            return
+        with self._lock:
+            if not self._from_file:
+                self._show(progress, self.total_events)
+
+    def _show(
+        self,
+        current: int,
+        total: int,
+        *,
+        rate: float | None = None,
+        eta: float | None = None,
+    ) -> None:
+        if current < self.last_progress:
+            return
+        self.total_events = total
+        self.last_progress = current
+        self.displayed = True
+        _write_progress(current, total, rate=rate, eta=eta)
+
+
+def _follow_progress_file(
+    reader: _ProgressFileReader,
+    display: _ProgressDisplay,
+    stop: threading.Event,
+) -> None:
+    """Poll the progress file until `stop` is set, then read it one last time."""
+
+    while True:
+        stopped = stop.wait(_PROGRESS_POLL_SECONDS)
+        snapshot = reader.poll()
+        if snapshot is not None:
+            display.update_from_snapshot(snapshot)
+        if stopped:
+            return
+
+
+def _write_progress(
+    current: int,
+    total: int,
+    *,
+    rate: float | None = None,
+    eta: float | None = None,
+) -> None:
     """Render a simple in-terminal simulation progress bar."""
 
     if total <= 0:
@@ -72,8 +230,13 @@ def _write_progress(current: int, total: int) -> None:
     filled = int(width * fraction)
     bar = f"[{'#' * filled}{'-' * (width - filled)}]"
     percent = int(fraction * 100)
+    details = ""
+    if rate is not None:
+        details += f", {rate:.1f} events/s"
+    if eta is not None and clamped < total:
+        details += f", ETA {eta:.0f} s"
     sys.stderr.write(
-        f"\rSimulation {bar} {percent:3d}% ({clamped}/{total} events)"
+        f"\rSimulation {bar} {percent:3d}% ({clamped}/{total} events{details})"
     )
     sys.stderr.flush()
     if clamped >= total:
@@ -113,17 +276,33 @@ def run(
 
     # Resolve the canonical log path for consistency with caller reporting.
     log_path = resolve_run_log_path(config)
-    command = _simulation_command(config, macro_path)
     total_events = (
         _simulation_total_events(config) if config.runner.show_progress else None
     )
+    progress_path = (
+        (run_paths.log / run_progress_filename(config)).resolve()
+        if total_events is not None
+        and not dry_run
+        and _supports_progress_file(config.runner.binary)
+        else None
+    )
+    command = _simulation_command(config, macro_path, progress_path=progress_path)
 
     logger = get_logger()
     if dry_run:
         return None
 
-    last_progress = 0
-    displayed_progress = False
+    display = _ProgressDisplay(total_events) if total_events is not None else None
+    monitor: threading.Thread | None = None
+    stop_monitor = threading.Event()
+    if progress_path is not None and display is not None:
+        # Never show a snapshot left behind by an earlier launch.
+        progress_path.unlink(missing_ok=True)
+        monitor = threading.Thread(
+            target=_follow_progress_file,
+            args=(_ProgressFileReader(progress_path), display, stop_monitor),
+            daemon=True,
+        )
     if log_filename is not None:
         log_path = Path(log_filename)
     logger.info(f"[simulation] Command: {shlex.join(command)}")
@@ -140,22 +319,27 @@ def run(
                 if process.stdout is None:
                     raise RuntimeError("Simulation process did not expose a stdout stream.")
 
-                for line in process.stdout:
-                    log_file.write(line)
-                    log_file.flush()
-
-                    if total_events is None:
-                        continue
-                    progress = _parse_simulated_events(line)
-                    if progress is None or progress < last_progress:
-                        continue
-                    last_progress = progress
-                    displayed_progress = True
-                    _write_progress(progress, total_events)
-
-                return_code = process.wait()
-
-    if displayed_progress and total_events is not None and last_progress < total_events:
+                if monitor is not None:
+                    monitor.start()
+                try:
+                    for line in process.stdout:
+                        log_file.write(line)
+                        log_file.flush()
+
+                        if display is not None:
+                            display.update_from_stdout(line)
+
+                    return_code = process.wait()
+                finally:
+                    if monitor is not None:
+                        stop_monitor.set()
+                        monitor.join()
+
+    if (
+        display is not None
+        and display.displayed
+        and display.last_progress < display.total_events
+    ):
         sys.stderr.write("\n")
         sys.stderr.flush()
     if return_code != 0:
@@ -160,6 +160,23 @@ class AnalysisDataBuilderMixin:
             handle.create_dataset("primaries", data=primary_rows)
             handle.create_dataset("photons", data=photon_rows)
 
+    def _write_timing_histograms_hdf5(self, path: Path) -> None:
+        path.parent.mkdir(parents=True, exist_ok=True)
+        with self.h5py.File(path, "w") as handle:
+            group = handle.create_group("histograms/timing")
+            for name, counts, range_max_ns in (
+                ("creation_delay/primary/n", [5, 3, 1, 0], 8.0),
+                ("creation_delay/secondary/proton", [4, 2, 1, 0], 8.0),
+                ("creation_delay/secondary/C12", [1, 1, 0, 0], 8.0),
+                ("arrival/primary/n", [0, 6, 3, 0], 4.0),
+            ):
+                dataset = group.create_dataset(
+                    name,
+                    data=self.np.asarray(counts, dtype=self.np.uint64),
+                )
+                dataset.attrs["range_min_ns"] = 0.0
+                dataset.attrs["range_max_ns"] = range_max_ns
+
     def _write_secondaries_hdf5(self, path: Path) -> None:
         path.parent.mkdir(parents=True, exist_ok=True)
         secondaries_dtype = self.np.dtype(
@@ -21,6 +21,8 @@ class TimingAnalysisTests(AnalysisDataBuilderMixin, AnalysisTestCase):
             fit_photon_creation_delay_histogram,
             photon_creation_delays_ns,
             photon_creation_delay_to_histogram,
+            stored_photon_creation_delay_histogram,
+            stored_timing_histograms,
         )
         import analysis.timing as timing_module
 
@@ -33,6 +35,10 @@ class TimingAnalysisTests(AnalysisDataBuilderMixin, AnalysisTestCase):
         cls.photon_creation_delay_to_histogram = staticmethod(
             photon_creation_delay_to_histogram
         )
+        cls.stored_photon_creation_delay_histogram = staticmethod(
+            stored_photon_creation_delay_histogram
+        )
+        cls.stored_timing_histograms = staticmethod(stored_timing_histograms)
         cls.scipy_available = timing_module.least_squares is not None
 
     def test_photon_creation_delay_histogram_uses_primary_interaction_times(self) -> None:
@@ -54,6 +60,31 @@ class TimingAnalysisTests(AnalysisDataBuilderMixin, AnalysisTestCase):
             self.assertIn("Primary Interaction", ax.get_title())
             self.plt.close(fig)
 
+    def test_stored_timing_histograms_rebuild_bin_edges(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            hdf5_path = Path(tmp_dir) / "photon_optical_interface_hits.h5"
+            self._write_timing_histograms_hdf5(hdf5_path)
+
+            arrival = self.stored_timing_histograms(hdf5_path, "arrival")
+            self.assertEqual(sorted(arrival), ["n"])
+            counts, edges = arrival["n"]
+            self.assertEqual(counts.tolist(), [0.0, 6.0, 3.0, 0.0])
+            self.assertEqual(edges.tolist(), [0.0, 1.0, 2.0, 3.0, 4.0])
+
+            counts, edges = self.stored_photon_creation_delay_histogram(
+                hdf5_path,
+                by="secondary",
+            )
+            self.assertEqual(counts.tolist(), [5.0, 3.0, 1.0, 0.0])
+            self.assertEqual(edges[-1], 8.0)
+
+            with self.assertRaisesRegex(KeyError, "alpha"):
+                self.stored_photon_creation_delay_histogram(
+                    hdf5_path,
+                    by="secondary",
+                    species="alpha",
+                )
+
     def test_photon_creation_delays_extract_expected_values(self) -> None:
         with tempfile.TemporaryDirectory() as tmp_dir:
             hdf5_path = Path(tmp_dir) / "photon_optical_interface_hits.h5"
@@ -2,7 +2,9 @@
 
 from __future__ import annotations
 
+import json
 from pathlib import Path
+import subprocess
 import sys
 import tempfile
 import unittest
@@ -456,5 +458,204 @@ class IntensifierPipelineTests(unittest.TestCase):
                 )
 
 
+class NativeIntensifierChainTests(unittest.TestCase):
+    """Compare `build/g4emi_intensifier` with the Python intensifier stages."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.binary = _repo_root() / "build" / "g4emi_intensifier"
+        if not cls.binary.is_file():
+            raise unittest.SkipTest(f"Build {cls.binary} to compare the native intensifier.")
+        try:
+            import h5py
+
+            from src.intensifier.io import _INTENSIFIER_OUTPUT_DTYPE
+            from src.intensifier.mcp import convert_photoelectrons_to_mcp_events
+            from src.intensifier.models import McpParams
+            from src.intensifier.models import PhotocathodeParams
+            from src.intensifier.models import PhosphorParams
+            from src.intensifier.models import TransportedPhotonBatch
+            from src.intensifier.phosphor import convert_mcp_events_to_intensifier_output
+            from src.intensifier.photocathode import convert_photons_to_photoelectrons
+        except ModuleNotFoundError as exc:
+            raise unittest.SkipTest(f"Missing dependency for intensifier comparison: {exc}.")
+        cls.h5py = h5py
+        cls.output_dtype = _INTENSIFIER_OUTPUT_DTYPE
+        cls.photocathode = PhotocathodeParams(
+            qe_wavelength_nm=np.array([350.0, 420.0, 500.0, 650.0]),
+            qe_values=np.array([0.15, 0.4, 0.25, 0.05]),
+            collection_efficiency=0.9,
+            tts_sigma_ns=0.5,
+        )
+        cls.mcp = McpParams(
+            stage1_mean_gain=8.0,
+            stage1_gain_shape=2.0,
+            stage2_mean_gain=800.0,
+            stage2_gain_shape=0.8,
+            gain_ref=1000.0,
+            spread_sigma0_mm=0.03,
+            spread_gain_exponent=0.4,
+        )
+        cls.phosphor = PhosphorParams(
+            phosphor_gain=2.0,
+            decay_fast_ns=70.0,
+            decay_slow_ns=200.0,
+            fast_fraction=0.9,
+            psf_sigma_mm=0.04,
+        )
+        cls.TransportedPhotonBatch = TransportedPhotonBatch
+        cls.stages = staticmethod(
+            lambda photons, rng: convert_mcp_events_to_intensifier_output(
+                convert_photoelectrons_to_mcp_events(
+                    convert_photons_to_photoelectrons(photons, cls.photocathode, rng=rng),
+                    cls.mcp,
+                    rng=rng,
+                ),
+                cls.phosphor,
+                rng=rng,
+            )
+        )
+
+    def _transported(self, n: int) -> np.ndarray:
+        """Transported photons at t=0 with a spread of wavelengths and `in_bounds`."""
+
+        rng = np.random.default_rng(11)
+        rows = np.zeros(
+            n,
+            dtype=[
+                ("source_photon_index", "<i8"),
+                ("gun_call_id", "<i8"),
+                ("primary_track_id", "<i4"),
+                ("secondary_track_id", "<i4"),
+                ("photon_track_id", "<i4"),
+                ("intensifier_hit_x_mm", "<f8"),
+                ("intensifier_hit_y_mm", "<f8"),
+                ("intensifier_hit_z_mm", "<f8"),
+                ("intensifier_hit_time_ns", "<f8"),
+                ("intensifier_hit_wavelength_nm", "<f8"),
+                ("in_bounds", "?"),
+            ],
+        )
+        rows["source_photon_index"] = np.arange(n)
+        rows["gun_call_id"] = np.arange(n) // 50
+        rows["photon_track_id"] = np.arange(n) % 50
+        rows["intensifier_hit_x_mm"] = rng.uniform(-5.0, 5.0, size=n)
+        rows["intensifier_hit_y_mm"] = rng.uniform(-5.0, 5.0, size=n)
+        rows["intensifier_hit_wavelength_nm"] = rng.uniform(300.0, 700.0, size=n)
+        rows["in_bounds"] = rng.random(n) < 0.8
+        return rows
+
+    def _run(self, input_path: Path, output_path: Path, *extra: str) -> dict[str, object]:
+        completed = subprocess.run(
+            [
+                str(self.binary),
+                "--input", str(input_path),
+                "-o", str(output_path),
+                "--qe-wavelengths", "350,420,500,650",
+                "--qe-values", "0.15,0.4,0.25,0.05",
+                "--collection-efficiency", "0.9",
+                "--tts-sigma", "0.5",
+                "--stage2-gain-shape", "0.8",
+                "--phosphor-gain", "2",
+                "--intensifier-model", "Cricket2",
+                "--seed", "1234",
+                *extra,
+            ],
+            capture_output=True,
+            text=True,
+            check=True,
+        )
+        return json.loads(completed.stdout)
+
+    def test_matches_python_stages_statistically(self) -> None:
+        rows = self._transported(200_000)
+        selected = rows[rows["in_bounds"]]
+        expected = self.stages(
+            self.TransportedPhotonBatch(
+                source_photon_index=selected["source_photon_index"],
+                gun_call_id=selected["gun_call_id"],
+                primary_track_id=selected["primary_track_id"],
+                secondary_track_id=selected["secondary_track_id"],
+                photon_track_id=selected["photon_track_id"],
+                x_mm=selected["intensifier_hit_x_mm"],
+                y_mm=selected["intensifier_hit_y_mm"],
+                z_mm=selected["intensifier_hit_z_mm"],
+                time_ns=selected["intensifier_hit_time_ns"],
+                wavelength_nm=selected["intensifier_hit_wavelength_nm"],
+            ),
+            np.random.default_rng(5),
+        )
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = Path(tmpdir) / "transport.h5"
+            with self.h5py.File(input_path, "w") as handle:
+                handle.create_dataset("transported_photons", data=rows)
+            output_path = Path(tmpdir) / "intensifier.h5"
+            summary = self._run(input_path, output_path)
+            with self.h5py.File(output_path, "r") as handle:
+                events = handle["intensifier_output_events"][()]
+                self.assertEqual(handle["intensifier_output_events"].dtype, self.output_dtype)
+                self.assertEqual(handle.attrs["intensifier_model"], "Cricket2")
+                self.assertEqual(handle.attrs["transport_hdf5"], str(input_path.resolve()))
+                self.assertEqual(int(handle.attrs["intensifier_seed"]), 1234)
+
+        self.assertEqual(summary["selected_photons"], len(selected))
+        self.assertEqual(summary["output_events"], len(events))
+        self.assertTrue(np.all(np.diff(events["source_photon_index"]) > 0))
+        self.assertTrue(np.all(rows["in_bounds"][events["source_photon_index"]]))
+
+        # Detection count against its binomial expectation.
+        probability = 0.9 * np.interp(
+            selected["intensifier_hit_wavelength_nm"],
+            self.photocathode.qe_wavelength_nm,
+            self.photocathode.qe_values,
+            left=0.0,
+            right=0.0,
+        )
+        mean = probability.sum()
+        sigma = np.sqrt((probability * (1.0 - probability)).sum())
+        self.assertLess(abs(len(events) - mean), 5.0 * sigma)
+        self.assertLess(abs(len(expected) - mean), 5.0 * sigma)
+
+        source = rows[events["source_photon_index"]]
+        dx = events["output_x_mm"] - source["intensifier_hit_x_mm"]
+        expected_dx = expected.output_x_mm - rows["intensifier_hit_x_mm"][
+            expected.source_photon_index
+        ]
+        for name, native, python in (
+            ("total_gain", events["total_gain"].mean(), expected.total_gain.mean()),
+            ("output_time_ns", events["output_time_ns"].mean(), expected.output_time_ns.mean()),
+            ("output_time_ns std", events["output_time_ns"].std(), expected.output_time_ns.std()),
+            ("dx std", dx.std(), expected_dx.std()),
+        ):
+            with self.subTest(statistic=name):
+                self.assertAlmostEqual(native / python, 1.0, delta=0.04)
+        np.testing.assert_allclose(events["signal_amplitude_arb"], 2.0 * events["total_gain"])
+        np.testing.assert_array_equal(events["wavelength_nm"], source["intensifier_hit_wavelength_nm"])
+
+    def test_output_does_not_depend_on_threads_or_chunks(self) -> None:
+        rows = self._transported(20_000)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = Path(tmpdir) / "transport.h5"
+            with self.h5py.File(input_path, "w") as handle:
+                handle.create_dataset("transported_photons", data=rows)
+            outputs = []
+            for threads, chunk_rows in (("1", "1048576"), ("4", "3001")):
+                output_path = Path(tmpdir) / f"intensifier_{threads}.h5"
+                self._run(input_path, output_path, "--threads", threads, "--chunk-rows", chunk_rows)
+                with self.h5py.File(output_path, "r") as handle:
+                    outputs.append(handle["intensifier_output_events"][()])
+            np.testing.assert_array_equal(outputs[0], outputs[1])
+
+            all_rows_path = Path(tmpdir) / "intensifier_all.h5"
+            summary = self._run(input_path, all_rows_path, "--all-rows")
+            self.assertEqual(summary["selected_photons"], len(rows))
+            with self.h5py.File(all_rows_path, "r") as handle:
+                all_events = handle["intensifier_output_events"][()]
+            # Draws depend only on the source photon, so in-bounds results carry over.
+            kept = all_events[rows["in_bounds"][all_events["source_photon_index"]]]
+            np.testing.assert_array_equal(kept, outputs[0])
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -4,7 +4,10 @@ from __future__ import annotations
 
 import importlib.util
 import io
+import json
+import math
 from pathlib import Path
+import subprocess
 import sys
 import tempfile
 import unittest
@@ -465,5 +468,227 @@ class OpticalTransportTests(unittest.TestCase):
             self.assertNotIn("(2/2 photons)", terminal_output)
 
 
+
+class NativeLensTracerValidationTests(unittest.TestCase):
+    """Compare `build/g4emi_lenstrace` against `RayOpticsLensTracer`."""
+
+    # Fraunhofer d line: the native tracer's glass model reproduces nd exactly.
+    _WAVELENGTH_NM = 587.5618
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.binary = _repo_root() / "build" / "g4emi_lenstrace"
+        if not cls.binary.is_file():
+            raise unittest.SkipTest(f"Build {cls.binary} to compare the native lens tracer.")
+        try:
+            from src.optics.LensModels import resolve_lens_path, resolve_smx_path
+            from src.optics.OpticalTransport import RayOpticsLensTracer
+        except ModuleNotFoundError as exc:
+            raise unittest.SkipTest(f"Missing dependency for lens-tracer comparison: {exc}.")
+        if importlib.util.find_spec("rayoptics") is None:
+            raise unittest.SkipTest("rayoptics is required for lens-tracer comparison.")
+        cls.resolve_lens_path = staticmethod(resolve_lens_path)
+        cls.resolve_smx_path = staticmethod(resolve_smx_path)
+        cls.RayOpticsLensTracer = RayOpticsLensTracer
+
+    @staticmethod
+    def _rays() -> list[tuple[float, float, float, float, float]]:
+        """Rays well inside the clear aperture, on and off axis."""
+
+        rays = []
+        for height in (0.0, 2.0, 5.0, 8.0):
+            for angle in (0.0, 0.03, -0.06):
+                rays.append((0.0, height, 0.0, math.sin(angle), math.cos(angle)))
+                rays.append((height, 0.5 * height, math.sin(angle), 0.0, math.cos(angle)))
+        return rays
+
+    def _compare(self, lens: str, tolerance_mm: float) -> None:
+        zmx = self.resolve_lens_path(lens)
+        smx = self.resolve_smx_path(None, zmx_path=zmx)
+        reference = self.RayOpticsLensTracer(zmx, lens_smx_path=smx)
+        rays = self._rays()
+        stdin = "".join(
+            f"{x!r} {y!r} {dx!r} {dy!r} {dz!r} {self._WAVELENGTH_NM!r}\n"
+            for x, y, dx, dy, dz in rays
+        )
+        completed = subprocess.run(
+            [str(self.binary), "--lens", str(zmx)] + (["--smx", str(smx)] if smx else []),
+            input=stdin,
+            capture_output=True,
+            text=True,
+            check=True,
+        )
+        native = [line.split() for line in completed.stdout.splitlines()]
+        self.assertEqual(len(native), len(rays))
+
+        for (x, y, dx, dy, dz), fields in zip(rays, native):
+            expected = reference.trace_to_sensor(
+                x_mm=x, y_mm=y, dir_x=dx, dir_y=dy, dir_z=dz, wavelength_nm=self._WAVELENGTH_NM
+            )
+            with self.subTest(lens=lens, ray=(x, y, dx, dy, dz)):
+                self.assertEqual(fields[0] == "1", expected is not None)
+                if expected is None:
+                    continue
+                for got, want in zip(fields[1:], expected):
+                    self.assertAlmostEqual(float(got), want, delta=tolerance_mm)
+
+    def test_matches_rayoptics_for_model_glasses(self) -> None:
+        """nd/Vd model glasses (every Nikkor element) agree to rounding."""
+
+        self._compare("nikkor80-200", tolerance_mm=1.0e-6)
+
+    def test_matches_rayoptics_for_catalog_glasses(self) -> None:
+        """Catalog glasses differ from their printed nd in the last digits only."""
+
+        self._compare("canon50", tolerance_mm=1.0e-2)
+
+
+class NativeLensSurrogateTests(unittest.TestCase):
+    """Check `build/g4emi_lenssurrogate fit` against its exact-trace validation."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.binary = _repo_root() / "build" / "g4emi_lenssurrogate"
+        if not cls.binary.is_file():
+            raise unittest.SkipTest(f"Build {cls.binary} to check the lens surrogate.")
+
+    def _fit(self, lens: str) -> dict:
+        with tempfile.TemporaryDirectory() as tmpdir:
+            model = Path(tmpdir) / "model.h5"
+            completed = subprocess.run(
+                [str(self.binary), "fit", "--lens", lens, "--validate-rays", "20000",
+                 "-o", str(model)],
+                capture_output=True,
+                text=True,
+                check=True,
+            )
+            self.assertTrue(model.is_file())
+        return json.loads(completed.stdout)
+
+    def test_surrogate_tracks_exact_trace(self) -> None:
+        """Default fits stay within tens of microns and rarely misjudge vignetting."""
+
+        for lens, tolerance_mm in (("nikkor80-200", 1.0e-3), ("canon50", 0.1)):
+            with self.subTest(lens=lens):
+                validation = self._fit(lens)["validation"]
+                self.assertGreater(validation["exact_transmitted"], 0)
+                self.assertLess(validation["max_error_mm"], tolerance_mm)
+                misjudged = validation["false_pass"] + validation["false_block"]
+                self.assertLess(misjudged, 0.05 * validation["exact_transmitted"])
+
+
+class NativePipelineTests(unittest.TestCase):
+    """Check `build/g4emi_pipeline` against the standalone native stages."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        build = _repo_root() / "build"
+        cls.binaries = {
+            name: build / f"g4emi_{name}"
+            for name in ("pipeline", "lenssurrogate", "intensifier", "timepix")
+        }
+        for binary in cls.binaries.values():
+            if not binary.is_file():
+                raise unittest.SkipTest(f"Build {binary} to check the native pipeline.")
+        try:
+            import h5py
+            import numpy as np
+        except ModuleNotFoundError as exc:
+            raise unittest.SkipTest(f"Missing dependency for pipeline comparison: {exc}.")
+        cls.h5py = h5py
+        cls.np = np
+
+    def _write_photons(self, path: Path, n: int) -> None:
+        """Interface hits near the axis, 100 per event, spread over 60 mm."""
+
+        np = self.np
+        rng = np.random.default_rng(3)
+        photons = np.zeros(
+            n,
+            dtype=[
+                ("gun_call_id", "<i8"),
+                ("primary_track_id", "<i4"),
+                ("secondary_track_id", "<i4"),
+                ("photon_track_id", "<i4"),
+                ("optical_interface_hit_x_mm", "<f8"),
+                ("optical_interface_hit_y_mm", "<f8"),
+                ("optical_interface_hit_time_ns", "<f8"),
+                ("optical_interface_hit_dir_x", "<f8"),
+                ("optical_interface_hit_dir_y", "<f8"),
+                ("optical_interface_hit_dir_z", "<f8"),
+                ("optical_interface_hit_wavelength_nm", "<f8"),
+            ],
+        )
+        photons["gun_call_id"] = np.arange(n) // 100
+        photons["photon_track_id"] = np.arange(n) % 100
+        photons["optical_interface_hit_x_mm"] = rng.uniform(-30.0, 30.0, size=n)
+        photons["optical_interface_hit_y_mm"] = rng.uniform(-30.0, 30.0, size=n)
+        photons["optical_interface_hit_time_ns"] = (
+            photons["gun_call_id"] * 1000.0 + rng.uniform(0.0, 20.0, size=n)
+        )
+        slopes = rng.normal(0.0, 0.02, size=(n, 2))
+        photons["optical_interface_hit_dir_x"] = slopes[:, 0]
+        photons["optical_interface_hit_dir_y"] = slopes[:, 1]
+        photons["optical_interface_hit_dir_z"] = np.sqrt(1.0 - (slopes**2).sum(axis=1))
+        photons["optical_interface_hit_wavelength_nm"] = rng.uniform(380.0, 650.0, size=n)
+        with self.h5py.File(path, "w") as handle:
+            handle.create_dataset("photons", data=photons)
+            handle.create_dataset("primaries", data=np.zeros(1, dtype=[("gun_call_id", "<i8")]))
+
+    def _run(self, name: str, *args: str) -> dict:
+        completed = subprocess.run(
+            [str(self.binaries[name]), *args], capture_output=True, text=True, check=True
+        )
+        return json.loads(completed.stdout)
+
+    def test_matches_standalone_stages(self) -> None:
+        """Concurrent stages with a small chunk window write the staged files' rows."""
+
+        screen = ("--screen-diameter", "10")
+        seed = ("--seed", "7")
+        sensor = ("--pixels-x", "32", "--pixels-y", "32", "--pixel-pitch", "0.3")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = Path(tmpdir)
+            sim = tmp / "sim.h5"
+            model = tmp / "model.h5"
+            self._write_photons(sim, 20000)
+            self._run("lenssurrogate", "fit", "--lens", "nikkor80-200", "--validate-rays", "0",
+                      "-o", str(model))
+
+            staged = {name: tmp / f"staged_{name}.h5" for name in ("t", "i", "p")}
+            self._run("lenssurrogate", "apply", "--model", str(model), "--input", str(sim),
+                      "-o", str(staged["t"]), *screen)
+            self._run("intensifier", "--input", str(staged["t"]), "-o", str(staged["i"]), *seed)
+            self._run("timepix", "--input", str(staged["i"]), "-o", str(staged["p"]), *sensor)
+
+            piped = {name: tmp / f"piped_{name}.h5" for name in ("t", "i", "p")}
+            summary = self._run(
+                "pipeline", "--input", str(sim), "--surrogate", str(model), *screen, *seed,
+                *sensor, "--transport-threads", "2", "--intensifier-threads", "2",
+                "--chunk-rows", "1000", "--chunks-in-flight", "3",
+                "--timepix-chunk-events", "500",
+                "--transported-output", str(piped["t"]),
+                "--intensifier-output", str(piped["i"]),
+                "--timepix-output", str(piped["p"]),
+            )
+            self.assertGreater(summary["spilled_chunks"], 0)
+            for key, dataset in (
+                ("t", "transported_photons"),
+                ("i", "intensifier_output_events"),
+                ("p", "timepix_hits"),
+            ):
+                with self.subTest(dataset=dataset):
+                    with self.h5py.File(staged[key], "r") as handle:
+                        expected = handle[dataset][()]
+                    with self.h5py.File(piped[key], "r") as handle:
+                        actual = handle[dataset][()]
+                        self.assertIn("primaries", handle)
+                    self.assertGreater(len(expected), 0)
+                    self.assertEqual(expected.dtype, actual.dtype)
+                    self.np.testing.assert_array_equal(actual, expected)
+            with self.h5py.File(piped["p"], "r") as handle:
+                self.assertEqual(handle.attrs["transport_hdf5"], str(piped["t"].resolve()))
+
+
 if __name__ == "__main__":
     unittest.main()
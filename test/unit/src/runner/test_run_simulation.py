@@ -34,11 +34,17 @@ class RunSimulationTests(unittest.TestCase):
                 prepare_simulation_run,
                 resolve_run_environment_paths,
                 run_log_filename,
+                run_progress_filename,
                 simulated_output_filename,
             )
             from src.config.SimConfig import default_sim_config
             from src.runner.runSimulation import run, run_simulation
             from src.runner.runSimulation import _parse_simulated_events
+            from src.runner.runSimulation import (
+                _ProgressFileReader,
+                _parse_progress_snapshot,
+                _supports_progress_file,
+            )
         except ModuleNotFoundError as exc:
             missing = (getattr(exc, "name", "") or "").lower()
             if missing in {"pydantic", "loguru"}:
@@ -52,8 +58,12 @@ class RunSimulationTests(unittest.TestCase):
         cls.resolve_run_environment_paths = staticmethod(resolve_run_environment_paths)
         cls.run_log_filename = staticmethod(run_log_filename)
         cls.simulated_output_filename = staticmethod(simulated_output_filename)
+        cls.run_progress_filename = staticmethod(run_progress_filename)
         cls.parse_simulated_events = staticmethod(_parse_simulated_events)
-        cls.run = staticmethod(run)
+        cls.parse_progress_snapshot = staticmethod(_parse_progress_snapshot)
+        cls.progress_file_reader = _ProgressFileReader
+        cls.supports_progress_file = staticmethod(_supports_progress_file)
+        cls.launch = staticmethod(run)
         cls.run_simulation = staticmethod(run_simulation)
 
     class _FakeProcess:
@@ -71,6 +81,15 @@ class RunSimulationTests(unittest.TestCase):
         def wait(self) -> int:
             return self.returncode
 
+    def setUp(self) -> None:
+        # Launch tests fake Popen; keep the --help probe off it.
+        probe = patch(
+            "src.runner.runSimulation._supports_progress_file",
+            return_value=True,
+        )
+        probe.start()
+        self.addCleanup(probe.stop)
+
     def _config_for_tmp(self, tmp_path: Path):
         config = self.default_sim_config()
         config.metadata.run_environment.working_directory = tmp_path.as_posix()
@@ -88,6 +107,69 @@ class RunSimulationTests(unittest.TestCase):
             )
         )
 
+    def test_parse_progress_snapshot_requires_event_counter(self) -> None:
+        snapshot = self.parse_progress_snapshot(
+            '{"run": 0, "state": "running", "events_completed": 250, '
+            '"events_total": 1000, "events_per_s": 50.0, "eta_s": 15.0}'
+        )
+        self.assertEqual(snapshot["events_completed"], 250)
+        self.assertIsNone(self.parse_progress_snapshot('{"run": 0}'))
+        self.assertIsNone(self.parse_progress_snapshot('{"run": 0, "events_comp'))
+
+    def test_progress_file_reader_returns_newest_complete_snapshot(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            progress_path = Path(tmp_dir) / "runProgress.jsonl"
+            reader = self.progress_file_reader(progress_path)
+            self.assertIsNone(reader.poll())
+
+            progress_path.write_text(
+                '{"events_completed": 10}\n{"events_completed": 20}\n{"events_comp',
+                encoding="utf-8",
+            )
+            self.assertEqual(reader.poll()["events_completed"], 20)
+            self.assertIsNone(reader.poll())
+
+            with progress_path.open("a", encoding="utf-8") as handle:
+                handle.write('leted": 30}\n')
+            self.assertEqual(reader.poll()["events_completed"], 30)
+
+    def test_run_reports_progress_from_progress_file(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            tmp_path = Path(tmp_dir)
+            config = self._config_for_tmp(tmp_path)
+            config.runner.show_progress = True
+            config.simulation.number_of_particles = 1000
+            paths = self.resolve_run_environment_paths(config)
+            paths.macro.mkdir(parents=True, exist_ok=True)
+            paths.log.mkdir(parents=True, exist_ok=True)
+            paths.simulated_photons.mkdir(parents=True, exist_ok=True)
+            paths.macro_file.write_text("/run/initialize\n", encoding="utf-8")
+            output_hdf5 = paths.simulated_photons / self.simulated_output_filename(config)
+            output_hdf5.write_text("ok\n", encoding="utf-8")
+            progress_path = (paths.log / self.run_progress_filename(config)).resolve()
+
+            def launch(*args, **kwargs):
+                progress_path.write_text(
+                    '{"run": 0, "state": "done", "events_completed": 1000, '
+                    '"events_total": 1000, "events_per_s": 250.0, "eta_s": 0.0}\n',
+                    encoding="utf-8",
+                )
+                # Stdout counts must not override file snapshots once seen.
+                return self._FakeProcess(["Simulated 3 events\n"], returncode=0)
+
+            with patch(
+                "src.runner.runSimulation.subprocess.Popen",
+                side_effect=launch,
+            ) as popen_mock, patch(
+                "src.runner.runSimulation.sys.stderr",
+                new=io.StringIO(),
+            ) as stderr_capture:
+                self.run_simulation(config)
+
+            command = popen_mock.call_args.args[0]
+            self.assertIn(f'/g4emi/run/progressFile "{progress_path}"', command)
+            self.assertIn("(1000/1000 events, 250.0 events/s)", stderr_capture.getvalue())
+
     def test_run_dry_run_skips_subprocess(self) -> None:
         with tempfile.TemporaryDirectory() as tmp_dir:
             tmp_path = Path(tmp_dir)
@@ -129,8 +211,16 @@ class RunSimulationTests(unittest.TestCase):
                 completed = self.run_simulation(config)
 
             self.assertIsInstance(completed, subprocess.CompletedProcess)
+            progress_path = (paths.log / self.run_progress_filename(config)).resolve()
             popen_mock.assert_called_once_with(
-                ["pixi", "run", "g4emi", str(paths.macro_file.resolve())],
+                [
+                    "pixi",
+                    "run",
+                    "g4emi",
+                    "-c",
+                    f'/g4emi/run/progressFile "{progress_path}"',
+                    str(paths.macro_file.resolve()),
+                ],
                 stdout=subprocess.PIPE,
                 stderr=subprocess.STDOUT,
                 text=True,
@@ -141,6 +231,56 @@ class RunSimulationTests(unittest.TestCase):
                 expected_log_path.read_text(encoding="utf-8"),
             )
 
+    def test_run_omits_progress_file_when_binary_lacks_it(self) -> None:
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            tmp_path = Path(tmp_dir)
+            config = self._config_for_tmp(tmp_path)
+            config.runner.show_progress = True
+            config.simulation.number_of_particles = 10
+            paths = self.resolve_run_environment_paths(config)
+            paths.macro.mkdir(parents=True, exist_ok=True)
+            paths.simulated_photons.mkdir(parents=True, exist_ok=True)
+            paths.macro_file.write_text("/run/initialize\n", encoding="utf-8")
+            output_hdf5 = paths.simulated_photons / self.simulated_output_filename(config)
+            output_hdf5.write_text("ok\n", encoding="utf-8")
+
+            with patch(
+                "src.runner.runSimulation._supports_progress_file",
+                return_value=False,
+            ), patch(
+                "src.runner.runSimulation.subprocess.Popen",
+                return_value=self._FakeProcess(["Simulated 10 events\n"], returncode=0),
+            ) as popen_mock, patch(
+                "src.runner.runSimulation.sys.stderr",
+                new=io.StringIO(),
+            ) as stderr_capture:
+                self.run_simulation(config)
+
+            command = popen_mock.call_args.args[0]
+            self.assertNotIn("-c", command)
+            self.assertIn("(10/10 events)", stderr_capture.getvalue())
+
+    def test_supports_progress_file_probes_help_text(self) -> None:
+        probe = self.supports_progress_file.__wrapped__
+        with patch(
+            "src.runner.runSimulation.subprocess.run",
+            return_value=subprocess.CompletedProcess(
+                [], 0, stdout="-c '/g4emi/run/progressFile <path>'\n", stderr=""
+            ),
+        ) as run_mock:
+            self.assertTrue(probe("pixi run g4emi"))
+        self.assertEqual(run_mock.call_args.args[0], ["pixi", "run", "g4emi", "--help"])
+        with patch(
+            "src.runner.runSimulation.subprocess.run",
+            return_value=subprocess.CompletedProcess([], 1, stdout="", stderr="usage"),
+        ):
+            self.assertFalse(probe("old_g4emi"))
+        with patch(
+            "src.runner.runSimulation.subprocess.run",
+            side_effect=FileNotFoundError("missing"),
+        ):
+            self.assertFalse(probe("missing_g4emi"))
+
     def test_run_suppresses_terminal_progress_when_disabled(self) -> None:
         with tempfile.TemporaryDirectory() as tmp_dir:
             tmp_path = Path(tmp_dir)
@@ -174,7 +314,7 @@ class RunSimulationTests(unittest.TestCase):
 
             with patch("src.runner.runSimulation.subprocess.Popen") as popen_mock:
                 with self.assertRaises(FileNotFoundError):
-                    self.run(config)
+                    self.launch(config)
 
             popen_mock.assert_not_called()
 
@@ -197,7 +337,7 @@ class RunSimulationTests(unittest.TestCase):
                 new=io.StringIO(),
             ):
                 with self.assertRaises(FileNotFoundError):
-                    self.run(config)
+                    self.launch(config)
 
             popen_mock.assert_called_once()
 
@@ -220,7 +360,7 @@ class RunSimulationTests(unittest.TestCase):
                 "src.runner.runSimulation.sys.stderr",
                 new=io.StringIO(),
             ):
-                completed = self.run(config)
+                completed = self.launch(config)
 
             self.assertEqual(completed.returncode, 0)
             popen_mock.assert_called_once()
@@ -2,8 +2,11 @@
 
 from __future__ import annotations
 
+import json
 from pathlib import Path
+import subprocess
 import sys
+import tempfile
 import unittest
 
 import numpy as np
@@ -520,5 +523,107 @@ class TimepixModelTests(unittest.TestCase):
             self.timepix_params_from_sim_config(config)
 
 
+class NativeTimepixEngineTests(unittest.TestCase):
+    """Compare `build/g4emi_timepix` with the Python Timepix stage."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        cls.binary = _repo_root() / "build" / "g4emi_timepix"
+        if not cls.binary.is_file():
+            raise unittest.SkipTest(f"Build {cls.binary} to compare the native Timepix stage.")
+        try:
+            import h5py
+
+            from src.intensifier.io import intensifier_output_batch_to_structured_array
+            from src.intensifier.models import IntensifierOutputBatch
+            from src.sensor.models import TimepixParams
+            from src.sensor.timepix import convert_timepix_events_to_hits
+            from src.sensor.timepix import map_intensifier_output_to_timepix_events
+        except ModuleNotFoundError as exc:
+            raise unittest.SkipTest(f"Missing dependency for Timepix comparison: {exc}.")
+        cls.h5py = h5py
+        cls.to_structured = staticmethod(intensifier_output_batch_to_structured_array)
+        cls.IntensifierOutputBatch = IntensifierOutputBatch
+        cls.TimepixParams = TimepixParams
+        cls.convert = staticmethod(convert_timepix_events_to_hits)
+        cls.map_events = staticmethod(map_intensifier_output_to_timepix_events)
+
+    def _events(self, rng: np.random.Generator) -> object:
+        """Overlapping events on a small sensor so hits merge and go dead."""
+
+        counts = rng.integers(1, 30, size=400)
+        gun_call_id = np.repeat(np.arange(counts.size, dtype=np.int64), counts)
+        n = int(gun_call_id.size)
+        starts = rng.uniform(0.0, 2.0e4, size=counts.size)
+        # Quantized times give ties that only the stable order resolves.
+        time_ns = np.round((starts[gun_call_id] + rng.uniform(0.0, 400.0, size=n)) / 5.0) * 5.0
+        return self.IntensifierOutputBatch(
+            source_photon_index=np.arange(n, dtype=np.int64),
+            gun_call_id=gun_call_id,
+            primary_track_id=rng.integers(0, 5, size=n, dtype=np.int32),
+            secondary_track_id=rng.integers(0, 5, size=n, dtype=np.int32),
+            photon_track_id=np.arange(n, dtype=np.int32),
+            output_x_mm=rng.uniform(-0.3, 0.3, size=n),
+            output_y_mm=rng.uniform(-0.3, 0.3, size=n),
+            output_time_ns=time_ns,
+            signal_amplitude_arb=rng.uniform(0.0, 400.0, size=n),
+            total_gain=np.ones(n),
+            wavelength_nm=np.full(n, 430.0),
+        )
+
+    def test_matches_python_stage_with_and_without_spilling(self) -> None:
+        params = self.TimepixParams(
+            pixels_x=8,
+            pixels_y=8,
+            pixel_pitch_mm=0.055,
+            max_tot_ns=300.0,
+            dead_time_ns=50.0,
+        )
+        events = self._events(np.random.default_rng(7))
+        expected = self.convert(self.map_events(events, params), params)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            input_path = Path(tmpdir) / "intensifier.h5"
+            with self.h5py.File(input_path, "w") as handle:
+                handle.create_dataset(
+                    "intensifier_output_events", data=self.to_structured(events)
+                )
+            for chunk_events in (1 << 22, 500):
+                output_path = Path(tmpdir) / f"timepix_{chunk_events}.h5"
+                completed = subprocess.run(
+                    [
+                        str(self.binary),
+                        "--input", str(input_path),
+                        "-o", str(output_path),
+                        "--pixels-x", "8",
+                        "--pixels-y", "8",
+                        "--pixel-pitch", "0.055",
+                        "--max-tot", "300",
+                        "--dead-time", "50",
+                        "--chunk-events", str(chunk_events),
+                    ],
+                    capture_output=True,
+                    text=True,
+                    check=True,
+                )
+                summary = json.loads(completed.stdout)
+                with self.subTest(chunk_events=chunk_events):
+                    self.assertEqual(summary["spilled_chunks"] > 0, chunk_events == 500)
+                    with self.h5py.File(output_path, "r") as handle:
+                        hits = handle["timepix_hits"][()]
+                    self.assertEqual(len(hits), len(expected))
+                    for field in (
+                        "gun_call_id",
+                        "primary_track_id",
+                        "secondary_track_id",
+                        "x_pixel",
+                        "y_pixel",
+                        "time_of_arrival_ns",
+                        "time_over_threshold_ns",
+                        "contribution_count",
+                    ):
+                        np.testing.assert_array_equal(hits[field], getattr(expected, field))
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,110 @@
+"""Checks for the in-process `g4emi_native` Python module."""
+
+from __future__ import annotations
+
+from pathlib import Path
+import sys
+import tempfile
+import unittest
+
+
+def _repo_root() -> Path:
+    """Resolve repository root by searching parent directories."""
+
+    current = Path(__file__).resolve()
+    for parent in current.parents:
+        if (
+            (parent / "pixi.toml").is_file()
+            and (parent / "sim").is_dir()
+            and (parent / "src").is_dir()
+        ):
+            return parent
+    raise RuntimeError("Could not resolve repository root from test path.")
+
+
+class NativeModuleTests(unittest.TestCase):
+    """Run the bench workload through `build/g4emi_native` and inspect the rows."""
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        build = _repo_root() / "build"
+        if not any(build.glob("g4emi_native*.so")):
+            raise unittest.SkipTest(f"Build g4emi_native into {build} to test the module.")
+        try:
+            import numpy
+        except ModuleNotFoundError as exc:
+            raise unittest.SkipTest(f"Missing dependency for g4emi_native: {exc}.")
+        sys.path.insert(0, str(build))
+        import g4emi_native
+
+        cls.numpy = numpy
+        cls.tmp = tempfile.TemporaryDirectory()
+        output = Path(cls.tmp.name)
+        (output / "bench" / "simulatedPhotons").mkdir(parents=True)
+
+        # Geant4 allows one run manager per process, so the class shares one.
+        cls.sim = g4emi_native.Simulation(backend="serial")
+        cls.sim.command("/output/photonFields transport")
+        macro = _repo_root() / "sim" / "macros" / "neutron_gps_bench.mac"
+        for line in macro.read_text(encoding="utf-8").splitlines():
+            line = line.strip()
+            if not line or line.startswith("#") or line.startswith("/run/beamOn"):
+                continue
+            cls.sim.command(
+                line.replace("{threads}", "1").replace("{outputPath}", str(output))
+            )
+        cls.rows = cls.sim.run(20)
+
+    @classmethod
+    def tearDownClass(cls) -> None:
+        cls.tmp.cleanup()
+
+    def test_run_returns_structured_arrays(self) -> None:
+        """Each table should come back as a structured array over the capture buffer."""
+
+        self.assertEqual(
+            set(self.rows),
+            {"primaries", "secondaries", "photons", "transported_photons"},
+        )
+        for name, array in self.rows.items():
+            with self.subTest(table=name):
+                self.assertIsInstance(array, self.numpy.ndarray)
+                self.assertIsNotNone(array.dtype.names)
+                self.assertFalse(array.flags.owndata)
+        # Primaries that never interact leave no row.
+        self.assertLessEqual(len(self.rows["primaries"]), 20)
+
+    def test_photon_columns_follow_photon_fields(self) -> None:
+        """The `transport` preset should add direction and wavelength to `minimal`."""
+
+        names = self.rows["photons"].dtype.names
+        self.assertIn("optical_interface_hit_x_mm", names)
+        self.assertIn("optical_interface_hit_wavelength_nm", names)
+        self.assertNotIn("photon_origin_x_mm", names)
+
+    def test_primary_counts_match_photon_rows(self) -> None:
+        """Per-primary detected-photon counts should add up to the photon rows."""
+
+        primaries = self.rows["primaries"]
+        self.assertEqual(
+            int(primaries["primary_detected_optical_interface_photon_count"].sum()),
+            len(self.rows["photons"]),
+        )
+
+    def test_runs_capture_independently(self) -> None:
+        """A later run should return new rows and leave earlier arrays intact."""
+
+        before = self.rows["primaries"].copy()
+        again = self.sim.run(5)
+        self.assertLessEqual(len(again["primaries"]), 5)
+        self.numpy.testing.assert_array_equal(self.rows["primaries"], before)
+
+    def test_failing_command_raises(self) -> None:
+        """Unknown UI commands should raise instead of being ignored."""
+
+        with self.assertRaises(RuntimeError):
+            self.sim.command("/g4emi/not_a_command 1")
+
+
+if __name__ == "__main__":
+    unittest.main()